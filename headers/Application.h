@@ -20,6 +20,8 @@ public:
     void Run();
 
 private:
+    static constexpr const char* c_tracePath = "profile.json";
+
     void HandleInput(float diffTime);
 
     GLFWwindow* m_window;
@@ -39,9 +41,12 @@ private:
     bool m_mouseDown = false;
     bool m_rightKeyPressed = false;
     bool m_leftKeyPressed = false;
+    bool m_scheduleKeyPressed = false;
+    bool m_traceKeyPressed = false;
     double m_lastMouseX = 0.f;
     double m_lastMouseY = 0.f;
     float m_cameraMoveSpeed = 2.f;
     float m_cameraRotSpeed = 0.01f;
     int m_currentDebugCascade = -1;
+    int m_cascadeSchedule = 0;
 };
\ No newline at end of file
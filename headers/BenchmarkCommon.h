@@ -0,0 +1,179 @@
+#pragma once
+
+#include "CpuCascades.h"
+#include "DeferredShading.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#ifndef MODELS_DIR
+#define MODELS_DIR "models"
+#endif
+
+struct MeshView;
+
+// Shared by the sections of cascade-benchmark, each of which measures one part and writes its members of the report
+
+struct BenchmarkOptions
+{
+    CascadeResultion Resolution = {8, 8, 8};
+    CascadeExtends Extends = {1.f, 1.f, 1.f};
+    CascadeOffset Offset = {0.f, 1.f, 0.f};
+    uint32_t CascadeCount = 4;
+    CascadeTopology Topology = GetTopology(CascadeTopologyId::Default);
+    uint32_t MaxThreads = 0;
+    uint32_t Iterations = 3;
+    uint32_t ScheduleFrames = 8;
+    // Largest relative error of merged cascade 0 a packed format may have to be picked
+    double ErrorBudget = 0.01;
+    // Fractions of the synthetic G-buffer resolution the deferred gather runs at
+    std::vector<uint32_t> Downscales = {2, 4};
+    std::vector<std::string> Scenes = {"cornell", "teapot", "sphere"};
+    std::vector<std::string> BvhMeshes = {"teapot.obj", "Bunny.obj"};
+    std::string ModelsDir = MODELS_DIR;
+    std::string Output;
+    // Prefix of the Chrome traces of the headless frame loop, one per scene, none when empty
+    std::string Trace;
+};
+
+// Scene of the per scene sections, placed and lit like the instances in Application
+struct BenchmarkScene
+{
+    std::string Name;
+    CpuScene Scene;
+    uint64_t Triangles = 0;
+    // Emitter animated by the schedule and headless sections, c_invalidInstance for static scenes
+    uint32_t MovingInstance = c_invalidInstance;
+    Float3x4 MovingTransform = Float3x4::Identity();
+    // Object space occupancy and transform of every instance, the input of the brick section
+    std::vector<std::pair<const std::vector<Aabb>*, Float3x4>> Occupancy;
+
+    // Moves the emitter to where it is in the frame and returns its bounds before and after, none for static scenes
+    std::vector<Aabb> AnimateEmitter(uint32_t frame);
+    void ResetEmitter();
+};
+
+using BenchmarkClock = std::chrono::high_resolution_clock;
+
+template<typename Function>
+double MeasureSeconds(const Function& function)
+{
+    const auto start = BenchmarkClock::now();
+    function();
+    return std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+}
+
+// The fastest of one call per iteration, what the report gives for everything run more than once
+template<typename Function>
+double MeasureFastest(uint32_t iterations, const Function& function)
+{
+    double ret = INFINITY;
+    for (auto iteration = 0u; iteration < iterations; ++iteration)
+        ret = std::min(ret, MeasureSeconds(function));
+    return ret;
+}
+
+template<typename Function>
+void ForEachTexel(const CpuCascades& cascades, uint32_t cascade, const Function& function)
+{
+    for (auto z = 0u; z < cascades.GetDepth(cascade); ++z)
+    {
+        for (auto y = 0u; y < cascades.GetHeight(cascade); ++y)
+        {
+            for (auto x = 0u; x < cascades.GetWidth(cascade); ++x)
+                function(x, y, z);
+        }
+    }
+}
+
+// Relative L1 difference and largest absolute difference of the channels added
+struct ErrorStats
+{
+    double Difference = 0.0;
+    double Magnitude = 0.0;
+    double Max = 0.0;
+
+    inline void Add(double difference, double magnitude)
+    {
+        Difference += std::abs(difference);
+        Magnitude += std::abs(magnitude);
+        Max = std::max(Max, std::abs(difference));
+    }
+
+    inline double GetRelative() const { return Magnitude > 0.0 ? Difference / Magnitude : 0.0; }
+};
+
+// Relative L1 difference of the merged cascade 0, the only level the drawing reads
+double CompareCascades(const CpuCascades& reference, const CpuCascades& cascades);
+
+// Room of planes and spheres inside the cascade volume seen from its front, ray cast per pixel. The missing
+// ceiling leaves background at the top, the spheres in front of the walls give depth and normal edges.
+GBuffer MakeSyntheticGBuffer(uint32_t width, uint32_t height);
+
+// Indented JSON of the report. Members of objects take a key, elements of arrays none, and objects or arrays begun
+// compact stay on one line with everything inside them. Numbers that are not finite are written as null.
+class JsonWriter
+{
+public:
+    explicit JsonWriter(std::ostream& out) : m_out(out) {}
+
+    void BeginObject(const char* key = nullptr, bool compact = false);
+    void BeginArray(const char* key = nullptr, bool compact = false);
+    void End();
+
+    template<typename T>
+    void Write(const char* key, const T& value)
+    {
+        BeginValue(key);
+        if constexpr (std::is_same_v<T, bool>)
+            m_out << (value ? "true" : "false");
+        else if constexpr (std::is_floating_point_v<T>)
+            WriteNumber(value);
+        else if constexpr (std::is_arithmetic_v<T>)
+            m_out << +value;
+        else
+            WriteString(value);
+    }
+
+    template<typename T>
+    void Write(const T& value)
+    {
+        Write(nullptr, value);
+    }
+
+private:
+    struct Scope
+    {
+        bool Array;
+        bool Compact;
+        uint32_t Count;
+    };
+
+    void Begin(const char* key, bool compact, bool array);
+    void BeginValue(const char* key);
+    void WriteNumber(double value);
+    void WriteString(std::string_view text);
+
+    std::ostream& m_out;
+    std::vector<Scope> m_scopes;
+};
+
+void RunLevels(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json);
+void RunSchedules(const BenchmarkOptions& options, BenchmarkScene& scene, JsonWriter& json);
+void RunBricks(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json);
+void RunFormats(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json);
+void RunIrradiance(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json);
+void RunDeferred(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json);
+void RunHeadless(const BenchmarkOptions& options, BenchmarkScene& scene, JsonWriter& json);
+void RunProfiler(const BenchmarkOptions& options, JsonWriter& json);
+void RunPipelineCache(const BenchmarkOptions& options, JsonWriter& json);
+void RunLayouts(const BenchmarkOptions& options, JsonWriter& json);
+void RunBvh(const BenchmarkOptions& options, const std::string& file, const MeshView& view, JsonWriter& json);
+void RunAllocator(const BenchmarkOptions& options, JsonWriter& json);
+void RunDescriptors(const BenchmarkOptions& options, JsonWriter& json);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CascadeCommon.h"
+#include "CpuBvh.h"
+
+#include <vector>
+
+// Sparse residency of the cascade probes in bricks of GetBrickSize probes. Level 0 keeps the probes the drawing
+// interpolates around the occupied boxes, every level above the probes the merge of a resident brick below
+// interpolates, so every resident probe merges to the same result as the dense cascades. Resident bricks own a slot
+// of their level's atlas, see GetAtlasProbe, and keep it across updates while they stay resident.
+class CascadeBricks
+{
+public:
+    CascadeBricks(const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount);
+
+    // World bounds of geometry, collected until the next Update
+    void Occupy(const Aabb& bounds);
+    // Rebuilds residency from the bounds occupied since the last Update, frees the slots of bricks no longer
+    // resident and hands out slots to the new ones, lowest first
+    void Update();
+
+    // Slot of every brick of every level or c_absentBrick, level after level, see GetBrickIndex
+    inline auto& GetIndirection() const { return m_indirection; }
+    // Bricks of a level that got a slot with the last Update, their probes hold no result yet
+    inline auto& GetAddedBricks(uint32_t cascade) const { return m_levels[cascade].Added; }
+    inline auto GetResidentCount(uint32_t cascade) const { return m_levels[cascade].ResidentCount; }
+    inline auto GetBrickCount(uint32_t cascade) const { return m_levels[cascade].Bricks[0] * m_levels[cascade].Bricks[1] * m_levels[cascade].Bricks[2]; }
+    // Highest slot handed out plus one
+    inline auto GetSlotCount(uint32_t cascade) const { return m_levels[cascade].SlotCount; }
+    // Atlas layers of GetBrickSize z slices holding every slot, at least one
+    uint32_t GetLayerCount(uint32_t cascade) const;
+    inline auto GetCount() const { return m_count; }
+
+    inline uint32_t GetBrickIndex(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const
+    {
+        const auto& level = m_levels[cascade];
+        return level.Offset + (z / level.Size[2] * level.Bricks[1] + y / level.Size[1]) * level.Bricks[0] + x / level.Size[0];
+    }
+    inline bool IsResident(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const { return m_indirection[GetBrickIndex(cascade, x, y, z)] != c_absentBrick; }
+
+    // Object space boxes of the cells of a resolution^3 grid over the mesh bounds that triangle bounds touch, runs
+    // along x merged into one box. Transformed with an instance they are its input to Occupy.
+    static std::vector<Aabb> BuildOccupancy(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, uint32_t resolution = 32);
+
+private:
+    struct Level
+    {
+        std::array<uint32_t, 3> Probes;
+        std::array<uint32_t, 3> Size;
+        std::array<uint32_t, 3> Bricks;
+        uint32_t Offset = 0;
+        // Probes a lookup reads, marked by Occupy and the level below
+        std::vector<uint8_t> Needed;
+        std::vector<uint32_t> FreeSlots;
+        std::vector<uint32_t> Added;
+        uint32_t SlotCount = 0;
+        uint32_t ResidentCount = 0;
+    };
+
+    // Marks the probes of cascade the trilinear lookups between low and high read, positions scaled by the level's probes
+    void MarkLookup(uint32_t cascade, const Float3& low, const Float3& high);
+
+    std::vector<Level> m_levels;
+    std::vector<uint32_t> m_indirection;
+    CascadeResultion m_resolution;
+    CascadeExtends m_extends;
+    CascadeOffset m_offset;
+    uint32_t m_count = 0;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "CascadeTopologies.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+struct CascadeResultion
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t z;
+};
+
+struct CascadeExtends
+{
+    float x;
+    float y;
+    float z;
+};
+
+using CascadeOffset = CascadeExtends;
+
+// Directions and ray intervals of the levels, one entry of CASCADE_TOPOLOGIES for the GPU path and any for the CPU
+// reference. Mirrors GetPixelCount, GetEnd and GetAtlasSize of shaders/Common.hlsl.
+struct CascadeTopology
+{
+    const char* Name;
+    uint32_t PixelsX;
+    uint32_t PixelsY;
+    uint32_t AngularShift;
+    float Interval;
+    float Growth;
+
+    inline std::array<uint32_t, 2> GetPixelCount(uint32_t cascade) const
+    {
+        return {PixelsX << (AngularShift * cascade), PixelsY << (AngularShift * cascade)};
+    }
+
+    // Distance the rays of cascade end at and the rays of cascade + 1 start from, 0 below cascade 0
+    inline float GetEnd(int cascade) const
+    {
+        return (Interval * (1.f - std::pow(Growth, (float)(cascade + 1)))) / (1.f - Growth);
+    }
+
+    // Width and height of the atlas of a level, the same for every level when the directions grow by 2 per axis
+    inline std::array<uint32_t, 2> GetAtlasSize(const CascadeResultion& resolution, uint32_t cascade) const
+    {
+        const auto pixelCount = GetPixelCount(cascade);
+        return {(resolution.x >> cascade) * pixelCount[0], (resolution.y >> cascade) * pixelCount[1]};
+    }
+};
+
+#define CASCADE_TOPOLOGY_ID(name, pixelsX, pixelsY, angularShift, interval, growth) name,
+#define CASCADE_TOPOLOGY_ENTRY(name, pixelsX, pixelsY, angularShift, interval, growth) {#name, pixelsX, pixelsY, angularShift, interval, growth},
+
+enum class CascadeTopologyId : uint32_t
+{
+    CASCADE_TOPOLOGIES(CASCADE_TOPOLOGY_ID)
+};
+
+static constexpr CascadeTopology c_cascadeTopologies[] = {CASCADE_TOPOLOGIES(CASCADE_TOPOLOGY_ENTRY)};
+static constexpr uint32_t c_cascadeTopologyCount = sizeof(c_cascadeTopologies) / sizeof(c_cascadeTopologies[0]);
+
+#undef CASCADE_TOPOLOGY_ID
+#undef CASCADE_TOPOLOGY_ENTRY
+
+inline const CascadeTopology& GetTopology(CascadeTopologyId id) { return c_cascadeTopologies[(uint32_t)id]; }
+
+// nullptr for names not in CASCADE_TOPOLOGIES
+inline const CascadeTopology* FindTopology(const char* name)
+{
+    for (const auto& topology : c_cascadeTopologies)
+    {
+        if (std::strcmp(topology.Name, name) == 0)
+            return &topology;
+    }
+    return nullptr;
+}
+
+// Traced levels store R16_UINT hit ids, c_cascadeMiss for a miss and the instance id + 1 for a hit
+static constexpr uint16_t c_cascadeMiss = 0;
+static constexpr uint32_t c_maxCascadeInstances = 0xffff;
+// Probes per axis of a CascadeBricks brick, clamped to the probes of a level, and the indirection of absent bricks
+static constexpr uint32_t c_cascadeBrickSize = 4;
+static constexpr uint32_t c_absentBrick = ~0u;
+// L2 spherical harmonics per probe of the irradiance volume, 9 rgb coefficients packed coefficient-major into
+// c_irradianceTexels RGBA texels. Texel k of every probe lies in the k-th block of probe count x texels, so
+// hardware bilinear filtering in x and y stays within one texel's probes.
+static constexpr uint32_t c_shCoefficients = 9;
+static constexpr uint32_t c_irradianceTexels = (c_shCoefficients * 3 + 3) / 4;
+
+inline std::array<uint32_t, 3> GetBrickSize(const CascadeResultion& resolution, uint32_t cascade)
+{
+    return {std::min(c_cascadeBrickSize, resolution.x >> cascade), std::min(c_cascadeBrickSize, resolution.y >> cascade), std::min(c_cascadeBrickSize, resolution.z >> cascade)};
+}
+
+// Atlas position of a probe whose brick lives in slot. Slots fill the bricks of a level's x/y plane first, then the
+// next GetBrickSize z slices, so slot n of brick n is the dense layout.
+inline std::array<uint32_t, 3> GetAtlasProbe(const CascadeResultion& resolution, uint32_t cascade, uint32_t slot, uint32_t x, uint32_t y, uint32_t z)
+{
+    const auto brickSize = GetBrickSize(resolution, cascade);
+    const uint32_t bricksX = (resolution.x >> cascade) / brickSize[0];
+    const uint32_t bricksY = (resolution.y >> cascade) / brickSize[1];
+    const uint32_t column = slot % bricksX;
+    const uint32_t row = slot / bricksX % bricksY;
+    const uint32_t layer = slot / (bricksX * bricksY);
+    return {column * brickSize[0] + x % brickSize[0], row * brickSize[1] + y % brickSize[1], layer * brickSize[2] + z % brickSize[2]};
+}
+
+// Arrangement of the directions in a level's atlas, both fill the same width and height. Probe-major gives every
+// probe a GetPixelCount tile of its directions, direction-major gives every direction a tile of the level's probes,
+// so neighboring threads of a dispatch trace parallel rays and the merges read neighboring probes together.
+enum class CascadeLayout : uint32_t
+{
+    ProbeMajor,
+    DirectionMajor,
+};
+
+inline const char* GetLayoutName(CascadeLayout layout) { return layout == CascadeLayout::DirectionMajor ? "direction-major" : "probe-major"; }
+
+// Texel of one direction of the probe at atlasProbe
+inline std::array<uint32_t, 3> GetDirectionTexel(const CascadeTopology& topology, const CascadeResultion& resolution, uint32_t cascade, CascadeLayout layout, const std::array<uint32_t, 3>& atlasProbe, uint32_t directionX, uint32_t directionY)
+{
+    if (layout == CascadeLayout::DirectionMajor)
+        return {directionX * (resolution.x >> cascade) + atlasProbe[0], directionY * (resolution.y >> cascade) + atlasProbe[1], atlasProbe[2]};
+    const auto pixelCount = topology.GetPixelCount(cascade);
+    return {atlasProbe[0] * pixelCount[0] + directionX, atlasProbe[1] * pixelCount[1] + directionY, atlasProbe[2]};
+}
+
+// Dense probe and direction of a dispatch index over the texels of a level, the inverse of GetDirectionTexel for
+// dense bricks. Returns probe x, y, z and direction x, y.
+inline std::array<uint32_t, 5> SplitDispatchIndex(const CascadeTopology& topology, const CascadeResultion& resolution, uint32_t cascade, CascadeLayout layout, uint32_t x, uint32_t y, uint32_t z)
+{
+    const uint32_t probesX = resolution.x >> cascade;
+    const uint32_t probesY = resolution.y >> cascade;
+    if (layout == CascadeLayout::DirectionMajor)
+        return {x % probesX, y % probesY, z, x / probesX, y / probesY};
+    const auto pixelCount = topology.GetPixelCount(cascade);
+    return {x / pixelCount[0], y / pixelCount[1], z, x % pixelCount[0], y % pixelCount[1]};
+}
+
+// Real L2 spherical harmonics basis in a unit direction
+inline std::array<float, c_shCoefficients> GetShBasis(float x, float y, float z)
+{
+    return {
+        0.282095f,
+        0.488603f * y,
+        0.488603f * z,
+        0.488603f * x,
+        1.092548f * x * y,
+        1.092548f * y * z,
+        0.315392f * (3.f * z * z - 1.f),
+        1.092548f * x * z,
+        0.546274f * (x * x - y * y)
+    };
+}
+
+// Clamped cosine convolution of each coefficient's band, projections scaled by it evaluate to irradiance
+inline float GetShCosineLobe(uint32_t coefficient)
+{
+    constexpr float pi = 3.1415926f;
+    return coefficient == 0 ? pi : (coefficient < 4 ? pi * 2.f / 3.f : pi / 4.f);
+}
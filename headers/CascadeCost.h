@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CascadeCommon.h"
+#include "CascadeFormats.h"
+#include "CascadeScheduler.h"
+
+// Cost model of RadianceCascades::Generate with dense bricks, from the texels every pass touches. Tracing writes one
+// hit id per ray, every level is merged each frame reading its hits and each texel of the level above once, and
+// cascade 0 is projected into the irradiance volume.
+struct CascadeCost
+{
+    // Rays per frame averaged over a schedule period, and of its worst frame
+    uint64_t Rays = 0;
+    uint64_t PeakRays = 0;
+    // Bytes per frame of each pass
+    uint64_t TraceBytes = 0;
+    uint64_t MergeBytes = 0;
+    uint64_t ProjectBytes = 0;
+    // Memory of the cascade and hit atlases
+    uint64_t CascadeBytes = 0;
+    uint64_t HitBytes = 0;
+
+    inline uint64_t GetFrameBytes() const { return TraceBytes + MergeBytes + ProjectBytes; }
+};
+
+CascadeCost EstimateCascadeCost(const CascadeTopology& topology, const CascadeResultion& resolution, uint32_t cascadeCount, CascadeFormat format, CascadeScheduler::Mode mode = CascadeScheduler::Mode::Full, uint32_t base = 2);
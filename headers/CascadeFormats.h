@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CpuMath.h"
+
+#include <cstdint>
+
+// Storage of the cascade texels. Alpha is written by the tracing and carried along by the merges, but neither the
+// merges nor the drawing read it, so the 32 bit formats drop it and read back 1 like the GPU does for formats
+// without alpha. Rgb9e5 cannot be a UAV or render target, RadianceCascades only takes the others.
+enum class CascadeFormat
+{
+    Rgba32f,
+    Rgba16f,
+    R11g11b10f,
+    Rgb9e5,
+};
+
+static constexpr CascadeFormat c_cascadeFormats[] = {CascadeFormat::Rgba32f, CascadeFormat::Rgba16f, CascadeFormat::R11g11b10f, CascadeFormat::Rgb9e5};
+
+// 32 bit words of one texel
+inline uint32_t GetFormatWords(CascadeFormat format)
+{
+    switch (format)
+    {
+    case CascadeFormat::Rgba32f:
+        return 4;
+    case CascadeFormat::Rgba16f:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+inline uint32_t GetFormatBytes(CascadeFormat format) { return GetFormatWords(format) * sizeof(uint32_t); }
+const char* GetFormatName(CascadeFormat format);
+
+// Round trip of a texel through the format, rounding like the GPU does on stores
+void EncodeTexel(CascadeFormat format, const Float4& value, uint32_t* words);
+Float4 DecodeTexel(CascadeFormat format, const uint32_t* words);
+
+// Unsigned float of 5 exponent bits and mantissaBits, 6 for the red and green and 5 for the blue of R11G11B10_FLOAT.
+// Negative values and NaN turn to 0, values past the largest finite one saturate to it.
+uint32_t PackUnsignedFloat(float value, uint32_t mantissaBits);
+float UnpackUnsignedFloat(uint32_t value, uint32_t mantissaBits);
+
+// R9G9B9E5_SHAREDEXP, three 9 bit mantissas under the exponent of the largest channel
+uint32_t PackRgb9e5(const Float3& value);
+Float3 UnpackRgb9e5(uint32_t value);
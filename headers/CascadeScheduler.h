@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CascadeCommon.h"
+
+#include <vector>
+
+// Z slice range [Begin, End) of one cascade level updated in a frame, empty when the level is reused as is
+struct CascadeSlices
+{
+    uint32_t Begin = 0;
+    uint32_t End = 0;
+
+    inline bool IsEmpty() const { return Begin >= End; }
+    inline uint32_t GetCount() const { return End > Begin ? End - Begin : 0; }
+};
+
+// Picks the cascade slices re-traced every frame. Skipped slices keep the hits of an earlier frame and are merged
+// from them again, trading latency of moving geometry for rays.
+class CascadeScheduler
+{
+public:
+    enum class Mode
+    {
+        // Every level every frame
+        Full,
+        // Level i every base^i frames, staggered so levels do not all land on the same frame
+        Cadence,
+        // Level i in base^i round robin groups of its slices, one group per frame
+        Slices
+    };
+
+    CascadeScheduler(const CascadeResultion& resolution, uint32_t cascadeCount, const CascadeTopology& topology = ::GetTopology(CascadeTopologyId::Default), Mode mode = Mode::Full, uint32_t base = 2);
+
+    void SetMode(Mode mode, uint32_t base = 2);
+    // Updates everything with the next frame, needed while the cascades hold no result yet
+    void Invalidate();
+
+    // Slices of every level to update in the next frame
+    const std::vector<CascadeSlices>& Advance();
+
+    // Rays of the frame returned by Advance last
+    uint64_t GetFrameRays() const;
+    // Cost model: rays per frame averaged over a whole schedule period, and the worst frame of it
+    uint64_t GetAverageRays() const;
+    uint64_t GetPeakRays() const;
+    // Rays of a frame updating every level
+    uint64_t GetFullRays() const;
+
+    // Frames until a slice of cascade is updated again
+    uint32_t GetPeriod(uint32_t cascade) const;
+    inline auto GetMode() const { return m_mode; }
+    inline auto GetCount() const { return m_count; }
+    inline auto& GetUpdates() const { return m_updates; }
+
+private:
+    void Select(uint64_t frame, std::vector<CascadeSlices>& updates) const;
+    uint64_t GetRays(const std::vector<CascadeSlices>& updates) const;
+
+    std::vector<CascadeSlices> m_updates;
+    std::vector<uint32_t> m_depths;
+    std::vector<uint64_t> m_texelsPerSlice;
+    uint64_t m_frame = 0;
+    Mode m_mode = Mode::Full;
+    uint32_t m_base = 2;
+    uint32_t m_count = 0;
+    bool m_invalid = true;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+// Cascade topologies, included by CascadeCommon.h and shaders/Common.hlsl, so keep it to the preprocessor. Every
+// entry is X(name, directions of level 0 in x, in y, log2 of the direction growth per axis and level, end of the
+// first interval, growth of the interval per level). Probes halve per axis and level in every topology, the bricks,
+// the schedules and the merge interpolation are built on it. The shaders are compiled once per entry with
+// CASCADE_TOPOLOGY set to its index, see shaders.cmake.
+#define CASCADE_TOPOLOGIES(X) \
+    X(Default, 64, 32, 1, 0.03125f, 8.f) \
+    X(Fast, 32, 16, 1, 0.0625f, 4.f) \
+    X(Wide, 16, 8, 2, 0.015625f, 16.f)
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CpuMath.h"
+
+#include <vector>
+
+struct Aabb
+{
+    Float3 Min;
+    Float3 Max;
+};
+
+inline Aabb Union(const Aabb& a, const Aabb& b) { return {Min(a.Min, b.Min), Max(a.Max, b.Max)}; }
+
+// World bounds of the eight transformed corners
+inline Aabb TransformBounds(const Aabb& box, const Float3x4& transform)
+{
+    Aabb ret = {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+    for (auto corner = 0u; corner < 8; ++corner)
+    {
+        const Float3 p = {
+            corner & 1 ? box.Max.x : box.Min.x,
+            corner & 2 ? box.Max.y : box.Min.y,
+            corner & 4 ? box.Max.z : box.Min.z
+        };
+        const auto world = transform.TransformPoint(p);
+        ret = Union(ret, {world, world});
+    }
+    return ret;
+}
+
+inline float HalfArea(const Aabb& box)
+{
+    const auto extent = box.Max - box.Min;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+static constexpr uint32_t c_bvhWidth = 4;
+static constexpr uint32_t c_emptyChild = ~0u;
+
+// Four children with structure-of-arrays bounds. Valid children come first, the rest have Child == c_emptyChild.
+// Count 0 marks an inner child whose Child is a node index, otherwise Child is the first of Count entries in Bvh4::Primitives.
+struct alignas(64) Bvh4Node
+{
+    float MinX[c_bvhWidth];
+    float MinY[c_bvhWidth];
+    float MinZ[c_bvhWidth];
+    float MaxX[c_bvhWidth];
+    float MaxY[c_bvhWidth];
+    float MaxZ[c_bvhWidth];
+    uint32_t Child[c_bvhWidth];
+    uint32_t Count[c_bvhWidth];
+
+    inline Aabb GetBounds(uint32_t slot) const
+    {
+        return {{MinX[slot], MinY[slot], MinZ[slot]}, {MaxX[slot], MaxY[slot], MaxZ[slot]}};
+    }
+
+    inline void SetBounds(uint32_t slot, const Aabb& bounds)
+    {
+        MinX[slot] = bounds.Min.x;
+        MinY[slot] = bounds.Min.y;
+        MinZ[slot] = bounds.Min.z;
+        MaxX[slot] = bounds.Max.x;
+        MaxY[slot] = bounds.Max.y;
+        MaxZ[slot] = bounds.Max.z;
+    }
+};
+
+struct Bvh4
+{
+    // Nodes[0] is the root, children are always stored after their parent
+    std::vector<Bvh4Node> Nodes;
+    std::vector<uint32_t> Primitives;
+    Aabb Bounds;
+};
+
+// Binned SAH build over primitive bounds. Large subtrees are split off and built on threadCount threads (0 = all).
+Bvh4 BuildBvh4(const std::vector<Aabb>& primitives, uint32_t maxLeafSize, uint32_t threadCount = 0);
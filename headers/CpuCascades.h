@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CascadeBricks.h"
+#include "CascadeCommon.h"
+#include "CascadeFormats.h"
+#include "CascadeScheduler.h"
+#include "CpuScene.h"
+#include "ProbeInvalidation.h"
+
+// CPU reference of RadianceCascades::Generate. Cascade i is stored like m_cascades[i]:
+// a (GetWidth(i) x GetHeight(i) x GetDepth(i)) array of GetFormat() texels, probe-major tiles of GetPixelCount(i) directions,
+// next to the hit ids of the same size the tracing writes and the merging resolves. With bricks set only the probes
+// of resident bricks are traced and merged, in place of the atlas slots of the GPU path.
+class CpuCascades
+{
+public:
+    // Any topology, its PixelsX a multiple of c_packetSize
+    CpuCascades(const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount = 5, CascadeFormat format = CascadeFormat::Rgba16f, const CascadeTopology& topology = ::GetTopology(CascadeTopologyId::Default));
+
+    void Generate(const CpuScene& scene, uint32_t threadCount = 0);
+    // Traces only the slices picked by a CascadeScheduler, the others keep their earlier hits
+    void Generate(const CpuScene& scene, const std::vector<CascadeSlices>& updates, uint32_t threadCount = 0);
+    // Also traces the invalidated probes outside those slices
+    void Generate(const CpuScene& scene, const std::vector<CascadeSlices>& updates, const ProbeInvalidation& invalidation, uint32_t threadCount = 0);
+
+    // Single steps of Generate, CascadeTracing.hlsl for one level and CascadeAccumulation.hlsl merging cascade + 1 into cascade
+    void Trace(const CpuScene& scene, uint32_t cascade, uint32_t threadCount = 0);
+    void Trace(const CpuScene& scene, uint32_t cascade, const CascadeSlices& slices, uint32_t threadCount = 0);
+    // Packed probes of a ProbeInvalidation
+    void TraceProbes(const CpuScene& scene, uint32_t cascade, const std::vector<uint32_t>& probes, uint32_t threadCount = 0);
+    // Every level is merged, the highest one against nothing but misses
+    void Merge(const CpuScene& scene, uint32_t cascade, uint32_t threadCount = 0);
+    // CascadeIrradiance.hlsl, cascade 0 projected per probe into the coefficients of GetIrradiance
+    void ProjectIrradiance(uint32_t threadCount = 0);
+
+    // Irradiance at a position normalized to the cascade volume like cascadePos in Drawing.ps.hlsl, from the projected
+    // probes and from the sum over every direction of cascade 0 the projection replaces
+    Float3 SampleIrradiance(const Float3& pos, const Float3& normal) const;
+    Float3 IntegrateIrradiance(const Float3& pos, const Float3& normal) const;
+
+    // Null traces and merges every probe, the bricks have to outlive this
+    inline void SetBricks(const CascadeBricks* bricks) { m_bricks = bricks; }
+    // Drops the merged levels, the hits stay and the next merges store in format
+    void SetFormat(CascadeFormat format);
+
+    Float4 Load(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const;
+
+    // GetFormatWords(GetFormat()) words per texel
+    inline auto& GetCascade(uint32_t cascade) const { return m_cascades[cascade]; }
+    inline auto GetFormat() const { return m_format; }
+    // c_shCoefficients rgb coefficients per probe of cascade 0, x fastest, scaled by GetShCosineLobe
+    inline auto& GetIrradiance() const { return m_irradiance; }
+    inline auto& GetHits(uint32_t cascade) const { return m_hits[cascade]; }
+    inline auto GetCount() const { return m_count; }
+    inline auto GetWidth(uint32_t cascade) const { return m_sizes[cascade][0]; }
+    inline auto GetHeight(uint32_t cascade) const { return m_sizes[cascade][1]; }
+    inline auto GetDepth(uint32_t cascade) const { return m_resolution.z >> cascade; }
+    inline auto& GetResolution() const { return m_resolution; }
+    inline auto& GetTopology() const { return m_topology; }
+
+private:
+    void TraceSpan(const CpuScene& scene, uint32_t cascade, uint32_t xBegin, uint32_t xEnd, uint32_t y, uint32_t z, RayPacket& packet);
+    void Store(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z, const Float4& value);
+    // Trilinear lookup of direction (u, v) around pos in cascade, SampleHigherCascade of CascadeAccumulation.hlsl.
+    // Averages the 1 << angularShift square of directions of cascade around (u, v), one direction for 0.
+    Float4 SampleCascade(uint32_t cascade, float u, float v, const Float3& pos, uint32_t angularShift) const;
+    Float4 SingleSample(uint32_t cascade, float x, float y, float z) const;
+
+    std::vector<std::vector<uint32_t>> m_cascades;
+    std::vector<std::vector<uint16_t>> m_hits;
+    std::vector<float> m_irradiance;
+    const CascadeBricks* m_bricks = nullptr;
+    CascadeResultion m_resolution;
+    CascadeExtends m_extends;
+    CascadeOffset m_offset;
+    CascadeTopology m_topology;
+    // Atlas width and height of every level
+    std::vector<std::array<uint32_t, 2>> m_sizes;
+    CascadeFormat m_format = CascadeFormat::Rgba16f;
+    uint32_t m_count = 0;
+};
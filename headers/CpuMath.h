@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+struct Float3
+{
+    float x;
+    float y;
+    float z;
+
+    inline float& operator[](uint32_t i) { return (&x)[i]; }
+    inline float operator[](uint32_t i) const { return (&x)[i]; }
+};
+
+inline Float3 operator+(const Float3& a, const Float3& b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Float3 operator-(const Float3& a, const Float3& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Float3 operator*(const Float3& a, const Float3& b) { return {a.x * b.x, a.y * b.y, a.z * b.z}; }
+inline Float3 operator*(const Float3& a, float b) { return {a.x * b, a.y * b, a.z * b}; }
+inline Float3 operator/(const Float3& a, const Float3& b) { return {a.x / b.x, a.y / b.y, a.z / b.z}; }
+
+inline float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Float3 Cross(const Float3& a, const Float3& b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+inline Float3 Min(const Float3& a, const Float3& b) { return {std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)}; }
+inline Float3 Max(const Float3& a, const Float3& b) { return {std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)}; }
+
+struct Float4
+{
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+// Row-major 3x4 affine transform, same layout as D3D12_RAYTRACING_INSTANCE_DESC::Transform
+struct Float3x4
+{
+    float m[3][4];
+
+    inline Float3 TransformPoint(const Float3& p) const
+    {
+        return {
+            m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+            m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+            m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]
+        };
+    }
+
+    inline Float3 TransformVector(const Float3& v) const
+    {
+        return {
+            m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+            m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+            m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z
+        };
+    }
+
+    static inline Float3x4 Identity()
+    {
+        return {{{1.f, 0.f, 0.f, 0.f}, {0.f, 1.f, 0.f, 0.f}, {0.f, 0.f, 1.f, 0.f}}};
+    }
+
+    inline Float3x4 Inverse() const
+    {
+        const Float3 c0 = {m[0][0], m[1][0], m[2][0]};
+        const Float3 c1 = {m[0][1], m[1][1], m[2][1]};
+        const Float3 c2 = {m[0][2], m[1][2], m[2][2]};
+        const Float3 r0 = Cross(c1, c2);
+        const Float3 r1 = Cross(c2, c0);
+        const Float3 r2 = Cross(c0, c1);
+        const float invDet = 1.f / Dot(c0, r0);
+
+        Float3x4 ret;
+        for (auto i = 0u; i < 3; ++i)
+        {
+            ret.m[0][i] = r0[i] * invDet;
+            ret.m[1][i] = r1[i] * invDet;
+            ret.m[2][i] = r2[i] * invDet;
+        }
+        const Float3 t = {m[0][3], m[1][3], m[2][3]};
+        const auto invT = ret.TransformVector(t);
+        ret.m[0][3] = -invT.x;
+        ret.m[1][3] = -invT.y;
+        ret.m[2][3] = -invT.z;
+        return ret;
+    }
+};
+
+// Mirrors fromSpherical in shaders/Common.hlsl
+inline Float3 FromSpherical(float u, float v)
+{
+    constexpr float pi = 3.1415926f;
+    const float sx = u * 2.f - 1.f;
+    const float sy = v;
+    return {
+        std::sin(sy * pi) * std::cos(sx * pi),
+        std::cos(sy * pi),
+        std::sin(sy * pi) * std::sin(sx * pi)
+    };
+}
+
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t absBits = bits & 0x7FFFFFFFu;
+
+    if (absBits >= 0x7F800000u)
+        return (uint16_t)(sign | 0x7C00u | (absBits > 0x7F800000u ? 0x200u : 0u));
+    if (absBits >= 0x477FF000u)
+        return (uint16_t)(sign | 0x7C00u);
+    if (absBits < 0x38800000u)
+    {
+        if (absBits < 0x33000000u)
+            return (uint16_t)sign;
+        const uint32_t mantissa = (absBits & 0x007FFFFFu) | 0x00800000u;
+        const uint32_t shift = 126u - (absBits >> 23);
+        const uint32_t rounded = (mantissa + (1u << (shift - 1)) - 1u + ((mantissa >> shift) & 1u)) >> shift;
+        return (uint16_t)(sign | rounded);
+    }
+
+    const uint32_t rebased = absBits - 0x38000000u;
+    return (uint16_t)(sign | ((rebased + 0x0FFFu + ((rebased >> 13) & 1u)) >> 13));
+}
+
+inline float HalfToFloat(uint16_t value)
+{
+    const uint32_t sign = (uint32_t)(value & 0x8000u) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1Fu;
+    uint32_t mantissa = value & 0x3FFu;
+
+    uint32_t bits;
+    if (exponent == 0x1Fu)
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    else if (mantissa == 0)
+        bits = sign;
+    else
+    {
+        uint32_t e = 113u;
+        while ((mantissa & 0x400u) == 0)
+        {
+            mantissa <<= 1;
+            --e;
+        }
+        bits = sign | (e << 23) | ((mantissa & 0x3FFu) << 13);
+    }
+
+    float ret;
+    std::memcpy(&ret, &bits, sizeof(ret));
+    return ret;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CpuBvh.h"
+
+#include <vector>
+
+static constexpr uint32_t c_packetSize = 8;
+static constexpr uint32_t c_invalidInstance = ~0u;
+
+// Structure-of-arrays group of rays traced together through the SIMD path
+struct alignas(32) RayPacket
+{
+    float OriginX[c_packetSize];
+    float OriginY[c_packetSize];
+    float OriginZ[c_packetSize];
+    float DirX[c_packetSize];
+    float DirY[c_packetSize];
+    float DirZ[c_packetSize];
+    float TMin[c_packetSize];
+    float TMax[c_packetSize];
+    uint32_t Instance[c_packetSize];
+    uint32_t Active;
+};
+
+// Name of the SIMD backend the tracer was compiled with, "avx2", "neon" or "scalar"
+const char* GetSimdBackendName();
+
+// Counterpart of a BLAS: a 4-wide SAH BVH over the triangles of one mesh, built on threadCount threads (0 = all)
+class CpuMesh
+{
+public:
+    CpuMesh(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, uint32_t threadCount = 0);
+
+    // Packet is expected in object space, closer hits shrink TMax and record instanceId
+    void Intersect(RayPacket& packet, uint32_t instanceId) const;
+
+    inline auto& GetBoundsMin() const { return m_bounds.Min; }
+    inline auto& GetBoundsMax() const { return m_bounds.Max; }
+    inline auto GetTriangleCount() const { return (uint32_t)m_triangles.size(); }
+    inline auto GetNodeCount() const { return (uint32_t)m_nodes.size(); }
+    inline uint64_t GetMemorySize() const { return m_nodes.size() * sizeof(Bvh4Node) + m_triangles.size() * sizeof(Triangle); }
+
+private:
+    struct Triangle
+    {
+        Float3 V0;
+        Float3 E1;
+        Float3 E2;
+    };
+
+    std::vector<Bvh4Node> m_nodes;
+    std::vector<Triangle> m_triangles;
+    Aabb m_bounds;
+};
+
+// Counterpart of the TLAS: a 4-wide BVH over the instance bounds. Adding instances rebuilds it, moving them
+// refits the path from the instance up to the root.
+class CpuScene
+{
+public:
+    uint32_t AddInstance(const CpuMesh& mesh, const Float3x4& transform, const Float3& emission);
+
+    void SetInstanceTransform(uint32_t instanceId, const Float3x4& transform);
+    // Restores the build quality after many refits
+    void RebuildTopLevel();
+    void SetInstanceEmission(uint32_t instanceId, const Float3& emission);
+
+    // Finds the closest hit for every active lane, world space
+    void Trace(RayPacket& packet) const;
+
+    inline auto GetInstanceCount() const { return (uint32_t)m_instances.size(); }
+    inline auto GetTopLevelNodeCount() const { return (uint32_t)m_topLevel.Nodes.size(); }
+    inline auto& GetInstanceEmission(uint32_t instanceId) const { return m_instances[instanceId].Emission; }
+    inline auto& GetInstanceBounds(uint32_t instanceId) const { return m_instances[instanceId].Bounds; }
+
+private:
+    struct Instance
+    {
+        const CpuMesh* Mesh;
+        Float3x4 Transform;
+        Float3x4 InverseTransform;
+        Float3 Emission;
+        Aabb Bounds;
+    };
+
+    struct Slot
+    {
+        uint32_t Node;
+        uint32_t Index;
+    };
+
+    void Refit(uint32_t instanceId);
+
+    std::vector<Instance> m_instances;
+    Bvh4 m_topLevel;
+    // Parent slot of every top level node and the leaf slot of every instance
+    std::vector<Slot> m_nodeParents;
+    std::vector<Slot> m_instanceSlots;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CpuMath.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Deferred mode of the Renderer: the G-buffer is drawn at full resolution, the cascades are gathered at one pixel of
+// every downscale x downscale block and the result is upsampled with bilinear weights that drop taps across depth
+// and normal edges. Pixels left without a usable tap gather on their own. Mirrored by Common.hlsl.
+static constexpr float c_upsampleNormalPower = 16.f;
+// Depth difference, relative to the depth of the pixel, at which a tap's weight dropped to 1/e
+static constexpr float c_upsampleDepthScale = 0.05f;
+// Sum of the weights below which a pixel gathers on its own
+static constexpr float c_upsampleMinWeight = 0.05f;
+
+// What GBuffer.ps.hlsl writes. Depth is the linear view depth, 0 where nothing was drawn. Positions are normalized to
+// the cascade volume like cascadePos in Drawing.ps.hlsl, the GPU reconstructs them from the depth buffer.
+struct GBuffer
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<Float3> Positions;
+    std::vector<Float3> Normals;
+    std::vector<float> Depths;
+    std::vector<Float3> Albedo;
+    std::vector<Float3> Emission;
+
+    inline uint32_t GetIndex(uint32_t x, uint32_t y) const { return y * Width + x; }
+};
+
+// Irradiance at a position and normal of the G-buffer, e.g. CpuCascades::SampleIrradiance
+using IrradianceGather = std::function<Float3(const Float3& position, const Float3& normal)>;
+
+struct DeferredStats
+{
+    uint32_t Gathers = 0;
+    // Pixels of the upsample that gathered on their own
+    uint32_t Regathers = 0;
+};
+
+inline uint32_t GetGatherSize(uint32_t size, uint32_t downscale) { return (size + downscale - 1) / downscale; }
+// Pixel of the G-buffer a gathered pixel samples, the center of its block
+inline uint32_t GetGatherSource(uint32_t gathered, uint32_t downscale, uint32_t size) { return std::min(gathered * downscale + downscale / 2, size - 1); }
+
+// Weight of a gathered tap for a pixel on top of the bilinear one, 0 for taps on the background
+float GetUpsampleWeight(const Float3& normal, float depth, const Float3& tapNormal, float tapDepth);
+
+// GetGatherSize of the G-buffer, 0 on the background
+std::vector<Float3> GatherIrradiance(const GBuffer& gbuffer, uint32_t downscale, const IrradianceGather& gather, DeferredStats& stats);
+// Bilinear upsample of gathered to the G-buffer, weighted by GetUpsampleWeight when bilateral
+std::vector<Float3> UpsampleIrradiance(const GBuffer& gbuffer, uint32_t downscale, const std::vector<Float3>& gathered, const IrradianceGather& gather, bool bilateral, DeferredStats& stats);
+// Albedo times irradiance plus emission like Drawing.ps.hlsl, 0 on the background
+std::vector<Float3> Composite(const GBuffer& gbuffer, const std::vector<Float3>& irradiance);
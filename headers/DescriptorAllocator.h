@@ -0,0 +1,52 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+#include "UploadRing.h"
+
+#include <deque>
+
+// Index bookkeeping of a descriptor heap split into a persistent part and a transient ring. Persistent ranges
+// are reused through the free lists of a TlsfAllocator once their release completed on the device, transient
+// tables are bumped out of an UploadRing and retire with the submission they were recorded for.
+class DescriptorAllocator
+{
+public:
+    static constexpr uint32_t c_invalidIndex = ~0u;
+
+    // The last transientCapacity descriptors of the heap form the ring
+    DescriptorAllocator(uint32_t capacity, uint32_t transientCapacity);
+
+    // First index of count contiguous descriptors, c_invalidIndex when the persistent part is exhausted
+    uint32_t Allocate(uint32_t count = 1);
+    // The range may still be used by commands recorded for the next submission
+    void Release(uint32_t index);
+
+    // Valid for the commands recorded until the next Submit, c_invalidIndex until older submissions retire
+    uint32_t AllocateTransient(uint32_t count);
+
+    // Tags releases and transient tables since the previous call with submission
+    void Submit(uint64_t submission);
+    void Retire(uint64_t completedSubmission);
+
+    inline auto GetOldestTransientSubmission() const { return m_transient.GetOldestSubmission(); }
+    inline auto GetPersistentCapacity() const { return m_persistentCapacity; }
+    inline auto GetPersistentUsed() const { return (uint32_t)m_persistent.GetUsedBytes(); }
+    inline auto GetTransientUsed() const { return (uint32_t)m_transient.GetUsed(); }
+    inline auto GetPendingCount() const { return (uint32_t)(m_released.size() + m_pending.size()); }
+    inline auto GetStats() const { return m_persistent.GetStats(); }
+
+private:
+    struct PendingRelease
+    {
+        uint32_t Index;
+        uint64_t Submission;
+    };
+
+    TlsfAllocator m_persistent;
+    UploadRing m_transient;
+    // Block of every allocated persistent index, needed to free it by index
+    std::vector<uint32_t> m_blocks;
+    std::vector<uint32_t> m_released;
+    std::deque<PendingRelease> m_pending;
+    uint32_t m_persistentCapacity = 0;
+};
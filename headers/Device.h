@@ -1,6 +1,13 @@
 #pragma once
 
 #include "Shared.h"
+#include "CascadeCommon.h"
+#include "DescriptorAllocator.h"
+#include "FrameDevice.h"
+#include "GpuAllocator.h"
+#include "PipelineCache.h"
+#include "RenderGraph.h"
+#include "UploadRing.h"
 
 /*
 struct DescriptorHandle
@@ -20,6 +27,7 @@ struct VertexBuffer
 {
     ComPtr<ID3D12Resource> Resource;
     D3D12_VERTEX_BUFFER_VIEW View;
+    DXGI_FORMAT Format = DXGI_FORMAT_R32G32B32_FLOAT;
 };
 
 struct IndexBuffer
@@ -34,6 +42,9 @@ struct Pipeline
     ComPtr<ID3D12PipelineState> State;
 };
 
+// Albedo, emission and octahedral normals written by GBuffer.ps.hlsl
+static constexpr DXGI_FORMAT c_gbufferFormats[] = {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DXGI_FORMAT_R11G11B10_FLOAT, DXGI_FORMAT_R16G16_SNORM};
+
 struct State
 {
     ComPtr<ID3D12RootSignature> RootSignature;
@@ -54,31 +65,58 @@ public:
     ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t size = 65536);
     ComPtr<ID3D12Resource> CreateTexture(DXGI_FORMAT format, uint16_t width, uint16_t height, uint16_t arraySize, D3D12_RESOURCE_STATES defaultState = D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
     ComPtr<ID3D12Resource> CreateBuffer(uint64_t size, D3D12_RESOURCE_STATES defaultState = D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAGS = D3D12_RESOURCE_FLAG_NONE, bool staging = false);
-    VertexBuffer CreateVertexBuffer(const std::vector<float>& data);
-    IndexBuffer CreateIndexBuffer(const std::vector<uint32_t>& data);
 
-    ComPtr<ID3D12Resource> CreateBottomLevelAccelerationStructure(const VertexBuffer& vertices, const IndexBuffer& indices, uint32_t vertexCount, uint32_t indexCount);
-    ComPtr<ID3D12Resource> CreateTopLevelAccelerationStructure(const ComPtr<ID3D12GraphicsCommandList>& commandList, const ComPtr<ID3D12Resource>& instanceBuffer, uint32_t count);
+    inline auto& GetAllocator() const { return *m_allocator; }
+    inline auto& GetDescriptorAllocator() const { return m_srvDescriptors; }
+
+    uint64_t GetTopLevelAccelerationStructureSize(const ComPtr<ID3D12Resource>& instanceBuffer, uint32_t count);
+    // Full build into dest, or a refit of source into dest when source is set (may be dest itself)
+    void BuildTopLevelAccelerationStructure(const ComPtr<ID3D12GraphicsCommandList>& commandList, const ComPtr<ID3D12Resource>& instanceBuffer, uint32_t count, const ComPtr<ID3D12Resource>& dest, const ComPtr<ID3D12Resource>& source = nullptr);
 
+    // Recycles the allocator and list of a completed submission when there is one
     Commands CreateGraphicsCommands();
+    // Reopens commands whose previous submission completed, for callers keeping their own
+    void ResetCommands(Commands& commands);
+    // Commands are recycled by the device once the submission completed
     uint64_t SubmitGraphicsCommands(Commands&& commands);
+    // The list and its allocator stay with the caller
+    uint64_t SubmitCommandList(const ComPtr<ID3D12GraphicsCommandList>& commandList);
+    // Tags the constants, transient descriptors and descriptor releases of the frame recorded since the last call with
+    // the submission of its commands. Submissions made while recording it, e.g. by UploadContext::Flush, leave them untagged.
+    void SubmitFrame(uint64_t submission);
 
     D3D12_CPU_DESCRIPTOR_HANDLE CreateRenderTargetView(const ComPtr<ID3D12Resource>& resource, DXGI_FORMAT format);
     D3D12_CPU_DESCRIPTOR_HANDLE CreateDepthStencilView(const ComPtr<ID3D12Resource>& resource, DXGI_FORMAT format);
-    D3D12_GPU_DESCRIPTOR_HANDLE CreateShaderResourceView(const ComPtr<ID3D12Resource> resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc, D3D12_GPU_DESCRIPTOR_HANDLE oldHandle = {});
+    D3D12_GPU_DESCRIPTOR_HANDLE CreateShaderResourceView(const ComPtr<ID3D12Resource> resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc);
+    // Only valid for the commands of the frame being recorded, the descriptor is recycled once they completed
+    D3D12_GPU_DESCRIPTOR_HANDLE CreateTransientShaderResourceView(const ComPtr<ID3D12Resource> resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc);
     D3D12_GPU_DESCRIPTOR_HANDLE CreateUnorderedAccessView(const ComPtr<ID3D12Resource>& resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc);
     D3D12_GPU_DESCRIPTOR_HANDLE CreateUnorderedAccessViews(const ComPtr<ID3D12Resource>* resources, uint32_t count, const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc);
     D3D12_CPU_DESCRIPTOR_HANDLE CreateSampler(const D3D12_SAMPLER_DESC& desc);
-
-    Pipeline CreateDrawingPipeline();
-    State CreateCascadeTracingPipeline();
-    Pipeline CreateCascadeAccumulationPipeline();
-    Pipeline CreateCascadeDebugPipeline();
+    // Frees a view created by the methods above after the commands of the frame being recorded completed
+    void ReleaseDescriptor(D3D12_GPU_DESCRIPTOR_HANDLE handle);
+
+    // The G-buffer variant writes c_gbufferFormats for the deferred passes instead of shading
+    Pipeline CreateDrawingPipeline(DXGI_FORMAT positionFormat = DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT normalFormat = DXGI_FORMAT_R32G32B32_FLOAT, bool gbuffer = false);
+    // Permutations of the shaders compiled for topology
+    State CreateCascadeTracingPipeline(CascadeTopologyId topology);
+    Pipeline CreateCascadeAccumulationPipeline(CascadeTopologyId topology);
+    Pipeline CreateCascadeIrradiancePipeline(CascadeTopologyId topology);
+    Pipeline CreateCascadeDebugPipeline(CascadeTopologyId topology);
+    Pipeline CreateDeferredGatherPipeline();
+    Pipeline CreateDeferredCompositePipeline();
+
+    // Pipeline states are created through a cache loaded from c_pipelineCachePath and saved back by the destructor,
+    // the ray tracing state object has no blob to keep and is always built from scratch
+    inline auto& GetPipelineCache() const { return m_pipelineCache; }
+    // Spent creating pipeline states so far, cached or not
+    inline auto GetPipelineSeconds() const { return m_pipelineSeconds; }
 
     void SetDescriptorHeaps(const ComPtr<ID3D12GraphicsCommandList>& commandList);
 
     void Finish();
     void WaitIdle();
+    void WaitForSubmission(uint64_t submission);
 
     inline uint64_t GetCompletedSubmission() const { return m_submissionFence->GetCompletedValue(); }
 
@@ -87,6 +125,17 @@ public:
 
     static void PipelineBarrierUav(const ComPtr<ID3D12GraphicsCommandList>& commandList, const ComPtr<ID3D12Resource>& resource);
     static void PipelineBarrierTransition(const ComPtr<ID3D12GraphicsCommandList>& commandList, const ComPtr<ID3D12Resource>& resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after, uint32_t subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+    // Records a batch compiled by the graph with a single ResourceBarrier call
+    static void PipelineBarriers(const ComPtr<ID3D12GraphicsCommandList>& commandList, const RenderGraph& graph, const std::vector<GraphBarrier>& barriers);
+
+    // Copies data into this frame's slice of the persistently mapped constant ring, valid for the commands of the frame
+    template<typename T>
+    D3D12_GPU_VIRTUAL_ADDRESS UploadConstants(const T& data)
+    {
+        return UploadData(&data, sizeof(T));
+    }
+    // Same ring for small per-frame buffers read through root shader resource views
+    D3D12_GPU_VIRTUAL_ADDRESS UploadData(const void* data, uint64_t size);
 
     template<typename T>
     static void SetResourceData(const ComPtr<ID3D12Resource>& resource, const T& data, uint64_t count = 1)
@@ -95,30 +144,47 @@ public:
     }
 
 private:
+    static constexpr uint32_t c_srvDescriptorCount = 65536;
+    static constexpr uint32_t c_transientDescriptorCount = 4096;
+    static constexpr uint64_t c_constantRingSize = 1ull << 20;
+
+    static constexpr const char* c_pipelineCachePath = "pipelines.cache";
+
     static void SetResourceDataInternal(const ComPtr<ID3D12Resource>& resource, const void* data, uint64_t size);
+    // Keyed by the state of the stream and rootSignature, the blob the root signature was created from
+    ComPtr<ID3D12PipelineState> CreatePipelineState(const void* stream, uint64_t size, const ComPtr<ID3DBlob>& rootSignature);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetSrvCpuHandle(uint32_t index) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetSrvGpuHandle(uint32_t index) const;
 
     ComPtr<ID3D12Device> m_device;
     ComPtr<ID3D12CommandQueue> m_queue;
     ComPtr<ID3D12Fence> m_submissionFence;
+    // Declared ahead of every resource the device owns, placed resources return their range on release
+    std::unique_ptr<GpuAllocator> m_allocator;
     ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
     ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
     ComPtr<ID3D12DescriptorHeap> m_srvHeap;
     ComPtr<ID3D12DescriptorHeap> m_samplerHeap;
     uint32_t m_rtvPos = 0;
     uint32_t m_dsvPos = 0;
-    uint32_t m_srvPos = 0;
+    DescriptorAllocator m_srvDescriptors;
     uint32_t m_samplerPos = 0;
 
     HANDLE m_submissionEvent;
 
+    UploadRing m_constantRing;
+    ComPtr<ID3D12Resource> m_constantBuffer;
+    uint8_t* m_constantPtr = nullptr;
+
     struct PendingCommands
     {
-        ComPtr<ID3D12CommandAllocator> Allocator;
+        Commands Recorded;
         uint64_t Submission;
     };
 
     std::deque<PendingCommands> m_pendingCommands;
-    std::vector<ComPtr<ID3D12CommandAllocator>> m_freeAllocators;
+    std::vector<Commands> m_freeCommands;
     uint64_t m_submissionCounter = 0;
 
     ComPtr<ID3D12Resource> m_tlasScratch;
@@ -126,5 +192,30 @@ private:
 
     D3D12_STATIC_SAMPLER_DESC m_linearSampler;
 
+    PipelineCache m_pipelineCache;
+    double m_pipelineSeconds = 0.0;
+
     //D3D12_CPU_DESCRIPTOR_HANDLE m_linearSampler;
+};
+
+// FrameDevice of a Device, recording into the command list of the frame context being recorded
+class D3D12FrameDevice : public FrameDevice
+{
+public:
+    explicit D3D12FrameDevice(Device& device) : m_device(device) {}
+
+    // Taken by everything recorded until the next Submit
+    inline void SetCommandList(const ComPtr<ID3D12GraphicsCommandList>& commandList) { m_commandList = commandList; }
+
+    void RecordBarriers(const RenderGraph& graph, const std::vector<GraphBarrier>& barriers) override;
+    // Natives are ID3D12Resource buffers
+    void CopyBuffer(void* dest, uint64_t destOffset, void* source, uint64_t sourceOffset, uint64_t size) override;
+
+    uint64_t Submit() override;
+    inline uint64_t GetCompletedSubmission() const override { return m_device.GetCompletedSubmission(); }
+    inline void WaitForSubmission(uint64_t submission) override { m_device.WaitForSubmission(submission); }
+
+private:
+    Device& m_device;
+    ComPtr<ID3D12GraphicsCommandList> m_commandList;
 };
\ No newline at end of file
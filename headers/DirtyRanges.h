@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Half-open element range [Begin, End)
+struct DirtyRange
+{
+    uint32_t Begin;
+    uint32_t End;
+};
+
+// Elements and ranges returned by the last Collect, plus the elements of every Collect so far
+struct DirtyRangeStats
+{
+    uint32_t Elements = 0;
+    uint32_t Ranges = 0;
+    uint64_t TotalElements = 0;
+};
+
+// Tracks modified elements of an array and coalesces them into copy ranges. Ranges separated by at most
+// mergeGap clean elements are joined, once more than fullCopyFraction of the used elements are dirty a
+// single range over all of them is returned instead.
+class DirtyRanges
+{
+public:
+    DirtyRanges(uint32_t capacity, uint32_t mergeGap = 4, float fullCopyFraction = 0.5f);
+
+    void Mark(uint32_t index);
+    void MarkAll();
+
+    // Ranges covering every element marked since the last Collect, restricted to [0, usedCount), clears the marks
+    std::vector<DirtyRange> Collect(uint32_t usedCount);
+
+    inline bool IsDirty() const { return m_allDirty || !m_dirty.empty(); }
+    inline auto GetCapacity() const { return m_capacity; }
+    inline auto& GetStats() const { return m_stats; }
+
+private:
+    std::vector<uint64_t> m_marks;
+    std::vector<uint32_t> m_dirty;
+    uint32_t m_capacity = 0;
+    uint32_t m_mergeGap = 0;
+    float m_fullCopyFraction = 0.f;
+    bool m_allDirty = false;
+    DirtyRangeStats m_stats;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Pool of sized GPU objects that are handed out again once the last submission using them completed.
+// Items are released untagged and tagged by Submit, the same way UploadRing tags its allocations.
+template<typename T>
+class FencedPool
+{
+public:
+    // Smallest released item of at least size whose submission completed, false if there is none
+    bool Acquire(uint64_t size, uint64_t completedSubmission, T& item, uint64_t& itemSize)
+    {
+        auto best = m_entries.size();
+        for (auto i = 0u; i < m_entries.size(); ++i)
+        {
+            const auto& entry = m_entries[i];
+            if (!entry.Submitted || entry.Submission > completedSubmission || entry.Size < size)
+                continue;
+            if (best == m_entries.size() || entry.Size < m_entries[best].Size)
+                best = i;
+        }
+
+        if (best == m_entries.size())
+            return false;
+
+        item = std::move(m_entries[best].Item);
+        itemSize = m_entries[best].Size;
+        m_entries.erase(m_entries.begin() + best);
+        return true;
+    }
+
+    // Item may still be used by the commands recorded for the next submission
+    void Release(T item, uint64_t size)
+    {
+        m_entries.push_back({std::move(item), size, 0, false});
+    }
+
+    void Submit(uint64_t submission)
+    {
+        for (auto& entry : m_entries)
+        {
+            if (!entry.Submitted)
+            {
+                entry.Submission = submission;
+                entry.Submitted = true;
+            }
+        }
+    }
+
+    // Drops completed items smaller than size, they cannot serve requests of that size any more
+    void Trim(uint64_t size, uint64_t completedSubmission)
+    {
+        for (auto i = 0u; i < m_entries.size();)
+        {
+            const auto& entry = m_entries[i];
+            if (entry.Submitted && entry.Submission <= completedSubmission && entry.Size < size)
+                m_entries.erase(m_entries.begin() + i);
+            else
+                ++i;
+        }
+    }
+
+    inline auto GetCount() const { return (uint32_t)m_entries.size(); }
+
+private:
+    struct Entry
+    {
+        T Item;
+        uint64_t Size;
+        uint64_t Submission;
+        bool Submitted;
+    };
+
+    std::vector<Entry> m_entries;
+};
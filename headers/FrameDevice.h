@@ -0,0 +1,23 @@
+#pragma once
+
+#include "RenderGraph.h"
+
+#include <cstdint>
+#include <vector>
+
+// Queue side of a frame: the barriers of its graph, buffer copies and the submissions frame contexts wait on.
+// Resources are the natives imported into the graph. What the passes record stays with the backend, Renderer
+// records D3D12 commands and HeadlessRenderer runs the CPU cascades.
+class FrameDevice
+{
+public:
+    virtual ~FrameDevice() = default;
+
+    virtual void RecordBarriers(const RenderGraph& graph, const std::vector<GraphBarrier>& barriers) = 0;
+    virtual void CopyBuffer(void* dest, uint64_t destOffset, void* source, uint64_t sourceOffset, uint64_t size) = 0;
+
+    // Submits everything recorded since the last call, submissions count up from 1
+    virtual uint64_t Submit() = 0;
+    virtual uint64_t GetCompletedSubmission() const = 0;
+    virtual void WaitForSubmission(uint64_t submission) = 0;
+};
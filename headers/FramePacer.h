@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Round robin over framesInFlight frame contexts. A context is recorded again only after the submission of
+// its previous use completed, so the CPU blocks only once it is framesInFlight frames ahead of the device.
+class FramePacer
+{
+public:
+    explicit FramePacer(uint32_t framesInFlight)
+        : m_submissions(framesInFlight, 0)
+    {
+        assert(framesInFlight > 0);
+    }
+
+    // Context of the next frame. Returns the submission to wait for before reusing it, 0 if it is already free.
+    uint64_t Begin(uint64_t completedSubmission)
+    {
+        assert(!m_recording);
+        m_recording = true;
+
+        const auto submission = m_submissions[m_current];
+        if (submission <= completedSubmission)
+            return 0;
+
+        ++m_waitCount;
+        return submission;
+    }
+
+    void End(uint64_t submission)
+    {
+        assert(m_recording && submission >= m_submissions[m_current]);
+        m_recording = false;
+        m_submissions[m_current] = submission;
+        m_current = (m_current + 1) % (uint32_t)m_submissions.size();
+        ++m_frame;
+    }
+
+    // Submission every context is done with, waiting on it drains the pipeline
+    inline uint64_t GetLastSubmission() const { return m_submissions[(m_current + m_submissions.size() - 1) % m_submissions.size()]; }
+    inline auto GetCurrent() const { return m_current; }
+    inline auto GetFrame() const { return m_frame; }
+    inline auto GetFramesInFlight() const { return (uint32_t)m_submissions.size(); }
+    inline auto GetWaitCount() const { return m_waitCount; }
+
+private:
+    std::vector<uint64_t> m_submissions;
+    uint32_t m_current = 0;
+    uint64_t m_frame = 0;
+    uint64_t m_waitCount = 0;
+    bool m_recording = false;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Shared.h"
+#include "TlsfAllocator.h"
+
+// Places resources into large ID3D12Heap blocks suballocated by a TlsfAllocator each, instead of one
+// committed resource per call. The range goes back to its block when the resource is released.
+class GpuAllocator
+{
+public:
+    static constexpr uint64_t c_blockSize = 64ull << 20;
+    // Larger resources would waste most of a block and stay committed
+    static constexpr uint64_t c_maxPlacedSize = c_blockSize / 2;
+
+    // Resource heap tier 1 keeps buffers, textures and render targets in separate heaps
+    enum class Pool
+    {
+        Buffers,
+        UploadBuffers,
+        Textures,
+        RenderTargets,
+        Count
+    };
+
+    explicit GpuAllocator(const ComPtr<ID3D12Device>& device);
+    ~GpuAllocator();
+
+    ComPtr<ID3D12Resource> Create(const D3D12_RESOURCE_DESC& desc, Pool pool, D3D12_RESOURCE_STATES state);
+
+    // Summed over the blocks of every pool
+    TlsfStats GetStats() const;
+    uint32_t GetBlockCount() const;
+    inline auto GetCommittedCount() const { return m_committedCount; }
+
+private:
+    class Releaser;
+
+    struct HeapBlock
+    {
+        ComPtr<ID3D12Heap> Heap;
+        TlsfAllocator Allocator;
+    };
+
+    void Free(Pool pool, HeapBlock* block, const TlsfAllocation& allocation);
+
+    ComPtr<ID3D12Device> m_device;
+    std::array<std::vector<std::unique_ptr<HeapBlock>>, (size_t)Pool::Count> m_pools;
+    uint32_t m_committedCount = 0;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Shared.h"
+#include "Profiler.h"
+
+class Device;
+
+// Timestamp queries around the GPU work of a frame, resolved per frame context and handed to a Profiler once that
+// context is recorded again. Its previous submission completed by then, reading the timestamps never waits on the
+// device. They are converted to the profiler clock through the clock calibration of the queue.
+class GpuProfiler
+{
+public:
+    // Scopes per frame, the rest of a frame goes unmeasured
+    static constexpr uint32_t c_maxScopes = 256;
+
+    GpuProfiler(Device& device, Profiler& profiler, uint32_t framesInFlight);
+
+    // Before recording frame context, the samples its last use resolved go to the profiler
+    void BeginFrame(uint32_t context);
+    void Begin(const ComPtr<ID3D12GraphicsCommandList>& commandList, const char* name);
+    void End(const ComPtr<ID3D12GraphicsCommandList>& commandList);
+    // Recorded last, resolves the queries of the frame into the readback buffer
+    void EndFrame(const ComPtr<ID3D12GraphicsCommandList>& commandList);
+
+private:
+    struct Scope
+    {
+        const char* Name;
+        uint32_t Depth;
+    };
+
+    // Scope i of a context owns queries 2 * i and 2 * i + 1 of the context's range
+    struct Context
+    {
+        std::vector<Scope> Scopes;
+        uint64_t Frame = 0;
+        bool Resolved = false;
+    };
+
+    void ReadBack(uint32_t context);
+
+    Device& m_device;
+    Profiler& m_profiler;
+    ComPtr<ID3D12QueryHeap> m_queryHeap;
+    ComPtr<ID3D12Resource> m_readback;
+    std::vector<Context> m_contexts;
+    std::vector<uint32_t> m_openScopes;
+    uint32_t m_current = 0;
+    uint64_t m_frequency = 0;
+};
+
+// GPU scope of the enclosing block, nothing is recorded without a profiler
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(GpuProfiler* profiler, const ComPtr<ID3D12GraphicsCommandList>& commandList, const char* name)
+        : m_profiler(profiler)
+        , m_commandList(commandList)
+    {
+        if (m_profiler)
+            m_profiler->Begin(m_commandList, name);
+    }
+
+    ~GpuProfileScope()
+    {
+        if (m_profiler)
+            m_profiler->End(m_commandList);
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    GpuProfiler* m_profiler;
+    const ComPtr<ID3D12GraphicsCommandList>& m_commandList;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Fast non-cryptographic 64-bit hash for cache keys, processes 8 bytes per step
+inline uint64_t HashBytes(const void* data, uint64_t size, uint64_t seed = 0)
+{
+    constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    const auto rotl = [](uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); };
+    const auto round = [&](uint64_t hash, uint64_t word)
+    {
+        word = rotl(word * prime2, 31) * prime1;
+        return rotl(hash ^ word, 27) * prime1 + 0x85EBCA77C2B2AE63ull;
+    };
+
+    const auto bytes = (const uint8_t*)data;
+    uint64_t hash = seed ^ (size * prime1);
+    uint64_t offset = 0;
+    for (; offset + 8 <= size; offset += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        hash = round(hash, word);
+    }
+
+    if (offset < size)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + offset, size - offset);
+        hash = round(hash, word);
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+template<typename T>
+inline uint64_t HashValue(const T& value, uint64_t seed = 0)
+{
+    return HashBytes(&value, sizeof(T), seed);
+}
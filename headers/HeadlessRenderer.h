@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CascadeScheduler.h"
+#include "CpuCascades.h"
+#include "DeferredShading.h"
+#include "FrameDevice.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "ProbeInvalidation.h"
+
+// Renderer::Render without D3D12: the same frame pacing, invalidation, cascade schedule and graph passes, with
+// CpuCascades tracing and merging and DeferredShading shading a G-buffer the caller rasterized or ray cast. Runs on
+// any FrameDevice, on a NullDevice it needs neither a GPU nor a window.
+class HeadlessRenderer
+{
+public:
+    struct PassTiming
+    {
+        const char* Name;
+        double Seconds;
+    };
+
+    // A gatherDownscale of 0 shades every pixel in a single "Draw" pass like the forward Renderer
+    HeadlessRenderer(FrameDevice& device, uint32_t width, uint32_t height, const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount = 4, uint32_t framesInFlight = 2, uint32_t gatherDownscale = 0, CascadeFormat cascadeFormat = CascadeFormat::Rgba16f, const CascadeTopology& cascadeTopology = ::GetTopology(CascadeTopologyId::Default), uint32_t threadCount = 0);
+
+    // changedBounds are the old and new world bounds of the instances moved since the last frame, what
+    // Scene::CollectChangedBounds returns. gbuffer has the size of the renderer and is copied in by the device.
+    void Render(const CpuScene& scene, const std::vector<Aabb>& changedBounds, const GBuffer& gbuffer);
+
+    // Albedo times irradiance plus emission of the last frame
+    inline auto& GetColor() const { return m_color; }
+    // Frames, their pacing, graph execution, passes and submission are recorded as CPU scopes, null records nothing
+    inline void SetProfiler(Profiler* profiler) { m_profiler = profiler; }
+    inline auto& GetCascades() const { return m_cascades; }
+    inline auto& GetScheduler() { return m_scheduler; }
+    inline auto& GetFramePacer() const { return m_framePacer; }
+    // Passes of the last frame in execution order, the time is spent on the CPU running them
+    inline auto& GetPassTimings() const { return m_passTimings; }
+    inline auto GetBarrierCount() const { return m_barrierCount; }
+    inline auto& GetDeferredStats() const { return m_deferredStats; }
+
+private:
+    FrameDevice& m_device;
+    CpuCascades m_cascades;
+    ProbeInvalidation m_invalidation;
+    CascadeScheduler m_scheduler;
+    FramePacer m_framePacer;
+
+    // States the graph left the cascades in, like RadianceCascades::UpdateStates
+    std::vector<uint32_t> m_cascadeStates;
+    std::vector<uint32_t> m_hitStates;
+    uint32_t m_irradianceState;
+
+    GBuffer m_gbuffer;
+    std::vector<Float3> m_gathered;
+    std::vector<Float3> m_color;
+    DeferredStats m_deferredStats;
+
+    std::vector<PassTiming> m_passTimings;
+    Profiler* m_profiler = nullptr;
+    uint32_t m_barrierCount = 0;
+    uint32_t m_gatherDownscale = 0;
+    uint32_t m_threadCount = 0;
+};
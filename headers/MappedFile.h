@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file, empty if the file could not be opened
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const std::string& filepath);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline const uint8_t* GetData() const { return m_data; }
+    inline uint64_t GetSize() const { return m_size; }
+    inline bool IsOpen() const { return m_data != nullptr; }
+
+private:
+    void Close();
+
+    const uint8_t* m_data = nullptr;
+    uint64_t m_size = 0;
+#if defined(_WIN32)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
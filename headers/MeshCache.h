@@ -0,0 +1,40 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "MeshData.h"
+#include "MeshOptimization.h"
+
+// Non-owning view of mesh geometry, either into a mapped cache file or into MeshData
+struct MeshView
+{
+    const float* Positions = nullptr;
+    const float* Normals = nullptr;
+    const uint32_t* Indices = nullptr;
+    uint32_t VertexCount = 0;
+    uint32_t IndexCount = 0;
+};
+
+// Loads a model through a binary cache next to it ("<file>.meshcache"). The cache is keyed by a hash of the
+// source file contents and the format version and is rebuilt through Assimp and OptimizeMesh whenever either changes.
+class MeshCache
+{
+public:
+    MeshCache(const std::string& filepath);
+
+    inline auto& GetView() const { return m_view; }
+    inline bool IsRebuilt() const { return m_rebuilt; }
+    inline auto& GetOptimizationStats() const { return m_stats; }
+
+    static std::string GetCachePath(const std::string& filepath);
+    static bool Write(const std::string& cachePath, const MeshData& mesh, const MeshOptimizationStats& stats, uint64_t sourceHash, uint64_t sourceSize);
+
+private:
+    bool Map(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize);
+
+    MappedFile m_cache;
+    // Only filled when the cache file could not be written
+    MeshData m_fallback;
+    MeshView m_view;
+    MeshOptimizationStats m_stats;
+    bool m_rebuilt = false;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Device independent geometry as it comes out of the importer, float3 positions and normals plus triangle list indices
+struct MeshData
+{
+    std::vector<float> Positions;
+    std::vector<float> Normals;
+    std::vector<uint32_t> Indices;
+
+    inline uint32_t GetVertexCount() const { return (uint32_t)Positions.size() / 3; }
+    inline uint32_t GetIndexCount() const { return (uint32_t)Indices.size(); }
+};
+
+MeshData LoadMeshData(const std::string& filepath);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "MeshData.h"
+
+// Post-transform cache model used to report ACMR (average cache miss ratio, vertex shader runs per triangle)
+static constexpr uint32_t c_acmrCacheSize = 16;
+
+struct MeshOptimizationStats
+{
+    uint32_t SourceVertexCount = 0;
+    uint32_t VertexCount = 0;
+    float SourceAcmr = 0.f;
+    float Acmr = 0.f;
+};
+
+// Welds identical vertices, orders triangles for the post-transform cache and then coarsely front to back
+// per cluster against overdraw, and finally orders vertices by first use for fetch locality
+MeshOptimizationStats OptimizeMesh(MeshData& mesh);
+
+float ComputeAcmr(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = c_acmrCacheSize);
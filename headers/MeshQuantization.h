@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CpuMath.h"
+#include "MeshCache.h"
+
+enum class PositionFormat : uint32_t
+{
+    Float32,    // R32G32B32_FLOAT, 12 bytes
+    Float16,    // R16G16B16A16_FLOAT, 8 bytes
+    Snorm16     // R16G16B16A16_SNORM relative to the mesh bounds, 8 bytes
+};
+
+// Vertex and index encoding used for a model's GPU buffers, shared by the raster input layout and the BLAS
+struct MeshLayout
+{
+    PositionFormat Positions = PositionFormat::Float32;
+    bool OctahedralNormals = false;     // R16G16_SNORM instead of R32G32B32_FLOAT
+    bool CompactIndices = false;        // R16_UINT whenever all indices fit
+
+    inline bool IsPacked() const { return Positions != PositionFormat::Float32 || OctahedralNormals || CompactIndices; }
+};
+
+struct PackedMesh
+{
+    std::vector<uint8_t> Positions;
+    std::vector<uint8_t> Normals;
+    std::vector<uint8_t> Indices;
+    PositionFormat PositionEncoding = PositionFormat::Float32;
+    bool OctahedralNormals = false;
+    uint32_t PositionStride = 0;
+    uint32_t NormalStride = 0;
+    uint32_t IndexSize = 0;
+    uint32_t VertexCount = 0;
+    uint32_t IndexCount = 0;
+    // Decoded position = stored position * PositionScale + PositionBias
+    Float3 PositionScale = {1.f, 1.f, 1.f};
+    Float3 PositionBias = {0.f, 0.f, 0.f};
+};
+
+PackedMesh PackMesh(const MeshView& mesh, const MeshLayout& layout);
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2, matches DecodeOctahedral in shaders/Common.hlsl
+void EncodeOctahedral(const Float3& n, float& u, float& v);
+Float3 DecodeOctahedral(float u, float v);
+
+inline int16_t ToSnorm16(float value)
+{
+    return (int16_t)std::lround(std::clamp(value, -1.f, 1.f) * 32767.f);
+}
+
+inline float FromSnorm16(int16_t value)
+{
+    return std::max(value / 32767.f, -1.f);
+}
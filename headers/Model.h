@@ -1,22 +1,46 @@
 #pragma once
 
-#include "Device.h"
+#include "CpuBvh.h"
+#include "MeshQuantization.h"
+#include "UploadContext.h"
 
 class Model
 {
 public:
-    Model(const std::string& filepath, Device& device);
+    Model(const std::string& filepath, UploadContext& uploads, const MeshLayout& layout = {});
 
     void Draw(const ComPtr<ID3D12GraphicsCommandList>& commandList, uint32_t instanceId = 0) const;
     void DrawInstanced(const ComPtr<ID3D12GraphicsCommandList>& commandList, uint32_t instanceCount) const;
 
     inline auto& GetBLAS() const { return m_blas; }
+    inline auto GetVertexBytes() const { return m_vertexBuffer.View.SizeInBytes + m_normalBuffer.View.SizeInBytes; }
+    inline auto GetIndexBytes() const { return m_indexBuffer.View.SizeInBytes; }
+    // Object space bounds of the vertices
+    inline auto& GetBounds() const { return m_bounds; }
+    // Object space boxes around the triangles, see CascadeBricks::BuildOccupancy
+    inline auto& GetOccupancy() const { return m_occupancy; }
+
+    // Input layout formats of a mesh layout, the drawing pipeline has to be created with these
+    static DXGI_FORMAT GetPositionFormat(const MeshLayout& layout);
+    static DXGI_FORMAT GetNormalFormat(const MeshLayout& layout);
 
 private:
+    // Root constants of Drawing.vs.hlsl
+    struct ObjectConstants
+    {
+        uint32_t InstanceId;
+        Float3 PositionScale;
+        Float3 PositionBias;
+        uint32_t OctahedralNormals;
+    };
+
     VertexBuffer m_vertexBuffer;
     VertexBuffer m_normalBuffer;
     IndexBuffer m_indexBuffer;
     ComPtr<ID3D12Resource> m_blas;
+    ObjectConstants m_constants = {0, {1.f, 1.f, 1.f}, {0.f, 0.f, 0.f}, 0};
+    Aabb m_bounds = {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+    std::vector<Aabb> m_occupancy;
     uint32_t m_vertexCount = 0;
     uint32_t m_indexCount = 0;
-};
\ No newline at end of file
+};
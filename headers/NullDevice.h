@@ -0,0 +1,55 @@
+#pragma once
+
+#include "FrameDevice.h"
+
+struct NullDeviceStats
+{
+    uint64_t Transitions = 0;
+    uint64_t SplitBegins = 0;
+    uint64_t SplitEnds = 0;
+    uint64_t UavBarriers = 0;
+    // Calls of RecordBarriers
+    uint64_t Batches = 0;
+    uint64_t Copies = 0;
+    uint64_t CopiedBytes = 0;
+    uint64_t Submissions = 0;
+    // Waits on a submission not completed yet
+    uint64_t Waits = 0;
+};
+
+// Barrier as the null device recorded it, Native is the one of Barrier.Resource in its graph
+struct NullBarrier
+{
+    void* Native;
+    GraphBarrier Barrier;
+};
+
+// FrameDevice without a GPU. Copies run on host memory right away, barriers are counted and kept per submission
+// and a submission completes once latency later ones were made, or when it is waited for, so frame pacing behaves
+// like on a device running latency frames behind.
+class NullDevice : public FrameDevice
+{
+public:
+    explicit NullDevice(uint32_t latency = 0);
+
+    void RecordBarriers(const RenderGraph& graph, const std::vector<GraphBarrier>& barriers) override;
+    // Natives are host pointers here
+    void CopyBuffer(void* dest, uint64_t destOffset, void* source, uint64_t sourceOffset, uint64_t size) override;
+
+    uint64_t Submit() override;
+    inline uint64_t GetCompletedSubmission() const override { return m_completed; }
+    void WaitForSubmission(uint64_t submission) override;
+
+    // Barriers of the last submission in recording order, compared across frames they show changes of the graph
+    inline auto& GetSubmittedBarriers() const { return m_submittedBarriers; }
+    inline auto& GetStats() const { return m_stats; }
+    inline void ResetStats() { m_stats = {}; }
+
+private:
+    std::vector<NullBarrier> m_recordedBarriers;
+    std::vector<NullBarrier> m_submittedBarriers;
+    NullDeviceStats m_stats;
+    uint64_t m_submission = 0;
+    uint64_t m_completed = 0;
+    uint32_t m_latency = 0;
+};
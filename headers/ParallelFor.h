@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+inline uint32_t GetDefaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs func(begin, end) over [0, count) in chunks pulled from a shared counter by threadCount workers.
+// A threadCount of 0 uses all hardware threads.
+template<typename Func>
+void ParallelFor(uint64_t count, uint32_t threadCount, uint64_t chunkSize, const Func& func)
+{
+    if (threadCount == 0)
+        threadCount = GetDefaultThreadCount();
+    chunkSize = std::max<uint64_t>(chunkSize, 1);
+
+    std::atomic<uint64_t> next = 0;
+    const auto worker = [&]()
+    {
+        for (;;)
+        {
+            const auto begin = next.fetch_add(chunkSize);
+            if (begin >= count)
+                break;
+            func(begin, std::min(begin + chunkSize, count));
+        }
+    };
+
+    const auto chunkCount = (count + chunkSize - 1) / chunkSize;
+    const auto workerCount = (uint32_t)std::min<uint64_t>(threadCount, chunkCount);
+    if (workerCount <= 1)
+    {
+        worker();
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(workerCount - 1);
+    for (auto i = 1u; i < workerCount; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+}
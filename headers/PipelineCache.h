@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Hash.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Hash of everything a pipeline is built from. Pointers are never added themselves, only the bytes they point to,
+// so the key of the same shaders and state is the same on every launch.
+class PipelineKey
+{
+public:
+    // Returned for streams that cannot be keyed, never looked up or stored
+    static constexpr uint64_t c_invalidKey = 0;
+
+    inline PipelineKey& Add(const void* data, uint64_t size)
+    {
+        m_hash = HashBytes(data, size, m_hash);
+        return *this;
+    }
+
+    template<typename T>
+    inline PipelineKey& AddValue(const T& value)
+    {
+        return Add(&value, sizeof(T));
+    }
+
+    inline uint64_t GetHash() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 0;
+};
+
+struct PipelineCacheStats
+{
+    // Entries Load read and those it dropped for a payload not matching its hash
+    uint32_t Loaded = 0;
+    uint32_t Damaged = 0;
+    // Load ignored a cache of another version or environment, or one whose header or entry table is damaged
+    bool Stale = false;
+    uint32_t Hits = 0;
+    uint32_t Misses = 0;
+    // Blobs found but refused by the driver, they are replaced by the next Store
+    uint32_t Rejected = 0;
+    // Entries Save left out after c_maxAge saves without a Find or Store
+    uint32_t Evicted = 0;
+};
+
+// Pipeline blobs of the driver keyed by PipelineKey, kept in a versioned file across launches. The file is bound to
+// an environment, a hash of the adapter and driver the blobs were built by, and read whole or not at all when it
+// does not match. Every entry carries the hash of its payload, damaged entries are dropped one by one.
+class PipelineCache
+{
+public:
+    static constexpr uint32_t c_maxAge = 8;
+
+    PipelineCache(uint64_t environment = 0);
+
+    // Replaces the entries with those of the file at path, false when there is none or it cannot be used
+    bool Load(const std::string& path);
+    // Writes under a temporary name and renames it over path, nothing is written when nothing changed since Load
+    bool Save(const std::string& path);
+
+    // Blob stored under key or nullptr, counted as a hit or miss
+    const std::vector<uint8_t>* Find(uint64_t key);
+    void Store(uint64_t key, const void* data, uint64_t size);
+    // The driver refused the blob Find returned for key, it is dropped
+    void Reject(uint64_t key);
+
+    inline auto GetEntryCount() const { return (uint32_t)m_entries.size(); }
+    inline auto& GetStats() const { return m_stats; }
+    inline auto GetEnvironment() const { return m_environment; }
+
+private:
+    struct Entry
+    {
+        std::vector<uint8_t> Blob;
+        // Saves since the entry was last found or stored
+        uint32_t Age = 0;
+        bool Used = false;
+    };
+
+    std::unordered_map<uint64_t, Entry> m_entries;
+    PipelineCacheStats m_stats;
+    uint64_t m_environment = 0;
+    bool m_dirty = false;
+};
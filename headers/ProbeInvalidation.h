@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CascadeCommon.h"
+#include "CascadeScheduler.h"
+#include "CpuBvh.h"
+
+#include <vector>
+
+// Per cascade list of the probes whose ray interval shell [GetEnd(cascade - 1), GetEnd(cascade)] overlaps bounds
+// that changed since the lists were cleared. Only the probe grid cells near the bounds are visited, so the cost
+// follows the size of the change rather than the cascade volume.
+class ProbeInvalidation
+{
+public:
+    ProbeInvalidation(const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount, const CascadeTopology& topology = ::GetTopology(CascadeTopologyId::Default));
+
+    // Called with the old and the new world bounds of a moved instance
+    void Invalidate(const Aabb& bounds);
+    // Single probe, e.g. of a brick that just became resident
+    void InvalidateProbe(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z);
+    void Clear();
+
+    // Splits the tracing of cascade between the scheduled slices and a list of the invalidated probes outside them.
+    // Past half of the level the list costs more than tracing it whole, slices then covers the level and the list is empty.
+    void SplitTracing(uint32_t cascade, CascadeSlices& slices, std::vector<uint32_t>& listedProbes) const;
+
+    // Packed probe indices, see PackProbe, in order of invalidation
+    inline auto& GetProbes(uint32_t cascade) const { return m_probes[cascade]; }
+    inline uint32_t GetProbeCount(uint32_t cascade) const { return (m_resolution.x >> cascade) * (m_resolution.y >> cascade) * (m_resolution.z >> cascade); }
+    inline bool IsInvalid(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const { return m_marks[cascade][GetIndex(cascade, x, y, z)] != 0; }
+    inline auto GetCount() const { return m_count; }
+
+    // World position of a probe, the origin of its rays in CascadeTracing.hlsl
+    Float3 GetProbePosition(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const;
+
+    // Whether any point at a distance in [start, end] from position lies inside bounds
+    static bool Overlaps(const Float3& position, float start, float end, const Aabb& bounds);
+
+    // PackProbe keeps 10 bits per axis
+    static constexpr uint32_t c_maxResolution = 1024;
+
+    static inline uint32_t PackProbe(uint32_t x, uint32_t y, uint32_t z) { return x | (y << 10) | (z << 20); }
+    static inline std::array<uint32_t, 3> UnpackProbe(uint32_t probe) { return {probe & 0x3ff, (probe >> 10) & 0x3ff, probe >> 20}; }
+
+private:
+    inline uint32_t GetIndex(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const
+    {
+        return (z * (m_resolution.y >> cascade) + y) * (m_resolution.x >> cascade) + x;
+    }
+
+    std::vector<std::vector<uint32_t>> m_probes;
+    std::vector<std::vector<uint8_t>> m_marks;
+    CascadeResultion m_resolution;
+    CascadeExtends m_extends;
+    CascadeOffset m_offset;
+    CascadeTopology m_topology;
+    uint32_t m_count = 0;
+};
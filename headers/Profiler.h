@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+enum class ProfileTrack : uint8_t
+{
+    Cpu,
+    Gpu
+};
+
+// Times are nanoseconds on the clock of the profiler, GPU samples are converted to it when they are added
+struct ProfileSample
+{
+    // Names have to outlive the profiler, e.g. literals or RenderGraph pass names
+    const char* Name;
+    uint64_t Frame;
+    uint64_t Begin;
+    uint64_t End;
+    // Scopes open around the sample on its track
+    uint32_t Depth;
+    ProfileTrack Track;
+};
+
+// Sums of every frame a name appears in on a track, over the frames of the samples still in the ring
+struct ProfileStats
+{
+    const char* Name;
+    ProfileTrack Track;
+    uint32_t Depth;
+    uint32_t Frames = 0;
+    // Samples of the name per frame, e.g. one per cascade level
+    double Calls = 0.0;
+    double Mean = 0.0;
+    double Min = 0.0;
+    double Max = 0.0;
+    double Last = 0.0;
+};
+
+// Nested CPU scopes and GPU samples of the frame loop in a fixed ring of the last capacity samples, the oldest are
+// overwritten. Scopes are opened and closed from the thread running the frame loop, recording one is a clock read
+// and a copy into the ring. Exported as Chrome trace JSON, which Perfetto reads as well.
+class Profiler
+{
+public:
+    static constexpr uint32_t c_defaultCapacity = 1 << 16;
+
+    // capacity is a power of two
+    explicit Profiler(uint32_t capacity = c_defaultCapacity);
+
+    // Samples recorded until the next call belong to the next frame
+    void BeginFrame();
+
+    void BeginCpu(const char* name);
+    void EndCpu();
+    void AddGpuSample(const char* name, uint64_t frame, uint64_t begin, uint64_t end, uint32_t depth);
+
+    inline uint64_t Now() const { return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count(); }
+
+    // Samples in the ring, oldest first
+    std::vector<ProfileSample> GetSamples() const;
+    // In order of the first sample of every name, depth and track
+    std::vector<ProfileStats> CollectStats() const;
+
+    void WriteChromeTrace(std::ostream& out) const;
+    bool WriteChromeTrace(const std::string& path) const;
+
+    inline auto GetFrame() const { return m_frame; }
+    inline auto GetSampleCount() const { return (uint32_t)std::min<uint64_t>(m_written, m_samples.size()); }
+    // Samples overwritten since the start
+    inline auto GetDroppedCount() const { return m_written > m_samples.size() ? m_written - m_samples.size() : 0; }
+
+private:
+    struct OpenScope
+    {
+        const char* Name;
+        uint64_t Begin;
+    };
+
+    void Add(const ProfileSample& sample);
+
+    std::vector<ProfileSample> m_samples;
+    std::vector<OpenScope> m_openScopes;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_written = 0;
+    uint64_t m_frame = 0;
+};
+
+// CPU scope of the enclosing block, nothing is recorded without a profiler
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler* profiler, const char* name)
+        : m_profiler(profiler)
+    {
+        if (m_profiler)
+            m_profiler->BeginCpu(name);
+    }
+
+    ~ProfileScope()
+    {
+        if (m_profiler)
+            m_profiler->EndCpu();
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* m_profiler;
+};
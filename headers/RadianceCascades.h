@@ -1,49 +1,85 @@
 #pragma once
 
 #include "Device.h"
+#include "CascadeCommon.h"
+#include "CascadeFormats.h"
+#include "CascadeScheduler.h"
+#include "ProbeInvalidation.h"
+#include "CascadeBricks.h"
 
 class Scene;
 
-struct CascadeResultion
-{
-    uint32_t x;
-    uint32_t y;
-    uint32_t z;
-};
-
-struct CascadeExtends
-{
-    float x;
-    float y;
-    float z;
-};
-
-using CascadeOffset = CascadeExtends;
-
-
 class RadianceCascades
 {
 public:
-    RadianceCascades(Device& device, const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount = 5);
+    // format is any but CascadeFormat::Rgb9e5, which the merges cannot store to
+    RadianceCascades(Device& device, const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount = 5, CascadeFormat format = CascadeFormat::Rgba16f, CascadeLayout layout = CascadeLayout::ProbeMajor, CascadeTopologyId topology = CascadeTopologyId::Default);
 
-    const std::vector<D3D12_GPU_DESCRIPTOR_HANDLE>& Generate(const ComPtr<ID3D12GraphicsCommandList>& commandList, D3D12_GPU_DESCRIPTOR_HANDLE accelerationStructure, D3D12_GPU_DESCRIPTOR_HANDLE instanceData);
+    // Adds the tracing, merging and irradiance passes, returns the graph resources of the cascades. Levels are traced
+    // as the scheduler picks them plus the probes invalidated since the last call, every level is merged and cascade 0
+    // projected into the irradiance volume. Only probes of resident bricks are traced, merged and projected.
+    const std::vector<uint32_t>& Generate(RenderGraph& graph, const ComPtr<ID3D12GraphicsCommandList>& commandList, D3D12_GPU_DESCRIPTOR_HANDLE accelerationStructure, D3D12_GPU_DESCRIPTOR_HANDLE instanceData);
+    // Keeps the states the executed graph left the cascades in for the next frame
+    void UpdateStates(const RenderGraph& graph);
 
-    inline auto& GetConstants() const { return m_tracingConstants; }
+    inline auto& GetShaderResourceViews() const { return m_cascadeSrvs; }
+    // Per probe irradiance of cascade 0, see c_irradianceTexels, and its graph resource of the frame recorded last
+    inline auto GetIrradianceView() const { return m_irradianceSrv; }
+    inline auto GetIrradianceResource() const { return m_irradianceGraphResource; }
+
+    // Constants of the frame recorded last
+    inline auto GetConstants() const { return m_constants; }
 
     inline auto& GetResolution() const { return m_resolution; }
+    inline auto GetFormat() const { return m_format; }
+    inline auto GetLayout() const { return m_layout; }
+    inline auto& GetTopology() const { return ::GetTopology(m_topology); }
+    // Picks the levels and slices Generate updates, everything every frame by default
+    inline auto& GetScheduler() { return m_scheduler; }
+    // World bounds that changed, the probes seeing them are traced again by the next Generate
+    inline void Invalidate(const Aabb& bounds) { m_invalidation.Invalidate(bounds); }
+    // Rebuilds brick residency from the occupancy of every instance, growing a level's atlas waits for the GPU
+    void UpdateBricks(const Scene& scene);
+    // Brick indirection of the frame recorded last, see CascadeBricks::GetIndirection
+    inline auto GetBricks() const { return m_bricksAddress; }
 
 private:
+    // Cascade and hit atlases of a level holding layers of bricks, replaces the previous ones
+    void CreateLevel(uint32_t cascade, uint32_t layers);
+
+    Device& m_device;
     State m_cascadeGenerationPipeline;
     Pipeline m_cascadeAccumulationPipeline;
+    Pipeline m_irradiancePipeline;
     std::vector<ComPtr<ID3D12Resource>> m_cascades;
-    ComPtr<ID3D12Resource> m_tracingConstants;
+    D3D12_GPU_VIRTUAL_ADDRESS m_constants = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS m_bricksAddress = 0;
     std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> m_cascadeUavs;
     std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> m_cascadeSrvs;
+    std::vector<uint32_t> m_cascadeStates;
+    std::vector<uint32_t> m_graphResources;
+    // R16_UINT hit ids the tracing writes and the merging resolves, see c_cascadeMiss
+    std::vector<ComPtr<ID3D12Resource>> m_hits;
+    std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> m_hitUavs;
+    std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> m_hitSrvs;
+    std::vector<uint32_t> m_hitStates;
+    std::vector<uint32_t> m_hitGraphResources;
+    ComPtr<ID3D12Resource> m_irradiance;
+    D3D12_GPU_DESCRIPTOR_HANDLE m_irradianceUav;
+    D3D12_GPU_DESCRIPTOR_HANDLE m_irradianceSrv;
+    uint32_t m_irradianceState = GraphState::AllShaderResource;
+    uint32_t m_irradianceGraphResource = 0;
+    std::vector<uint32_t> m_listedProbes;
     CascadeResultion m_resolution;
     CascadeExtends m_extends;
     CascadeOffset m_offset;
+    CascadeFormat m_format = CascadeFormat::Rgba16f;
+    CascadeLayout m_layout = CascadeLayout::ProbeMajor;
+    CascadeTopologyId m_topology = CascadeTopologyId::Default;
     uint32_t m_count = 0;
-    uint32_t m_cascadePixelsX = 0;
-    uint32_t m_cascadePixelsY = 0;
-    uint32_t m_cascadePixelsZ = 0;
+    CascadeScheduler m_scheduler;
+    ProbeInvalidation m_invalidation;
+    CascadeBricks m_bricks;
+    // Atlas layers each level was created with
+    std::vector<uint32_t> m_layers;
 };
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Resource states, the values match D3D12_RESOURCE_STATES so the graph stays free of D3D12 headers
+namespace GraphState
+{
+    constexpr uint32_t Common = 0x0;
+    constexpr uint32_t Present = 0x0;
+    constexpr uint32_t RenderTarget = 0x4;
+    constexpr uint32_t UnorderedAccess = 0x8;
+    constexpr uint32_t DepthWrite = 0x10;
+    constexpr uint32_t DepthRead = 0x20;
+    constexpr uint32_t NonPixelShaderResource = 0x40;
+    constexpr uint32_t PixelShaderResource = 0x80;
+    constexpr uint32_t CopyDest = 0x400;
+    constexpr uint32_t CopySource = 0x800;
+    constexpr uint32_t AllShaderResource = NonPixelShaderResource | PixelShaderResource;
+
+    constexpr uint32_t WriteMask = RenderTarget | UnorderedAccess | DepthWrite | CopyDest;
+
+    inline bool IsReadOnly(uint32_t state) { return state != Common && !(state & WriteMask); }
+}
+
+struct GraphBarrier
+{
+    enum class Type : uint8_t
+    {
+        Transition,
+        Uav
+    };
+
+    // Split transitions begin right after the last use and end before the next one
+    enum class Split : uint8_t
+    {
+        None,
+        Begin,
+        End
+    };
+
+    uint32_t Resource;
+    uint32_t Before;
+    uint32_t After;
+    Type Kind;
+    Split Phase;
+};
+
+// First and last pass using a resource
+struct GraphLifetime
+{
+    uint32_t FirstPass;
+    uint32_t LastPass;
+};
+
+// Passes declare the state they need every resource in, Compile derives the barriers in front of each pass.
+// Consecutive reads are merged into a single transition to the union of their states, transitions are split
+// over passes not touching the resource and back to back UAV accesses get a UAV barrier.
+class RenderGraph
+{
+public:
+    using Execution = std::function<void()>;
+
+    static constexpr uint32_t c_anyState = ~0u;
+    static constexpr uint32_t c_unused = ~0u;
+
+    explicit RenderGraph(bool splitBarriers = true);
+
+    // External resources enter in state and leave in finalState, c_anyState keeps the state of the last use
+    uint32_t Import(void* native, uint32_t state, uint32_t finalState = c_anyState);
+    // Resources living only within the frame, created in the state of their first use
+    uint32_t CreateTransient(void* native = nullptr);
+
+    uint32_t AddPass(const char* name, Execution execution = {});
+    void Use(uint32_t pass, uint32_t resource, uint32_t state);
+
+    void Compile();
+
+    // Passes in declaration order, barriers is called with every non empty batch including the closing one
+    template<typename Barriers>
+    void Execute(const Barriers& barriers) const
+    {
+        Execute(barriers, [](uint32_t, const Execution& execution) { execution(); });
+    }
+
+    // Every pass runs as wrap(pass, execution), e.g. inside profiling scopes named GetPassName(pass)
+    template<typename Barriers, typename Wrap>
+    void Execute(const Barriers& barriers, const Wrap& wrap) const
+    {
+        for (auto i = 0u; i <= m_passes.size(); ++i)
+        {
+            if (!m_batches[i].empty())
+                barriers(m_batches[i]);
+            if (i < m_passes.size() && m_passes[i].Execute)
+                wrap(i, m_passes[i].Execute);
+        }
+    }
+
+    // Barriers recorded before pass, GetPassCount() gives the batch after the last pass
+    inline auto& GetBarriers(uint32_t pass) const { return m_batches[pass]; }
+    inline auto GetFinalState(uint32_t resource) const { return m_finalStates[resource]; }
+    inline auto GetLifetime(uint32_t resource) const { return m_lifetimes[resource]; }
+    inline auto GetNative(uint32_t resource) const { return m_resources[resource].Native; }
+    inline auto GetPassName(uint32_t pass) const { return m_passes[pass].Name; }
+    inline auto GetPassCount() const { return (uint32_t)m_passes.size(); }
+    inline auto GetResourceCount() const { return (uint32_t)m_resources.size(); }
+    uint32_t GetBarrierCount() const;
+
+private:
+    struct Resource
+    {
+        void* Native;
+        uint32_t State;
+        uint32_t FinalState;
+        bool Transient;
+    };
+
+    struct Access
+    {
+        uint32_t Resource;
+        uint32_t State;
+    };
+
+    struct Pass
+    {
+        const char* Name;
+        Execution Execute;
+        std::vector<Access> Accesses;
+    };
+
+    void CompileResource(uint32_t resource, const std::vector<std::pair<uint32_t, uint32_t>>& uses);
+    void AddTransition(uint32_t resource, uint32_t before, uint32_t after, uint32_t begin, uint32_t end);
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<std::vector<GraphBarrier>> m_batches;
+    std::vector<uint32_t> m_finalStates;
+    std::vector<GraphLifetime> m_lifetimes;
+    bool m_splitBarriers = true;
+};
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "Device.h"
+#include "FramePacer.h"
+#include "GpuProfiler.h"
+#include "MeshQuantization.h"
 #include "RadianceCascades.h"
+#include "UploadContext.h"
 
 class Camera;
 class Scene;
@@ -10,15 +14,26 @@ class Model;
 class Renderer
 {
 public:
-    Renderer(HWND window, uint32_t width, uint32_t height);
+    static constexpr uint32_t c_defaultFramesInFlight = 2;
+
+    // Models drawn through the scene have to be loaded with GetMeshLayout. A gatherDownscale above 0 draws a G-buffer
+    // and gathers the cascades at 1 / gatherDownscale of the resolution, see DeferredShading.h, instead of shading
+    // every drawn pixel.
+    Renderer(HWND window, uint32_t width, uint32_t height, const MeshLayout& meshLayout = {}, uint32_t framesInFlight = c_defaultFramesInFlight, CascadeFormat cascadeFormat = CascadeFormat::Rgba16f, uint32_t gatherDownscale = 0, CascadeLayout cascadeLayout = CascadeLayout::ProbeMajor, CascadeTopologyId cascadeTopology = CascadeTopologyId::Default);
 
     void Render(const Camera& camera, Scene& scene);
 
     void Finish();
 
     inline auto& GetDevice() { return m_device; }
+    inline auto& GetUploadContext() { return m_uploadContext; }
+    inline auto& GetMeshLayout() const { return m_meshLayout; }
+    inline auto GetFramesInFlight() const { return m_framePacer.GetFramesInFlight(); }
+    // CPU scopes of the frame loop and GPU timestamps of the TLAS build and every graph pass
+    inline auto& GetProfiler() const { return m_profiler; }
 
     inline void VisualizeCascade(int cascadeIndex) { m_debugCascade = cascadeIndex; }
+    inline void ScheduleCascades(CascadeScheduler::Mode mode, uint32_t base = 2) { m_radianceCascades.GetScheduler().SetMode(mode, base); }
 
 private:
     static constexpr auto c_backBufferCount = 2;
@@ -29,28 +44,40 @@ private:
         D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle; 
     };
 
-    struct PendingAccelStruct
-    {
-        ComPtr<ID3D12Resource> Resource;
-        D3D12_GPU_DESCRIPTOR_HANDLE Handle;
-        uint64_t Submission;
-    };
+    void CreateDeferredTargets();
 
     Device m_device;
+    // Queue side of the frame loop, the passes record into the frame context's list directly
+    D3D12FrameDevice m_frameDevice;
+    UploadContext m_uploadContext;
     RadianceCascades m_radianceCascades;
 
+    // Command allocator and list of every frame context, reset instead of recreated
+    std::vector<Commands> m_frames;
+    FramePacer m_framePacer;
+
+    Profiler m_profiler;
+    GpuProfiler m_gpuProfiler;
+
     ComPtr<IDXGISwapChain> m_swapChain;
     std::array<ViewedResource, c_backBufferCount> m_swapChainTargets;
     ViewedResource m_depthStencil;
 
+    MeshLayout m_meshLayout;
     Pipeline m_drawingPipeline;
-    ComPtr<ID3D12Resource> m_cameraConstants;
+
+    // Deferred mode, the depth stencil's GpuHandle is its shader resource view then
+    uint32_t m_gatherDownscale = 0;
+    Pipeline m_gbufferPipeline;
+    Pipeline m_deferredGatherPipeline;
+    Pipeline m_deferredCompositePipeline;
+    std::array<ViewedResource, std::size(c_gbufferFormats)> m_gbuffer;
+    ViewedResource m_gathered;
+    D3D12_GPU_DESCRIPTOR_HANDLE m_gatheredUav;
 
     State m_raytracingPipeline;
     ComPtr<ID3D12Resource> m_raytracingConstants;
     ViewedResource m_raytracingTarget;
-    std::deque<PendingAccelStruct> m_pendingRaytracingResources;
-    std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> m_freeRaytracingHandles;
 
     uint64_t m_frameCounter = 0;
     uint32_t m_width = 0;
@@ -58,6 +85,5 @@ private:
 
     std::unique_ptr<Model> m_debugSphere;
     Pipeline m_debugCascadesPipeline;
-    ComPtr<ID3D12Resource> m_debugCascadesConstants;
     int m_debugCascade = -1;
 };
\ No newline at end of file
@@ -1,19 +1,42 @@
 #pragma once
 
+#include "CascadeCommon.h"
 #include "Device.h"
+#include "DirtyRanges.h"
 #include "Model.h"
+#include "TlasUpdater.h"
+
+// Instance data uploaded by Update in the last frame
+struct SceneUploadStats
+{
+    uint64_t Bytes = 0;
+    uint32_t Ranges = 0;
+};
 
 class Scene
 {
 public:
-    Scene(Device& device);
+    // Every frame context gets its own upload copies of the instance data and TLAS instance descs
+    Scene(Device& device, uint32_t framesInFlight);
 
-    void Update(const ComPtr<ID3D12GraphicsCommandList>& commandList);
+    // context is the FramePacer context of the frame recorded into commandList, its upload copies are rewritten
+    void Update(const ComPtr<ID3D12GraphicsCommandList>& commandList, uint32_t context);
+    // Submission of the commands recorded by the last Update, recycles replaced TLAS buffers once it completes
+    void Submit(uint64_t submission);
 
     void Draw(const ComPtr<ID3D12GraphicsCommandList>& commandList);
 
-    inline auto& GetAccelerationStructure() const { return m_tlas; }
+    inline auto& GetAccelerationStructure() const { return m_tlasUpdater.GetCurrent(); }
+    inline auto& GetTlasStats() const { return m_tlasUpdater.GetStats(); }
     inline auto GetInstanceDataHandle() const { return m_instanceDataHandle; }
+    inline SceneUploadStats GetUploadStats() const { return {m_dirtyInstances.GetStats().Elements * sizeof(Instance), m_dirtyInstances.GetStats().Ranges}; }
+    inline auto GetTotalUploadedBytes() const { return m_dirtyInstances.GetStats().TotalElements * sizeof(Instance); }
+    // World bounds instances were added with or moved from and to since the last call
+    std::vector<Aabb> CollectChangedBounds();
+    inline auto GetInstanceCount() const { return (uint32_t)m_modelRefs.size(); }
+    inline auto& GetInstanceModel(uint32_t instanceId) const { return *m_modelRefs[instanceId]; }
+    // Rows of the world transform, kept next to the instance data uploaded by Update
+    inline auto& GetInstanceTransform(uint32_t instanceId) const { return m_instanceTransforms[instanceId]; }
     
     uint32_t AddInstance(const Model& model, const DirectX::XMMATRIX& transform, const DirectX::XMVECTOR& albedo, const DirectX::XMVECTOR& emission);
 
@@ -22,6 +45,20 @@ public:
     void SetInstanceEmission(uint32_t instanceId, const DirectX::XMVECTOR& emission);
 
 private:
+    struct TlasBackend
+    {
+        using Buffer = ComPtr<ID3D12Resource>;
+
+        uint64_t GetResultSize(uint32_t count);
+        Buffer CreateBuffer(uint64_t size);
+        void Build(const Buffer& dest, const Buffer* source, uint32_t count);
+        uint64_t GetCompletedSubmission();
+
+        Device& Gpu;
+        const ComPtr<ID3D12GraphicsCommandList>& CommandList;
+        const ComPtr<ID3D12Resource>& InstanceBuffer;
+    };
+
     struct Instance
     {
         DirectX::XMMATRIX Transform;
@@ -29,17 +66,38 @@ private:
         DirectX::XMVECTOR Emission;
     };
 
-    static constexpr auto c_instanceCount = 65536;
+    // Mapped upload buffers read by the copy and TLAS build of the frames recorded in the context, rewritten only
+    // once the FramePacer handed the context out again
+    struct FrameContext
+    {
+        ComPtr<ID3D12Resource> InstanceData;
+        ComPtr<ID3D12Resource> BuildData;
+        Instance* InstanceDataPtr;
+        D3D12_RAYTRACING_INSTANCE_DESC* BuildDataPtr;
+        // Instances written since the context was last updated
+        DirtyRanges Dirty;
+    };
+
+    void MarkDirty(uint32_t instanceId);
+
+    // Instance ids have to fit the R16_UINT hit ids of the cascades
+    static constexpr auto c_instanceCount = c_maxCascadeInstances;
     static constexpr auto c_instanceDataSize = c_instanceCount * sizeof(Instance);
 
     Device& m_device;
     std::vector<const Model*> m_modelRefs;
-    ComPtr<ID3D12Resource> m_tlas;
-    ComPtr<ID3D12Resource> m_instanceDataCpu;
+    TlasUpdater<TlasBackend> m_tlasUpdater;
+    std::vector<FrameContext> m_contexts;
     ComPtr<ID3D12Resource> m_instanceDataGpu;
-    ComPtr<ID3D12Resource> m_tlasBuildData;
     D3D12_GPU_DESCRIPTOR_HANDLE m_instanceDataHandle = {};
-    Instance* m_instanceDataPtr = nullptr;
+    // Written by the setters, copied into the upload buffers of a context when it is updated
+    std::vector<Instance> m_instances;
+    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> m_instanceDescs;
+    // Instances written since the last update, copied to the GPU buffer
+    DirtyRanges m_dirtyInstances;
+    std::vector<Float3x4> m_instanceTransforms;
+    std::vector<Aabb> m_instanceBounds;
+    std::vector<Aabb> m_changedBounds;
     bool m_transformsDirty = false;
-    bool m_instanceDataDirty = false;
+    bool m_instancesChanged = false;
 };
\ No newline at end of file
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// 8-wide float lane group, one lane per ray. Backed by AVX2, two NEON registers or plain scalar code.
+struct Mask8
+{
+#if defined(SIMD_AVX2)
+    __m256 v;
+#elif defined(SIMD_NEON)
+    uint32x4_t lo;
+    uint32x4_t hi;
+#else
+    uint32_t bits;
+#endif
+
+    inline uint32_t Bits() const
+    {
+#if defined(SIMD_AVX2)
+        return (uint32_t)_mm256_movemask_ps(v);
+#elif defined(SIMD_NEON)
+        const uint32x4_t weights = {1, 2, 4, 8};
+        return vaddvq_u32(vandq_u32(lo, weights)) | (vaddvq_u32(vandq_u32(hi, weights)) << 4);
+#else
+        return bits;
+#endif
+    }
+
+    inline bool Any() const { return Bits() != 0; }
+};
+
+inline Mask8 operator&(const Mask8& a, const Mask8& b)
+{
+#if defined(SIMD_AVX2)
+    return {_mm256_and_ps(a.v, b.v)};
+#elif defined(SIMD_NEON)
+    return {vandq_u32(a.lo, b.lo), vandq_u32(a.hi, b.hi)};
+#else
+    return {a.bits & b.bits};
+#endif
+}
+
+inline Mask8 operator|(const Mask8& a, const Mask8& b)
+{
+#if defined(SIMD_AVX2)
+    return {_mm256_or_ps(a.v, b.v)};
+#elif defined(SIMD_NEON)
+    return {vorrq_u32(a.lo, b.lo), vorrq_u32(a.hi, b.hi)};
+#else
+    return {a.bits | b.bits};
+#endif
+}
+
+struct Float8
+{
+#if defined(SIMD_AVX2)
+    __m256 v;
+#elif defined(SIMD_NEON)
+    float32x4_t lo;
+    float32x4_t hi;
+#else
+    float v[8];
+#endif
+
+    static inline Float8 Broadcast(float value)
+    {
+#if defined(SIMD_AVX2)
+        return {_mm256_set1_ps(value)};
+#elif defined(SIMD_NEON)
+        return {vdupq_n_f32(value), vdupq_n_f32(value)};
+#else
+        Float8 ret;
+        for (auto i = 0u; i < 8; ++i)
+            ret.v[i] = value;
+        return ret;
+#endif
+    }
+
+    static inline Float8 Load(const float* data)
+    {
+#if defined(SIMD_AVX2)
+        return {_mm256_loadu_ps(data)};
+#elif defined(SIMD_NEON)
+        return {vld1q_f32(data), vld1q_f32(data + 4)};
+#else
+        Float8 ret;
+        for (auto i = 0u; i < 8; ++i)
+            ret.v[i] = data[i];
+        return ret;
+#endif
+    }
+
+    inline void Store(float* data) const
+    {
+#if defined(SIMD_AVX2)
+        _mm256_storeu_ps(data, v);
+#elif defined(SIMD_NEON)
+        vst1q_f32(data, lo);
+        vst1q_f32(data + 4, hi);
+#else
+        for (auto i = 0u; i < 8; ++i)
+            data[i] = v[i];
+#endif
+    }
+};
+
+#if defined(SIMD_AVX2)
+#define SIMD_BINARY_OP(op, avx, neon) \
+    inline Float8 op(const Float8& a, const Float8& b) { return {avx(a.v, b.v)}; }
+#define SIMD_COMPARE_OP(op, cmp, neon) \
+    inline Mask8 op(const Float8& a, const Float8& b) { return {_mm256_cmp_ps(a.v, b.v, cmp)}; }
+#elif defined(SIMD_NEON)
+#define SIMD_BINARY_OP(op, avx, neon) \
+    inline Float8 op(const Float8& a, const Float8& b) { return {neon(a.lo, b.lo), neon(a.hi, b.hi)}; }
+#define SIMD_COMPARE_OP(op, cmp, neon) \
+    inline Mask8 op(const Float8& a, const Float8& b) { return {neon(a.lo, b.lo), neon(a.hi, b.hi)}; }
+#endif
+
+#if defined(SIMD_AVX2) || defined(SIMD_NEON)
+SIMD_BINARY_OP(operator+, _mm256_add_ps, vaddq_f32)
+SIMD_BINARY_OP(operator-, _mm256_sub_ps, vsubq_f32)
+SIMD_BINARY_OP(operator*, _mm256_mul_ps, vmulq_f32)
+SIMD_BINARY_OP(operator/, _mm256_div_ps, vdivq_f32)
+SIMD_BINARY_OP(Min, _mm256_min_ps, vminq_f32)
+SIMD_BINARY_OP(Max, _mm256_max_ps, vmaxq_f32)
+SIMD_COMPARE_OP(operator<, _CMP_LT_OQ, vcltq_f32)
+SIMD_COMPARE_OP(operator<=, _CMP_LE_OQ, vcleq_f32)
+SIMD_COMPARE_OP(operator>, _CMP_GT_OQ, vcgtq_f32)
+SIMD_COMPARE_OP(operator>=, _CMP_GE_OQ, vcgeq_f32)
+#undef SIMD_BINARY_OP
+#undef SIMD_COMPARE_OP
+#else
+#define SIMD_BINARY_OP(op, expr) \
+    inline Float8 op(const Float8& a, const Float8& b) \
+    { \
+        Float8 ret; \
+        for (auto i = 0u; i < 8; ++i) \
+            ret.v[i] = expr; \
+        return ret; \
+    }
+#define SIMD_COMPARE_OP(op, cmp) \
+    inline Mask8 op(const Float8& a, const Float8& b) \
+    { \
+        Mask8 ret = {0}; \
+        for (auto i = 0u; i < 8; ++i) \
+            ret.bits |= (a.v[i] cmp b.v[i] ? 1u : 0u) << i; \
+        return ret; \
+    }
+SIMD_BINARY_OP(operator+, a.v[i] + b.v[i])
+SIMD_BINARY_OP(operator-, a.v[i] - b.v[i])
+SIMD_BINARY_OP(operator*, a.v[i] * b.v[i])
+SIMD_BINARY_OP(operator/, a.v[i] / b.v[i])
+SIMD_BINARY_OP(Min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+SIMD_BINARY_OP(Max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+SIMD_COMPARE_OP(operator<, <)
+SIMD_COMPARE_OP(operator<=, <=)
+SIMD_COMPARE_OP(operator>, >)
+SIMD_COMPARE_OP(operator>=, >=)
+#undef SIMD_BINARY_OP
+#undef SIMD_COMPARE_OP
+#endif
+
+// Picks a where the mask is set, b elsewhere
+inline Float8 Select(const Mask8& mask, const Float8& a, const Float8& b)
+{
+#if defined(SIMD_AVX2)
+    return {_mm256_blendv_ps(b.v, a.v, mask.v)};
+#elif defined(SIMD_NEON)
+    return {vbslq_f32(mask.lo, a.lo, b.lo), vbslq_f32(mask.hi, a.hi, b.hi)};
+#else
+    Float8 ret;
+    for (auto i = 0u; i < 8; ++i)
+        ret.v[i] = (mask.bits >> i) & 1u ? a.v[i] : b.v[i];
+    return ret;
+#endif
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "FencedPool.h"
+
+enum class TlasUpdate
+{
+    None,
+    Refit,
+    Rebuild
+};
+
+// Rebuild when the set of instances changed or refits piled up, refit when only transforms moved
+inline TlasUpdate ChooseTlasUpdate(bool hasTlas, bool instancesChanged, bool transformsChanged, uint32_t refitsSinceBuild, uint32_t maxRefits)
+{
+    if (!hasTlas || instancesChanged)
+        return TlasUpdate::Rebuild;
+    if (!transformsChanged)
+        return TlasUpdate::None;
+    return refitsSinceBuild < maxRefits ? TlasUpdate::Refit : TlasUpdate::Rebuild;
+}
+
+struct TlasStats
+{
+    uint64_t Rebuilds = 0;
+    uint64_t Refits = 0;
+    uint64_t Allocations = 0;
+};
+
+// Keeps the current TLAS and records rebuilds or out-of-place refits into pooled result buffers, so the
+// TLAS read by frames still in flight is never written. Backend provides:
+//   Buffer                                  ref-counted result buffer handle
+//   uint64_t GetResultSize(uint32_t count)  prebuild result size for count instances
+//   Buffer CreateBuffer(uint64_t size)
+//   void Build(const Buffer& dest, const Buffer* source, uint32_t count)  source is set for refits
+//   uint64_t GetCompletedSubmission()
+template<typename Backend>
+class TlasUpdater
+{
+public:
+    using Buffer = typename Backend::Buffer;
+
+    static constexpr uint32_t c_defaultMaxRefits = 64;
+
+    TlasUpdater(uint32_t maxRefits = c_defaultMaxRefits)
+        : m_maxRefits(maxRefits)
+    {
+    }
+
+    TlasUpdate Update(Backend& backend, uint32_t instanceCount, bool instancesChanged, bool transformsChanged)
+    {
+        const auto update = ChooseTlasUpdate(m_current != nullptr, instancesChanged || instanceCount != m_instanceCount, transformsChanged, m_refitsSinceBuild, m_maxRefits);
+        if (update == TlasUpdate::None)
+            return update;
+
+        const auto completed = backend.GetCompletedSubmission();
+        const auto size = backend.GetResultSize(instanceCount);
+        m_pool.Trim(size, completed);
+
+        Buffer dest;
+        uint64_t destSize;
+        if (!m_pool.Acquire(size, completed, dest, destSize))
+        {
+            dest = backend.CreateBuffer(size);
+            destSize = size;
+            ++m_stats.Allocations;
+        }
+
+        if (update == TlasUpdate::Refit)
+        {
+            backend.Build(dest, &m_current, instanceCount);
+            ++m_refitsSinceBuild;
+            ++m_stats.Refits;
+        }
+        else
+        {
+            backend.Build(dest, nullptr, instanceCount);
+            m_refitsSinceBuild = 0;
+            ++m_stats.Rebuilds;
+        }
+
+        if (m_current != nullptr)
+            m_pool.Release(std::move(m_current), m_currentSize);
+        m_current = std::move(dest);
+        m_currentSize = destSize;
+        m_instanceCount = instanceCount;
+        return update;
+    }
+
+    // Tags the buffers replaced since the last call with the submission of the recorded commands
+    void Submit(uint64_t submission)
+    {
+        m_pool.Submit(submission);
+    }
+
+    inline auto& GetCurrent() const { return m_current; }
+    inline auto& GetStats() const { return m_stats; }
+    inline auto GetPooledCount() const { return m_pool.GetCount(); }
+
+private:
+    FencedPool<Buffer> m_pool;
+    Buffer m_current = {};
+    uint64_t m_currentSize = 0;
+    uint32_t m_instanceCount = 0;
+    uint32_t m_refitsSinceBuild = 0;
+    uint32_t m_maxRefits = 0;
+    TlasStats m_stats;
+};
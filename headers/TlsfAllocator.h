@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct TlsfAllocation
+{
+    uint64_t Offset;
+    uint32_t Block;
+};
+
+struct TlsfStats
+{
+    uint64_t Capacity = 0;
+    uint64_t UsedBytes = 0;
+    uint64_t LargestFreeBlock = 0;
+    uint32_t AllocationCount = 0;
+    uint32_t FreeBlockCount = 0;
+
+    inline double GetUtilization() const { return Capacity > 0 ? (double)UsedBytes / Capacity : 0.0; }
+    // Share of the free space not usable by a single allocation
+    inline double GetFragmentation() const { return Capacity > UsedBytes ? 1.0 - (double)LargestFreeBlock / (Capacity - UsedBytes) : 0.0; }
+};
+
+// Two-level segregated fit allocator over [0, capacity). Sizes are rounded up to granularity, the first level
+// splits by power of two and the second linearly into c_secondLevelCount classes, so Allocate and Free run in
+// constant time. Only offsets are managed, the memory behind them belongs to the caller.
+class TlsfAllocator
+{
+public:
+    static constexpr uint64_t c_invalidOffset = ~0ull;
+
+    TlsfAllocator(uint64_t capacity, uint64_t granularity = 1);
+
+    // Offset is c_invalidOffset if no free block fits, alignment has to be a power of two
+    TlsfAllocation Allocate(uint64_t size, uint64_t alignment = 1);
+    void Free(const TlsfAllocation& allocation);
+
+    TlsfStats GetStats() const;
+
+    inline auto GetCapacity() const { return m_capacity; }
+    inline auto GetUsedBytes() const { return m_usedBytes; }
+    inline auto GetAllocationCount() const { return m_allocationCount; }
+    inline bool IsEmpty() const { return m_allocationCount == 0; }
+
+private:
+    static constexpr uint32_t c_secondLevelLog2 = 4;
+    static constexpr uint32_t c_secondLevelCount = 1 << c_secondLevelLog2;
+    static constexpr uint32_t c_firstLevelCount = 64 - c_secondLevelLog2 + 1;
+    static constexpr uint32_t c_null = ~0u;
+
+    struct Block
+    {
+        uint64_t Offset;
+        // In granules
+        uint64_t Size;
+        uint32_t PrevPhysical;
+        uint32_t NextPhysical;
+        uint32_t PrevFree;
+        uint32_t NextFree;
+        bool Free;
+    };
+
+    static void Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+    uint32_t NewBlock(uint64_t offset, uint64_t size, uint32_t prevPhysical, uint32_t nextPhysical);
+    void InsertFree(uint32_t block);
+    void RemoveFree(uint32_t block);
+    uint32_t FindFree(uint64_t size) const;
+    // Splits the tail beyond size off block into a free block
+    void SplitTail(uint32_t block, uint64_t size);
+    uint32_t MergePhysical(uint32_t first, uint32_t second);
+
+    std::vector<Block> m_blocks;
+    std::vector<uint32_t> m_unusedBlocks;
+    uint32_t m_heads[c_firstLevelCount][c_secondLevelCount];
+    uint32_t m_secondLevelMasks[c_firstLevelCount] = {};
+    uint64_t m_firstLevelMask = 0;
+    uint64_t m_capacity = 0;
+    uint64_t m_granularity = 1;
+    uint64_t m_usedBytes = 0;
+    uint32_t m_allocationCount = 0;
+};
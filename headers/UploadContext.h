@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Device.h"
+#include "FencedPool.h"
+#include "UploadRing.h"
+
+// Batches buffer uploads and BLAS builds into a single command list fed from a persistent staging ring.
+// Nothing blocks on creation, Flush submits the batch and later submissions on the queue are ordered after it.
+class UploadContext
+{
+public:
+    UploadContext(Device& device, uint64_t stagingSize = c_defaultStagingSize);
+
+    VertexBuffer CreateVertexBuffer(const void* data, uint64_t size, uint32_t stride, DXGI_FORMAT format = DXGI_FORMAT_R32G32B32_FLOAT);
+    IndexBuffer CreateIndexBuffer(const void* data, uint64_t size, DXGI_FORMAT format = DXGI_FORMAT_R32_UINT);
+    // Geometry formats are taken from the buffers, transform is an optional row-major 3x4 matrix applied to the positions during the build
+    ComPtr<ID3D12Resource> CreateBottomLevelAccelerationStructure(const VertexBuffer& vertices, const IndexBuffer& indices, uint32_t vertexCount, uint32_t indexCount, const float* transform = nullptr);
+
+    UploadTicket Flush();
+    bool IsComplete(const UploadTicket& ticket) const;
+    void Wait(const UploadTicket& ticket);
+
+private:
+    static constexpr uint64_t c_defaultStagingSize = 64ull << 20;
+    static constexpr uint64_t c_stagingAlignment = 256;
+    static constexpr uint64_t c_scratchArenaSize = 16ull << 20;
+
+    ComPtr<ID3D12Resource> UploadBuffer(const void* data, uint64_t size);
+    // Builds of a batch share one scratch arena and wrap around behind a UAV barrier when it is full
+    D3D12_GPU_VIRTUAL_ADDRESS AllocateScratch(uint64_t size);
+    Commands& GetCommands();
+    void Retire();
+
+    struct PendingResource
+    {
+        ComPtr<ID3D12Resource> Resource;
+        uint64_t Submission;
+    };
+
+    Device& m_device;
+    UploadRing m_ring;
+    ComPtr<ID3D12Resource> m_staging;
+    uint8_t* m_stagingPtr = nullptr;
+
+    Commands m_commands;
+    std::vector<ComPtr<ID3D12Resource>> m_copiedBuffers;
+    std::vector<ComPtr<ID3D12Resource>> m_batchResources;
+    std::deque<PendingResource> m_pendingResources;
+    FencedPool<ComPtr<ID3D12Resource>> m_scratchPool;
+    ComPtr<ID3D12Resource> m_scratch;
+    uint64_t m_scratchSize = 0;
+    uint64_t m_scratchOffset = 0;
+    uint64_t m_lastSubmission = 0;
+    bool m_hasBuilds = false;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Handed out for batched uploads, complete once the device finished the submission
+struct UploadTicket
+{
+    uint64_t Submission = 0;
+};
+
+// Fence-tracked ring suballocator for a persistent staging buffer. Offsets grow monotonically and wrap
+// at the capacity; allocations are released in submission order once their submission completed.
+class UploadRing
+{
+public:
+    static constexpr uint64_t c_invalidOffset = ~0ull;
+
+    UploadRing(uint64_t capacity);
+
+    // Returns c_invalidOffset when there is no contiguous room left until older submissions retire
+    uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+    // Tags all allocations made since the previous call with submission
+    void Submit(uint64_t submission);
+
+    // Releases every allocation tagged with a submission <= completedSubmission
+    void Retire(uint64_t completedSubmission);
+
+    // Oldest submission still holding ring memory, 0 if none
+    uint64_t GetOldestSubmission() const;
+
+    inline uint64_t GetCapacity() const { return m_capacity; }
+    inline uint64_t GetUsed() const { return m_head - m_tail; }
+    inline bool HasUnsubmitted() const { return m_head != m_submittedHead; }
+
+private:
+    struct Block
+    {
+        uint64_t Submission;
+        uint64_t End;
+    };
+
+    std::deque<Block> m_blocks;
+    uint64_t m_capacity = 0;
+    uint64_t m_head = 0;
+    uint64_t m_tail = 0;
+    uint64_t m_submittedHead = 0;
+};
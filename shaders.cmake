@@ -1,11 +1,42 @@
 find_program(DXC dxc.exe)
 
+# Extra arguments are NAME=VALUE defines of the compilation
 function(add_shader FILE TARGET HEADER VARNAME)
+    set(DEFINES)
+    foreach(DEFINE ${ARGN})
+        list(APPEND DEFINES /D ${DEFINE})
+    endforeach()
     add_custom_command(
         OUTPUT ${CMAKE_SOURCE_DIR}/${HEADER}
         MAIN_DEPENDENCY ${CMAKE_SOURCE_DIR}/${FILE}
-        DEPENDS ${CMAKE_SOURCE_DIR}/shaders/Common.hlsl
-        COMMAND ${DXC} /T ${TARGET} /Fh ${CMAKE_SOURCE_DIR}/${HEADER} /Vn ${VARNAME} ${CMAKE_SOURCE_DIR}/${FILE}
+        DEPENDS ${CMAKE_SOURCE_DIR}/shaders/Common.hlsl ${CMAKE_SOURCE_DIR}/headers/CascadeTopologies.h
+        COMMAND ${DXC} /T ${TARGET} /I ${CMAKE_SOURCE_DIR}/headers ${DEFINES} /Fh ${CMAKE_SOURCE_DIR}/${HEADER} /Vn ${VARNAME} ${CMAKE_SOURCE_DIR}/${FILE}
         VERBATIM
     )
-endfunction()
\ No newline at end of file
+endfunction()
+
+# One permutation of a shader per entry of CASCADE_TOPOLOGIES, generated/<NAME><Topology>.h holding <NAME><Topology>,
+# all included by generated/CascadeShaders.h. The headers are appended to OUTPUTS.
+function(add_cascade_shader FILE TARGET NAME OUTPUTS)
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${CMAKE_SOURCE_DIR}/headers/CascadeTopologies.h)
+    file(STRINGS ${CMAKE_SOURCE_DIR}/headers/CascadeTopologies.h ENTRIES REGEX "^ *X\\(")
+    set(HEADERS ${${OUTPUTS}})
+    set(INDEX 0)
+    foreach(ENTRY ${ENTRIES})
+        string(REGEX REPLACE "^ *X\\(([A-Za-z0-9_]+),.*" "\\1" TOPOLOGY ${ENTRY})
+        add_shader(${FILE} ${TARGET} generated/${NAME}${TOPOLOGY}.h ${NAME}${TOPOLOGY} CASCADE_TOPOLOGY=${INDEX})
+        list(APPEND HEADERS generated/${NAME}${TOPOLOGY}.h)
+        math(EXPR INDEX "${INDEX} + 1")
+    endforeach()
+    set(${OUTPUTS} ${HEADERS} PARENT_SCOPE)
+endfunction()
+
+function(write_cascade_shaders HEADERS)
+    set(CONTENT "#pragma once\n\n")
+    foreach(HEADER ${HEADERS})
+        get_filename_component(FILE ${HEADER} NAME)
+        string(APPEND CONTENT "#include \"${FILE}\"\n")
+    endforeach()
+    file(WRITE ${CMAKE_SOURCE_DIR}/generated/CascadeShaders.h.in ${CONTENT})
+    configure_file(${CMAKE_SOURCE_DIR}/generated/CascadeShaders.h.in ${CMAKE_SOURCE_DIR}/generated/CascadeShaders.h COPYONLY)
+endfunction()
@@ -3,6 +3,7 @@
 cbuffer Constants : register(b0)
 {
     uint cascade;
+    uint cascadeCount;
 };
 
 cbuffer CascadeConstants : register(b1)
@@ -11,17 +12,44 @@ cbuffer CascadeConstants : register(b1)
     float3 extends;
     float3 offset;
     uint2 size;
+    uint layout;
 };
 
 Texture2DArray<float4> higherCascade : register(t0);
+Texture2DArray<uint> hits : register(t1);
+StructuredBuffer<Instance> Instances : register(t2);
+StructuredBuffer<uint> Bricks : register(t3);
 RWTexture2DArray<float4> currentCascade : register(u0);
 SamplerState linearSampler : register(s0);
 
 float4 SingleSample(float3 pixelCoord)
 {
-    return higherCascade.SampleLevel(linearSampler, float3(pixelCoord.xy / size.xy, pixelCoord.z), 0);
+    return higherCascade.SampleLevel(linearSampler, float3(pixelCoord.xy / GetAtlasSize(probeCount, cascade + 1), pixelCoord.z), 0);
 }
 
+// Direction-major keeps the directions of a probe in separate tiles, the bilinear tap SingleSample takes between
+// them becomes four loads
+float4 SampleDirections(uint3 atlasProbe, float2 uv, float2 tapOffset)
+{
+    uint2 hpixelCount = GetPixelCount(cascade + 1);
+    float2 coord = uv * hpixelCount + tapOffset - 0.5f;
+    float2 base = floor(coord);
+    float2 fraction = coord - base;
+
+    float4 ret = 0.f;
+    for (uint i = 0; i < 4; ++i)
+    {
+        uint2 corner = uint2(i & 1, i >> 1);
+        uint2 direction = clamp(int2(base) + int2(corner), 0, int2(hpixelCount) - 1);
+        float2 weight = lerp(1.f - fraction, fraction, float2(corner));
+        ret += weight.x * weight.y * higherCascade.Load(int4(GetDirectionTexel(probeCount, cascade + 1, layout, atlasProbe, direction), 0));
+    }
+    return ret;
+}
+
+// A direction covers a 1 << c_angularShift square of the next level's, averaged with one bilinear tap per 2x2 of it
+static const uint c_blockTaps = max((1u << c_angularShift) / 2, 1u);
+
 float4 SampleHigherCascade(float2 uv, float3 pos)
 {
     uint3 nextCascadeProbeCount = probeCount >> (cascade + 1);
@@ -34,18 +62,21 @@ float4 SampleHigherCascade(float2 uv, float3 pos)
     float3 interp = t < 0 ? 1 + t : t;
     float3 ll = t < 0.f ? floor(higherPos) - 1 : floor(higherPos);
 
-    float3 pixelCoordll = float3(ll.xy * hpixelCount + uv * hpixelCount, ll.z);
-
-    float4 samples[8] = {
-        SingleSample(pixelCoordll + float3(0, 0, 0)),
-        SingleSample(pixelCoordll + float3(hpixelCount.x, 0, 0)),
-        SingleSample(pixelCoordll + float3(0, hpixelCount.y, 0)),
-        SingleSample(pixelCoordll + float3(hpixelCount.xy, 0)),
-        SingleSample(pixelCoordll + float3(0, 0, 1)),
-        SingleSample(pixelCoordll + float3(hpixelCount.x, 0, 1)),
-        SingleSample(pixelCoordll + float3(0, hpixelCount.y, 1)),
-        SingleSample(pixelCoordll + float3(hpixelCount.xy, 1))
-    };
+    float4 samples[8];
+    for (uint i = 0; i < 8; ++i)
+    {
+        int3 corner = int3(ll) + int3(i & 1, (i >> 1) & 1, i >> 2);
+        samples[i] = 0.f;
+        for (uint tap = 0; tap < c_blockTaps * c_blockTaps; ++tap)
+        {
+            float2 tapOffset = float2(tap % c_blockTaps, tap / c_blockTaps) * 2.f + 1.f - c_blockTaps;
+            if (layout == c_directionMajor)
+                samples[i] += SampleDirections(GetCornerProbe(Bricks, probeCount, cascade + 1, corner), uv, tapOffset);
+            else
+                samples[i] += SingleSample(GetCornerTexel(Bricks, probeCount, cascade + 1, corner) + float3(uv * hpixelCount + tapOffset, 0));
+        }
+        samples[i] /= c_blockTaps * c_blockTaps;
+    }
 
     float4 lerpX[4];
     lerpX[0] = lerp(samples[0], samples[1], interp.x);
@@ -64,10 +95,33 @@ float4 SampleHigherCascade(float2 uv, float3 pos)
 void main(in uint3 index : SV_DispatchThreadId)
 {
     uint2 pixelCount = GetPixelCount(cascade);
-    uint3 index3d = uint3(index.xy / pixelCount, index.z);
+    uint3 index3d;
+    uint2 direction;
+    SplitDispatchIndex(probeCount, cascade, layout, index, index3d, direction);
     uint3 levelResolution = probeCount >> cascade;
-
-    float2 uv = (float2(index.xy) - float2(index3d.xy * pixelCount) + 0.5) / float2(pixelCount);
+    if (index3d.z >= levelResolution.z)
+        return;
+
+    // Absent bricks are neither traced nor read, see CascadeBricks
+    uint slot = Bricks[GetBrickIndex(probeCount, cascade, index3d)];
+    if (slot == c_absentBrick)
+        return;
+    uint3 texel = GetDirectionTexel(probeCount, cascade, layout, GetAtlasProbe(probeCount, cascade, slot, index3d), direction);
+
+    // A hit is opaque, the levels above only show through misses
+    uint hit = hits[texel];
+    if (hit != 0)
+    {
+        currentCascade[texel] = float4(Instances[hit - 1].Emission.rgb, 0.f);
+        return;
+    }
+    if (cascade + 1 >= cascadeCount)
+    {
+        currentCascade[texel] = float4(0.f, 0.f, 0.f, 1.f);
+        return;
+    }
+
+    float2 uv = (float2(direction) + 0.5) / float2(pixelCount);
     float3 pos = float3(index3d + 0.5) / float3(levelResolution);
 /*
     float gauss[] = { 1, 2, 1, 2, 4, 2, 1, 2, 1 };
@@ -82,8 +136,5 @@ void main(in uint3 index : SV_DispatchThreadId)
 
     nextLevelRad /= 16.f;*/
 
-    float4 nextLevelRad = SampleHigherCascade(uv, pos);
-    float4 currLevelRad = currentCascade[index];
-
-    currentCascade[index] = float4(currLevelRad.rgb + currLevelRad.a * nextLevelRad.rgb, currLevelRad.a * nextLevelRad.a);
+    currentCascade[texel] = SampleHigherCascade(uv, pos);
 }
\ No newline at end of file
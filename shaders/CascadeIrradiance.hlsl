@@ -0,0 +1,72 @@
+#include "Common.hlsl"
+
+cbuffer CascadeConstants : register(b0)
+{
+    uint3 probeCount;
+    float3 extends;
+    float3 offset;
+    uint2 size;
+    uint layout;
+};
+
+Texture2DArray<float4> cascade : register(t0);
+StructuredBuffer<uint> Bricks : register(t1);
+RWTexture2DArray<float4> irradiance : register(u0);
+
+static const uint c_groupSize = 64;
+groupshared float3 partialSums[c_groupSize][c_shCoefficients];
+
+// One group per probe of cascade 0, projecting the same directions integrateCascades in Drawing.ps.hlsl used to
+// sum over, so the evaluated irradiance replaces that sum
+[numthreads(c_groupSize, 1, 1)]
+void main(in uint3 probe : SV_GroupID, in uint thread : SV_GroupIndex)
+{
+    // The whole group leaves together, absent probes are never looked up
+    uint slot = Bricks[GetBrickIndex(probeCount, 0, probe)];
+    if (slot == c_absentBrick)
+        return;
+    uint3 atlasProbe = GetAtlasProbe(probeCount, 0, slot, probe);
+    uint2 pixelCount = GetPixelCount(0);
+
+    float3 sums[c_shCoefficients];
+    for (uint i = 0; i < c_shCoefficients; ++i)
+        sums[i] = 0.f;
+    for (uint x = thread; x < pixelCount.x; x += c_groupSize)
+    {
+        for (uint y = 0; y < pixelCount.y; ++y)
+        {
+            float3 radiance = cascade[GetDirectionTexel(probeCount, 0, layout, atlasProbe, uint2(x, y))].rgb;
+            float basis[9];
+            GetShBasis(fromSpherical((float2(x, y) + 0.5f) / pixelCount), basis);
+            for (uint i = 0; i < c_shCoefficients; ++i)
+                sums[i] += radiance * basis[i];
+        }
+    }
+    for (uint i = 0; i < c_shCoefficients; ++i)
+        partialSums[thread][i] = sums[i];
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint stride = c_groupSize / 2; stride > 0; stride /= 2)
+    {
+        if (thread < stride)
+        {
+            for (uint i = 0; i < c_shCoefficients; ++i)
+                partialSums[thread][i] += partialSums[thread + stride][i];
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (thread < c_irradianceTexels)
+    {
+        float values[4];
+        for (uint c = 0; c < 4; ++c)
+        {
+            uint index = thread * 4 + c;
+            uint coefficient = min(index / 3, c_shCoefficients - 1);
+            float3 sum = partialSums[0][coefficient];
+            float value = index % 3 == 0 ? sum.r : (index % 3 == 1 ? sum.g : sum.b);
+            values[c] = index < c_shCoefficients * 3 ? value * GetShCosineLobe(coefficient) / (pixelCount.x * pixelCount.y) : 0.f;
+        }
+        irradiance[uint3(thread * probeCount.x + probe.x, probe.y, probe.z)] = float4(values[0], values[1], values[2], values[3]);
+    }
+}
@@ -3,6 +3,10 @@
 cbuffer Constants : register(b0)
 {
     uint cascade;
+    // First slice of the range dispatched, see CascadeScheduler
+    uint sliceBegin;
+    // Dispatch z walks the packed probes of a ProbeInvalidation instead of slices
+    uint probeListed;
 };
 
 cbuffer CascadeConstants : register(b1)
@@ -11,38 +15,50 @@ cbuffer CascadeConstants : register(b1)
     float3 extends;
     float3 offset;
     uint2 size;
+    uint layout;
 };
 
 RaytracingAccelerationStructure Scene : register(t0);
-StructuredBuffer<Instance> Instances : register(t1);
+StructuredBuffer<uint> Probes : register(t1);
+StructuredBuffer<uint> Bricks : register(t2);
 
-RWTexture2DArray<float4> Cascades : register(u0);
+// Instance id + 1 of the closest hit, 0 for a miss, resolved by CascadeAccumulation.hlsl
+RWTexture2DArray<uint> Hits : register(u0);
 
 struct RayPayload
 {
-    float4 color;
+    uint hit;
 };
 
-float GetEnd(int cascade)
-{
-    const float interval = 0.03125f;
-    return (interval * (1 - pow(8, cascade + 1))) / (1 - 8);
-}
-
 [shader("raygeneration")]
 void RayGen()
 {
-    uint3 pixelIndex = uint3(DispatchRaysIndex());
-
     uint2 pixelCount = GetPixelCount(cascade);
-    uint3 index3d = uint3(DispatchRaysIndex().xy / pixelCount, DispatchRaysIndex().z);
+    uint3 index3d;
+    uint2 direction;
+    if (probeListed)
+    {
+        uint probe = Probes[DispatchRaysIndex().z];
+        index3d = uint3(probe & 0x3ff, (probe >> 10) & 0x3ff, probe >> 20);
+        direction = DispatchRaysIndex().xy;
+    }
+    else
+    {
+        SplitDispatchIndex(probeCount, cascade, layout, uint3(DispatchRaysIndex().xy, DispatchRaysIndex().z + sliceBegin), index3d, direction);
+    }
     uint3 levelProbeCount = probeCount >> cascade;
 
+    // Absent bricks are neither traced nor read, see CascadeBricks
+    uint slot = Bricks[GetBrickIndex(probeCount, cascade, index3d)];
+    if (slot == c_absentBrick)
+        return;
+    uint3 texel = GetDirectionTexel(probeCount, cascade, layout, GetAtlasProbe(probeCount, cascade, slot, index3d), direction);
+
     float3 cascadePosition = float3(index3d + 0.5) / float3(levelProbeCount) * 2 - 1;
     cascadePosition *= extends;
     cascadePosition += offset;
 
-    float2 uv = (pixelIndex.xy - index3d.xy * pixelCount + 0.5) / float2(pixelCount);
+    float2 uv = (direction + 0.5) / float2(pixelCount);
     float3 rayStart = cascadePosition;
     float3 rayDir = fromSpherical(uv);
 
@@ -55,23 +71,21 @@ void RayGen()
     ray.TMin = 0.01f + start;
     ray.TMax = end;
 
-    RayPayload payload = { float4(0, 0, 0, 0) };
+    RayPayload payload = { 0 };
 
     TraceRay(Scene, 0, ~0, 0, 0, 0, ray, payload);
 
-    Cascades[DispatchRaysIndex()] = payload.color;
+    Hits[texel] = payload.hit;
 }
 
 [shader("closesthit")]
 void RayHit(inout RayPayload payload, in BuiltInTriangleIntersectionAttributes attr)
 {
-    uint instanceId = InstanceID();
-    Instance instance = Instances[instanceId];
-    payload.color = float4(instance.Emission.rgb, 0.f);
+    payload.hit = InstanceID() + 1;
 }
 
 [shader("miss")]
 void RayMiss(inout RayPayload payload)
 {
-    payload.color = float4(0.f, 0.f, 0.f, 1.f);
+    payload.hit = 0;
 }
@@ -1,3 +1,5 @@
+#include "CascadeTopologies.h"
+
 #define M_PI 3.1415926f
 
 struct Instance
@@ -23,8 +25,214 @@ float2 toSpherical(float3 dir)
     return spherical / float2(M_PI, M_PI) * float2(0.5, 1.f) + float2(0.5, 0.f);
 }
 
+// Mirrors EncodeOctahedral in MeshQuantization.cpp
+float2 EncodeOctahedral(float3 n)
+{
+    float2 e = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    if (n.z < 0)
+        e = (1 - abs(e.yx)) * float2(e.x >= 0 ? 1 : -1, e.y >= 0 ? 1 : -1);
+    return e;
+}
+
+// Inverse of EncodeOctahedral in MeshQuantization.cpp
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0 ? -t : t;
+    n.y += n.y >= 0 ? -t : t;
+    return normalize(n);
+}
+
+// Entry of CASCADE_TOPOLOGIES the shader is compiled for, mirrors CascadeTopology of CascadeCommon.h
+#ifndef CASCADE_TOPOLOGY
+#define CASCADE_TOPOLOGY 0
+#endif
+#define CASCADE_TOPOLOGY_PIXELS(name, pixelsX, pixelsY, angularShift, interval, growth) uint2(pixelsX, pixelsY),
+#define CASCADE_TOPOLOGY_SHIFT(name, pixelsX, pixelsY, angularShift, interval, growth) angularShift,
+#define CASCADE_TOPOLOGY_INTERVAL(name, pixelsX, pixelsY, angularShift, interval, growth) float2(interval, growth),
+static const uint2 c_topologyPixels[] = {CASCADE_TOPOLOGIES(CASCADE_TOPOLOGY_PIXELS) uint2(0, 0)};
+static const uint c_topologyShifts[] = {CASCADE_TOPOLOGIES(CASCADE_TOPOLOGY_SHIFT) 0};
+static const float2 c_topologyIntervals[] = {CASCADE_TOPOLOGIES(CASCADE_TOPOLOGY_INTERVAL) float2(0.f, 0.f)};
+static const uint2 c_cascadePixels = c_topologyPixels[CASCADE_TOPOLOGY];
+static const uint c_angularShift = c_topologyShifts[CASCADE_TOPOLOGY];
+static const float c_cascadeInterval = c_topologyIntervals[CASCADE_TOPOLOGY].x;
+static const float c_cascadeGrowth = c_topologyIntervals[CASCADE_TOPOLOGY].y;
+
 uint2 GetPixelCount(uint cascade)
 {
-    uint2 pixelCount = uint2(64, 32) << cascade;
-    return pixelCount;
+    return c_cascadePixels << (c_angularShift * cascade);
+}
+
+float GetEnd(int cascade)
+{
+    return (c_cascadeInterval * (1 - pow(c_cascadeGrowth, cascade + 1))) / (1 - c_cascadeGrowth);
+}
+
+uint2 GetAtlasSize(uint3 probeCount, uint cascade)
+{
+    return (probeCount.xy >> cascade) * GetPixelCount(cascade);
+}
+
+// Mirrors c_cascadeBrickSize, GetBrickSize, GetAtlasProbe, CascadeLayout, GetDirectionTexel and SplitDispatchIndex of
+// CascadeCommon.h, see CascadeBricks
+static const uint c_brickSize = 4;
+static const uint c_absentBrick = 0xffffffff;
+static const uint c_probeMajor = 0;
+static const uint c_directionMajor = 1;
+
+uint3 GetBrickSize(uint3 levelProbeCount)
+{
+    return min(c_brickSize, levelProbeCount);
+}
+
+// Entry of a probe's brick in the indirection of all levels
+uint GetBrickIndex(uint3 probeCount, uint cascade, uint3 probe)
+{
+    uint offset = 0;
+    for (uint i = 0; i < cascade; ++i)
+    {
+        uint3 levelBricks = (probeCount >> i) / GetBrickSize(probeCount >> i);
+        offset += levelBricks.x * levelBricks.y * levelBricks.z;
+    }
+    uint3 levelProbeCount = probeCount >> cascade;
+    uint3 bricks = levelProbeCount / GetBrickSize(levelProbeCount);
+    uint3 brick = probe / GetBrickSize(levelProbeCount);
+    return offset + (brick.z * bricks.y + brick.y) * bricks.x + brick.x;
+}
+
+// Position in the atlas of a probe whose brick lives in slot
+uint3 GetAtlasProbe(uint3 probeCount, uint cascade, uint slot, uint3 probe)
+{
+    uint3 levelProbeCount = probeCount >> cascade;
+    uint3 brickSize = GetBrickSize(levelProbeCount);
+    uint2 bricks = levelProbeCount.xy / brickSize.xy;
+    uint3 brick = uint3(slot % bricks.x, slot / bricks.x % bricks.y, slot / (bricks.x * bricks.y));
+    return brick * brickSize + probe % brickSize;
+}
+
+// Texel of one direction of the probe at atlasProbe
+uint3 GetDirectionTexel(uint3 probeCount, uint cascade, uint layout, uint3 atlasProbe, uint2 direction)
+{
+    if (layout == c_directionMajor)
+        return uint3(direction * (probeCount.xy >> cascade) + atlasProbe.xy, atlasProbe.z);
+    return uint3(atlasProbe.xy * GetPixelCount(cascade) + direction, atlasProbe.z);
+}
+
+// Probe and direction of a dispatch over the texels of a level, the inverse of GetDirectionTexel for dense bricks
+void SplitDispatchIndex(uint3 probeCount, uint cascade, uint layout, uint3 index, out uint3 probe, out uint2 direction)
+{
+    uint2 levelProbeCount = (probeCount >> cascade).xy;
+    uint2 pixelCount = GetPixelCount(cascade);
+    if (layout == c_directionMajor)
+    {
+        direction = index.xy / levelProbeCount;
+        probe = uint3(index.xy - direction * levelProbeCount, index.z);
+    }
+    else
+    {
+        probe = uint3(index.xy / pixelCount, index.z);
+        direction = index.xy - probe.xy * pixelCount;
+    }
+}
+
+// Atlas position of a trilinear corner's probe, resident by construction
+uint3 GetCornerProbe(StructuredBuffer<uint> bricks, uint3 probeCount, uint cascade, int3 corner)
+{
+    uint3 probe = clamp(corner, 0, int3(probeCount >> cascade) - 1);
+    return GetAtlasProbe(probeCount, cascade, bricks[GetBrickIndex(probeCount, cascade, probe)], probe);
+}
+
+// Probe-major texel of a trilinear corner. Corners off a single probe axis keep their offset from its only probe,
+// so the clamped samples match the dense layout.
+float3 GetCornerTexel(StructuredBuffer<uint> bricks, uint3 probeCount, uint cascade, int3 corner)
+{
+    uint3 probe = clamp(corner, 0, int3(probeCount >> cascade) - 1);
+    int3 texel = GetDirectionTexel(probeCount, cascade, c_probeMajor, GetCornerProbe(bricks, probeCount, cascade, corner), 0);
+    return texel + (corner - int3(probe)) * int3(GetPixelCount(cascade), 1);
+}
+
+// Mirrors c_irradianceTexels, GetShBasis and GetShCosineLobe of CascadeCommon.h
+static const uint c_shCoefficients = 9;
+static const uint c_irradianceTexels = 7;
+
+void GetShBasis(float3 d, out float basis[9])
+{
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * d.y;
+    basis[2] = 0.488603f * d.z;
+    basis[3] = 0.488603f * d.x;
+    basis[4] = 1.092548f * d.x * d.y;
+    basis[5] = 1.092548f * d.y * d.z;
+    basis[6] = 0.315392f * (3.f * d.z * d.z - 1.f);
+    basis[7] = 1.092548f * d.x * d.z;
+    basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+float GetShCosineLobe(uint coefficient)
+{
+    return coefficient == 0 ? M_PI : (coefficient < 4 ? M_PI * 2.f / 3.f : M_PI / 4.f);
+}
+
+// Trilinear interpolation of the probes around pos with the weights of SampleHigherCascade in
+// CascadeAccumulation.hlsl, x and y filtered by the sampler
+float3 SampleIrradiance(Texture2DArray<float4> irradianceVolume, SamplerState linearSampler, uint3 probeCount, float3 n, float3 pos)
+{
+    float3 probePos = clamp(pos * probeCount, 0.51f, probeCount - 0.51f);
+    float lowerSlice = floor(probePos.z - 0.5f);
+    float interp = probePos.z - 0.5f - lowerSlice;
+
+    float coefficients[c_irradianceTexels * 4];
+    for (uint i = 0; i < c_irradianceTexels; ++i)
+    {
+        float2 uv = float2(i * probeCount.x + probePos.x, probePos.y) / float2(c_irradianceTexels * probeCount.x, probeCount.y);
+        float4 lower = irradianceVolume.SampleLevel(linearSampler, float3(uv, lowerSlice), 0);
+        float4 upper = irradianceVolume.SampleLevel(linearSampler, float3(uv, lowerSlice + 1), 0);
+        float4 value = lerp(lower, upper, interp);
+        coefficients[i * 4] = value.x;
+        coefficients[i * 4 + 1] = value.y;
+        coefficients[i * 4 + 2] = value.z;
+        coefficients[i * 4 + 3] = value.w;
+    }
+
+    float basis[9];
+    GetShBasis(n, basis);
+    float3 irradiance = 0.f;
+    for (uint c = 0; c < c_shCoefficients; ++c)
+        irradiance += basis[c] * float3(coefficients[c * 3], coefficients[c * 3 + 1], coefficients[c * 3 + 2]);
+    return irradiance;
+}
+
+// Surface position normalized to the cascade volume
+float3 GetCascadePosition(float3 worldPosition, float3 n, float3 offset, float3 extends)
+{
+    // Quick hack to avoid under-surface interpolations
+    return (worldPosition + 0.1 * n - offset) / extends * 0.5 + 0.5;
+}
+
+// Mirrors the constants and helpers of DeferredShading.h
+static const float c_upsampleNormalPower = 16.f;
+static const float c_upsampleDepthScale = 0.05f;
+static const float c_upsampleMinWeight = 0.05f;
+
+uint2 GetGatherSource(uint2 gathered, uint downscale, uint2 size)
+{
+    return min(gathered * downscale + downscale / 2, size - 1);
+}
+
+float GetUpsampleWeight(float3 n, float depth, float3 tapNormal, float tapDepth)
+{
+    if (tapDepth <= 0.f)
+        return 0.f;
+    float normalWeight = pow(max(dot(n, tapNormal), 0.f), c_upsampleNormalPower);
+    float depthWeight = exp(-abs(depth - tapDepth) / (c_upsampleDepthScale * depth));
+    return normalWeight * depthWeight;
+}
+
+// World position and linear view depth of a pixel with a non zero value in the reversed depth buffer
+float4 ReconstructPosition(float4x4 inverseViewProjection, uint2 pixel, uint2 size, float depth)
+{
+    float2 ndc = (pixel + 0.5f) / size * float2(2, -2) + float2(-1, 1);
+    float4 world = mul(inverseViewProjection, float4(ndc, depth, 1));
+    return float4(world.xyz / world.w, 1.f / world.w);
 }
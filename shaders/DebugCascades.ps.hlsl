@@ -13,29 +13,34 @@ cbuffer CascadeConstants : register(b1)
     float3 extends;
     float3 offset;
     uint2 size;
+    uint layout;
 };
 
 Texture2DArray<float4> RadianceCascade : register(t0);
 SamplerState linearSampler : register(s0);
 
-float4 SampleCascade(uint cascade, uint3 index3d, float2 uv)
+float4 SampleCascade(uint cascade, uint3 atlasProbe, float2 uv)
 {
     uint2 pixelCount = GetPixelCount(cascade);
 
+    // Neighboring directions are not neighboring texels, the nearest one is shown
+    if (layout == c_directionMajor)
+        return RadianceCascade.Load(int4(GetDirectionTexel(probeCount, cascade, layout, atlasProbe, min(uint2(uv * pixelCount), pixelCount - 1)), 0));
+
     float2 pixelCoord = clamp(uv * pixelCount, 0.5f, pixelCount - 0.5f);
-    float2 coord = (index3d.xy * pixelCount + pixelCoord) / size.xy;
+    float2 coord = (atlasProbe.xy * pixelCount + pixelCoord) / GetAtlasSize(probeCount, cascade);
 
-    return RadianceCascade.SampleLevel(linearSampler, float3(coord, index3d.z), 0);
+    return RadianceCascade.SampleLevel(linearSampler, float3(coord, atlasProbe.z), 0);
 }
 
 struct PixelIn
 {
-    uint3 Index : Indexs;
+    nointerpolation uint3 AtlasProbe : AtlasProbe;
     float3 Dir : Direction;
     float4 Position : SV_Position;
 };
 
 float4 main(in PixelIn input) : SV_Target
 {
-    return SampleCascade(cascade, input.Index, toSpherical(input.Dir));
-}
\ No newline at end of file
+    return SampleCascade(cascade, input.AtlasProbe, toSpherical(input.Dir));
+}
@@ -13,11 +13,14 @@ cbuffer CascadeConstants : register(b1)
     float3 extends;
     float3 offset;
     uint2 size;
+    uint layout;
 };
 
+StructuredBuffer<uint> Bricks : register(t1);
+
 struct VertexOut
 {
-    uint3 Index : Indexs;
+    uint3 AtlasProbe : AtlasProbe;
     float3 Dir : Direction;
     float4 Position : SV_Position;
 };
@@ -40,8 +43,13 @@ VertexOut main(in float3 position : Position, in float3 normal : Normal, in uint
     float3 worldPos = mul(model, float4(position * gridRes, 1)).xyz;
 
     VertexOut output;
-    output.Index = cascadeIndex;
     output.Dir = normalize(normal);
     output.Position = mul(viewProjection, float4(worldPos + cascadePosition, 1.f));
+
+    // Probes of absent bricks collapse to a point and draw nothing
+    uint slot = Bricks[GetBrickIndex(probeCount, cascade, cascadeIndex)];
+    output.AtlasProbe = slot == c_absentBrick ? 0 : GetAtlasProbe(probeCount, cascade, slot, cascadeIndex);
+    if (slot == c_absentBrick)
+        output.Position = 0.f;
     return output;
 }
\ No newline at end of file
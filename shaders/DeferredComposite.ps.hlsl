@@ -0,0 +1,72 @@
+#include "Common.hlsl"
+
+cbuffer DeferredConstants : register(b0)
+{
+    float4x4 InverseViewProjection;
+    uint2 ScreenSize;
+    uint2 GatherSize;
+    uint Downscale;
+};
+
+cbuffer CascadeConstants : register(b1)
+{
+    uint3 probeCount;
+    float3 extends;
+    float3 offset;
+    uint2 size;
+};
+
+Texture2D<float4> Albedo : register(t0);
+Texture2D<float4> Emission : register(t1);
+Texture2D<float2> Normals : register(t2);
+Texture2D<float> Depth : register(t3);
+Texture2D<float4> Gathered : register(t4);
+Texture2DArray<float4> Irradiance : register(t5);
+
+SamplerState linearSampler : register(s0);
+
+// Gathered pixel left of or above a pixel and the bilinear weight of the one after it, see GetUpsampleTap in
+// DeferredShading.cpp
+void GetUpsampleTap(uint pixel, uint gatheredSize, out uint tap, out float fraction)
+{
+    float position = ((float)pixel - (float)(Downscale / 2)) / Downscale;
+    float base = floor(position);
+    tap = base < 0.f ? 0 : min((uint)base, gatheredSize - 1);
+    fraction = base < 0.f || base >= gatheredSize - 1 ? 0.f : position - base;
+}
+
+// Bilateral upsample of DeferredGather.hlsl and composite, UpsampleIrradiance and Composite in DeferredShading.cpp
+float4 main(in float4 position : SV_Position) : SV_Target
+{
+    uint2 pixel = position.xy;
+    float depth = Depth[pixel];
+    if (depth == 0.f)
+        discard;
+
+    float4 world = ReconstructPosition(InverseViewProjection, pixel, ScreenSize, depth);
+    float3 n = DecodeOctahedral(Normals[pixel]);
+    uint2 tap;
+    float2 fraction;
+    GetUpsampleTap(pixel.x, GatherSize.x, tap.x, fraction.x);
+    GetUpsampleTap(pixel.y, GatherSize.y, tap.y, fraction.y);
+
+    float3 sum = 0.f;
+    float weightSum = 0.f;
+    for (uint corner = 0; corner < 4; ++corner)
+    {
+        uint2 cornerOffset = uint2(corner & 1, corner >> 1);
+        uint2 cornerPixel = min(tap + cornerOffset, GatherSize - 1);
+        float2 bilinear = lerp(1.f - fraction, fraction, float2(cornerOffset));
+        float4 gathered = Gathered[cornerPixel];
+        float3 tapNormal = DecodeOctahedral(Normals[GetGatherSource(cornerPixel, Downscale, ScreenSize)]);
+        float weight = bilinear.x * bilinear.y * GetUpsampleWeight(n, world.w, tapNormal, gathered.w);
+        sum += gathered.rgb * weight;
+        weightSum += weight;
+    }
+
+    // No tap on the same surface, the pixel gathers on its own
+    float3 irradiance = sum / weightSum;
+    if (weightSum < c_upsampleMinWeight)
+        irradiance = SampleIrradiance(Irradiance, linearSampler, probeCount, n, GetCascadePosition(world.xyz, n, offset, extends));
+    return float4(irradiance * Albedo[pixel].rgb + Emission[pixel].rgb, 0.f);
+}
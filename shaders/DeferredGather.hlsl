@@ -0,0 +1,47 @@
+#include "Common.hlsl"
+
+cbuffer DeferredConstants : register(b0)
+{
+    float4x4 InverseViewProjection;
+    uint2 ScreenSize;
+    uint2 GatherSize;
+    uint Downscale;
+};
+
+cbuffer CascadeConstants : register(b1)
+{
+    uint3 probeCount;
+    float3 extends;
+    float3 offset;
+    uint2 size;
+};
+
+Texture2D<float2> Normals : register(t0);
+Texture2D<float> Depth : register(t1);
+Texture2DArray<float4> Irradiance : register(t2);
+// Irradiance and linear depth of the G-buffer pixel, depth 0 on the background
+RWTexture2D<float4> Gathered : register(u0);
+
+SamplerState linearSampler : register(s0);
+
+// One thread per gathered pixel, the center of a Downscale x Downscale block of the G-buffer, see GatherIrradiance
+// in DeferredShading.cpp
+[numthreads(8, 8, 1)]
+void main(in uint3 id : SV_DispatchThreadID)
+{
+    if (any(id.xy >= GatherSize))
+        return;
+
+    uint2 source = GetGatherSource(id.xy, Downscale, ScreenSize);
+    float depth = Depth[source];
+    if (depth == 0.f)
+    {
+        Gathered[id.xy] = 0.f;
+        return;
+    }
+
+    float4 world = ReconstructPosition(InverseViewProjection, source, ScreenSize, depth);
+    float3 n = DecodeOctahedral(Normals[source]);
+    float3 cascadePos = GetCascadePosition(world.xyz, n, offset, extends);
+    Gathered[id.xy] = float4(SampleIrradiance(Irradiance, linearSampler, probeCount, n, cascadePos), world.w);
+}
@@ -8,6 +8,9 @@ cbuffer CameraConstants : register(b0)
 cbuffer ObjectConstants : register(b1)
 {
     uint InstanceId;
+    float3 PositionScale;
+    float3 PositionBias;
+    uint OctahedralNormals;
 }
 
 StructuredBuffer<Instance> instances : register(t0);
@@ -34,8 +37,12 @@ VertexOut main(in VertexIn input)
     VertexOut output;
     output.Albedo = instance.Albedo;
     output.Emission = instance.Emission;
-    output.Normal = normalize(mul(instance.Transform, float4(input.Normal, 0))).xyz;
-    output.WorldPosition = mul(instance.Transform, float4(input.Position, 1)).xyz;
+    // Packed layouts store normalized positions and octahedral normals, the missing z of R16G16_SNORM reads as 0
+    float3 position = input.Position * PositionScale + PositionBias;
+    float3 normal = OctahedralNormals ? DecodeOctahedral(input.Normal.xy) : input.Normal;
+
+    output.Normal = normalize(mul(instance.Transform, float4(normal, 0))).xyz;
+    output.WorldPosition = mul(instance.Transform, float4(position, 1)).xyz;
     output.Position = mul(ViewProjection, float4(output.WorldPosition, 1));
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "Common.hlsl"
+
+struct PixelIn
+{
+    float4 Albedo : Albedo;
+    float4 Emission : Emission;
+    float3 Normal : Normal;
+    float3 WorldPosition : WorldPosition;
+    float4 Position : SV_Position;
+};
+
+struct GBufferOut
+{
+    float4 Albedo : SV_Target0;
+    float4 Emission : SV_Target1;
+    float2 Normal : SV_Target2;
+};
+
+// Deferred counterpart of Drawing.ps.hlsl, positions come back from the depth buffer in DeferredGather.hlsl
+GBufferOut main(in PixelIn input)
+{
+    GBufferOut output;
+    output.Albedo = input.Albedo;
+    output.Emission = input.Emission;
+    output.Normal = EncodeOctahedral(normalize(input.Normal));
+    return output;
+}
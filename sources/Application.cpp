@@ -3,6 +3,7 @@
 #include "Scene.h"
 
 #include <chrono>
+#include <cstdio>
 
 Application::Application(uint32_t width, uint32_t height)
     : m_camera((float)M_PI / 2, (float)width / height, 0.1f)
@@ -11,20 +12,31 @@ Application::Application(uint32_t width, uint32_t height)
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
     m_window = glfwCreateWindow(width, height, "dx12-radiance-casccades", nullptr, nullptr);
-    m_renderer = std::make_unique<Renderer>(glfwGetWin32Window(m_window), width, height);
+    MeshLayout meshLayout;
+    meshLayout.Positions = PositionFormat::Snorm16;
+    meshLayout.OctahedralNormals = true;
+    meshLayout.CompactIndices = true;
+    m_renderer = std::make_unique<Renderer>(glfwGetWin32Window(m_window), width, height, meshLayout);
+
+    const auto& device = m_renderer->GetDevice();
+    const auto& pipelines = device.GetPipelineCache().GetStats();
+    std::printf("Pipeline cache: %u hits, %u misses, %u rejected, %u damaged%s, %.1f ms creating pipelines\n",
+        pipelines.Hits, pipelines.Misses, pipelines.Rejected, pipelines.Damaged, pipelines.Stale ? ", stale cache dropped" : "", device.GetPipelineSeconds() * 1e3);
 
     m_camera.SetPosition(0, 1.f, 4.f);
 
-    m_cornell = std::make_unique<Model>("..\\..\\Models\\CornellBox-Original.obj", m_renderer->GetDevice());
-    m_sphere = std::make_unique<Model>("..\\..\\Models\\Sphere.glb", m_renderer->GetDevice());
-    m_bunny = std::make_unique<Model>("..\\..\\Models\\Bunny.obj", m_renderer->GetDevice());
-    m_teapot = std::make_unique<Model>("..\\..\\Models\\teapot.obj", m_renderer->GetDevice());
+    auto& uploads = m_renderer->GetUploadContext();
+    m_cornell = std::make_unique<Model>("..\\..\\Models\\CornellBox-Original.obj", uploads, meshLayout);
+    m_sphere = std::make_unique<Model>("..\\..\\Models\\Sphere.glb", uploads, meshLayout);
+    m_bunny = std::make_unique<Model>("..\\..\\Models\\Bunny.obj", uploads, meshLayout);
+    m_teapot = std::make_unique<Model>("..\\..\\Models\\teapot.obj", uploads, meshLayout);
+    uploads.Flush();
 
     const auto bunnyTransform = DirectX::XMMatrixMultiply(DirectX::XMMatrixScaling(0.3f, 0.3f, 0.3f), DirectX::XMMatrixTranslation(0.3f, 1.1f, 0.3f));
     const auto sphereTransform = DirectX::XMMatrixMultiply(DirectX::XMMatrixScaling(0.01f, 0.01f, 0.01f), DirectX::XMMatrixTranslation(0.f, 1.f, 0));
     const auto teapotTransform = DirectX::XMMatrixMultiply(DirectX::XMMatrixScaling(0.1f, 0.1f, 0.1f), DirectX::XMMatrixTranslation(-0.7f, 1.3f, -0.7f));
 
-    m_scene = std::make_unique<Scene>(m_renderer->GetDevice());
+    m_scene = std::make_unique<Scene>(m_renderer->GetDevice(), m_renderer->GetFramesInFlight());
     m_scene->AddInstance(*m_cornell, DirectX::XMMatrixIdentity(), DirectX::XMVECTOR{1.f, 1.f, 1.f, 1.f}, DirectX::XMVECTOR{0.f, 0.f, 0.f, 1.f});
     m_bunnyInstance = m_scene->AddInstance(*m_bunny, bunnyTransform, DirectX::XMVECTOR{0.f, 0.f, 0.f, 1.f}, DirectX::XMVECTOR{1.f, 0.1f, 0.01f, 0.f});
     m_sphereInstance = m_scene->AddInstance(*m_sphere, sphereTransform, DirectX::XMVECTOR{0.f, 0.f, 0.f, 1.f}, DirectX::XMVECTOR{20.f, 20.f, 20.f, 1.f});
@@ -124,6 +136,38 @@ void Application::HandleInput(float diffTime)
     else
         m_leftKeyPressed = false;
 
+    // Cycles the cascade update schedule between full, cadence and slices
+    if (glfwGetKey(m_window, GLFW_KEY_U) == GLFW_PRESS)
+    {
+        if (!m_scheduleKeyPressed)
+        {
+            m_cascadeSchedule = (m_cascadeSchedule + 1) % 3;
+            m_renderer->ScheduleCascades((CascadeScheduler::Mode)m_cascadeSchedule);
+            m_scheduleKeyPressed = true;
+        }
+    }
+    else
+        m_scheduleKeyPressed = false;
+
+    // Writes the frames still in the profiler as a Chrome trace, chrome://tracing or ui.perfetto.dev open it
+    if (glfwGetKey(m_window, GLFW_KEY_T) == GLFW_PRESS)
+    {
+        if (!m_traceKeyPressed)
+        {
+            const auto& profiler = m_renderer->GetProfiler();
+            if (profiler.WriteChromeTrace(c_tracePath))
+                std::printf("Wrote %u samples to %s\n", profiler.GetSampleCount(), c_tracePath);
+            for (const auto& stats : profiler.CollectStats())
+            {
+                std::printf("%s %*s%s: %.3f ms mean, %.3f min, %.3f max, %.1f per frame\n", stats.Track == ProfileTrack::Gpu ? "GPU" : "CPU",
+                    stats.Depth * 2, "", stats.Name, stats.Mean * 1e3, stats.Min * 1e3, stats.Max * 1e3, stats.Calls);
+            }
+            m_traceKeyPressed = true;
+        }
+    }
+    else
+        m_traceKeyPressed = false;
+
     double currMouseX, currMouseY;
     glfwGetCursorPos(m_window, &currMouseX, &currMouseY);
     if(glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_1) == GLFW_PRESS)
@@ -0,0 +1,349 @@
+#include "BenchmarkCommon.h"
+#include "CascadeCost.h"
+#include "MeshCache.h"
+#include "ParallelFor.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+namespace
+{
+    struct BenchmarkMesh
+    {
+        std::unique_ptr<MeshCache> Cache;
+        std::unique_ptr<CpuMesh> Mesh;
+        std::vector<Aabb> Occupancy;
+    };
+
+    Float3x4 ScaleTranslate(float scale, const Float3& translation)
+    {
+        auto ret = Float3x4::Identity();
+        for (auto i = 0u; i < 3; ++i)
+        {
+            ret.m[i][i] = scale;
+            ret.m[i][3] = translation[i];
+        }
+        return ret;
+    }
+
+    template<typename T>
+    bool ParseTriple(const char* text, T& ret)
+    {
+        std::stringstream stream(text);
+        char separator;
+        return (bool)(stream >> ret.x >> separator >> ret.y >> separator >> ret.z);
+    }
+
+    std::vector<std::string> Split(const std::string& text)
+    {
+        std::vector<std::string> ret;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            ret.push_back(item);
+        return ret;
+    }
+
+    void PrintUsage()
+    {
+        std::cerr <<
+            "cascade-benchmark [options]\n"
+            "  --resolution x,y,z   probe count of cascade 0 (default 8,8,8)\n"
+            "  --extends x,y,z      half size of the cascade volume (default 1,1,1)\n"
+            "  --offset x,y,z       center of the cascade volume (default 0,1,0)\n"
+            "  --cascades n         cascade count (default 4)\n"
+            "  --topology name      entry of CASCADE_TOPOLOGIES the CPU cascades use (default Default)\n"
+            "  --threads n          highest thread count of the scaling sweep (default all cores)\n"
+            "  --iterations n       runs per measurement, the fastest is reported (default 3)\n"
+            "  --schedule-frames n  animated frames of the cascade schedule comparison (default 8)\n"
+            "  --error-budget e     relative error of cascade 0 a packed texel format may have (default 0.01)\n"
+            "  --downscales a,b     resolution divisors of the deferred gather comparison (default 2,4)\n"
+            "  --scenes a,b         any of cornell, teapot, sphere (default all)\n"
+            "  --bvh-meshes a,b     model files for the BVH build and traversal measurements (default teapot.obj,Bunny.obj)\n"
+            "  --models path        directory of the bundled models\n"
+            "  --output file        write the JSON report to a file instead of stdout\n"
+            "  --trace prefix       write the headless frames of every scene as Chrome trace to <prefix><scene>.json\n";
+    }
+
+    bool ParseOptions(int argc, char** argv, BenchmarkOptions& options)
+    {
+        for (auto i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            const char* value = argv[++i];
+
+            bool ok = true;
+            if (arg == "--resolution")
+                ok = ParseTriple(value, options.Resolution);
+            else if (arg == "--extends")
+                ok = ParseTriple(value, options.Extends);
+            else if (arg == "--offset")
+                ok = ParseTriple(value, options.Offset);
+            else if (arg == "--cascades")
+                options.CascadeCount = (uint32_t)std::stoul(value);
+            else if (arg == "--topology")
+            {
+                const auto topology = FindTopology(value);
+                ok = topology != nullptr;
+                if (ok)
+                    options.Topology = *topology;
+            }
+            else if (arg == "--threads")
+                options.MaxThreads = (uint32_t)std::stoul(value);
+            else if (arg == "--iterations")
+                options.Iterations = std::max(1u, (uint32_t)std::stoul(value));
+            else if (arg == "--schedule-frames")
+                options.ScheduleFrames = std::max(2u, (uint32_t)std::stoul(value));
+            else if (arg == "--error-budget")
+                options.ErrorBudget = std::stod(value);
+            else if (arg == "--downscales")
+            {
+                options.Downscales.clear();
+                for (const auto& item : Split(value))
+                    options.Downscales.push_back(std::max(1u, (uint32_t)std::stoul(item)));
+            }
+            else if (arg == "--scenes")
+                options.Scenes = Split(value);
+            else if (arg == "--bvh-meshes")
+                options.BvhMeshes = Split(value);
+            else if (arg == "--models")
+                options.ModelsDir = value;
+            else if (arg == "--output")
+                options.Output = value;
+            else if (arg == "--trace")
+                options.Trace = value;
+            else
+                ok = false;
+
+            if (!ok)
+                return false;
+        }
+
+        if (options.MaxThreads == 0)
+            options.MaxThreads = GetDefaultThreadCount();
+
+        return options.CascadeCount > 0
+            && (options.Resolution.x >> (options.CascadeCount - 1)) > 0
+            && (options.Resolution.y >> (options.CascadeCount - 1)) > 0
+            && (options.Resolution.z >> (options.CascadeCount - 1)) > 0;
+    }
+
+    // Same placement and emission as the instances in Application
+    bool BuildScene(const std::string& name, std::map<std::string, BenchmarkMesh>& meshes, const std::string& modelsDir, BenchmarkScene& scene)
+    {
+        const auto addInstance = [&](const std::string& file, const Float3x4& transform, const Float3& emission)
+        {
+            auto& mesh = meshes[file];
+            if (!mesh.Mesh)
+            {
+                mesh.Cache = std::make_unique<MeshCache>(modelsDir + "/" + file);
+                const auto& view = mesh.Cache->GetView();
+                mesh.Mesh = std::make_unique<CpuMesh>(view.Positions, view.VertexCount, view.Indices, view.IndexCount);
+                mesh.Occupancy = CascadeBricks::BuildOccupancy(view.Positions, view.VertexCount, view.Indices, view.IndexCount);
+            }
+            scene.Triangles += mesh.Mesh->GetTriangleCount();
+            scene.Occupancy.push_back({&mesh.Occupancy, transform});
+            return scene.Scene.AddInstance(*mesh.Mesh, transform, emission);
+        };
+
+        addInstance("CornellBox-Original.obj", Float3x4::Identity(), {0.f, 0.f, 0.f});
+        if (name == "teapot")
+        {
+            scene.MovingTransform = ScaleTranslate(0.1f, {-0.7f, 1.3f, -0.7f});
+            scene.MovingInstance = addInstance("teapot.obj", scene.MovingTransform, {0.01f, 0.25f, 1.f});
+        }
+        else if (name == "sphere")
+        {
+            scene.MovingTransform = ScaleTranslate(0.01f, {0.f, 1.f, 0.f});
+            scene.MovingInstance = addInstance("Sphere.glb", scene.MovingTransform, {20.f, 20.f, 20.f});
+        }
+        else if (name != "cornell")
+        {
+            return false;
+        }
+
+        scene.Name = name;
+        return true;
+    }
+
+    void WriteConfig(JsonWriter& json, const BenchmarkOptions& options)
+    {
+        json.BeginObject("config");
+        json.BeginArray("resolution", true);
+        json.Write(options.Resolution.x);
+        json.Write(options.Resolution.y);
+        json.Write(options.Resolution.z);
+        json.End();
+        json.BeginArray("extends", true);
+        json.Write(options.Extends.x);
+        json.Write(options.Extends.y);
+        json.Write(options.Extends.z);
+        json.End();
+        json.BeginArray("offset", true);
+        json.Write(options.Offset.x);
+        json.Write(options.Offset.y);
+        json.Write(options.Offset.z);
+        json.End();
+        json.Write("cascades", options.CascadeCount);
+        json.Write("topology", options.Topology.Name);
+        json.Write("iterations", options.Iterations);
+        json.Write("scheduleFrames", options.ScheduleFrames);
+        json.Write("errorBudget", options.ErrorBudget);
+        json.Write("threads", options.MaxThreads);
+        json.Write("simd", GetSimdBackendName());
+        json.End();
+    }
+
+    void WriteMeshes(JsonWriter& json, const std::map<std::string, BenchmarkMesh>& meshes)
+    {
+        json.BeginArray("meshes");
+        for (const auto& [file, mesh] : meshes)
+        {
+            const auto& stats = mesh.Cache->GetOptimizationStats();
+            json.BeginObject(nullptr, true);
+            json.Write("file", file);
+            json.Write("triangles", mesh.Mesh->GetTriangleCount());
+            json.Write("sourceVertices", stats.SourceVertexCount);
+            json.Write("vertices", stats.VertexCount);
+            json.Write("sourceAcmr", stats.SourceAcmr);
+            json.Write("acmr", stats.Acmr);
+            json.End();
+        }
+        json.End();
+    }
+
+    // Dense Rgba16f cascades of the benchmark volume, like RadianceCascades keeps them by default
+    void WriteTopologies(JsonWriter& json, const BenchmarkOptions& options)
+    {
+        json.BeginArray("topologies");
+        for (const auto& topology : c_cascadeTopologies)
+        {
+            const auto cost = EstimateCascadeCost(topology, options.Resolution, options.CascadeCount, CascadeFormat::Rgba16f);
+            const auto scheduled = EstimateCascadeCost(topology, options.Resolution, options.CascadeCount, CascadeFormat::Rgba16f, CascadeScheduler::Mode::Slices);
+            json.BeginObject(nullptr, true);
+            json.Write("name", topology.Name);
+            json.BeginArray("directions", true);
+            json.Write(topology.PixelsX);
+            json.Write(topology.PixelsY);
+            json.End();
+            json.Write("angularShift", topology.AngularShift);
+            json.Write("interval", topology.Interval);
+            json.Write("growth", topology.Growth);
+            json.Write("reach", topology.GetEnd((int)options.CascadeCount - 1));
+            json.Write("raysPerFrame", cost.Rays);
+            json.Write("slicedRaysPerFrame", scheduled.Rays);
+            json.Write("traceBytes", cost.TraceBytes);
+            json.Write("mergeBytes", cost.MergeBytes);
+            json.Write("projectBytes", cost.ProjectBytes);
+            json.Write("frameBytes", cost.GetFrameBytes());
+            json.Write("memoryBytes", cost.CascadeBytes + cost.HitBytes);
+            json.End();
+        }
+        json.End();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // Sections write as they finish, the report is printed once all of them ran
+    std::ostringstream report;
+    JsonWriter json(report);
+    json.BeginObject();
+    WriteConfig(json, options);
+
+    std::map<std::string, BenchmarkMesh> meshes;
+    json.BeginArray("scenes");
+    for (const auto& name : options.Scenes)
+    {
+        BenchmarkScene scene;
+        try
+        {
+            if (!BuildScene(name, meshes, options.ModelsDir, scene))
+            {
+                std::cerr << "Unknown scene " << name << "\n";
+                return 1;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+
+        json.BeginObject();
+        json.Write("name", scene.Name);
+        json.Write("instances", scene.Scene.GetInstanceCount());
+        json.Write("triangles", scene.Triangles);
+        std::cerr << "Running " << name << "...\n";
+        RunLevels(options, scene, json);
+        std::cerr << "Comparing cascade schedules of " << name << "...\n";
+        RunSchedules(options, scene, json);
+        std::cerr << "Measuring cascade bricks of " << name << "...\n";
+        RunBricks(options, scene, json);
+        std::cerr << "Comparing cascade texel formats of " << name << "...\n";
+        RunFormats(options, scene, json);
+        std::cerr << "Comparing projected irradiance of " << name << "...\n";
+        RunIrradiance(options, scene, json);
+        std::cerr << "Comparing deferred gathers of " << name << "...\n";
+        RunDeferred(options, scene, json);
+        std::cerr << "Running the headless frame loop on " << name << "...\n";
+        RunHeadless(options, scene, json);
+        json.End();
+    }
+    json.End();
+    WriteMeshes(json, meshes);
+
+    json.BeginArray("bvh");
+    for (const auto& file : options.BvhMeshes)
+    {
+        try
+        {
+            const MeshCache cache(options.ModelsDir + "/" + file);
+            std::cerr << "Measuring BVH of " << file << "...\n";
+            RunBvh(options, file, cache.GetView(), json);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Skipping BVH of " << file << ": " << e.what() << "\n";
+        }
+    }
+    json.End();
+
+    std::cerr << "Measuring heap allocator...\n";
+    RunAllocator(options, json);
+    std::cerr << "Measuring descriptor allocator...\n";
+    RunDescriptors(options, json);
+    std::cerr << "Measuring pipeline cache...\n";
+    RunPipelineCache(options, json);
+    std::cerr << "Measuring profiler scopes...\n";
+    RunProfiler(options, json);
+    std::cerr << "Simulating cascade layout cache traffic...\n";
+    RunLayouts(options, json);
+    WriteTopologies(json, options);
+    json.End();
+
+    if (options.Output.empty())
+    {
+        std::cout << report.str();
+    }
+    else
+    {
+        std::ofstream file(options.Output);
+        file << report.str();
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "BenchmarkCommon.h"
+#include "DescriptorAllocator.h"
+
+#include <deque>
+#include <random>
+
+// Churn of GpuAllocator sized requests on one heap block: 64 KiB placement granularity, mostly small buffers with
+// occasional multi-megabyte ones, freed in random order once half the block is in use
+void RunAllocator(const BenchmarkOptions& options, JsonWriter& json)
+{
+    constexpr uint64_t capacity = 64ull << 20;
+    constexpr uint64_t granularity = 64ull << 10;
+    constexpr uint32_t operationCount = 1 << 20;
+
+    std::mt19937 random(1);
+    std::vector<uint64_t> sizes(operationCount);
+    std::vector<uint32_t> picks(operationCount);
+    for (auto i = 0u; i < operationCount; ++i)
+    {
+        sizes[i] = random() % 8 == 0 ? granularity * (1 + random() % 64) : 256 + random() % granularity;
+        picks[i] = random();
+    }
+
+    uint32_t failures = 0;
+    TlsfStats stats;
+    const auto seconds = MeasureFastest(options.Iterations, [&]()
+    {
+        TlsfAllocator allocator(capacity, granularity);
+        std::vector<TlsfAllocation> live;
+        failures = 0;
+        for (auto i = 0u; i < operationCount; ++i)
+        {
+            if (allocator.GetUsedBytes() > capacity / 2 && !live.empty())
+            {
+                auto& victim = live[picks[i] % live.size()];
+                allocator.Free(victim);
+                victim = live.back();
+                live.pop_back();
+                continue;
+            }
+
+            const auto allocation = allocator.Allocate(sizes[i], granularity);
+            if (allocation.Offset == TlsfAllocator::c_invalidOffset)
+                ++failures;
+            else
+                live.push_back(allocation);
+        }
+        stats = allocator.GetStats();
+    });
+
+    json.BeginObject("allocator", true);
+    json.Write("operations", operationCount);
+    json.Write("operationsPerSecond", operationCount / seconds);
+    json.Write("failures", failures);
+    json.Write("utilization", stats.GetUtilization());
+    json.Write("fragmentation", stats.GetFragmentation());
+    json.Write("freeBlocks", stats.FreeBlockCount);
+    json.End();
+}
+
+// Frames of Device descriptor traffic with two frames in flight: transient tables from the ring plus churn of
+// persistent views released behind the fence
+void RunDescriptors(const BenchmarkOptions& options, JsonWriter& json)
+{
+    constexpr uint32_t frameCount = 1 << 14;
+    constexpr uint32_t tablesPerFrame = 64;
+    constexpr uint32_t viewsPerFrame = 16;
+    constexpr uint32_t liveViews = 4096;
+    constexpr uint64_t framesInFlight = 2;
+
+    std::mt19937 random(1);
+    std::vector<uint32_t> counts(tablesPerFrame + viewsPerFrame);
+    for (auto& count : counts)
+        count = 1 + random() % 8;
+
+    uint32_t persistentUsed = 0;
+    uint32_t pendingCount = 0;
+    const auto seconds = MeasureFastest(options.Iterations, [&]()
+    {
+        DescriptorAllocator allocator(65536, 4096);
+        std::deque<uint32_t> views;
+        for (auto frame = 1u; frame <= frameCount; ++frame)
+        {
+            for (auto i = 0u; i < tablesPerFrame; ++i)
+                allocator.AllocateTransient(counts[i]);
+
+            for (auto i = 0u; i < viewsPerFrame; ++i)
+            {
+                const auto index = allocator.Allocate(counts[tablesPerFrame + i]);
+                if (index != DescriptorAllocator::c_invalidIndex)
+                    views.push_back(index);
+            }
+            while (views.size() > liveViews)
+            {
+                allocator.Release(views.front());
+                views.pop_front();
+            }
+
+            allocator.Submit(frame);
+            allocator.Retire(frame > framesInFlight ? frame - framesInFlight : 0);
+        }
+        persistentUsed = allocator.GetPersistentUsed();
+        pendingCount = allocator.GetPendingCount();
+    });
+
+    const uint64_t operations = (uint64_t)frameCount * (tablesPerFrame + 2 * viewsPerFrame);
+    json.BeginObject("descriptors", true);
+    json.Write("operations", operations);
+    json.Write("operationsPerSecond", operations / seconds);
+    json.Write("persistentUsed", persistentUsed);
+    json.Write("pendingReleases", pendingCount);
+    json.End();
+}
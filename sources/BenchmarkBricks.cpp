@@ -0,0 +1,97 @@
+#include "BenchmarkCommon.h"
+#include "CascadeBricks.h"
+
+namespace
+{
+    struct BrickLevelResult
+    {
+        uint32_t Bricks = 0;
+        uint32_t Resident = 0;
+        uint32_t Layers = 0;
+        uint64_t DenseBytes = 0;
+        uint64_t SparseBytes = 0;
+    };
+}
+
+// Residency of CascadeBricks built from the instance occupancy: memory of the cascade and hit atlases against the
+// dense textures, and sparse against dense generation, whose resident probes CascadeBricksTests checks for a match.
+void RunBricks(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json)
+{
+    CascadeBricks bricks(options.Resolution, options.Extends, options.Offset, options.CascadeCount);
+    uint32_t boxes = 0;
+    double buildSeconds = INFINITY;
+    for (auto iteration = 0u; iteration < options.Iterations; ++iteration)
+    {
+        bricks = CascadeBricks(options.Resolution, options.Extends, options.Offset, options.CascadeCount);
+        boxes = 0;
+        buildSeconds = std::min(buildSeconds, MeasureSeconds([&]()
+        {
+            for (const auto& [occupancy, transform] : scene.Occupancy)
+            {
+                for (const auto& box : *occupancy)
+                    bricks.Occupy(TransformBounds(box, transform));
+                boxes += (uint32_t)occupancy->size();
+            }
+            bricks.Update();
+        }));
+    }
+
+    CpuCascades dense(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba16f, options.Topology);
+    CpuCascades sparse(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba16f, options.Topology);
+    sparse.SetBricks(&bricks);
+    const auto denseSeconds = MeasureFastest(options.Iterations, [&]() { dense.Generate(scene.Scene, options.MaxThreads); });
+    const auto sparseSeconds = MeasureFastest(options.Iterations, [&]() { sparse.Generate(scene.Scene, options.MaxThreads); });
+
+    // Cascade texel and hit id
+    constexpr uint64_t texelSize = 4 * sizeof(uint16_t) + sizeof(uint16_t);
+    std::vector<BrickLevelResult> levels;
+    uint64_t denseBytes = 0;
+    uint64_t sparseBytes = 0;
+    uint64_t denseRays = 0;
+    uint64_t sparseRays = 0;
+    for (auto i = 0u; i < dense.GetCount(); ++i)
+    {
+        const auto slice = (uint64_t)dense.GetWidth(i) * dense.GetHeight(i);
+        BrickLevelResult level;
+        level.Bricks = bricks.GetBrickCount(i);
+        level.Resident = bricks.GetResidentCount(i);
+        level.Layers = bricks.GetLayerCount(i);
+        level.DenseBytes = slice * dense.GetDepth(i) * texelSize;
+        level.SparseBytes = slice * level.Layers * GetBrickSize(options.Resolution, i)[2] * texelSize;
+        levels.push_back(level);
+        denseBytes += level.DenseBytes;
+        sparseBytes += level.SparseBytes;
+
+        const auto pixelCount = options.Topology.GetPixelCount(i);
+        denseRays += slice * dense.GetDepth(i);
+        ForEachTexel(dense, i, [&](uint32_t x, uint32_t y, uint32_t z)
+        {
+            if (x % pixelCount[0] == 0 && y % pixelCount[1] == 0 && bricks.IsResident(i, x / pixelCount[0], y / pixelCount[1], z))
+                sparseRays += (uint64_t)pixelCount[0] * pixelCount[1];
+        });
+    }
+
+    json.BeginObject("bricks");
+    json.Write("occupancyBoxes", boxes);
+    json.Write("buildSeconds", buildSeconds);
+    json.Write("denseBytes", denseBytes);
+    json.Write("sparseBytes", sparseBytes);
+    json.Write("memoryReduction", (double)denseBytes / sparseBytes);
+    json.Write("rayReduction", sparseRays > 0 ? (double)denseRays / sparseRays : 0.0);
+    json.Write("denseSeconds", denseSeconds);
+    json.Write("sparseSeconds", sparseSeconds);
+    json.BeginArray("levels");
+    for (auto i = 0u; i < levels.size(); ++i)
+    {
+        json.BeginObject(nullptr, true);
+        json.Write("cascade", i);
+        json.Write("bricks", levels[i].Bricks);
+        json.Write("resident", levels[i].Resident);
+        json.Write("layers", levels[i].Layers);
+        json.Write("denseBytes", levels[i].DenseBytes);
+        json.Write("sparseBytes", levels[i].SparseBytes);
+        json.End();
+    }
+    json.End();
+    json.End();
+}
@@ -0,0 +1,72 @@
+#include "BenchmarkCommon.h"
+#include "MeshCache.h"
+#include "ParallelFor.h"
+
+#include <memory>
+#include <random>
+
+// Build time and memory of one mesh BVH plus incoherent packet throughput: random origins inside the bounds,
+// eight random directions per packet
+void RunBvh(const BenchmarkOptions& options, const std::string& file, const MeshView& view, JsonWriter& json)
+{
+    std::unique_ptr<CpuMesh> mesh;
+    const auto buildSeconds = MeasureFastest(options.Iterations, [&]()
+    {
+        mesh = std::make_unique<CpuMesh>(view.Positions, view.VertexCount, view.Indices, view.IndexCount, options.MaxThreads);
+    });
+
+    CpuScene scene;
+    scene.AddInstance(*mesh, Float3x4::Identity(), {1.f, 1.f, 1.f});
+
+    constexpr uint32_t packetCount = 1 << 16;
+    std::vector<RayPacket> packets(packetCount);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    const auto& boundsMin = mesh->GetBoundsMin();
+    const auto extent = mesh->GetBoundsMax() - boundsMin;
+    for (auto& packet : packets)
+    {
+        const Float3 origin = boundsMin + extent * Float3{uniform(random), uniform(random), uniform(random)};
+        for (auto lane = 0u; lane < c_packetSize; ++lane)
+        {
+            const auto dir = FromSpherical(uniform(random), uniform(random));
+            packet.OriginX[lane] = origin.x;
+            packet.OriginY[lane] = origin.y;
+            packet.OriginZ[lane] = origin.z;
+            packet.DirX[lane] = dir.x;
+            packet.DirY[lane] = dir.y;
+            packet.DirZ[lane] = dir.z;
+            packet.TMin[lane] = 0.f;
+        }
+        packet.Active = (1u << c_packetSize) - 1;
+    }
+
+    const auto traceSeconds = MeasureFastest(options.Iterations, [&]()
+    {
+        ParallelFor(packetCount, options.MaxThreads, 256, [&](uint64_t begin, uint64_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto packet = packets[i];
+                for (auto lane = 0u; lane < c_packetSize; ++lane)
+                {
+                    packet.TMax[lane] = INFINITY;
+                    packet.Instance[lane] = c_invalidInstance;
+                }
+                scene.Trace(packet);
+            }
+        });
+    });
+
+    const auto triangles = mesh->GetTriangleCount();
+    const uint64_t rays = (uint64_t)packetCount * c_packetSize;
+    json.BeginObject(nullptr, true);
+    json.Write("file", file);
+    json.Write("triangles", triangles);
+    json.Write("nodes", mesh->GetNodeCount());
+    json.Write("buildSeconds", buildSeconds);
+    json.Write("bytesPerTriangle", triangles > 0 ? (double)mesh->GetMemorySize() / triangles : 0.0);
+    json.Write("rays", rays);
+    json.Write("raysPerSecond", rays / traceSeconds);
+    json.End();
+}
@@ -0,0 +1,187 @@
+#include "BenchmarkCommon.h"
+
+#include <cassert>
+
+std::vector<Aabb> BenchmarkScene::AnimateEmitter(uint32_t frame)
+{
+    std::vector<Aabb> ret;
+    if (MovingInstance == c_invalidInstance)
+        return ret;
+
+    ret.push_back(Scene.GetInstanceBounds(MovingInstance));
+    auto transform = MovingTransform;
+    transform.m[0][3] += 0.3f * std::sin(frame * 0.4f);
+    Scene.SetInstanceTransform(MovingInstance, transform);
+    ret.push_back(Scene.GetInstanceBounds(MovingInstance));
+    return ret;
+}
+
+void BenchmarkScene::ResetEmitter()
+{
+    if (MovingInstance != c_invalidInstance)
+        Scene.SetInstanceTransform(MovingInstance, MovingTransform);
+}
+
+double CompareCascades(const CpuCascades& reference, const CpuCascades& cascades)
+{
+    ErrorStats error;
+    ForEachTexel(reference, 0, [&](uint32_t x, uint32_t y, uint32_t z)
+    {
+        const auto expected = reference.Load(0, x, y, z);
+        const auto actual = cascades.Load(0, x, y, z);
+        error.Add(actual.x - expected.x, expected.x);
+        error.Add(actual.y - expected.y, expected.y);
+        error.Add(actual.z - expected.z, expected.z);
+    });
+    return error.GetRelative();
+}
+
+GBuffer MakeSyntheticGBuffer(uint32_t width, uint32_t height)
+{
+    struct Sphere
+    {
+        Float3 Center;
+        float Radius;
+        Float3 Albedo;
+        Float3 Emission;
+    };
+    const Sphere spheres[] = {
+        {{0.35f, 0.25f, 0.6f}, 0.15f, {0.8f, 0.3f, 0.3f}, {}},
+        {{0.7f, 0.2f, 0.4f}, 0.1f, {0.9f, 0.9f, 0.9f}, {0.5f, 0.5f, 0.4f}},
+        {{0.55f, 0.5f, 0.75f}, 0.08f, {0.3f, 0.8f, 0.3f}, {}},
+    };
+    const Float3 camera = {0.5f, 0.45f, 0.02f};
+
+    GBuffer ret;
+    ret.Width = width;
+    ret.Height = height;
+    ret.Positions.resize(width * height);
+    ret.Normals.resize(width * height);
+    ret.Depths.resize(width * height);
+    ret.Albedo.resize(width * height);
+    ret.Emission.resize(width * height);
+    for (auto y = 0u; y < height; ++y)
+    {
+        for (auto x = 0u; x < width; ++x)
+        {
+            const Float3 toPixel = {((x + 0.5f) / width * 2.f - 1.f) * width / height, 1.f - (y + 0.5f) / height * 2.f, 1.5f};
+            const auto direction = toPixel * (1.f / std::sqrt(Dot(toPixel, toPixel)));
+            float nearest = INFINITY;
+            Float3 normal = {};
+            Float3 albedo = {};
+            Float3 emission = {};
+            const auto hitPlane = [&](uint32_t axis, float value, float side, const Float3& planeAlbedo)
+            {
+                const float t = (value - camera[axis]) / direction[axis];
+                const auto position = camera + direction * t;
+                if (t <= 0.f || t >= nearest || position.y > 0.8f)
+                    return;
+                nearest = t;
+                normal = {};
+                normal[axis] = side;
+                albedo = planeAlbedo;
+                emission = {};
+            };
+            hitPlane(1, 0.05f, 1.f, {0.7f, 0.7f, 0.7f});
+            hitPlane(2, 0.95f, -1.f, {0.6f, 0.6f, 0.8f});
+            hitPlane(0, 0.05f, 1.f, {0.8f, 0.6f, 0.4f});
+            hitPlane(0, 0.95f, -1.f, {0.4f, 0.6f, 0.8f});
+            for (const auto& sphere : spheres)
+            {
+                const auto toCenter = sphere.Center - camera;
+                const float along = Dot(toCenter, direction);
+                const float squared = along * along - Dot(toCenter, toCenter) + sphere.Radius * sphere.Radius;
+                const float t = along - std::sqrt(std::max(squared, 0.f));
+                if (squared < 0.f || t <= 0.f || t >= nearest)
+                    continue;
+                nearest = t;
+                normal = (camera + direction * t - sphere.Center) * (1.f / sphere.Radius);
+                albedo = sphere.Albedo;
+                emission = sphere.Emission;
+            }
+            if (nearest == INFINITY)
+                continue;
+
+            const auto index = ret.GetIndex(x, y);
+            ret.Positions[index] = camera + direction * nearest;
+            ret.Normals[index] = normal;
+            ret.Depths[index] = nearest * direction.z;
+            ret.Albedo[index] = albedo;
+            ret.Emission[index] = emission;
+        }
+    }
+    return ret;
+}
+
+void JsonWriter::BeginObject(const char* key, bool compact)
+{
+    Begin(key, compact, false);
+}
+
+void JsonWriter::BeginArray(const char* key, bool compact)
+{
+    Begin(key, compact, true);
+}
+
+void JsonWriter::End()
+{
+    assert(!m_scopes.empty());
+    const auto scope = m_scopes.back();
+    m_scopes.pop_back();
+
+    if (!scope.Compact && scope.Count > 0)
+        m_out << "\n" << std::string(2 * m_scopes.size(), ' ');
+    m_out << (scope.Array ? "]" : "}");
+    if (m_scopes.empty())
+        m_out << "\n";
+}
+
+void JsonWriter::Begin(const char* key, bool compact, bool array)
+{
+    BeginValue(key);
+    m_out << (array ? "[" : "{");
+    m_scopes.push_back({array, compact || (!m_scopes.empty() && m_scopes.back().Compact), 0});
+}
+
+void JsonWriter::BeginValue(const char* key)
+{
+    if (!m_scopes.empty())
+    {
+        auto& scope = m_scopes.back();
+        assert((key == nullptr) == scope.Array);
+        if (scope.Count++ > 0)
+            m_out << (scope.Compact ? ", " : ",");
+        if (!scope.Compact)
+            m_out << "\n" << std::string(2 * m_scopes.size(), ' ');
+    }
+
+    if (key)
+    {
+        WriteString(key);
+        m_out << ": ";
+    }
+}
+
+void JsonWriter::WriteNumber(double value)
+{
+    if (std::isfinite(value))
+        m_out << value;
+    else
+        m_out << "null";
+}
+
+void JsonWriter::WriteString(std::string_view text)
+{
+    constexpr char hex[] = "0123456789abcdef";
+    m_out << "\"";
+    for (const auto c : text)
+    {
+        if (c == '"' || c == '\\')
+            m_out << "\\" << c;
+        else if ((unsigned char)c < 0x20)
+            m_out << "\\u00" << hex[c >> 4] << hex[c & 15];
+        else
+            m_out << c;
+    }
+    m_out << "\"";
+}
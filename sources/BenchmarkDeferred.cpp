@@ -0,0 +1,104 @@
+#include "BenchmarkCommon.h"
+
+namespace
+{
+    // Pixels whose 3x3 neighborhood crosses the background, a normal edge or a depth step GetUpsampleWeight rejects
+    std::vector<uint8_t> FindEdges(const GBuffer& gbuffer)
+    {
+        std::vector<uint8_t> ret(gbuffer.Width * gbuffer.Height);
+        for (auto y = 1u; y + 1 < gbuffer.Height; ++y)
+        {
+            for (auto x = 1u; x + 1 < gbuffer.Width; ++x)
+            {
+                const auto index = gbuffer.GetIndex(x, y);
+                if (gbuffer.Depths[index] <= 0.f)
+                    continue;
+                for (auto i = 0u; i < 9; ++i)
+                {
+                    const auto neighbor = gbuffer.GetIndex(x + i % 3 - 1, y + i / 3 - 1);
+                    ret[index] |= GetUpsampleWeight(gbuffer.Normals[index], gbuffer.Depths[index], gbuffer.Normals[neighbor], gbuffer.Depths[neighbor]) < 0.5f;
+                }
+            }
+        }
+        return ret;
+    }
+}
+
+// Deferred gather at each downscale with plain bilinear and with bilateral upsampling against the gather of every
+// pixel, compared after compositing on a synthetic G-buffer, errors relative like CompareCascades
+void RunDeferred(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json)
+{
+    constexpr uint32_t width = 320;
+    constexpr uint32_t height = 180;
+    CpuCascades cascades(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba16f, options.Topology);
+    cascades.Generate(scene.Scene, options.MaxThreads);
+    cascades.ProjectIrradiance(options.MaxThreads);
+    const IrradianceGather gather = [&](const Float3& position, const Float3& normal)
+    {
+        return cascades.SampleIrradiance(position, normal);
+    };
+
+    const auto gbuffer = MakeSyntheticGBuffer(width, height);
+    const auto edges = FindEdges(gbuffer);
+    std::vector<Float3> reference;
+    uint32_t pixels = 0;
+    const auto referenceSeconds = MeasureFastest(options.Iterations, [&]()
+    {
+        DeferredStats stats;
+        reference = Composite(gbuffer, GatherIrradiance(gbuffer, 1, gather, stats));
+        pixels = stats.Gathers;
+    });
+    uint32_t edgePixels = 0;
+    for (const auto edge : edges)
+        edgePixels += edge;
+
+    json.BeginObject("deferred");
+    json.Write("width", width);
+    json.Write("height", height);
+    json.Write("pixels", pixels);
+    json.Write("edgePixels", edgePixels);
+    json.Write("referenceSeconds", referenceSeconds);
+    json.BeginArray("entries");
+    for (const auto downscale : options.Downscales)
+    {
+        for (const auto bilateral : {false, true})
+        {
+            DeferredStats stats;
+            std::vector<Float3> colors;
+            const auto seconds = MeasureFastest(options.Iterations, [&]()
+            {
+                stats = {};
+                const auto gathered = GatherIrradiance(gbuffer, downscale, gather, stats);
+                colors = Composite(gbuffer, UpsampleIrradiance(gbuffer, downscale, gathered, gather, bilateral, stats));
+            });
+
+            // Emission is not gathered, only the rest of the color is compared
+            ErrorStats error;
+            ErrorStats edgeError;
+            for (auto i = 0u; i < colors.size(); ++i)
+            {
+                for (auto c = 0u; c < 3; ++c)
+                {
+                    error.Add(colors[i][c] - reference[i][c], reference[i][c] - gbuffer.Emission[i][c]);
+                    if (edges[i])
+                        edgeError.Add(colors[i][c] - reference[i][c], reference[i][c] - gbuffer.Emission[i][c]);
+                }
+            }
+
+            const auto gathers = stats.Gathers + stats.Regathers;
+            json.BeginObject(nullptr, true);
+            json.Write("downscale", downscale);
+            json.Write("upsample", bilateral ? "bilateral" : "bilinear");
+            json.Write("gathers", stats.Gathers);
+            json.Write("regathers", stats.Regathers);
+            json.Write("gatherReduction", gathers > 0 ? (double)pixels / gathers : 0.0);
+            json.Write("seconds", seconds);
+            json.Write("meanError", error.GetRelative());
+            // Error of the pixels next to a depth or normal edge, where plain bilinear upsampling leaks
+            json.Write("edgeError", edgeError.GetRelative());
+            json.End();
+        }
+    }
+    json.End();
+    json.End();
+}
@@ -0,0 +1,101 @@
+#include "BenchmarkCommon.h"
+#include "CascadeCost.h"
+
+namespace
+{
+    struct FormatResult
+    {
+        CascadeFormat Format;
+        uint64_t CascadeBytes = 0;
+        uint64_t MergeBytes = 0;
+        double MergeSeconds = INFINITY;
+        double Error = 0.0;
+        double MaxError = 0.0;
+        double AlphaError = 0.0;
+    };
+}
+
+// Merges the same hits into every CascadeFormat and compares cascade 0 against the float merge, picking the
+// smallest format within the error budget. The bytes are those of EstimateCascadeCost.
+void RunFormats(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json)
+{
+    CpuCascades cascades(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba32f, options.Topology);
+    for (auto i = 0u; i < cascades.GetCount(); ++i)
+        cascades.Trace(scene.Scene, i, options.MaxThreads);
+    for (int i = cascades.GetCount() - 1; i >= 0; --i)
+        cascades.Merge(scene.Scene, i, options.MaxThreads);
+    const auto reference = cascades;
+
+    // Largest error of a 1 bit visibility mask in place of the float alpha
+    double maskError = 0.0;
+    ForEachTexel(reference, 0, [&](uint32_t x, uint32_t y, uint32_t z)
+    {
+        const auto alpha = reference.Load(0, x, y, z).w;
+        maskError = std::max(maskError, (double)std::abs(alpha - std::round(alpha)));
+    });
+
+    std::vector<FormatResult> formats;
+    for (const auto format : c_cascadeFormats)
+    {
+        FormatResult entry;
+        entry.Format = format;
+        const auto cost = EstimateCascadeCost(options.Topology, options.Resolution, options.CascadeCount, format);
+        entry.CascadeBytes = cost.CascadeBytes;
+        entry.MergeBytes = cost.MergeBytes;
+
+        cascades.SetFormat(format);
+        entry.MergeSeconds = MeasureFastest(options.Iterations, [&]()
+        {
+            for (int i = cascades.GetCount() - 1; i >= 0; --i)
+                cascades.Merge(scene.Scene, i, options.MaxThreads);
+        });
+
+        ErrorStats error;
+        ForEachTexel(reference, 0, [&](uint32_t x, uint32_t y, uint32_t z)
+        {
+            const auto expected = reference.Load(0, x, y, z);
+            const auto actual = cascades.Load(0, x, y, z);
+            error.Add(actual.x - expected.x, expected.x);
+            error.Add(actual.y - expected.y, expected.y);
+            error.Add(actual.z - expected.z, expected.z);
+            entry.AlphaError = std::max(entry.AlphaError, (double)std::abs(actual.w - expected.w));
+        });
+        entry.Error = error.GetRelative();
+        entry.MaxError = error.Max;
+        formats.push_back(entry);
+    }
+
+    const FormatResult* selected = &formats[0];
+    for (const auto& entry : formats)
+    {
+        if (entry.Error > options.ErrorBudget)
+            continue;
+        const auto bytes = GetFormatBytes(entry.Format);
+        const auto selectedBytes = GetFormatBytes(selected->Format);
+        if (bytes < selectedBytes || (bytes == selectedBytes && entry.Error < selected->Error))
+            selected = &entry;
+    }
+
+    const auto& baseline = formats[0];
+    json.BeginObject("formats");
+    json.Write("selected", GetFormatName(selected->Format));
+    json.Write("maskError", maskError);
+    json.BeginArray("entries");
+    for (const auto& entry : formats)
+    {
+        json.BeginObject(nullptr, true);
+        json.Write("format", GetFormatName(entry.Format));
+        json.Write("texelBytes", GetFormatBytes(entry.Format));
+        json.Write("cascadeBytes", entry.CascadeBytes);
+        json.Write("mergeBytes", entry.MergeBytes);
+        json.Write("memoryReduction", (double)baseline.CascadeBytes / entry.CascadeBytes);
+        json.Write("mergeSeconds", entry.MergeSeconds);
+        json.Write("mergeSpeedup", baseline.MergeSeconds / entry.MergeSeconds);
+        json.Write("meanError", entry.Error);
+        json.Write("maxError", entry.MaxError);
+        json.Write("alphaError", entry.AlphaError);
+        json.End();
+    }
+    json.End();
+    json.End();
+}
@@ -0,0 +1,60 @@
+#include "BenchmarkCommon.h"
+#include "HeadlessRenderer.h"
+#include "NullDevice.h"
+
+// Frame loop of HeadlessRenderer on a NullDevice a frame behind, animating the emitter like RunSchedules. Its barriers
+// and shading are checked by HeadlessRendererTests.
+void RunHeadless(const BenchmarkOptions& options, BenchmarkScene& scene, JsonWriter& json)
+{
+    constexpr uint32_t width = 160;
+    constexpr uint32_t height = 90;
+    constexpr uint32_t downscale = 2;
+    NullDevice device(1);
+    HeadlessRenderer renderer(device, width, height, options.Resolution, options.Extends, options.Offset, options.CascadeCount, 2, downscale, CascadeFormat::Rgba16f, options.Topology, options.MaxThreads);
+    const auto gbuffer = MakeSyntheticGBuffer(width, height);
+
+    Profiler profiler;
+    renderer.SetProfiler(&profiler);
+
+    double seconds = 0.0;
+    for (auto frame = 0u; frame < options.ScheduleFrames; ++frame)
+    {
+        const auto changedBounds = scene.AnimateEmitter(frame);
+        seconds += MeasureSeconds([&]() { renderer.Render(scene.Scene, changedBounds, gbuffer); });
+    }
+    if (!options.Trace.empty())
+        profiler.WriteChromeTrace(options.Trace + scene.Name + ".json");
+    scene.ResetEmitter();
+
+    json.BeginObject("headless");
+    json.Write("frames", options.ScheduleFrames);
+    json.Write("width", width);
+    json.Write("height", height);
+    json.Write("seconds", seconds / options.ScheduleFrames);
+    json.Write("passes", renderer.GetPassTimings().size());
+    json.Write("samples", profiler.GetSampleCount());
+    json.Write("barriers", renderer.GetBarrierCount());
+    json.Write("pacerWaits", renderer.GetFramePacer().GetWaitCount());
+    const auto& deviceStats = device.GetStats();
+    json.BeginObject("device", true);
+    json.Write("transitions", deviceStats.Transitions);
+    json.Write("splitBegins", deviceStats.SplitBegins);
+    json.Write("splitEnds", deviceStats.SplitEnds);
+    json.Write("uavBarriers", deviceStats.UavBarriers);
+    json.Write("batches", deviceStats.Batches);
+    json.Write("copies", deviceStats.Copies);
+    json.Write("copiedBytes", deviceStats.CopiedBytes);
+    json.Write("submissions", deviceStats.Submissions);
+    json.Write("waits", deviceStats.Waits);
+    json.End();
+    // Per frame, the passes summed by name in the order they first ran, the scopes nested in "Graph execution" of
+    // "Frame"
+    json.BeginObject("passSeconds", true);
+    for (const auto& entry : profiler.CollectStats())
+    {
+        if (entry.Track == ProfileTrack::Cpu && entry.Depth == 2)
+            json.Write(entry.Name, entry.Mean);
+    }
+    json.End();
+    json.End();
+}
@@ -0,0 +1,47 @@
+#include "BenchmarkCommon.h"
+
+#include <random>
+
+// Projection of cascade 0 into per probe SH irradiance against the gather over every direction at random
+// positions and normals inside the cascade volume, errors relative like CompareCascades
+void RunIrradiance(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json)
+{
+    constexpr uint32_t sampleCount = 1024;
+    CpuCascades cascades(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba16f, options.Topology);
+    cascades.Generate(scene.Scene, options.MaxThreads);
+    const auto projectSeconds = MeasureFastest(options.Iterations, [&]() { cascades.ProjectIrradiance(options.MaxThreads); });
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    ErrorStats error;
+    double gatherSeconds = 0.0;
+    double sampleSeconds = 0.0;
+    for (auto i = 0u; i < sampleCount; ++i)
+    {
+        const Float3 pos = {unit(random), unit(random), unit(random)};
+        const auto normal = FromSpherical(unit(random), std::acos(1.f - 2.f * unit(random)) / 3.1415926f);
+
+        Float3 expected;
+        Float3 actual;
+        gatherSeconds += MeasureSeconds([&]() { expected = cascades.IntegrateIrradiance(pos, normal); });
+        sampleSeconds += MeasureSeconds([&]() { actual = cascades.SampleIrradiance(pos, normal); });
+        for (auto c = 0u; c < 3; ++c)
+            error.Add(actual[c] - expected[c], expected[c]);
+    }
+
+    const auto pixelCount = options.Topology.GetPixelCount(0);
+    // Texture taps per shaded pixel, 8 per direction against 2 per irradiance texel
+    const auto gatherFetches = pixelCount[0] * pixelCount[1] * 8;
+    const auto sampleFetches = c_irradianceTexels * 2;
+    json.BeginObject("irradiance", true);
+    json.Write("samples", sampleCount);
+    json.Write("projectSeconds", projectSeconds);
+    json.Write("gatherFetches", gatherFetches);
+    json.Write("sampleFetches", sampleFetches);
+    json.Write("fetchReduction", (double)gatherFetches / sampleFetches);
+    json.Write("gatherSecondsPerSample", gatherSeconds / sampleCount);
+    json.Write("sampleSecondsPerSample", sampleSeconds / sampleCount);
+    json.Write("meanError", error.GetRelative());
+    json.Write("maxError", error.Max);
+    json.End();
+}
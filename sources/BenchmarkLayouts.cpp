@@ -0,0 +1,259 @@
+#include "BenchmarkCommon.h"
+
+#include <array>
+
+namespace
+{
+    // Set associative LRU cache of 128 byte lines, each holding a 4x4 texel tile of one atlas slice like the swizzled
+    // layouts of GPU textures do for the 8 byte Rgba16f texels
+    class CacheSimulator
+    {
+    public:
+        static constexpr uint32_t c_lineBytes = 128;
+        static constexpr uint32_t c_lineTexels = 4;
+
+        CacheSimulator(uint32_t bytes, uint32_t ways, uint32_t width, uint32_t height)
+            : m_ways(ways)
+            , m_sets(bytes / c_lineBytes / ways)
+            , m_linesX((width + c_lineTexels - 1) / c_lineTexels)
+            , m_linesY((height + c_lineTexels - 1) / c_lineTexels)
+            , m_tags(m_sets * ways, ~0ull)
+        {
+        }
+
+        inline uint64_t GetLine(uint32_t x, uint32_t y, uint32_t z) const
+        {
+            return ((uint64_t)z * m_linesY + y / c_lineTexels) * m_linesX + x / c_lineTexels;
+        }
+
+        // One memory request of a warp, the distinct lines of its lanes are looked up once each
+        void Request(std::vector<uint64_t>& lines)
+        {
+            std::sort(lines.begin(), lines.end());
+            lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+            for (const auto line : lines)
+            {
+                auto* set = &m_tags[line % m_sets * m_ways];
+                auto way = 0u;
+                while (way < m_ways && set[way] != line)
+                    ++way;
+                if (way < m_ways)
+                    ++m_hits;
+                else
+                    ++m_misses;
+                for (way = std::min(way, m_ways - 1); way > 0; --way)
+                    set[way] = set[way - 1];
+                set[0] = line;
+            }
+            lines.clear();
+        }
+
+        inline uint64_t GetLookups() const { return m_hits + m_misses; }
+        inline double GetHitRate() const { return GetLookups() > 0 ? (double)m_hits / GetLookups() : 0.0; }
+        inline uint64_t GetMissBytes() const { return m_misses * c_lineBytes; }
+
+    private:
+        uint32_t m_ways;
+        uint32_t m_sets;
+        uint32_t m_linesX;
+        uint32_t m_linesY;
+        std::vector<uint64_t> m_tags;
+        uint64_t m_hits = 0;
+        uint64_t m_misses = 0;
+    };
+
+    struct LayoutLevelResult
+    {
+        // Cache lines per warp of the merge reading this level's next level, 0 for the last level
+        double MergeLines = 0.0;
+        double MergeHitRate = 0.0;
+        uint64_t MergeMissBytes = 0;
+        // Length of the mean ray direction of a warp, 1 when all its rays are parallel
+        double RayCoherence = 0.0;
+    };
+}
+
+// Texel reads of the merges and the irradiance projection replayed through a 32 KiB 4 way cache for both
+// layouts, with the dense bricks of the benchmark volume. Warps are 32 threads of a group in x, y, z order and
+// groups run one after the other in dispatch order, which leaves out the reuse between groups in flight.
+void RunLayouts(const BenchmarkOptions& options, JsonWriter& json)
+{
+    constexpr uint32_t cacheBytes = 32 << 10;
+    constexpr uint32_t cacheWays = 4;
+    constexpr uint32_t warpSize = 32;
+    const auto& resolution = options.Resolution;
+    const auto& topology = options.Topology;
+
+    json.BeginArray("layouts");
+    for (const auto layout : {CascadeLayout::ProbeMajor, CascadeLayout::DirectionMajor})
+    {
+        std::vector<LayoutLevelResult> levels(options.CascadeCount);
+        const auto start = BenchmarkClock::now();
+
+        for (auto cascade = 0u; cascade < options.CascadeCount; ++cascade)
+        {
+            auto& level = levels[cascade];
+            const uint32_t levelCount[3] = {resolution.x >> cascade, resolution.y >> cascade, resolution.z >> cascade};
+            const auto pixelCount = topology.GetPixelCount(cascade);
+            const auto atlasSize = topology.GetAtlasSize(resolution, cascade);
+
+            // Rays of a warp of consecutive dispatch x, as CascadeTracing.hlsl traces every texel of a slice
+            double coherence = 0.0;
+            uint64_t warps = 0;
+            for (auto y = 0u; y < atlasSize[1]; ++y)
+            {
+                for (auto x = 0u; x < atlasSize[0]; x += warpSize)
+                {
+                    Float3 sum = {0.f, 0.f, 0.f};
+                    for (auto lane = x; lane < x + warpSize; ++lane)
+                    {
+                        const auto split = SplitDispatchIndex(topology, resolution, cascade, layout, lane, y, 0);
+                        sum = sum + FromSpherical((split[3] + 0.5f) / pixelCount[0], (split[4] + 0.5f) / pixelCount[1]);
+                    }
+                    coherence += std::sqrt(Dot(sum, sum)) / warpSize;
+                    ++warps;
+                }
+            }
+            level.RayCoherence = coherence / warps;
+
+            if (cascade + 1 >= options.CascadeCount)
+                continue;
+
+            // Reads of the next level by the merge of this one, see SampleHigherCascade in
+            // CascadeAccumulation.hlsl. Probe-major takes one bilinear sample per corner and tap, direction-major
+            // four loads, every request of a warp is one instruction.
+            const uint32_t nextCount[3] = {levelCount[0] / 2, levelCount[1] / 2, levelCount[2] / 2};
+            const auto nextPixelCount = topology.GetPixelCount(cascade + 1);
+            const auto nextSize = topology.GetAtlasSize(resolution, cascade + 1);
+            const auto taps = std::max((1u << topology.AngularShift) / 2, 1u);
+            const auto requests = (layout == CascadeLayout::DirectionMajor ? 32u : 8u) * taps * taps;
+            CacheSimulator cache(cacheBytes, cacheWays, nextSize[0], nextSize[1]);
+            std::vector<std::vector<uint64_t>> lines(requests);
+            warps = 0;
+            for (auto gz = 0u; gz < levelCount[2]; gz += 4)
+            {
+                for (auto gy = 0u; gy < atlasSize[1]; gy += 4)
+                {
+                    for (auto gx = 0u; gx < atlasSize[0]; gx += 4)
+                    {
+                        for (auto thread = 0u; thread < 64; ++thread)
+                        {
+                            const uint32_t z = gz + thread / 16;
+                            const auto split = SplitDispatchIndex(topology, resolution, cascade, layout, gx + thread % 4, gy + thread / 4 % 4, z);
+                            if (z < levelCount[2])
+                            {
+                                const float u = (split[3] + 0.5f) / pixelCount[0];
+                                const float v = (split[4] + 0.5f) / pixelCount[1];
+                                int ll[3];
+                                for (auto axis = 0u; axis < 3; ++axis)
+                                {
+                                    const float position = std::clamp((split[axis] + 0.5f) / levelCount[axis] * nextCount[axis], 0.51f, nextCount[axis] - 0.51f);
+                                    const float t = position - std::floor(position) - 0.5f;
+                                    ll[axis] = (int)std::floor(position) - (t < 0.f ? 1 : 0);
+                                }
+
+                                for (auto i = 0u; i < 8 * taps * taps; ++i)
+                                {
+                                    const auto tap = i / 8;
+                                    const int corner[3] = {ll[0] + (int)(i & 1), ll[1] + (int)((i >> 1) & 1), ll[2] + (int)((i >> 2) & 1)};
+                                    std::array<uint32_t, 3> probe;
+                                    for (auto axis = 0u; axis < 3; ++axis)
+                                        probe[axis] = (uint32_t)std::clamp(corner[axis], 0, (int)nextCount[axis] - 1);
+                                    const float coordX = u * nextPixelCount[0] + (tap % taps) * 2.f + 1.f - taps - 0.5f;
+                                    const float coordY = v * nextPixelCount[1] + (tap / taps) * 2.f + 1.f - taps - 0.5f;
+                                    if (layout == CascadeLayout::DirectionMajor)
+                                    {
+                                        for (auto load = 0u; load < 4; ++load)
+                                        {
+                                            const auto dx = (uint32_t)std::clamp((int)std::floor(coordX) + (int)(load & 1), 0, (int)nextPixelCount[0] - 1);
+                                            const auto dy = (uint32_t)std::clamp((int)std::floor(coordY) + (int)(load >> 1), 0, (int)nextPixelCount[1] - 1);
+                                            const auto texel = GetDirectionTexel(topology, resolution, cascade + 1, layout, probe, dx, dy);
+                                            lines[i * 4 + load].push_back(cache.GetLine(texel[0], texel[1], texel[2]));
+                                        }
+                                    }
+                                    else
+                                    {
+                                        // Sampler footprint around the corner's tile, clamped at the atlas border
+                                        const float baseX = std::floor(corner[0] * (float)nextPixelCount[0] + coordX);
+                                        const float baseY = std::floor(corner[1] * (float)nextPixelCount[1] + coordY);
+                                        for (auto load = 0u; load < 4; ++load)
+                                        {
+                                            const auto x = (uint32_t)std::clamp((int)baseX + (int)(load & 1), 0, (int)nextSize[0] - 1);
+                                            const auto y = (uint32_t)std::clamp((int)baseY + (int)(load >> 1), 0, (int)nextSize[1] - 1);
+                                            lines[i].push_back(cache.GetLine(x, y, probe[2]));
+                                        }
+                                    }
+                                }
+                            }
+
+                            if ((thread + 1) % warpSize == 0 && !lines[0].empty())
+                            {
+                                for (auto& request : lines)
+                                    cache.Request(request);
+                                ++warps;
+                            }
+                        }
+                    }
+                }
+            }
+            level.MergeLines = (double)cache.GetLookups() / warps;
+            level.MergeHitRate = cache.GetHitRate();
+            level.MergeMissBytes = cache.GetMissBytes();
+        }
+
+        // CascadeIrradiance.hlsl, one group per probe whose threads stride over the directions of a row
+        const auto pixelCount = topology.GetPixelCount(0);
+        const auto atlasSize = topology.GetAtlasSize(resolution, 0);
+        CacheSimulator cache(cacheBytes, cacheWays, atlasSize[0], atlasSize[1]);
+        std::vector<uint64_t> lines;
+        uint64_t warps = 0;
+        for (auto z = 0u; z < resolution.z; ++z)
+        {
+            for (auto y = 0u; y < resolution.y; ++y)
+            {
+                for (auto x = 0u; x < resolution.x; ++x)
+                {
+                    for (auto warp = 0u; warp < 64; warp += warpSize)
+                    {
+                        for (auto first = warp; first < pixelCount[0]; first += 64)
+                        {
+                            for (auto dy = 0u; dy < pixelCount[1]; ++dy)
+                            {
+                                for (auto dx = first; dx < std::min(first + warpSize, pixelCount[0]); ++dx)
+                                {
+                                    const auto texel = GetDirectionTexel(topology, resolution, 0, layout, {x, y, z}, dx, dy);
+                                    lines.push_back(cache.GetLine(texel[0], texel[1], texel[2]));
+                                }
+                                cache.Request(lines);
+                            }
+                        }
+                        ++warps;
+                    }
+                }
+            }
+        }
+        const auto seconds = std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+
+        json.BeginObject();
+        json.Write("layout", GetLayoutName(layout));
+        json.Write("seconds", seconds);
+        // Irradiance projection reading cascade 0
+        json.Write("projectLinesPerWarp", (double)cache.GetLookups() / warps);
+        json.Write("projectHitRate", cache.GetHitRate());
+        json.Write("projectMissBytes", cache.GetMissBytes());
+        json.BeginArray("levels");
+        for (auto i = 0u; i < levels.size(); ++i)
+        {
+            json.BeginObject(nullptr, true);
+            json.Write("cascade", i);
+            json.Write("rayCoherence", levels[i].RayCoherence);
+            json.Write("mergeLinesPerWarp", levels[i].MergeLines);
+            json.Write("mergeHitRate", levels[i].MergeHitRate);
+            json.Write("mergeMissBytes", levels[i].MergeMissBytes);
+            json.End();
+        }
+        json.End();
+        json.End();
+    }
+    json.End();
+}
@@ -0,0 +1,57 @@
+#include "BenchmarkCommon.h"
+
+// Trace and merge of every level on its own, then whole generations across thread counts
+void RunLevels(const BenchmarkOptions& options, const BenchmarkScene& scene, JsonWriter& json)
+{
+    CpuCascades cascades(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba16f, options.Topology);
+    const auto count = cascades.GetCount();
+
+    std::vector<double> traceSeconds(count, INFINITY);
+    std::vector<double> mergeSeconds(count, INFINITY);
+    for (auto iteration = 0u; iteration < options.Iterations; ++iteration)
+    {
+        for (auto i = 0u; i < count; ++i)
+            traceSeconds[i] = std::min(traceSeconds[i], MeasureSeconds([&]() { cascades.Trace(scene.Scene, i, options.MaxThreads); }));
+        for (int i = count - 1; i >= 0; --i)
+            mergeSeconds[i] = std::min(mergeSeconds[i], MeasureSeconds([&]() { cascades.Merge(scene.Scene, i, options.MaxThreads); }));
+    }
+
+    json.BeginArray("levels");
+    for (auto i = 0u; i < count; ++i)
+    {
+        const uint64_t texels = (uint64_t)cascades.GetWidth(i) * cascades.GetHeight(i) * cascades.GetDepth(i);
+        const uint64_t texelSize = GetFormatBytes(cascades.GetFormat());
+        // Hit ids in and the merged level out, plus eight bilinear taps into the level above
+        const uint64_t mergeBytes = texels * (sizeof(uint16_t) + texelSize + (i + 1 < count ? texelSize * 8 * 4 : 0));
+        json.BeginObject(nullptr, true);
+        json.Write("cascade", i);
+        json.Write("rays", texels);
+        json.Write("traceSeconds", traceSeconds[i]);
+        json.Write("raysPerSecond", texels / traceSeconds[i]);
+        json.Write("mergeSeconds", mergeSeconds[i]);
+        json.Write("traceBytes", texels * sizeof(uint16_t));
+        json.Write("mergeBytes", mergeBytes);
+        json.Write("mergeBytesPerSecond", mergeSeconds[i] > 0.0 ? mergeBytes / mergeSeconds[i] : 0.0);
+        json.End();
+    }
+    json.End();
+
+    std::vector<uint32_t> threadCounts;
+    for (auto threads = 1u; threads < options.MaxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(options.MaxThreads);
+
+    json.BeginArray("scaling");
+    double first = 0.0;
+    for (const auto threads : threadCounts)
+    {
+        const auto seconds = MeasureFastest(options.Iterations, [&]() { cascades.Generate(scene.Scene, threads); });
+        first = first > 0.0 ? first : seconds;
+        json.BeginObject(nullptr, true);
+        json.Write("threads", threads);
+        json.Write("seconds", seconds);
+        json.Write("speedup", first / seconds);
+        json.End();
+    }
+    json.End();
+}
@@ -0,0 +1,62 @@
+#include "BenchmarkCommon.h"
+#include "PipelineCache.h"
+
+#include <filesystem>
+#include <random>
+
+// Round trips of PipelineCache through a file, with blobs of random bytes in the size range of driver pipeline
+// blobs, keyed like Device keys its pipeline streams. Damaged files and eviction are checked by PipelineCacheTests.
+void RunPipelineCache(const BenchmarkOptions& options, JsonWriter& json)
+{
+    constexpr uint32_t entryCount = 64;
+    constexpr uint64_t environment = 0x5043;
+    const auto path = (std::filesystem::temp_directory_path() / "cascade-benchmark.pipelines").string();
+
+    struct Pipeline
+    {
+        std::vector<uint8_t> Bytecode;
+        uint32_t State[8];
+        std::vector<uint8_t> Blob;
+    };
+    const auto getKey = [](const Pipeline& pipeline) { return PipelineKey().Add(pipeline.Bytecode.data(), pipeline.Bytecode.size()).AddValue(pipeline.State).GetHash(); };
+
+    std::mt19937 random(1);
+    std::vector<Pipeline> pipelines(entryCount);
+    std::vector<uint64_t> keys;
+    for (auto& pipeline : pipelines)
+    {
+        pipeline.Bytecode.resize(1024 + random() % 8192);
+        for (auto& byte : pipeline.Bytecode)
+            byte = (uint8_t)random();
+        for (auto& state : pipeline.State)
+            state = random() % 4;
+        pipeline.Blob.resize(4096 + random() % 61440);
+        for (auto& byte : pipeline.Blob)
+            byte = (uint8_t)random();
+        keys.push_back(getKey(pipeline));
+    }
+
+    double saveSeconds = INFINITY;
+    double loadSeconds = INFINITY;
+    for (auto iteration = 0u; iteration < options.Iterations; ++iteration)
+    {
+        PipelineCache written(environment);
+        for (auto i = 0u; i < entryCount; ++i)
+            written.Store(keys[i], pipelines[i].Blob.data(), pipelines[i].Blob.size());
+        saveSeconds = std::min(saveSeconds, MeasureSeconds([&]() { written.Save(path); }));
+
+        PipelineCache loaded(environment);
+        loadSeconds = std::min(loadSeconds, MeasureSeconds([&]() { loaded.Load(path); }));
+    }
+    const auto fileBytes = std::filesystem::file_size(path);
+
+    std::error_code error;
+    std::filesystem::remove(path, error);
+
+    json.BeginObject("pipelineCache", true);
+    json.Write("entries", entryCount);
+    json.Write("fileBytes", fileBytes);
+    json.Write("saveSeconds", saveSeconds);
+    json.Write("loadSeconds", loadSeconds);
+    json.End();
+}
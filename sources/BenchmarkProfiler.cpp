@@ -0,0 +1,50 @@
+#include "BenchmarkCommon.h"
+#include "Profiler.h"
+
+#include <sstream>
+
+// Cost of the CPU scopes and of collecting and exporting a full ring, three nested scopes per frame with the
+// innermost opened several times like the per level passes
+void RunProfiler(const BenchmarkOptions& options, JsonWriter& json)
+{
+    constexpr uint32_t scopeCount = 1 << 20;
+    Profiler profiler;
+    const auto scopeSeconds = MeasureSeconds([&]()
+    {
+        for (auto i = 0u; i < scopeCount; ++i)
+            ProfileScope scope(&profiler, "Scope");
+    });
+
+    Profiler frames;
+    constexpr uint32_t passesPerFrame = 4;
+    while (frames.GetDroppedCount() == 0)
+    {
+        frames.BeginFrame();
+        ProfileScope frame(&frames, "Frame");
+        ProfileScope execution(&frames, "Graph execution");
+        for (auto i = 0u; i < passesPerFrame; ++i)
+            ProfileScope pass(&frames, "Pass");
+    }
+
+    // ProfilerTests checks the stats of a wrapped ring
+    std::vector<ProfileStats> stats;
+    const auto statsSeconds = MeasureFastest(options.Iterations, [&]() { stats = frames.CollectStats(); });
+
+    size_t traceBytes = 0;
+    const auto exportSeconds = MeasureFastest(options.Iterations, [&]()
+    {
+        std::ostringstream trace;
+        frames.WriteChromeTrace(trace);
+        traceBytes = trace.str().size();
+    });
+
+    json.BeginObject("profiler", true);
+    json.Write("scopes", scopeCount);
+    json.Write("scopeNanoseconds", scopeSeconds * 1e9 / scopeCount);
+    json.Write("samples", frames.GetSampleCount());
+    json.Write("dropped", frames.GetDroppedCount());
+    json.Write("statsSeconds", statsSeconds);
+    json.Write("exportSeconds", exportSeconds);
+    json.Write("traceBytes", traceBytes);
+    json.End();
+}
@@ -0,0 +1,122 @@
+#include "BenchmarkCommon.h"
+
+#include <memory>
+
+namespace
+{
+    struct ScheduleResult
+    {
+        std::string Mode;
+        uint64_t FullRays = 0;
+        uint64_t ModelRays = 0;
+        uint64_t PeakRays = 0;
+        uint64_t Rays = 0;
+        double Seconds = 0.0;
+        double Error = 0.0;
+        double MaxError = 0.0;
+    };
+}
+
+// Animates the emitter and runs every CascadeScheduler mode next to full updates of every frame, reporting the rays
+// traced per frame and the error of the stale levels against the full update. The "incremental" entry traces only
+// the probes a ProbeInvalidation collects from the old and new emitter bounds, its model and peak rays are those of
+// the frames after the first. It matches the full update exactly, which ProbeInvalidationTests checks, so it has no
+// error of its own.
+void RunSchedules(const BenchmarkOptions& options, BenchmarkScene& scene, JsonWriter& json)
+{
+    const std::pair<CascadeScheduler::Mode, const char*> modes[] = {
+        {CascadeScheduler::Mode::Full, "full"},
+        {CascadeScheduler::Mode::Cadence, "cadence"},
+        {CascadeScheduler::Mode::Slices, "slices"}
+    };
+
+    CpuCascades reference(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba16f, options.Topology);
+    std::vector<std::unique_ptr<CpuCascades>> cascades;
+    std::vector<CascadeScheduler> schedulers;
+    std::vector<ScheduleResult> schedules;
+    for (const auto& [mode, name] : modes)
+    {
+        cascades.push_back(std::make_unique<CpuCascades>(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba16f, options.Topology));
+        schedulers.emplace_back(options.Resolution, options.CascadeCount, options.Topology, mode);
+
+        ScheduleResult schedule;
+        schedule.Mode = name;
+        schedule.FullRays = schedulers.back().GetFullRays();
+        schedule.ModelRays = schedulers.back().GetAverageRays();
+        schedule.PeakRays = schedulers.back().GetPeakRays();
+        schedules.push_back(schedule);
+    }
+
+    CpuCascades incremental(options.Resolution, options.Extends, options.Offset, options.CascadeCount, CascadeFormat::Rgba16f, options.Topology);
+    ProbeInvalidation invalidation(options.Resolution, options.Extends, options.Offset, options.CascadeCount, options.Topology);
+    const std::vector<CascadeSlices> noSlices(options.CascadeCount);
+    ScheduleResult incrementalResult;
+    incrementalResult.Mode = "incremental";
+    incrementalResult.FullRays = schedulers[0].GetFullRays();
+
+    for (auto frame = 0u; frame < options.ScheduleFrames; ++frame)
+    {
+        for (const auto& bounds : scene.AnimateEmitter(frame))
+            invalidation.Invalidate(bounds);
+
+        uint64_t rays = incrementalResult.FullRays;
+        if (frame > 0)
+        {
+            rays = 0;
+            for (auto i = 0u; i < options.CascadeCount; ++i)
+            {
+                const auto pixelCount = options.Topology.GetPixelCount(i);
+                rays += invalidation.GetProbes(i).size() * pixelCount[0] * pixelCount[1];
+            }
+            incrementalResult.ModelRays += rays / (options.ScheduleFrames - 1);
+            incrementalResult.PeakRays = std::max(incrementalResult.PeakRays, rays);
+        }
+        incrementalResult.Seconds += MeasureSeconds([&]()
+        {
+            if (frame == 0)
+                incremental.Generate(scene.Scene, options.MaxThreads);
+            else
+                incremental.Generate(scene.Scene, noSlices, invalidation, options.MaxThreads);
+        });
+        incrementalResult.Rays += rays;
+        invalidation.Clear();
+
+        reference.Generate(scene.Scene, options.MaxThreads);
+        for (auto m = 0u; m < schedulers.size(); ++m)
+        {
+            auto& schedule = schedules[m];
+            const auto& updates = schedulers[m].Advance();
+            schedule.Seconds += MeasureSeconds([&]() { cascades[m]->Generate(scene.Scene, updates, options.MaxThreads); });
+            schedule.Rays += schedulers[m].GetFrameRays();
+
+            // The first frame updates everything in every mode
+            if (frame == 0)
+                continue;
+            const auto error = CompareCascades(reference, *cascades[m]);
+            schedule.Error += error / (options.ScheduleFrames - 1);
+            schedule.MaxError = std::max(schedule.MaxError, error);
+        }
+    }
+    scene.ResetEmitter();
+
+    schedules.push_back(incrementalResult);
+    json.BeginArray("schedules");
+    for (const auto& schedule : schedules)
+    {
+        const auto rays = schedule.Rays / options.ScheduleFrames;
+        json.BeginObject(nullptr, true);
+        json.Write("mode", schedule.Mode);
+        json.Write("raysPerFrame", rays);
+        json.Write("modelRaysPerFrame", schedule.ModelRays);
+        json.Write("peakRaysPerFrame", schedule.PeakRays);
+        json.Write("rayReduction", (double)schedule.FullRays / rays);
+        json.Write("secondsPerFrame", schedule.Seconds / options.ScheduleFrames);
+        if (&schedule != &schedules.back())
+        {
+            json.Write("meanError", schedule.Error);
+            json.Write("maxError", schedule.MaxError);
+        }
+        json.End();
+    }
+    json.End();
+}
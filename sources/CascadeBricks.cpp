@@ -0,0 +1,256 @@
+#include "CascadeBricks.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+namespace
+{
+    // Drawing.ps.hlsl looks the cascade up this far along the normal, plus rounding slack
+    constexpr float c_lookupBias = 0.1f + 1e-3f;
+
+    // Lower corner of the trilinear footprint, the ll of SampleHigherCascade in CascadeAccumulation.hlsl
+    float LowerCorner(float position)
+    {
+        const float t = position - std::floor(position) - 0.5f;
+        return t < 0.f ? std::floor(position) - 1.f : std::floor(position);
+    }
+}
+
+CascadeBricks::CascadeBricks(const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount)
+    : m_levels(cascadeCount)
+    , m_resolution(resolution)
+    , m_extends(extends)
+    , m_offset(offset)
+    , m_count(cascadeCount)
+{
+    uint32_t offsetBricks = 0;
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        auto& level = m_levels[i];
+        level.Probes = {resolution.x >> i, resolution.y >> i, resolution.z >> i};
+        level.Size = GetBrickSize(resolution, i);
+        for (auto axis = 0u; axis < 3; ++axis)
+        {
+            // GetAtlasProbe keeps the dense texture width and height, bricks have to tile the level
+            assert(level.Probes[axis] % level.Size[axis] == 0);
+            level.Bricks[axis] = level.Probes[axis] / level.Size[axis];
+        }
+        level.Offset = offsetBricks;
+        level.Needed.resize((uint64_t)level.Probes[0] * level.Probes[1] * level.Probes[2]);
+        offsetBricks += GetBrickCount(i);
+    }
+    m_indirection.resize(offsetBricks, c_absentBrick);
+}
+
+void CascadeBricks::Occupy(const Aabb& bounds)
+{
+    const auto& level = m_levels[0];
+    const Float3 extends = {m_extends.x, m_extends.y, m_extends.z};
+    const Float3 offset = {m_offset.x, m_offset.y, m_offset.z};
+    Float3 low;
+    Float3 high;
+    for (auto axis = 0u; axis < 3; ++axis)
+    {
+        // cascadePos * probeCount of Drawing.ps.hlsl
+        low[axis] = ((bounds.Min[axis] - c_lookupBias - offset[axis]) / extends[axis] * 0.5f + 0.5f) * level.Probes[axis];
+        high[axis] = ((bounds.Max[axis] + c_lookupBias - offset[axis]) / extends[axis] * 0.5f + 0.5f) * level.Probes[axis];
+    }
+    MarkLookup(0, low, high);
+}
+
+void CascadeBricks::Update()
+{
+    std::vector<uint8_t> resident;
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        auto& level = m_levels[i];
+        resident.assign(GetBrickCount(i), 0);
+        for (auto z = 0u; z < level.Probes[2]; ++z)
+        {
+            for (auto y = 0u; y < level.Probes[1]; ++y)
+            {
+                for (auto x = 0u; x < level.Probes[0]; ++x)
+                {
+                    if (level.Needed[((uint64_t)z * level.Probes[1] + y) * level.Probes[0] + x])
+                        resident[GetBrickIndex(i, x, y, z) - level.Offset] = 1;
+                }
+            }
+        }
+        std::fill(level.Needed.begin(), level.Needed.end(), 0);
+
+        level.ResidentCount = 0;
+        for (auto brick = 0u; brick < resident.size(); ++brick)
+        {
+            auto& slot = m_indirection[level.Offset + brick];
+            level.ResidentCount += resident[brick];
+            if (!resident[brick] && slot != c_absentBrick)
+            {
+                level.FreeSlots.push_back(slot);
+                slot = c_absentBrick;
+            }
+        }
+
+        // Lowest free slots first keeps the atlas layers in use few
+        std::sort(level.FreeSlots.begin(), level.FreeSlots.end(), std::greater<uint32_t>());
+        level.Added.clear();
+        for (auto brick = 0u; brick < resident.size(); ++brick)
+        {
+            auto& slot = m_indirection[level.Offset + brick];
+            if (!resident[brick] || slot != c_absentBrick)
+                continue;
+            if (level.FreeSlots.empty())
+            {
+                slot = level.SlotCount++;
+            }
+            else
+            {
+                slot = level.FreeSlots.back();
+                level.FreeSlots.pop_back();
+            }
+            level.Added.push_back(brick);
+        }
+
+        if (i + 1 == m_count)
+            continue;
+
+        // Every probe of a resident brick is merged, so the level above has to hold what all of them read
+        const auto& above = m_levels[i + 1];
+        for (auto brick = 0u; brick < resident.size(); ++brick)
+        {
+            if (!resident[brick])
+                continue;
+            const uint32_t brickIndex[3] = {brick % level.Bricks[0], brick / level.Bricks[0] % level.Bricks[1], brick / (level.Bricks[0] * level.Bricks[1])};
+            Float3 low;
+            Float3 high;
+            for (auto axis = 0u; axis < 3; ++axis)
+            {
+                const auto first = brickIndex[axis] * level.Size[axis];
+                low[axis] = (first + 0.5f) / level.Probes[axis] * above.Probes[axis];
+                high[axis] = (first + level.Size[axis] - 0.5f) / level.Probes[axis] * above.Probes[axis];
+            }
+            MarkLookup(i + 1, low, high);
+        }
+    }
+}
+
+uint32_t CascadeBricks::GetLayerCount(uint32_t cascade) const
+{
+    const auto& level = m_levels[cascade];
+    const auto bricksPerLayer = level.Bricks[0] * level.Bricks[1];
+    return std::max((level.SlotCount + bricksPerLayer - 1) / bricksPerLayer, 1u);
+}
+
+void CascadeBricks::MarkLookup(uint32_t cascade, const Float3& low, const Float3& high)
+{
+    auto& level = m_levels[cascade];
+    uint32_t first[3];
+    uint32_t last[3];
+    for (auto axis = 0u; axis < 3; ++axis)
+    {
+        // Same clamp as the lookups, corners outside a single probe axis read its only probe
+        const float maxPosition = level.Probes[axis] - 0.51f;
+        const float lowCorner = LowerCorner(std::min(std::max(low[axis], 0.51f), maxPosition));
+        const float highCorner = LowerCorner(std::min(std::max(high[axis], 0.51f), maxPosition)) + 1.f;
+        first[axis] = (uint32_t)std::max(lowCorner, 0.f);
+        last[axis] = (uint32_t)std::min(highCorner, level.Probes[axis] - 1.f);
+    }
+
+    for (auto z = first[2]; z <= last[2]; ++z)
+    {
+        for (auto y = first[1]; y <= last[1]; ++y)
+        {
+            auto needed = level.Needed.data() + ((uint64_t)z * level.Probes[1] + y) * level.Probes[0];
+            std::fill(needed + first[0], needed + last[0] + 1, 1);
+        }
+    }
+}
+
+std::vector<Aabb> CascadeBricks::BuildOccupancy(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, uint32_t resolution)
+{
+    Aabb bounds = {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+    for (auto i = 0u; i < vertexCount; ++i)
+    {
+        const Float3 position = {positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]};
+        bounds = Union(bounds, {position, position});
+    }
+    if (indexCount == 0)
+        return {};
+
+    Float3 cellSize;
+    for (auto axis = 0u; axis < 3; ++axis)
+        cellSize[axis] = std::max((bounds.Max[axis] - bounds.Min[axis]) / resolution, 1e-6f);
+
+    std::vector<uint8_t> cells((uint64_t)resolution * resolution * resolution);
+    std::vector<std::array<Float3, 3>> triangles;
+    for (auto i = 0u; i + 2 < indexCount; i += 3)
+    {
+        std::array<Float3, 3> triangle;
+        for (auto corner = 0u; corner < 3; ++corner)
+        {
+            const auto vertex = positions + indices[i + corner] * 3ull;
+            triangle[corner] = {vertex[0], vertex[1], vertex[2]};
+        }
+        triangles.push_back(triangle);
+
+        // Bounds of a slanted triangle cover far more cells than it does, halves are split until they fit a cell
+        while (!triangles.empty())
+        {
+            const auto [a, b, c] = triangles.back();
+            triangles.pop_back();
+            const auto low = Min(Min(a, b), c);
+            const auto high = Max(Max(a, b), c);
+            const auto extent = high - low;
+            if (extent.x > cellSize.x || extent.y > cellSize.y || extent.z > cellSize.z)
+            {
+                const auto lengthAB = Dot(b - a, b - a);
+                const auto lengthBC = Dot(c - b, c - b);
+                const auto lengthCA = Dot(a - c, a - c);
+                if (lengthAB >= lengthBC && lengthAB >= lengthCA)
+                    triangles.insert(triangles.end(), {{a, (a + b) * 0.5f, c}, {(a + b) * 0.5f, b, c}});
+                else if (lengthBC >= lengthCA)
+                    triangles.insert(triangles.end(), {{a, b, (b + c) * 0.5f}, {a, (b + c) * 0.5f, c}});
+                else
+                    triangles.insert(triangles.end(), {{a, b, (c + a) * 0.5f}, {(c + a) * 0.5f, b, c}});
+                continue;
+            }
+
+            uint32_t first[3];
+            uint32_t last[3];
+            for (auto axis = 0u; axis < 3; ++axis)
+            {
+                first[axis] = std::min((uint32_t)((low[axis] - bounds.Min[axis]) / cellSize[axis]), resolution - 1);
+                last[axis] = std::min((uint32_t)((high[axis] - bounds.Min[axis]) / cellSize[axis]), resolution - 1);
+            }
+            for (auto z = first[2]; z <= last[2]; ++z)
+            {
+                for (auto y = first[1]; y <= last[1]; ++y)
+                {
+                    auto row = cells.data() + ((uint64_t)z * resolution + y) * resolution;
+                    std::fill(row + first[0], row + last[0] + 1, 1);
+                }
+            }
+        }
+    }
+
+    std::vector<Aabb> ret;
+    for (auto z = 0u; z < resolution; ++z)
+    {
+        for (auto y = 0u; y < resolution; ++y)
+        {
+            const auto row = cells.data() + ((uint64_t)z * resolution + y) * resolution;
+            for (auto x = 0u; x < resolution; ++x)
+            {
+                if (!row[x])
+                    continue;
+                const auto begin = x;
+                while (x + 1 < resolution && row[x + 1])
+                    ++x;
+                const Float3 low = bounds.Min + cellSize * Float3{(float)begin, (float)y, (float)z};
+                const Float3 high = bounds.Min + cellSize * Float3{x + 1.f, y + 1.f, z + 1.f};
+                ret.push_back({low, Min(high, bounds.Max)});
+            }
+        }
+    }
+    return ret;
+}
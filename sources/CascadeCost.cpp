@@ -0,0 +1,30 @@
+#include "CascadeCost.h"
+
+CascadeCost EstimateCascadeCost(const CascadeTopology& topology, const CascadeResultion& resolution, uint32_t cascadeCount, CascadeFormat format, CascadeScheduler::Mode mode, uint32_t base)
+{
+    CascadeCost ret;
+    const CascadeScheduler scheduler(resolution, cascadeCount, topology, mode, base);
+    ret.Rays = scheduler.GetAverageRays();
+    ret.PeakRays = scheduler.GetPeakRays();
+    ret.TraceBytes = ret.Rays * sizeof(uint16_t);
+
+    const uint64_t texelBytes = GetFormatBytes(format);
+    std::vector<uint64_t> texels(cascadeCount);
+    for (auto i = 0u; i < cascadeCount; ++i)
+    {
+        const auto atlasSize = topology.GetAtlasSize(resolution, i);
+        texels[i] = (uint64_t)atlasSize[0] * atlasSize[1] * (resolution.z >> i);
+    }
+
+    for (auto i = 0u; i < cascadeCount; ++i)
+    {
+        ret.CascadeBytes += texels[i] * texelBytes;
+        ret.HitBytes += texels[i] * sizeof(uint16_t);
+        ret.MergeBytes += texels[i] * (sizeof(uint16_t) + texelBytes) + (i + 1 < cascadeCount ? texels[i + 1] * texelBytes : 0);
+    }
+
+    // Cascade 0 read once, the R16G16B16A16_FLOAT irradiance texels written
+    const uint64_t probes = (uint64_t)resolution.x * resolution.y * resolution.z;
+    ret.ProjectBytes = texels[0] * texelBytes + probes * c_irradianceTexels * 4 * sizeof(uint16_t);
+    return ret;
+}
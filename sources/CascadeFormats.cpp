@@ -0,0 +1,172 @@
+#include "CascadeFormats.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t c_exponentBias = 15;
+    constexpr uint32_t c_sharedMantissaBits = 9;
+
+    uint32_t FloatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float BitsFloat(uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint32_t PackR11G11B10(const Float3& value)
+    {
+        return PackUnsignedFloat(value.x, 6) | (PackUnsignedFloat(value.y, 6) << 11) | (PackUnsignedFloat(value.z, 5) << 22);
+    }
+
+    Float3 UnpackR11G11B10(uint32_t value)
+    {
+        return {UnpackUnsignedFloat(value & 0x7ffu, 6), UnpackUnsignedFloat((value >> 11) & 0x7ffu, 6), UnpackUnsignedFloat(value >> 22, 5)};
+    }
+}
+
+const char* GetFormatName(CascadeFormat format)
+{
+    switch (format)
+    {
+    case CascadeFormat::Rgba32f:
+        return "rgba32f";
+    case CascadeFormat::Rgba16f:
+        return "rgba16f";
+    case CascadeFormat::R11g11b10f:
+        return "r11g11b10f";
+    case CascadeFormat::Rgb9e5:
+        return "rgb9e5";
+    }
+    return "";
+}
+
+void EncodeTexel(CascadeFormat format, const Float4& value, uint32_t* words)
+{
+    switch (format)
+    {
+    case CascadeFormat::Rgba32f:
+        words[0] = FloatBits(value.x);
+        words[1] = FloatBits(value.y);
+        words[2] = FloatBits(value.z);
+        words[3] = FloatBits(value.w);
+        break;
+    case CascadeFormat::Rgba16f:
+        words[0] = FloatToHalf(value.x) | ((uint32_t)FloatToHalf(value.y) << 16);
+        words[1] = FloatToHalf(value.z) | ((uint32_t)FloatToHalf(value.w) << 16);
+        break;
+    case CascadeFormat::R11g11b10f:
+        words[0] = PackR11G11B10({value.x, value.y, value.z});
+        break;
+    case CascadeFormat::Rgb9e5:
+        words[0] = PackRgb9e5({value.x, value.y, value.z});
+        break;
+    }
+}
+
+Float4 DecodeTexel(CascadeFormat format, const uint32_t* words)
+{
+    switch (format)
+    {
+    case CascadeFormat::Rgba32f:
+        return {BitsFloat(words[0]), BitsFloat(words[1]), BitsFloat(words[2]), BitsFloat(words[3])};
+    case CascadeFormat::Rgba16f:
+        return {HalfToFloat(words[0] & 0xffffu), HalfToFloat(words[0] >> 16), HalfToFloat(words[1] & 0xffffu), HalfToFloat(words[1] >> 16)};
+    case CascadeFormat::R11g11b10f:
+    {
+        const auto rgb = UnpackR11G11B10(words[0]);
+        return {rgb.x, rgb.y, rgb.z, 1.f};
+    }
+    case CascadeFormat::Rgb9e5:
+    {
+        const auto rgb = UnpackRgb9e5(words[0]);
+        return {rgb.x, rgb.y, rgb.z, 1.f};
+    }
+    }
+    return {};
+}
+
+uint32_t PackUnsignedFloat(float value, uint32_t mantissaBits)
+{
+    assert(mantissaBits > 0 && mantissaBits < 23);
+    const uint32_t shift = 23 - mantissaBits;
+    const uint32_t mantissaMask = (1u << mantissaBits) - 1;
+    const uint32_t infinity = 0x1fu << mantissaBits;
+    // Float bits of the largest finite value and of half the smallest denormal, below which values round to 0
+    const uint32_t largest = ((30 - c_exponentBias + 127) << 23) | (mantissaMask << shift);
+    const uint32_t smallest = (127 - (c_exponentBias - 1) - mantissaBits - 1) << 23;
+
+    uint32_t bits = FloatBits(value);
+    const bool negative = (bits & 0x80000000u) != 0;
+    bits &= 0x7fffffffu;
+    if (bits >= 0x7f800000u)
+        return bits > 0x7f800000u ? infinity | mantissaMask : (negative ? 0 : infinity);
+    if (negative || bits < smallest)
+        return 0;
+    if (bits > largest)
+        return infinity - 1;
+
+    if (bits < ((127 - (c_exponentBias - 1)) << 23))
+    {
+        // Denormal, the implicit one moves into the mantissa
+        const uint32_t denormalShift = 127 - (c_exponentBias - 1) - (bits >> 23);
+        bits = (0x800000u | (bits & 0x7fffffu)) >> denormalShift;
+    }
+    else
+    {
+        bits -= (127 - c_exponentBias) << 23;
+    }
+    // Round to nearest even, a carry out of the mantissa steps the exponent up
+    return ((bits + (1u << (shift - 1)) - 1 + ((bits >> shift) & 1)) >> shift) & (infinity | mantissaMask);
+}
+
+float UnpackUnsignedFloat(uint32_t value, uint32_t mantissaBits)
+{
+    const uint32_t exponent = value >> mantissaBits;
+    const uint32_t mantissa = value & ((1u << mantissaBits) - 1);
+    if (exponent == 0x1f)
+        return mantissa != 0 ? NAN : INFINITY;
+    if (exponent == 0)
+        return std::ldexp((float)mantissa, 1 - (int)c_exponentBias - (int)mantissaBits);
+    return std::ldexp((float)(mantissa | (1u << mantissaBits)), (int)exponent - (int)c_exponentBias - (int)mantissaBits);
+}
+
+uint32_t PackRgb9e5(const Float3& value)
+{
+    const uint32_t mantissaMax = (1u << c_sharedMantissaBits) - 1;
+    const float largest = std::ldexp((float)mantissaMax, 31 - (int)c_exponentBias - (int)c_sharedMantissaBits);
+    const float smallest = std::ldexp(1.f, -(int)c_exponentBias - (int)c_sharedMantissaBits);
+
+    float rgb[3];
+    for (auto i = 0u; i < 3; ++i)
+        rgb[i] = value[i] > 0.f ? std::min(value[i], largest) : 0.f;
+
+    // Rounding the largest channel to 9 bits first keeps its mantissa from overflowing the exponent
+    const float maxChannel = std::max(std::max(std::max(rgb[0], rgb[1]), rgb[2]), smallest);
+    const uint32_t roundedBits = FloatBits(maxChannel) + (1u << (23 - c_sharedMantissaBits));
+    const int exponent = std::max((int)(roundedBits >> 23) - 127, -(int)c_exponentBias - 1) + 1;
+    const uint32_t shared = (uint32_t)(exponent + (int)c_exponentBias);
+
+    uint32_t ret = shared << 27;
+    for (auto i = 0u; i < 3; ++i)
+    {
+        const float scaled = std::ldexp(rgb[i], (int)c_sharedMantissaBits - exponent);
+        ret |= std::min((uint32_t)std::nearbyint(scaled), mantissaMax) << (i * c_sharedMantissaBits);
+    }
+    return ret;
+}
+
+Float3 UnpackRgb9e5(uint32_t value)
+{
+    const int exponent = (int)(value >> 27) - (int)c_exponentBias - (int)c_sharedMantissaBits;
+    const uint32_t mask = (1u << c_sharedMantissaBits) - 1;
+    return {std::ldexp((float)(value & mask), exponent), std::ldexp((float)((value >> 9) & mask), exponent), std::ldexp((float)((value >> 18) & mask), exponent)};
+}
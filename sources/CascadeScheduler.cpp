@@ -0,0 +1,136 @@
+#include "CascadeScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace
+{
+    // Longest schedule period the peak is searched over
+    constexpr uint64_t c_maxPeakFrames = 4096;
+}
+
+CascadeScheduler::CascadeScheduler(const CascadeResultion& resolution, uint32_t cascadeCount, const CascadeTopology& topology, Mode mode, uint32_t base)
+    : m_updates(cascadeCount)
+    , m_depths(cascadeCount)
+    , m_texelsPerSlice(cascadeCount)
+    , m_count(cascadeCount)
+{
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        const auto atlasSize = topology.GetAtlasSize(resolution, i);
+        m_depths[i] = resolution.z >> i;
+        m_texelsPerSlice[i] = (uint64_t)atlasSize[0] * atlasSize[1];
+    }
+    SetMode(mode, base);
+}
+
+void CascadeScheduler::SetMode(Mode mode, uint32_t base)
+{
+    assert(base > 1);
+    m_mode = mode;
+    m_base = base;
+}
+
+void CascadeScheduler::Invalidate()
+{
+    m_invalid = true;
+}
+
+const std::vector<CascadeSlices>& CascadeScheduler::Advance()
+{
+    if (m_invalid)
+    {
+        for (auto i = 0u; i < m_count; ++i)
+            m_updates[i] = {0, m_depths[i]};
+        m_invalid = false;
+    }
+    else
+    {
+        Select(m_frame, m_updates);
+    }
+    ++m_frame;
+    return m_updates;
+}
+
+uint64_t CascadeScheduler::GetFrameRays() const
+{
+    return GetRays(m_updates);
+}
+
+uint64_t CascadeScheduler::GetAverageRays() const
+{
+    // Every slice is updated exactly once per period
+    double rays = 0.0;
+    for (auto i = 0u; i < m_count; ++i)
+        rays += (double)m_depths[i] * m_texelsPerSlice[i] / GetPeriod(i);
+    return (uint64_t)(rays + 0.5);
+}
+
+uint64_t CascadeScheduler::GetPeakRays() const
+{
+    uint64_t frames = 1;
+    for (auto i = 0u; i < m_count && frames < c_maxPeakFrames; ++i)
+        frames = std::lcm(frames, (uint64_t)GetPeriod(i));
+    frames = std::min(frames, c_maxPeakFrames);
+
+    uint64_t peak = 0;
+    std::vector<CascadeSlices> updates(m_count);
+    for (auto frame = 0ull; frame < frames; ++frame)
+    {
+        Select(frame, updates);
+        peak = std::max(peak, GetRays(updates));
+    }
+    return peak;
+}
+
+uint64_t CascadeScheduler::GetFullRays() const
+{
+    uint64_t rays = 0;
+    for (auto i = 0u; i < m_count; ++i)
+        rays += m_depths[i] * m_texelsPerSlice[i];
+    return rays;
+}
+
+uint32_t CascadeScheduler::GetPeriod(uint32_t cascade) const
+{
+    uint32_t period = 1;
+    if (m_mode != Mode::Full)
+    {
+        for (auto i = 0u; i < cascade && period < (1u << 16); ++i)
+            period *= m_base;
+    }
+    if (m_mode == Mode::Slices)
+        period = std::min(period, std::max(m_depths[cascade], 1u));
+    return period;
+}
+
+void CascadeScheduler::Select(uint64_t frame, std::vector<CascadeSlices>& updates) const
+{
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        const auto period = GetPeriod(i);
+        // Offsetting every level by its index spreads the updates of different levels over the period
+        const auto phase = (uint32_t)((frame + i) % period);
+        switch (m_mode)
+        {
+        case Mode::Full:
+            updates[i] = {0, m_depths[i]};
+            break;
+        case Mode::Cadence:
+            updates[i] = phase == 0 ? CascadeSlices{0, m_depths[i]} : CascadeSlices{};
+            break;
+        case Mode::Slices:
+            updates[i] = {m_depths[i] * phase / period, m_depths[i] * (phase + 1) / period};
+            break;
+        }
+    }
+}
+
+uint64_t CascadeScheduler::GetRays(const std::vector<CascadeSlices>& updates) const
+{
+    uint64_t rays = 0;
+    for (auto i = 0u; i < updates.size(); ++i)
+        rays += updates[i].GetCount() * m_texelsPerSlice[i];
+    return rays;
+}
@@ -0,0 +1,296 @@
+#include "CpuBvh.h"
+#include "ParallelFor.h"
+
+#include <cassert>
+
+namespace
+{
+    constexpr uint32_t c_binCount = 16;
+    constexpr float c_traversalCost = 1.f;
+    // Subtrees below this size are built as independent tasks
+    constexpr uint32_t c_minTaskSize = 1024;
+
+    const Aabb c_emptyBounds = {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+
+    // Binary node, Count > 0 marks a leaf over Primitives[Begin, Begin + Count)
+    struct BuildNode
+    {
+        Aabb Bounds;
+        uint32_t Left;
+        uint32_t Right;
+        uint32_t Begin;
+        uint32_t Count;
+    };
+
+    struct BuildTask
+    {
+        uint32_t Node;
+        uint32_t Begin;
+        uint32_t End;
+    };
+
+    class BinaryBuilder
+    {
+    public:
+        BinaryBuilder(const std::vector<Aabb>& primitives, std::vector<uint32_t>& order, uint32_t maxLeafSize)
+            : m_primitives(primitives)
+            , m_order(order)
+            , m_maxLeafSize(std::max(1u, maxLeafSize))
+        {
+            m_centroids.resize(primitives.size());
+            for (auto i = 0u; i < primitives.size(); ++i)
+                m_centroids[i] = (primitives[i].Min + primitives[i].Max) * 0.5f;
+        }
+
+        // Ranges of at most taskSize primitives are not built but recorded in tasks, unless tasks is null
+        uint32_t Build(std::vector<BuildNode>& nodes, uint32_t begin, uint32_t end, std::vector<BuildTask>* tasks, uint32_t taskSize)
+        {
+            const auto nodeIndex = (uint32_t)nodes.size();
+            nodes.push_back({c_emptyBounds, 0, 0, begin, end - begin});
+            if (tasks && end - begin <= taskSize)
+            {
+                tasks->push_back({nodeIndex, begin, end});
+                return nodeIndex;
+            }
+
+            auto bounds = c_emptyBounds;
+            auto centroidBounds = c_emptyBounds;
+            for (auto i = begin; i < end; ++i)
+            {
+                bounds = Union(bounds, m_primitives[m_order[i]]);
+                centroidBounds = Union(centroidBounds, {m_centroids[m_order[i]], m_centroids[m_order[i]]});
+            }
+            nodes[nodeIndex].Bounds = bounds;
+
+            const auto count = end - begin;
+            if (count == 1)
+                return nodeIndex;
+
+            uint32_t axis = 0;
+            uint32_t split = 0;
+            float splitCost = INFINITY;
+            FindSplit(begin, end, centroidBounds, axis, split, splitCost);
+
+            const float leafCost = (float)count;
+            const float area = HalfArea(bounds);
+            if (count <= m_maxLeafSize && (split == 0 || c_traversalCost + splitCost / std::max(area, 1e-30f) >= leafCost))
+                return nodeIndex;
+
+            uint32_t mid;
+            if (split == 0)
+            {
+                // All centroids coincide, any partition is as good as another
+                mid = (begin + end) / 2;
+            }
+            else
+            {
+                const auto extent = centroidBounds.Max[axis] - centroidBounds.Min[axis];
+                mid = (uint32_t)(std::partition(m_order.begin() + begin, m_order.begin() + end, [&](uint32_t primitive)
+                {
+                    return GetBin(m_centroids[primitive][axis], centroidBounds.Min[axis], extent) < split;
+                }) - m_order.begin());
+                assert(mid > begin && mid < end);
+            }
+
+            const auto left = Build(nodes, begin, mid, tasks, taskSize);
+            const auto right = Build(nodes, mid, end, tasks, taskSize);
+            nodes[nodeIndex].Left = left;
+            nodes[nodeIndex].Right = right;
+            nodes[nodeIndex].Count = 0;
+            return nodeIndex;
+        }
+
+    private:
+        static uint32_t GetBin(float centroid, float minimum, float extent)
+        {
+            return std::min(c_binCount - 1, (uint32_t)((centroid - minimum) / extent * c_binCount));
+        }
+
+        // Split is the first bin of the right side, 0 if no axis has any extent
+        void FindSplit(uint32_t begin, uint32_t end, const Aabb& centroidBounds, uint32_t& bestAxis, uint32_t& bestSplit, float& bestCost) const
+        {
+            for (auto axis = 0u; axis < 3; ++axis)
+            {
+                const auto extent = centroidBounds.Max[axis] - centroidBounds.Min[axis];
+                if (!(extent > 0.f))
+                    continue;
+
+                Aabb binBounds[c_binCount];
+                uint32_t binCounts[c_binCount] = {};
+                std::fill(binBounds, binBounds + c_binCount, c_emptyBounds);
+                for (auto i = begin; i < end; ++i)
+                {
+                    const auto primitive = m_order[i];
+                    const auto bin = GetBin(m_centroids[primitive][axis], centroidBounds.Min[axis], extent);
+                    binBounds[bin] = Union(binBounds[bin], m_primitives[primitive]);
+                    ++binCounts[bin];
+                }
+
+                float rightCosts[c_binCount];
+                auto right = c_emptyBounds;
+                uint32_t rightCount = 0;
+                for (auto bin = c_binCount - 1; bin > 0; --bin)
+                {
+                    right = Union(right, binBounds[bin]);
+                    rightCount += binCounts[bin];
+                    rightCosts[bin] = rightCount > 0 ? HalfArea(right) * rightCount : 0.f;
+                }
+
+                auto left = c_emptyBounds;
+                uint32_t leftCount = 0;
+                for (auto split = 1u; split < c_binCount; ++split)
+                {
+                    left = Union(left, binBounds[split - 1]);
+                    leftCount += binCounts[split - 1];
+                    if (leftCount == 0 || leftCount == end - begin)
+                        continue;
+
+                    const auto cost = HalfArea(left) * leftCount + rightCosts[split];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = split;
+                    }
+                }
+            }
+        }
+
+        const std::vector<Aabb>& m_primitives;
+        std::vector<Float3> m_centroids;
+        std::vector<uint32_t>& m_order;
+        uint32_t m_maxLeafSize;
+    };
+
+    // Pulls grandchildren up until a node has four children, opening the largest inner child first
+    uint32_t Collapse(const std::vector<BuildNode>& binary, uint32_t binaryIndex, Bvh4& bvh)
+    {
+        const auto nodeIndex = (uint32_t)bvh.Nodes.size();
+        bvh.Nodes.emplace_back();
+
+        uint32_t children[c_bvhWidth];
+        uint32_t childCount = 0;
+        if (binary[binaryIndex].Count > 0)
+        {
+            children[childCount++] = binaryIndex;
+        }
+        else
+        {
+            children[childCount++] = binary[binaryIndex].Left;
+            children[childCount++] = binary[binaryIndex].Right;
+        }
+
+        while (childCount < c_bvhWidth)
+        {
+            auto largest = c_emptyChild;
+            float largestArea = -1.f;
+            for (auto i = 0u; i < childCount; ++i)
+            {
+                const auto& child = binary[children[i]];
+                if (child.Count == 0 && HalfArea(child.Bounds) > largestArea)
+                {
+                    largest = i;
+                    largestArea = HalfArea(child.Bounds);
+                }
+            }
+            if (largest == c_emptyChild)
+                break;
+
+            const auto opened = children[largest];
+            children[largest] = binary[opened].Left;
+            children[childCount++] = binary[opened].Right;
+        }
+
+        Bvh4Node node;
+        for (auto slot = 0u; slot < c_bvhWidth; ++slot)
+        {
+            node.SetBounds(slot, c_emptyBounds);
+            node.Child[slot] = c_emptyChild;
+            node.Count[slot] = 0;
+        }
+
+        for (auto slot = 0u; slot < childCount; ++slot)
+        {
+            const auto& child = binary[children[slot]];
+            node.SetBounds(slot, child.Bounds);
+            if (child.Count > 0)
+            {
+                node.Child[slot] = child.Begin;
+                node.Count[slot] = child.Count;
+            }
+            else
+            {
+                node.Child[slot] = Collapse(binary, children[slot], bvh);
+            }
+        }
+
+        bvh.Nodes[nodeIndex] = node;
+        return nodeIndex;
+    }
+}
+
+Bvh4 BuildBvh4(const std::vector<Aabb>& primitives, uint32_t maxLeafSize, uint32_t threadCount)
+{
+    Bvh4 ret;
+    ret.Bounds = c_emptyBounds;
+    ret.Primitives.resize(primitives.size());
+    for (auto i = 0u; i < primitives.size(); ++i)
+        ret.Primitives[i] = i;
+
+    if (primitives.empty())
+    {
+        Bvh4Node root;
+        for (auto slot = 0u; slot < c_bvhWidth; ++slot)
+        {
+            root.SetBounds(slot, c_emptyBounds);
+            root.Child[slot] = c_emptyChild;
+            root.Count[slot] = 0;
+        }
+        ret.Nodes.push_back(root);
+        return ret;
+    }
+
+    if (threadCount == 0)
+        threadCount = GetDefaultThreadCount();
+
+    BinaryBuilder builder(primitives, ret.Primitives, maxLeafSize);
+    const auto primitiveCount = (uint32_t)primitives.size();
+    const auto taskSize = std::max(c_minTaskSize, primitiveCount / (threadCount * 4));
+
+    std::vector<BuildNode> binary;
+    binary.reserve(primitiveCount * 2);
+    std::vector<BuildTask> tasks;
+    builder.Build(binary, 0, primitiveCount, threadCount > 1 ? &tasks : nullptr, taskSize);
+
+    // Tasks cover disjoint ranges of the primitive order, each builds into its own node list
+    std::vector<std::vector<BuildNode>> taskNodes(tasks.size());
+    ParallelFor(tasks.size(), threadCount, 1, [&](uint64_t begin, uint64_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+            builder.Build(taskNodes[i], tasks[i].Begin, tasks[i].End, nullptr, 0);
+    });
+
+    for (auto i = 0u; i < tasks.size(); ++i)
+    {
+        const auto base = (uint32_t)binary.size() - 1;
+        const auto remap = [&](uint32_t index) { return index == 0 ? tasks[i].Node : base + index; };
+        for (auto j = 0u; j < taskNodes[i].size(); ++j)
+        {
+            auto node = taskNodes[i][j];
+            if (node.Count == 0)
+            {
+                node.Left = remap(node.Left);
+                node.Right = remap(node.Right);
+            }
+            if (j == 0)
+                binary[tasks[i].Node] = node;
+            else
+                binary.push_back(node);
+        }
+    }
+
+    ret.Bounds = binary[0].Bounds;
+    ret.Nodes.reserve(binary.size() / 2 + 1);
+    Collapse(binary, 0, ret);
+    return ret;
+}
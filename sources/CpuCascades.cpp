@@ -0,0 +1,386 @@
+#include "CpuCascades.h"
+#include "ParallelFor.h"
+
+#include <cassert>
+
+namespace
+{
+    constexpr uint64_t c_rowsPerChunk = 4;
+
+    Float4 Lerp(const Float4& a, const Float4& b, float t)
+    {
+        return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t};
+    }
+
+    Float4 AddScaled(const Float4& a, const Float4& b, float t)
+    {
+        return {a.x + b.x * t, a.y + b.y * t, a.z + b.z * t, a.w + b.w * t};
+    }
+}
+
+CpuCascades::CpuCascades(const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount, CascadeFormat format, const CascadeTopology& topology)
+    : m_resolution(resolution)
+    , m_extends(extends)
+    , m_offset(offset)
+    , m_topology(topology)
+    , m_format(format)
+    , m_count(cascadeCount)
+{
+    // Packets of TraceSpan stay within a probe's directions
+    assert(topology.PixelsX % c_packetSize == 0);
+
+    m_cascades.resize(m_count);
+    m_hits.resize(m_count);
+    m_sizes.resize(m_count);
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        m_sizes[i] = topology.GetAtlasSize(resolution, i);
+        m_hits[i].resize((uint64_t)GetWidth(i) * GetHeight(i) * GetDepth(i), c_cascadeMiss);
+    }
+    SetFormat(format);
+}
+
+void CpuCascades::SetFormat(CascadeFormat format)
+{
+    m_format = format;
+    for (auto i = 0u; i < m_count; ++i)
+        m_cascades[i].assign((uint64_t)GetWidth(i) * GetHeight(i) * GetDepth(i) * GetFormatWords(format), 0);
+}
+
+void CpuCascades::Generate(const CpuScene& scene, uint32_t threadCount)
+{
+    for (auto i = 0u; i < m_count; ++i)
+        Trace(scene, i, threadCount);
+
+    for (int i = m_count - 1; i >= 0; --i)
+        Merge(scene, i, threadCount);
+}
+
+void CpuCascades::Generate(const CpuScene& scene, const std::vector<CascadeSlices>& updates, uint32_t threadCount)
+{
+    assert(updates.size() == m_count);
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        if (!updates[i].IsEmpty())
+            Trace(scene, i, updates[i], threadCount);
+    }
+
+    // Skipped slices keep their hits, merging every level picks up the changes of the levels above
+    for (int i = m_count - 1; i >= 0; --i)
+        Merge(scene, i, threadCount);
+}
+
+void CpuCascades::Generate(const CpuScene& scene, const std::vector<CascadeSlices>& updates, const ProbeInvalidation& invalidation, uint32_t threadCount)
+{
+    assert(updates.size() == m_count && invalidation.GetCount() == m_count);
+    std::vector<uint32_t> probes;
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        auto slices = updates[i];
+        invalidation.SplitTracing(i, slices, probes);
+        if (!slices.IsEmpty())
+            Trace(scene, i, slices, threadCount);
+        TraceProbes(scene, i, probes, threadCount);
+    }
+
+    for (int i = m_count - 1; i >= 0; --i)
+        Merge(scene, i, threadCount);
+}
+
+void CpuCascades::Trace(const CpuScene& scene, uint32_t cascade, uint32_t threadCount)
+{
+    Trace(scene, cascade, {0, GetDepth(cascade)}, threadCount);
+}
+
+void CpuCascades::Trace(const CpuScene& scene, uint32_t cascade, const CascadeSlices& slices, uint32_t threadCount)
+{
+    assert(slices.End <= GetDepth(cascade));
+    ParallelFor((uint64_t)slices.GetCount() * GetHeight(cascade), threadCount, c_rowsPerChunk, [&](uint64_t rowBegin, uint64_t rowEnd)
+    {
+        RayPacket packet;
+        for (auto row = rowBegin; row < rowEnd; ++row)
+        {
+            const auto z = slices.Begin + (uint32_t)(row / GetHeight(cascade));
+            const auto y = (uint32_t)(row % GetHeight(cascade));
+            TraceSpan(scene, cascade, 0, GetWidth(cascade), y, z, packet);
+        }
+    });
+}
+
+void CpuCascades::TraceProbes(const CpuScene& scene, uint32_t cascade, const std::vector<uint32_t>& probes, uint32_t threadCount)
+{
+    // One row of a probe's direction tile per work item, the compacted list of the GPU path
+    const auto pixelCount = m_topology.GetPixelCount(cascade);
+    ParallelFor((uint64_t)probes.size() * pixelCount[1], threadCount, c_rowsPerChunk * 8, [&](uint64_t rowBegin, uint64_t rowEnd)
+    {
+        RayPacket packet;
+        for (auto row = rowBegin; row < rowEnd; ++row)
+        {
+            const auto [probeX, probeY, z] = ProbeInvalidation::UnpackProbe(probes[row / pixelCount[1]]);
+            const auto y = probeY * pixelCount[1] + (uint32_t)(row % pixelCount[1]);
+            TraceSpan(scene, cascade, probeX * pixelCount[0], (probeX + 1) * pixelCount[0], y, z, packet);
+        }
+    });
+}
+
+void CpuCascades::TraceSpan(const CpuScene& scene, uint32_t cascade, uint32_t xBegin, uint32_t xEnd, uint32_t y, uint32_t z, RayPacket& packet)
+{
+    const auto pixelCount = m_topology.GetPixelCount(cascade);
+    const Float3 levelProbeCount = {(float)(m_resolution.x >> cascade), (float)(m_resolution.y >> cascade), (float)(m_resolution.z >> cascade)};
+    const float start = m_topology.GetEnd((int)cascade - 1);
+    const float end = m_topology.GetEnd(cascade);
+
+    const auto probeY = y / pixelCount[1];
+    const float v = (y - probeY * pixelCount[1] + 0.5f) / pixelCount[1];
+    auto hits = m_hits[cascade].data() + ((uint64_t)z * GetHeight(cascade) + y) * GetWidth(cascade);
+
+    for (auto x = xBegin; x < xEnd; x += c_packetSize)
+    {
+        // Packets never straddle probes, the direction tiles are multiples of c_packetSize wide
+        const auto probeX = x / pixelCount[0];
+        if (m_bricks && !m_bricks->IsResident(cascade, probeX, probeY, z))
+            continue;
+        Float3 origin = {(probeX + 0.5f) / levelProbeCount.x, (probeY + 0.5f) / levelProbeCount.y, (z + 0.5f) / levelProbeCount.z};
+        origin = (origin * 2.f - Float3{1.f, 1.f, 1.f}) * Float3{m_extends.x, m_extends.y, m_extends.z} + Float3{m_offset.x, m_offset.y, m_offset.z};
+
+        for (auto lane = 0u; lane < c_packetSize; ++lane)
+        {
+            const float u = (x + lane - probeX * pixelCount[0] + 0.5f) / pixelCount[0];
+            const auto dir = FromSpherical(u, v);
+            packet.OriginX[lane] = origin.x;
+            packet.OriginY[lane] = origin.y;
+            packet.OriginZ[lane] = origin.z;
+            packet.DirX[lane] = dir.x;
+            packet.DirY[lane] = dir.y;
+            packet.DirZ[lane] = dir.z;
+            packet.TMin[lane] = 0.01f + start;
+            packet.TMax[lane] = end;
+            packet.Instance[lane] = c_invalidInstance;
+        }
+        packet.Active = (1u << c_packetSize) - 1;
+
+        scene.Trace(packet);
+
+        for (auto lane = 0u; lane < c_packetSize; ++lane)
+        {
+            const auto instance = packet.Instance[lane];
+            assert(instance == c_invalidInstance || instance < c_maxCascadeInstances);
+            hits[x + lane] = instance == c_invalidInstance ? c_cascadeMiss : (uint16_t)(instance + 1);
+        }
+    }
+}
+
+void CpuCascades::Merge(const CpuScene& scene, uint32_t cascade, uint32_t threadCount)
+{
+    const auto pixelCount = m_topology.GetPixelCount(cascade);
+    const Float3 levelResolution = {(float)(m_resolution.x >> cascade), (float)(m_resolution.y >> cascade), (float)(m_resolution.z >> cascade)};
+    const bool hasHigher = cascade + 1 < m_count;
+
+    ParallelFor((uint64_t)GetDepth(cascade) * GetHeight(cascade), threadCount, c_rowsPerChunk, [&](uint64_t rowBegin, uint64_t rowEnd)
+    {
+        for (auto row = rowBegin; row < rowEnd; ++row)
+        {
+            const auto z = (uint32_t)(row / GetHeight(cascade));
+            const auto y = (uint32_t)(row % GetHeight(cascade));
+            const auto probeY = y / pixelCount[1];
+            const float v = (y - probeY * pixelCount[1] + 0.5f) / pixelCount[1];
+            const auto hits = m_hits[cascade].data() + row * GetWidth(cascade);
+
+            for (auto x = 0u; x < GetWidth(cascade); ++x)
+            {
+                const auto probeX = x / pixelCount[0];
+                if (m_bricks && !m_bricks->IsResident(cascade, probeX, probeY, z))
+                    continue;
+
+                // A hit is opaque, the levels above only show through misses
+                if (hits[x] != c_cascadeMiss)
+                {
+                    const auto& emission = scene.GetInstanceEmission(hits[x] - 1);
+                    Store(cascade, x, y, z, {emission.x, emission.y, emission.z, 0.f});
+                    continue;
+                }
+                if (!hasHigher)
+                {
+                    Store(cascade, x, y, z, {0.f, 0.f, 0.f, 1.f});
+                    continue;
+                }
+
+                const float u = (x - probeX * pixelCount[0] + 0.5f) / pixelCount[0];
+                const Float3 pos = Float3{probeX + 0.5f, probeY + 0.5f, z + 0.5f} / levelResolution;
+                Store(cascade, x, y, z, SampleCascade(cascade + 1, u, v, pos, m_topology.AngularShift));
+            }
+        }
+    });
+}
+
+void CpuCascades::ProjectIrradiance(uint32_t threadCount)
+{
+    const auto pixelCount = m_topology.GetPixelCount(0);
+    const auto directionCount = pixelCount[0] * pixelCount[1];
+    std::vector<std::array<float, c_shCoefficients>> bases(directionCount);
+    for (auto y = 0u; y < pixelCount[1]; ++y)
+    {
+        for (auto x = 0u; x < pixelCount[0]; ++x)
+        {
+            const auto direction = FromSpherical((x + 0.5f) / pixelCount[0], (y + 0.5f) / pixelCount[1]);
+            bases[y * pixelCount[0] + x] = GetShBasis(direction.x, direction.y, direction.z);
+        }
+    }
+
+    const uint64_t probeCount = (uint64_t)m_resolution.x * m_resolution.y * m_resolution.z;
+    m_irradiance.resize(probeCount * c_shCoefficients * 3);
+    ParallelFor(probeCount, threadCount, 16, [&](uint64_t probeBegin, uint64_t probeEnd)
+    {
+        for (auto probe = probeBegin; probe < probeEnd; ++probe)
+        {
+            const auto probeX = (uint32_t)(probe % m_resolution.x);
+            const auto probeY = (uint32_t)(probe / m_resolution.x % m_resolution.y);
+            const auto z = (uint32_t)(probe / ((uint64_t)m_resolution.x * m_resolution.y));
+            if (m_bricks && !m_bricks->IsResident(0, probeX, probeY, z))
+                continue;
+
+            std::array<Float3, c_shCoefficients> sums = {};
+            for (auto y = 0u; y < pixelCount[1]; ++y)
+            {
+                for (auto x = 0u; x < pixelCount[0]; ++x)
+                {
+                    const auto radiance = Load(0, probeX * pixelCount[0] + x, probeY * pixelCount[1] + y, z);
+                    const auto& basis = bases[y * pixelCount[0] + x];
+                    for (auto i = 0u; i < c_shCoefficients; ++i)
+                        sums[i] = sums[i] + Float3{radiance.x, radiance.y, radiance.z} * basis[i];
+                }
+            }
+
+            // Rounded like the R16G16B16A16_FLOAT volume of RadianceCascades
+            const auto coefficients = m_irradiance.data() + probe * c_shCoefficients * 3;
+            for (auto i = 0u; i < c_shCoefficients; ++i)
+            {
+                const auto scale = GetShCosineLobe(i) / directionCount;
+                for (auto c = 0u; c < 3; ++c)
+                    coefficients[i * 3 + c] = HalfToFloat(FloatToHalf(sums[i][c] * scale));
+            }
+        }
+    });
+}
+
+Float3 CpuCascades::SampleIrradiance(const Float3& pos, const Float3& normal) const
+{
+    const uint32_t probeCount[3] = {m_resolution.x, m_resolution.y, m_resolution.z};
+    uint32_t lower[3];
+    uint32_t upper[3];
+    Float3 interp;
+    for (auto i = 0u; i < 3; ++i)
+    {
+        const float probePos = std::min(std::max(pos[i] * probeCount[i], 0.51f), probeCount[i] - 0.51f);
+        const float lowerPos = std::floor(probePos - 0.5f);
+        interp[i] = probePos - 0.5f - lowerPos;
+        lower[i] = (uint32_t)lowerPos;
+        upper[i] = std::min(lower[i] + 1, probeCount[i] - 1);
+    }
+
+    std::array<float, c_shCoefficients * 3> coefficients = {};
+    for (auto corner = 0u; corner < 8; ++corner)
+    {
+        const auto x = corner & 1 ? upper[0] : lower[0];
+        const auto y = corner & 2 ? upper[1] : lower[1];
+        const auto z = corner & 4 ? upper[2] : lower[2];
+        const float weight = (corner & 1 ? interp.x : 1.f - interp.x) * (corner & 2 ? interp.y : 1.f - interp.y) * (corner & 4 ? interp.z : 1.f - interp.z);
+        const auto probe = m_irradiance.data() + (((uint64_t)z * probeCount[1] + y) * probeCount[0] + x) * c_shCoefficients * 3;
+        for (auto i = 0u; i < coefficients.size(); ++i)
+            coefficients[i] += probe[i] * weight;
+    }
+
+    const auto basis = GetShBasis(normal.x, normal.y, normal.z);
+    Float3 ret = {};
+    for (auto i = 0u; i < c_shCoefficients; ++i)
+        ret = ret + Float3{coefficients[i * 3], coefficients[i * 3 + 1], coefficients[i * 3 + 2]} * basis[i];
+    return ret;
+}
+
+Float3 CpuCascades::IntegrateIrradiance(const Float3& pos, const Float3& normal) const
+{
+    const auto pixelCount = m_topology.GetPixelCount(0);
+    Float3 ret = {};
+    for (auto y = 0u; y < pixelCount[1]; ++y)
+    {
+        for (auto x = 0u; x < pixelCount[0]; ++x)
+        {
+            const float u = (x + 0.5f) / pixelCount[0];
+            const float v = (y + 0.5f) / pixelCount[1];
+            const auto radiance = SampleCascade(0, u, v, pos, 0);
+            const auto weight = std::max(0.f, Dot(normal, FromSpherical(u, v)));
+            ret = ret + Float3{radiance.x, radiance.y, radiance.z} * weight;
+        }
+    }
+    return ret * (1.f / (pixelCount[0] * pixelCount[1]));
+}
+
+Float4 CpuCascades::Load(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const
+{
+    const auto texel = m_cascades[cascade].data() + (((uint64_t)z * GetHeight(cascade) + y) * GetWidth(cascade) + x) * GetFormatWords(m_format);
+    return DecodeTexel(m_format, texel);
+}
+
+void CpuCascades::Store(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z, const Float4& value)
+{
+    const auto texel = m_cascades[cascade].data() + (((uint64_t)z * GetHeight(cascade) + y) * GetWidth(cascade) + x) * GetFormatWords(m_format);
+    EncodeTexel(m_format, value, texel);
+}
+
+Float4 CpuCascades::SingleSample(uint32_t cascade, float x, float y, float z) const
+{
+    // Texture2DArray.SampleLevel with a clamped linear sampler, x/y in texels
+    const int maxX = (int)GetWidth(cascade) - 1;
+    const int maxY = (int)GetHeight(cascade) - 1;
+    const int slice = std::clamp((int)std::floor(z + 0.5f), 0, (int)GetDepth(cascade) - 1);
+
+    const float fx = x - 0.5f;
+    const float fy = y - 0.5f;
+    const float x0 = std::floor(fx);
+    const float y0 = std::floor(fy);
+    const int ix0 = std::clamp((int)x0, 0, maxX);
+    const int ix1 = std::clamp((int)x0 + 1, 0, maxX);
+    const int iy0 = std::clamp((int)y0, 0, maxY);
+    const int iy1 = std::clamp((int)y0 + 1, 0, maxY);
+
+    const auto top = Lerp(Load(cascade, ix0, iy0, slice), Load(cascade, ix1, iy0, slice), fx - x0);
+    const auto bottom = Lerp(Load(cascade, ix0, iy1, slice), Load(cascade, ix1, iy1, slice), fx - x0);
+    return Lerp(top, bottom, fy - y0);
+}
+
+Float4 CpuCascades::SampleCascade(uint32_t cascade, float u, float v, const Float3& pos, uint32_t angularShift) const
+{
+    const Float3 probeCount = {(float)(m_resolution.x >> cascade), (float)(m_resolution.y >> cascade), (float)(m_resolution.z >> cascade)};
+    const auto pixelCount = m_topology.GetPixelCount(cascade);
+
+    Float3 interp;
+    Float3 ll;
+    for (auto i = 0u; i < 3; ++i)
+    {
+        const float probePos = std::min(std::max(pos[i] * probeCount[i], 0.51f), probeCount[i] - 0.51f);
+        const float t = probePos - std::floor(probePos) - 0.5f;
+        interp[i] = t < 0.f ? 1.f + t : t;
+        ll[i] = t < 0.f ? std::floor(probePos) - 1.f : std::floor(probePos);
+    }
+
+    // One bilinear tap per 2x2 of the square of directions, a single tap is the whole square up to a shift of 1
+    const auto taps = std::max((1u << angularShift) / 2, 1u);
+    const float weight = 1.f / (taps * taps);
+
+    Float4 samples[8] = {};
+    for (auto i = 0u; i < 8; ++i)
+    {
+        const float px = (ll.x + (i & 1)) * pixelCount[0] + u * pixelCount[0];
+        const float py = (ll.y + ((i >> 1) & 1)) * pixelCount[1] + v * pixelCount[1];
+        for (auto tap = 0u; tap < taps * taps; ++tap)
+        {
+            const float dx = (tap % taps) * 2.f + 1.f - taps;
+            const float dy = (tap / taps) * 2.f + 1.f - taps;
+            samples[i] = AddScaled(samples[i], SingleSample(cascade, px + dx, py + dy, ll.z + (i >> 2)), weight);
+        }
+    }
+
+    const auto lerpY0 = Lerp(Lerp(samples[0], samples[1], interp.x), Lerp(samples[2], samples[3], interp.x), interp.y);
+    const auto lerpY1 = Lerp(Lerp(samples[4], samples[5], interp.x), Lerp(samples[6], samples[7], interp.x), interp.y);
+    return Lerp(lerpY0, lerpY1, interp.z);
+}
@@ -0,0 +1,321 @@
+#include "CpuScene.h"
+#include "Simd.h"
+
+#include <cassert>
+
+namespace
+{
+    constexpr uint32_t c_leafSize = 4;
+    constexpr uint32_t c_stackSize = 128;
+
+    float SafeInverse(float value)
+    {
+        constexpr float epsilon = 1e-20f;
+        if (std::abs(value) < epsilon)
+            value = value < 0.f ? -epsilon : epsilon;
+        return 1.f / value;
+    }
+
+    struct PacketBox
+    {
+        Float8 OriginX, OriginY, OriginZ;
+        Float8 InvDirX, InvDirY, InvDirZ;
+        Float8 TMin;
+    };
+
+    PacketBox PreparePacket(const RayPacket& packet)
+    {
+        alignas(32) float invX[c_packetSize];
+        alignas(32) float invY[c_packetSize];
+        alignas(32) float invZ[c_packetSize];
+        for (auto i = 0u; i < c_packetSize; ++i)
+        {
+            invX[i] = SafeInverse(packet.DirX[i]);
+            invY[i] = SafeInverse(packet.DirY[i]);
+            invZ[i] = SafeInverse(packet.DirZ[i]);
+        }
+
+        PacketBox ret;
+        ret.OriginX = Float8::Load(packet.OriginX);
+        ret.OriginY = Float8::Load(packet.OriginY);
+        ret.OriginZ = Float8::Load(packet.OriginZ);
+        ret.InvDirX = Float8::Load(invX);
+        ret.InvDirY = Float8::Load(invY);
+        ret.InvDirZ = Float8::Load(invZ);
+        ret.TMin = Float8::Load(packet.TMin);
+        return ret;
+    }
+
+    uint32_t IntersectBox(const PacketBox& rays, const Float8& tMax, const Float3& boxMin, const Float3& boxMax)
+    {
+        const auto t0x = (Float8::Broadcast(boxMin.x) - rays.OriginX) * rays.InvDirX;
+        const auto t1x = (Float8::Broadcast(boxMax.x) - rays.OriginX) * rays.InvDirX;
+        const auto t0y = (Float8::Broadcast(boxMin.y) - rays.OriginY) * rays.InvDirY;
+        const auto t1y = (Float8::Broadcast(boxMax.y) - rays.OriginY) * rays.InvDirY;
+        const auto t0z = (Float8::Broadcast(boxMin.z) - rays.OriginZ) * rays.InvDirZ;
+        const auto t1z = (Float8::Broadcast(boxMax.z) - rays.OriginZ) * rays.InvDirZ;
+
+        const auto tNear = Max(Max(Min(t0x, t1x), Min(t0y, t1y)), Max(Min(t0z, t1z), rays.TMin));
+        const auto tFar = Min(Min(Max(t0x, t1x), Max(t0y, t1y)), Min(Max(t0z, t1z), tMax));
+        return (tNear <= tFar).Bits();
+    }
+
+    // Front to back traversal of a Bvh4 for a packet. Children are ordered along the ray of the first active lane,
+    // leaf(first, count, tMax) intersects the primitives of a leaf and shrinks tMax.
+    template<typename LeafFunc>
+    void Traverse(const std::vector<Bvh4Node>& nodes, const RayPacket& packet, const PacketBox& rays, Float8& tMax, const LeafFunc& leaf)
+    {
+        uint32_t lane = 0;
+        while (lane + 1 < c_packetSize && !(packet.Active & (1u << lane)))
+            ++lane;
+        const Float3 origin = {packet.OriginX[lane], packet.OriginY[lane], packet.OriginZ[lane]};
+        const Float3 dir = {packet.DirX[lane], packet.DirY[lane], packet.DirZ[lane]};
+
+        uint32_t stack[c_stackSize];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0)
+        {
+            const auto& node = nodes[stack[--stackSize]];
+
+            uint32_t hits[c_bvhWidth];
+            float distances[c_bvhWidth];
+            uint32_t hitCount = 0;
+            for (auto slot = 0u; slot < c_bvhWidth && node.Child[slot] != c_emptyChild; ++slot)
+            {
+                const Float3 boxMin = {node.MinX[slot], node.MinY[slot], node.MinZ[slot]};
+                const Float3 boxMax = {node.MaxX[slot], node.MaxY[slot], node.MaxZ[slot]};
+                if ((IntersectBox(rays, tMax, boxMin, boxMax) & packet.Active) == 0)
+                    continue;
+
+                // Insertion sort by distance of the box center along the ray
+                const float distance = Dot((boxMin + boxMax) * 0.5f - origin, dir);
+                auto i = hitCount++;
+                for (; i > 0 && distances[i - 1] > distance; --i)
+                {
+                    hits[i] = hits[i - 1];
+                    distances[i] = distances[i - 1];
+                }
+                hits[i] = slot;
+                distances[i] = distance;
+            }
+
+            // Leaves right away to shrink tMax, inner nodes pushed far to near
+            for (auto i = 0u; i < hitCount; ++i)
+            {
+                if (node.Count[hits[i]] > 0)
+                    leaf(node.Child[hits[i]], node.Count[hits[i]], tMax);
+            }
+            for (auto i = hitCount; i > 0; --i)
+            {
+                if (node.Count[hits[i - 1]] == 0)
+                {
+                    assert(stackSize < c_stackSize);
+                    stack[stackSize++] = node.Child[hits[i - 1]];
+                }
+            }
+        }
+    }
+}
+
+const char* GetSimdBackendName()
+{
+#if defined(SIMD_AVX2)
+    return "avx2";
+#elif defined(SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+CpuMesh::CpuMesh(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, uint32_t threadCount)
+{
+    const auto triangleCount = indexCount / 3;
+
+    std::vector<Triangle> triangles(triangleCount);
+    std::vector<Aabb> bounds(triangleCount);
+    for (auto i = 0u; i < triangleCount; ++i)
+    {
+        assert(indices[i * 3] < vertexCount && indices[i * 3 + 1] < vertexCount && indices[i * 3 + 2] < vertexCount);
+        const auto v0 = reinterpret_cast<const Float3*>(positions)[indices[i * 3]];
+        const auto v1 = reinterpret_cast<const Float3*>(positions)[indices[i * 3 + 1]];
+        const auto v2 = reinterpret_cast<const Float3*>(positions)[indices[i * 3 + 2]];
+        triangles[i] = {v0, v1 - v0, v2 - v0};
+        bounds[i] = {Min(Min(v0, v1), v2), Max(Max(v0, v1), v2)};
+    }
+
+    auto bvh = BuildBvh4(bounds, c_leafSize, threadCount);
+    m_nodes = std::move(bvh.Nodes);
+    m_bounds = bvh.Bounds;
+
+    m_triangles.resize(triangleCount);
+    for (auto i = 0u; i < triangleCount; ++i)
+        m_triangles[i] = triangles[bvh.Primitives[i]];
+}
+
+void CpuMesh::Intersect(RayPacket& packet, uint32_t instanceId) const
+{
+    if (m_triangles.empty())
+        return;
+
+    const auto rays = PreparePacket(packet);
+    const auto dirX = Float8::Load(packet.DirX);
+    const auto dirY = Float8::Load(packet.DirY);
+    const auto dirZ = Float8::Load(packet.DirZ);
+    auto tMax = Float8::Load(packet.TMax);
+    const auto zero = Float8::Broadcast(0.f);
+    const auto one = Float8::Broadcast(1.f);
+
+    Traverse(m_nodes, packet, rays, tMax, [&](uint32_t first, uint32_t count, Float8& tMax)
+    {
+        for (auto i = first; i < first + count; ++i)
+        {
+            const auto& triangle = m_triangles[i];
+            const auto e1x = Float8::Broadcast(triangle.E1.x);
+            const auto e1y = Float8::Broadcast(triangle.E1.y);
+            const auto e1z = Float8::Broadcast(triangle.E1.z);
+            const auto e2x = Float8::Broadcast(triangle.E2.x);
+            const auto e2y = Float8::Broadcast(triangle.E2.y);
+            const auto e2z = Float8::Broadcast(triangle.E2.z);
+
+            const auto px = dirY * e2z - dirZ * e2y;
+            const auto py = dirZ * e2x - dirX * e2z;
+            const auto pz = dirX * e2y - dirY * e2x;
+            const auto invDet = one / (e1x * px + e1y * py + e1z * pz);
+
+            const auto tx = rays.OriginX - Float8::Broadcast(triangle.V0.x);
+            const auto ty = rays.OriginY - Float8::Broadcast(triangle.V0.y);
+            const auto tz = rays.OriginZ - Float8::Broadcast(triangle.V0.z);
+            const auto u = (tx * px + ty * py + tz * pz) * invDet;
+
+            const auto qx = ty * e1z - tz * e1y;
+            const auto qy = tz * e1x - tx * e1z;
+            const auto qz = tx * e1y - ty * e1x;
+            const auto v = (dirX * qx + dirY * qy + dirZ * qz) * invDet;
+            const auto t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+            const auto hit = (u >= zero) & (v >= zero) & (u + v <= one) & (t > rays.TMin) & (t < tMax);
+            const auto hitBits = hit.Bits() & packet.Active;
+            if (hitBits == 0)
+                continue;
+
+            tMax = Select(hit, t, tMax);
+            for (auto lane = 0u; lane < c_packetSize; ++lane)
+            {
+                if (hitBits & (1u << lane))
+                    packet.Instance[lane] = instanceId;
+            }
+        }
+    });
+
+    // Inactive lanes never set a hit bit, but Select above may still have written their tMax
+    alignas(32) float result[c_packetSize];
+    tMax.Store(result);
+    for (auto lane = 0u; lane < c_packetSize; ++lane)
+    {
+        if (packet.Active & (1u << lane))
+            packet.TMax[lane] = result[lane];
+    }
+}
+
+uint32_t CpuScene::AddInstance(const CpuMesh& mesh, const Float3x4& transform, const Float3& emission)
+{
+    const uint32_t instanceId = (uint32_t)m_instances.size();
+    m_instances.push_back({&mesh, {}, {}, emission, {}});
+    SetInstanceTransform(instanceId, transform);
+    RebuildTopLevel();
+    return instanceId;
+}
+
+void CpuScene::SetInstanceTransform(uint32_t instanceId, const Float3x4& transform)
+{
+    auto& instance = m_instances[instanceId];
+    instance.Transform = transform;
+    instance.InverseTransform = transform.Inverse();
+
+    instance.Bounds = TransformBounds({instance.Mesh->GetBoundsMin(), instance.Mesh->GetBoundsMax()}, transform);
+
+    if (instanceId < m_instanceSlots.size())
+        Refit(instanceId);
+}
+
+void CpuScene::SetInstanceEmission(uint32_t instanceId, const Float3& emission)
+{
+    m_instances[instanceId].Emission = emission;
+}
+
+void CpuScene::RebuildTopLevel()
+{
+    std::vector<Aabb> bounds(m_instances.size());
+    for (auto i = 0u; i < m_instances.size(); ++i)
+        bounds[i] = m_instances[i].Bounds;
+    m_topLevel = BuildBvh4(bounds, 1, 1);
+
+    m_nodeParents.assign(m_topLevel.Nodes.size(), {c_emptyChild, 0});
+    m_instanceSlots.assign(m_instances.size(), {c_emptyChild, 0});
+    for (auto nodeIndex = 0u; nodeIndex < m_topLevel.Nodes.size(); ++nodeIndex)
+    {
+        const auto& node = m_topLevel.Nodes[nodeIndex];
+        for (auto slot = 0u; slot < c_bvhWidth && node.Child[slot] != c_emptyChild; ++slot)
+        {
+            if (node.Count[slot] == 0)
+                m_nodeParents[node.Child[slot]] = {nodeIndex, slot};
+            else
+                m_instanceSlots[m_topLevel.Primitives[node.Child[slot]]] = {nodeIndex, slot};
+        }
+    }
+}
+
+void CpuScene::Refit(uint32_t instanceId)
+{
+    auto slot = m_instanceSlots[instanceId];
+    auto bounds = m_instances[instanceId].Bounds;
+    while (slot.Node != c_emptyChild)
+    {
+        auto& node = m_topLevel.Nodes[slot.Node];
+        node.SetBounds(slot.Index, bounds);
+
+        bounds = node.GetBounds(0);
+        for (auto i = 1u; i < c_bvhWidth && node.Child[i] != c_emptyChild; ++i)
+            bounds = Union(bounds, node.GetBounds(i));
+        slot = m_nodeParents[slot.Node];
+    }
+    m_topLevel.Bounds = bounds;
+}
+
+void CpuScene::Trace(RayPacket& packet) const
+{
+    const auto rays = PreparePacket(packet);
+    auto tMax = Float8::Load(packet.TMax);
+
+    Traverse(m_topLevel.Nodes, packet, rays, tMax, [&](uint32_t first, uint32_t count, Float8& tMax)
+    {
+        for (auto i = first; i < first + count; ++i)
+        {
+            const auto instanceId = m_topLevel.Primitives[i];
+            const auto& instance = m_instances[instanceId];
+
+            // Directions stay unnormalized in object space so hit distances remain comparable across instances
+            RayPacket local = packet;
+            for (auto lane = 0u; lane < c_packetSize; ++lane)
+            {
+                const auto origin = instance.InverseTransform.TransformPoint({packet.OriginX[lane], packet.OriginY[lane], packet.OriginZ[lane]});
+                const auto dir = instance.InverseTransform.TransformVector({packet.DirX[lane], packet.DirY[lane], packet.DirZ[lane]});
+                local.OriginX[lane] = origin.x;
+                local.OriginY[lane] = origin.y;
+                local.OriginZ[lane] = origin.z;
+                local.DirX[lane] = dir.x;
+                local.DirY[lane] = dir.y;
+                local.DirZ[lane] = dir.z;
+            }
+
+            instance.Mesh->Intersect(local, instanceId);
+
+            std::memcpy(packet.TMax, local.TMax, sizeof(packet.TMax));
+            std::memcpy(packet.Instance, local.Instance, sizeof(packet.Instance));
+        }
+        tMax = Float8::Load(packet.TMax);
+    });
+}
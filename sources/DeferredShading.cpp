@@ -0,0 +1,109 @@
+#include "DeferredShading.h"
+
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+    // Gathered pixel left of or above a G-buffer pixel and the bilinear weight of the one after it. Gathered pixel i
+    // sits at GetGatherSource(i), so pixel p lies (p - downscale / 2) / downscale gathered pixels in.
+    std::pair<uint32_t, float> GetUpsampleTap(uint32_t pixel, uint32_t downscale, uint32_t gatheredSize)
+    {
+        const float position = ((float)pixel - (float)(downscale / 2)) / downscale;
+        const float base = std::floor(position);
+        if (base < 0.f)
+            return {0, 0.f};
+        if (base >= gatheredSize - 1)
+            return {gatheredSize - 1, 0.f};
+        return {(uint32_t)base, position - base};
+    }
+}
+
+float GetUpsampleWeight(const Float3& normal, float depth, const Float3& tapNormal, float tapDepth)
+{
+    if (tapDepth <= 0.f)
+        return 0.f;
+    const float normalWeight = std::pow(std::max(Dot(normal, tapNormal), 0.f), c_upsampleNormalPower);
+    const float depthWeight = std::exp(-std::abs(depth - tapDepth) / (c_upsampleDepthScale * depth));
+    return normalWeight * depthWeight;
+}
+
+std::vector<Float3> GatherIrradiance(const GBuffer& gbuffer, uint32_t downscale, const IrradianceGather& gather, DeferredStats& stats)
+{
+    assert(downscale > 0);
+    const auto width = GetGatherSize(gbuffer.Width, downscale);
+    const auto height = GetGatherSize(gbuffer.Height, downscale);
+
+    std::vector<Float3> ret(width * height);
+    for (auto y = 0u; y < height; ++y)
+    {
+        for (auto x = 0u; x < width; ++x)
+        {
+            const auto source = gbuffer.GetIndex(GetGatherSource(x, downscale, gbuffer.Width), GetGatherSource(y, downscale, gbuffer.Height));
+            if (gbuffer.Depths[source] <= 0.f)
+                continue;
+            ret[y * width + x] = gather(gbuffer.Positions[source], gbuffer.Normals[source]);
+            ++stats.Gathers;
+        }
+    }
+    return ret;
+}
+
+std::vector<Float3> UpsampleIrradiance(const GBuffer& gbuffer, uint32_t downscale, const std::vector<Float3>& gathered, const IrradianceGather& gather, bool bilateral, DeferredStats& stats)
+{
+    const auto width = GetGatherSize(gbuffer.Width, downscale);
+    const auto height = GetGatherSize(gbuffer.Height, downscale);
+    assert(gathered.size() == width * height);
+
+    std::vector<Float3> ret(gbuffer.Width * gbuffer.Height);
+    for (auto y = 0u; y < gbuffer.Height; ++y)
+    {
+        const auto [tapY, fractionY] = GetUpsampleTap(y, downscale, height);
+        for (auto x = 0u; x < gbuffer.Width; ++x)
+        {
+            const auto index = gbuffer.GetIndex(x, y);
+            const float depth = gbuffer.Depths[index];
+            if (depth <= 0.f)
+                continue;
+            const auto [tapX, fractionX] = GetUpsampleTap(x, downscale, width);
+
+            Float3 sum = {};
+            float weightSum = 0.f;
+            for (auto corner = 0u; corner < 4; ++corner)
+            {
+                const uint32_t cornerX = std::min(tapX + (corner & 1), width - 1);
+                const uint32_t cornerY = std::min(tapY + (corner >> 1), height - 1);
+                float weight = (corner & 1 ? fractionX : 1.f - fractionX) * (corner >> 1 ? fractionY : 1.f - fractionY);
+                if (bilateral)
+                {
+                    const auto source = gbuffer.GetIndex(GetGatherSource(cornerX, downscale, gbuffer.Width), GetGatherSource(cornerY, downscale, gbuffer.Height));
+                    weight *= GetUpsampleWeight(gbuffer.Normals[index], depth, gbuffer.Normals[source], gbuffer.Depths[source]);
+                }
+                sum = sum + gathered[cornerY * width + cornerX] * weight;
+                weightSum += weight;
+            }
+
+            if (weightSum < c_upsampleMinWeight)
+            {
+                ret[index] = gather(gbuffer.Positions[index], gbuffer.Normals[index]);
+                ++stats.Regathers;
+            }
+            else
+            {
+                ret[index] = sum * (1.f / weightSum);
+            }
+        }
+    }
+    return ret;
+}
+
+std::vector<Float3> Composite(const GBuffer& gbuffer, const std::vector<Float3>& irradiance)
+{
+    std::vector<Float3> ret(gbuffer.Width * gbuffer.Height);
+    for (auto i = 0u; i < ret.size(); ++i)
+    {
+        if (gbuffer.Depths[i] > 0.f)
+            ret[i] = gbuffer.Albedo[i] * irradiance[i] + gbuffer.Emission[i];
+    }
+    return ret;
+}
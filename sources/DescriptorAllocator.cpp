@@ -0,0 +1,54 @@
+#include "DescriptorAllocator.h"
+
+#include <cassert>
+
+DescriptorAllocator::DescriptorAllocator(uint32_t capacity, uint32_t transientCapacity)
+    : m_persistent(capacity - transientCapacity)
+    , m_transient(transientCapacity)
+    , m_blocks(capacity - transientCapacity, c_invalidIndex)
+    , m_persistentCapacity(capacity - transientCapacity)
+{
+    assert(transientCapacity <= capacity);
+}
+
+uint32_t DescriptorAllocator::Allocate(uint32_t count)
+{
+    const auto allocation = m_persistent.Allocate(count);
+    if (allocation.Offset == TlsfAllocator::c_invalidOffset)
+        return c_invalidIndex;
+
+    m_blocks[allocation.Offset] = allocation.Block;
+    return (uint32_t)allocation.Offset;
+}
+
+void DescriptorAllocator::Release(uint32_t index)
+{
+    assert(index < m_persistentCapacity && m_blocks[index] != c_invalidIndex);
+    m_released.push_back(index);
+}
+
+uint32_t DescriptorAllocator::AllocateTransient(uint32_t count)
+{
+    const auto offset = m_transient.Allocate(count, 1);
+    return offset == UploadRing::c_invalidOffset ? c_invalidIndex : m_persistentCapacity + (uint32_t)offset;
+}
+
+void DescriptorAllocator::Submit(uint64_t submission)
+{
+    m_transient.Submit(submission);
+    for (const auto index : m_released)
+        m_pending.push_back({index, submission});
+    m_released.clear();
+}
+
+void DescriptorAllocator::Retire(uint64_t completedSubmission)
+{
+    m_transient.Retire(completedSubmission);
+    while (!m_pending.empty() && m_pending.front().Submission <= completedSubmission)
+    {
+        const auto index = m_pending.front().Index;
+        m_persistent.Free({index, m_blocks[index]});
+        m_blocks[index] = c_invalidIndex;
+        m_pending.pop_front();
+    }
+}
@@ -2,21 +2,147 @@
 
 #include "Drawing.vs.h"
 #include "Drawing.ps.h"
-#include "CascadeTracing.h"
-#include "CascadeAccumulation.h"
+#include "GBuffer.ps.h"
+#include "FullScreen.vs.h"
+#include "DeferredGather.h"
+#include "DeferredComposite.ps.h"
 #include "DebugCascades.vs.h"
-#include "DebugCascades.ps.h"
+#include "CascadeShaders.h"
+
+#include <chrono>
+#include <dxgi1_4.h>
 
 namespace
 {
+    struct CascadeShaders
+    {
+        D3D12_SHADER_BYTECODE Tracing;
+        D3D12_SHADER_BYTECODE Accumulation;
+        D3D12_SHADER_BYTECODE Irradiance;
+        D3D12_SHADER_BYTECODE DebugPS;
+    };
+
+#define CASCADE_SHADERS(name, pixelsX, pixelsY, angularShift, interval, growth) { \
+    {CascadeTracing##name, sizeof(CascadeTracing##name)}, \
+    {CascadeAccumulation##name, sizeof(CascadeAccumulation##name)}, \
+    {CascadeIrradiance##name, sizeof(CascadeIrradiance##name)}, \
+    {DebugCascadesPS##name, sizeof(DebugCascadesPS##name)}},
+
+    // Permutations compiled for every entry of CASCADE_TOPOLOGIES, indexed by CascadeTopologyId
+    const CascadeShaders c_cascadeShaders[] = {CASCADE_TOPOLOGIES(CASCADE_SHADERS)};
+#undef CASCADE_SHADERS
+
     template<typename T, typename U>
     T roundUp(T value, U align)
     {
         return ((value + align - 1) / align) * align;
     }
+
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS GetTopLevelInputs(const ComPtr<ID3D12Resource>& instanceBuffer, uint32_t instanceCount, bool update)
+    {
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs;
+        inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+        if (update)
+            inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+        inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+        inputs.NumDescs = instanceCount;
+        inputs.InstanceDescs = instanceBuffer->GetGPUVirtualAddress();
+        return inputs;
+    }
+
+    // Adapter and driver the pipeline blobs are built by, a cache of any other is dropped whole
+    uint64_t GetPipelineEnvironment(ID3D12Device* device)
+    {
+        ComPtr<IDXGIFactory4> factory;
+        ComPtr<IDXGIAdapter> adapter;
+        CreateDXGIFactory1(IID_PPV_ARGS(&factory));
+        if (!factory || FAILED(factory->EnumAdapterByLuid(device->GetAdapterLuid(), IID_PPV_ARGS(&adapter))))
+            return 0;
+
+        DXGI_ADAPTER_DESC desc;
+        adapter->GetDesc(&desc);
+        LARGE_INTEGER driverVersion = {};
+        adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+        return PipelineKey().AddValue(desc.VendorId).AddValue(desc.DeviceId).AddValue(desc.SubSysId).AddValue(desc.Revision).AddValue(driverVersion.QuadPart).GetHash();
+    }
+
+    // Every subobject is its type followed by its desc at the desc's alignment, padded to pointer alignment
+    template<typename T>
+    T ReadSubobject(const uint8_t* stream, uint64_t& offset)
+    {
+        T desc;
+        offset = roundUp(offset + sizeof(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE), alignof(T));
+        std::memcpy(&desc, stream + offset, sizeof(T));
+        offset = roundUp(offset + sizeof(T), sizeof(void*));
+        return desc;
+    }
+
+    // Key of a pipeline state stream holding the subobject types the pipelines of Device use. The root signature
+    // enters through its serialized blob, shaders and input layouts through what they point to. Streams with other
+    // subobject types get PipelineKey::c_invalidKey and bypass the cache.
+    uint64_t GetPipelineKey(const void* stream, uint64_t size, const ComPtr<ID3DBlob>& rootSignature)
+    {
+        PipelineKey key;
+        key.Add(rootSignature->GetBufferPointer(), rootSignature->GetBufferSize());
+        const auto bytes = (const uint8_t*)stream;
+        uint64_t offset = 0;
+        while (offset < size)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type;
+            std::memcpy(&type, bytes + offset, sizeof(type));
+            key.AddValue(type);
+            switch (type)
+            {
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS:
+            {
+                const auto shader = ReadSubobject<D3D12_SHADER_BYTECODE>(bytes, offset);
+                key.Add(shader.pShaderBytecode, shader.BytecodeLength);
+                break;
+            }
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE:
+                ReadSubobject<ID3D12RootSignature*>(bytes, offset);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT:
+            {
+                const auto layout = ReadSubobject<D3D12_INPUT_LAYOUT_DESC>(bytes, offset);
+                for (auto i = 0u; i < layout.NumElements; ++i)
+                {
+                    const auto& element = layout.pInputElementDescs[i];
+                    key.Add(element.SemanticName, std::strlen(element.SemanticName));
+                    key.AddValue(element.SemanticIndex).AddValue(element.Format).AddValue(element.InputSlot).AddValue(element.AlignedByteOffset);
+                    key.AddValue(element.InputSlotClass).AddValue(element.InstanceDataStepRate);
+                }
+                break;
+            }
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS:
+                key.AddValue(ReadSubobject<D3D12_RT_FORMAT_ARRAY>(bytes, offset));
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL:
+                key.AddValue(ReadSubobject<D3D12_DEPTH_STENCIL_DESC>(bytes, offset));
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT:
+                key.AddValue(ReadSubobject<DXGI_FORMAT>(bytes, offset));
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER:
+                key.AddValue(ReadSubobject<D3D12_RASTERIZER_DESC>(bytes, offset));
+                break;
+            default:
+                // New subobject types have to be added above, or the key misses their state
+                assert(false);
+                return PipelineKey::c_invalidKey;
+            }
+        }
+        // Keeps the invalid key free for the streams above
+        return key.GetHash() != PipelineKey::c_invalidKey ? key.GetHash() : 1;
+    }
 }
 
 Device::Device()
+    : m_srvDescriptors(c_srvDescriptorCount, c_transientDescriptorCount)
+    , m_constantRing(c_constantRingSize)
 {
     D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(&m_device));
     D3D12_FEATURE_DATA_D3D12_OPTIONS5 featureSupportData = {};
@@ -31,9 +157,17 @@ Device::Device()
     m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_queue));
 
     m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_submissionFence));
+    m_allocator = std::make_unique<GpuAllocator>(m_device);
+    m_pipelineCache = PipelineCache(GetPipelineEnvironment(m_device.Get()));
+    m_pipelineCache.Load(c_pipelineCachePath);
+
+    m_constantBuffer = CreateBuffer(c_constantRingSize, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_FLAG_NONE, true);
+    D3D12_RANGE readRange = {0, 0};
+    m_constantBuffer->Map(0, &readRange, (void**)&m_constantPtr);
+    assert(m_constantPtr);
     m_submissionEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
-    m_srvHeap = CreateDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    m_srvHeap = CreateDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, c_srvDescriptorCount);
     m_rtvHeap = CreateDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 128);
     m_dsvHeap = CreateDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 128);
     m_samplerHeap = CreateDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 128);
@@ -55,6 +189,7 @@ Device::Device()
 Device::~Device()
 {
     Finish();
+    m_pipelineCache.Save(c_pipelineCachePath);
     CloseHandle(m_submissionEvent);
 }
 
@@ -98,13 +233,6 @@ ComPtr<ID3D12DescriptorHeap> Device::CreateDescriptorHeap(D3D12_DESCRIPTOR_HEAP_
 
 ComPtr<ID3D12Resource> Device::CreateTexture(DXGI_FORMAT format, uint16_t width, uint16_t height, uint16_t arraySize, D3D12_RESOURCE_STATES defaultState, D3D12_RESOURCE_FLAGS flags)
 {
-    ComPtr<ID3D12Resource> texture;
-    D3D12_HEAP_PROPERTIES heapProps;
-    heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    heapProps.CreationNodeMask = 0b1;
-    heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-    heapProps.VisibleNodeMask = 0b1;
     D3D12_RESOURCE_DESC textureDesc;
     textureDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
     textureDesc.DepthOrArraySize = arraySize;
@@ -116,19 +244,12 @@ ComPtr<ID3D12Resource> Device::CreateTexture(DXGI_FORMAT format, uint16_t width,
     textureDesc.MipLevels = 1;
     textureDesc.SampleDesc = {1, 0};
     textureDesc.Width = width;
-    m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES, &textureDesc, defaultState, nullptr, IID_PPV_ARGS(&texture));
-    return texture;
+    const auto pool = flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) ? GpuAllocator::Pool::RenderTargets : GpuAllocator::Pool::Textures;
+    return m_allocator->Create(textureDesc, pool, defaultState);
 }
 
 ComPtr<ID3D12Resource> Device::CreateBuffer(uint64_t size, D3D12_RESOURCE_STATES defaultState, D3D12_RESOURCE_FLAGS flags, bool staging)
 {
-    ComPtr<ID3D12Resource> buffer;
-    D3D12_HEAP_PROPERTIES heapProps;
-    heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    heapProps.CreationNodeMask = 0b1;
-    heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    heapProps.Type = staging ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT;
-    heapProps.VisibleNodeMask = 0b1;
     D3D12_RESOURCE_DESC bufferDesc;
     bufferDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
     bufferDesc.DepthOrArraySize = 1;
@@ -140,141 +261,43 @@ ComPtr<ID3D12Resource> Device::CreateBuffer(uint64_t size, D3D12_RESOURCE_STATES
     bufferDesc.MipLevels = 1;
     bufferDesc.SampleDesc = {1, 0};
     bufferDesc.Width = size;
-    m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES, &bufferDesc, defaultState, nullptr, IID_PPV_ARGS(&buffer));
-    return buffer;
+    return m_allocator->Create(bufferDesc, staging ? GpuAllocator::Pool::UploadBuffers : GpuAllocator::Pool::Buffers, defaultState);
 }
 
-VertexBuffer Device::CreateVertexBuffer(const std::vector<float>& data)
+uint64_t Device::GetTopLevelAccelerationStructureSize(const ComPtr<ID3D12Resource>& instanceBuffer, uint32_t instanceCount)
 {
-    const auto dataSize = data.size() * sizeof(data[0]);
-    const auto stagingBuffer = CreateBuffer(dataSize, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
-    const auto gpuBuffer = CreateBuffer(dataSize);
-
-    SetResourceData(stagingBuffer, *data.data(), data.size());
-
-    auto commands = CreateGraphicsCommands();
-    commands.List->CopyResource(gpuBuffer.Get(), stagingBuffer.Get());
-    SubmitGraphicsCommands(std::move(commands));
-
-    VertexBuffer ret;
-    ret.Resource = std::move(gpuBuffer);
-    ret.View.BufferLocation = ret.Resource->GetGPUVirtualAddress();
-    ret.View.SizeInBytes = (UINT)dataSize;
-    ret.View.StrideInBytes = 3 * sizeof(data[0]);
-
-    WaitIdle();
-
-    return ret;
-}
-
-IndexBuffer Device::CreateIndexBuffer(const std::vector<uint32_t>& data)
-{
-    const auto dataSize = data.size() * sizeof(data[0]);
-    const auto stagingBuffer = CreateBuffer(dataSize, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
-    const auto gpuBuffer = CreateBuffer(dataSize);
-
-    SetResourceData(stagingBuffer, *data.data(), data.size());
-
-    auto commands = CreateGraphicsCommands();
-    commands.List->CopyResource(gpuBuffer.Get(), stagingBuffer.Get());
-    SubmitGraphicsCommands(std::move(commands));
-
-    IndexBuffer ret;
-    ret.Resource = std::move(gpuBuffer);
-    ret.View.BufferLocation = ret.Resource->GetGPUVirtualAddress();
-    ret.View.SizeInBytes = (UINT)dataSize;
-    ret.View.Format = DXGI_FORMAT_R32_UINT;
-
-    WaitIdle();
-
-    return ret;
-}
-
-ComPtr<ID3D12Resource> Device::CreateBottomLevelAccelerationStructure(const VertexBuffer& vertices, const IndexBuffer& indices, uint32_t vertexCount, uint32_t indexCount)
-{
-    D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc;
-    geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-    geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
-    geometryDesc.Triangles.IndexBuffer = indices.Resource->GetGPUVirtualAddress();
-    geometryDesc.Triangles.IndexCount = indexCount;
-    geometryDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-    geometryDesc.Triangles.Transform3x4 = 0;
-    geometryDesc.Triangles.VertexBuffer = {vertices.Resource->GetGPUVirtualAddress(), sizeof(float) * 3};
-    geometryDesc.Triangles.VertexCount = vertexCount;
-    geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-
     ComPtr<ID3D12Device5> device;
     m_device.As(&device);
     assert(device);
 
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info;
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs;
-    inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
-    inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-    inputs.NumDescs = 1;
-    inputs.pGeometryDescs = &geometryDesc;
+    const auto inputs = GetTopLevelInputs(instanceBuffer, instanceCount, false);
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
     device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
-
-    const auto scratch = CreateBuffer(roundUp(info.ScratchDataSizeInBytes, 256), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-    const auto ret = CreateBuffer(roundUp(info.ResultDataMaxSizeInBytes, 256), D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
-    buildDesc.Inputs = inputs;
-    buildDesc.DestAccelerationStructureData = ret->GetGPUVirtualAddress();
-    buildDesc.ScratchAccelerationStructureData = scratch->GetGPUVirtualAddress();
-    buildDesc.SourceAccelerationStructureData = 0;
-
-    auto commands = CreateGraphicsCommands();
-    ComPtr<ID3D12GraphicsCommandList4> commandList;
-    commands.List.As(&commandList);
-    assert(commandList);
-
-    commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
-
-    D3D12_RESOURCE_BARRIER barr;
-    barr.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-    barr.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    barr.UAV.pResource = ret.Get();
-    commandList->ResourceBarrier(1, &barr);
-
-    SubmitGraphicsCommands(std::move(commands));
-
-    WaitIdle();
-
-    return ret;
-
+    return roundUp(info.ResultDataMaxSizeInBytes, 256);
 }
 
-ComPtr<ID3D12Resource> Device::CreateTopLevelAccelerationStructure(const ComPtr<ID3D12GraphicsCommandList>& commandList, const ComPtr<ID3D12Resource>& instanceBuffer, uint32_t instanceCount)
+void Device::BuildTopLevelAccelerationStructure(const ComPtr<ID3D12GraphicsCommandList>& commandList, const ComPtr<ID3D12Resource>& instanceBuffer, uint32_t instanceCount, const ComPtr<ID3D12Resource>& dest, const ComPtr<ID3D12Resource>& source)
 {
     ComPtr<ID3D12Device5> device;
     m_device.As(&device);
     assert(device);
-    
+
+    const auto inputs = GetTopLevelInputs(instanceBuffer, instanceCount, source != nullptr);
     D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs;
-    inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
-    inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
-    inputs.NumDescs = instanceCount;
-    inputs.InstanceDescs = instanceBuffer->GetGPUVirtualAddress();
     device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
 
-    const auto scratchSize = roundUp(info.ScratchDataSizeInBytes, 256);
+    const auto scratchSize = roundUp(std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes), 256);
     if(scratchSize > m_tlasScratchSize)
     {
         m_tlasScratch = CreateBuffer(scratchSize, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
         m_tlasScratchSize = scratchSize;
     }
 
-    const auto ret = CreateBuffer(roundUp(info.ResultDataMaxSizeInBytes, 256), D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS); 
-
     D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
     buildDesc.Inputs = inputs;
-    buildDesc.DestAccelerationStructureData = ret->GetGPUVirtualAddress();
+    buildDesc.DestAccelerationStructureData = dest->GetGPUVirtualAddress();
     buildDesc.ScratchAccelerationStructureData = m_tlasScratch->GetGPUVirtualAddress();
-    buildDesc.SourceAccelerationStructureData = 0;
+    buildDesc.SourceAccelerationStructureData = source ? source->GetGPUVirtualAddress() : 0;
 
     ComPtr<ID3D12GraphicsCommandList4> commandList4;
     commandList.As(&commandList4);
@@ -285,51 +308,67 @@ ComPtr<ID3D12Resource> Device::CreateTopLevelAccelerationStructure(const ComPtr<
     D3D12_RESOURCE_BARRIER barr;
     barr.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
     barr.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    barr.UAV.pResource = ret.Get();
+    barr.UAV.pResource = dest.Get();
     commandList->ResourceBarrier(1, &barr);
-
-    return ret;
 }
 
 Commands Device::CreateGraphicsCommands()
 {
     Commands commands;
-    if (m_freeAllocators.empty())
+    if (m_freeCommands.empty())
     {
         m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commands.Allocator));
+        m_device->CreateCommandList(0b1, D3D12_COMMAND_LIST_TYPE_DIRECT, commands.Allocator.Get(), nullptr, IID_PPV_ARGS(&commands.List));
+        SetDescriptorHeaps(commands.List);
+        return commands;
     }
-    else
-    {
-        commands.Allocator = std::move(m_freeAllocators.back());
-        m_freeAllocators.pop_back();
-    }
+
+    commands = std::move(m_freeCommands.back());
+    m_freeCommands.pop_back();
+    ResetCommands(commands);
+    return commands;
+}
+
+void Device::ResetCommands(Commands& commands)
+{
     commands.Allocator->Reset();
-    m_device->CreateCommandList(0b1, D3D12_COMMAND_LIST_TYPE_DIRECT, commands.Allocator.Get(), nullptr, IID_PPV_ARGS(&commands.List));
+    commands.List->Reset(commands.Allocator.Get(), nullptr);
     SetDescriptorHeaps(commands.List);
-    return commands;
 }
 
 uint64_t Device::SubmitGraphicsCommands(Commands&& commands)
 {
-    commands.List->Close();
-    ID3D12CommandList* list = commands.List.Get();
+    const auto submission = SubmitCommandList(commands.List);
+    m_pendingCommands.push_back({std::move(commands), submission});
+    return submission;
+}
+
+uint64_t Device::SubmitCommandList(const ComPtr<ID3D12GraphicsCommandList>& commandList)
+{
+    commandList->Close();
+    ID3D12CommandList* list = commandList.Get();
     m_queue->ExecuteCommandLists(1, &list);
     m_queue->Signal(m_submissionFence.Get(), ++m_submissionCounter);
 
-    m_pendingCommands.push_back({std::move(commands.Allocator), m_submissionCounter});
-
     const auto fenceValue = m_submissionFence->GetCompletedValue();
+    m_srvDescriptors.Retire(fenceValue);
+    m_constantRing.Retire(fenceValue);
 
     while(!m_pendingCommands.empty() && m_pendingCommands.front().Submission <= fenceValue)
     {
-        auto& front = m_pendingCommands.front();
-        m_freeAllocators.push_back(std::move(front.Allocator));
+        m_freeCommands.push_back(std::move(m_pendingCommands.front().Recorded));
         m_pendingCommands.pop_front();
     }
 
     return m_submissionCounter;
 }
 
+void Device::SubmitFrame(uint64_t submission)
+{
+    m_srvDescriptors.Submit(submission);
+    m_constantRing.Submit(submission);
+}
+
 D3D12_CPU_DESCRIPTOR_HANDLE Device::CreateRenderTargetView(const ComPtr<ID3D12Resource>& resource, DXGI_FORMAT format)
 {
     D3D12_CPU_DESCRIPTOR_HANDLE handle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart() + m_rtvPos * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
@@ -360,50 +399,58 @@ D3D12_CPU_DESCRIPTOR_HANDLE Device::CreateDepthStencilView(const ComPtr<ID3D12Re
     return handle;
 }
 
-D3D12_GPU_DESCRIPTOR_HANDLE Device::CreateShaderResourceView(const ComPtr<ID3D12Resource> resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc, D3D12_GPU_DESCRIPTOR_HANDLE oldHandle)
+D3D12_GPU_DESCRIPTOR_HANDLE Device::CreateShaderResourceView(const ComPtr<ID3D12Resource> resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc)
 {
-    D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle;
-    D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle; 
+    const auto index = m_srvDescriptors.Allocate();
+    assert(index != DescriptorAllocator::c_invalidIndex);
 
-    if (oldHandle.ptr)
-    {
-        const auto pos = (oldHandle.ptr - m_srvHeap->GetGPUDescriptorHandleForHeapStart().ptr) / m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        cpuHandle = m_srvHeap->GetCPUDescriptorHandleForHeapStart() + (uint32_t)pos * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        gpuHandle = oldHandle;
-    }
-    else
+    m_device->CreateShaderResourceView(desc.ViewDimension == D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE ? nullptr : resource.Get(), &desc, GetSrvCpuHandle(index));
+
+    return GetSrvGpuHandle(index);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Device::CreateTransientShaderResourceView(const ComPtr<ID3D12Resource> resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc)
+{
+    auto index = m_srvDescriptors.AllocateTransient(1);
+    while (index == DescriptorAllocator::c_invalidIndex && m_srvDescriptors.GetOldestTransientSubmission() != 0)
     {
-        cpuHandle = m_srvHeap->GetCPUDescriptorHandleForHeapStart() + m_srvPos * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        gpuHandle = m_srvHeap->GetGPUDescriptorHandleForHeapStart() + m_srvPos * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        ++m_srvPos;
+        // Ring is full: wait for the oldest frame still holding transient descriptors
+        WaitForSubmission(m_srvDescriptors.GetOldestTransientSubmission());
+        m_srvDescriptors.Retire(GetCompletedSubmission());
+        index = m_srvDescriptors.AllocateTransient(1);
     }
+    assert(index != DescriptorAllocator::c_invalidIndex);
 
-    m_device->CreateShaderResourceView(desc.ViewDimension == D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE ? nullptr : resource.Get(), &desc, cpuHandle);
+    m_device->CreateShaderResourceView(desc.ViewDimension == D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE ? nullptr : resource.Get(), &desc, GetSrvCpuHandle(index));
 
-    return gpuHandle;
+    return GetSrvGpuHandle(index);
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE Device::CreateUnorderedAccessView(const ComPtr<ID3D12Resource>& resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc)
 {
-    D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = m_srvHeap->GetCPUDescriptorHandleForHeapStart() + m_srvPos * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = m_srvHeap->GetGPUDescriptorHandleForHeapStart() + m_srvPos * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    ++m_srvPos;
+    const auto index = m_srvDescriptors.Allocate();
+    assert(index != DescriptorAllocator::c_invalidIndex);
 
-    m_device->CreateUnorderedAccessView(resource.Get(), nullptr, &desc, cpuHandle);
+    m_device->CreateUnorderedAccessView(resource.Get(), nullptr, &desc, GetSrvCpuHandle(index));
 
-    return gpuHandle;
+    return GetSrvGpuHandle(index);
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE Device::CreateUnorderedAccessViews(const ComPtr<ID3D12Resource>* resources, const uint32_t count, const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc)
 {
-    D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = m_srvHeap->GetCPUDescriptorHandleForHeapStart() + m_srvPos * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = m_srvHeap->GetGPUDescriptorHandleForHeapStart() + m_srvPos * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    m_srvPos += count;
+    const auto index = m_srvDescriptors.Allocate(count);
+    assert(index != DescriptorAllocator::c_invalidIndex);
 
     for (auto i = 0u; i < count; ++i)
-        m_device->CreateUnorderedAccessView(resources[i].Get(), nullptr, &desc, cpuHandle + i * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+        m_device->CreateUnorderedAccessView(resources[i].Get(), nullptr, &desc, GetSrvCpuHandle(index + i));
 
-    return gpuHandle;
+    return GetSrvGpuHandle(index);
+}
+
+void Device::ReleaseDescriptor(D3D12_GPU_DESCRIPTOR_HANDLE handle)
+{
+    const auto index = (handle.ptr - m_srvHeap->GetGPUDescriptorHandleForHeapStart().ptr) / m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    m_srvDescriptors.Release((uint32_t)index);
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE Device::CreateSampler(const D3D12_SAMPLER_DESC& desc)
@@ -415,7 +462,7 @@ D3D12_CPU_DESCRIPTOR_HANDLE Device::CreateSampler(const D3D12_SAMPLER_DESC& desc
     return cpuHandle;
 }
 
-Pipeline Device::CreateDrawingPipeline()
+Pipeline Device::CreateDrawingPipeline(DXGI_FORMAT positionFormat, DXGI_FORMAT normalFormat, bool gbuffer)
 {
     ComPtr<ID3D12Device5> device;
     m_device.As(&device);
@@ -443,7 +490,7 @@ Pipeline Device::CreateDrawingPipeline()
     D3D12_ROOT_PARAMETER objectConstants;
     objectConstants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
     objectConstants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-    objectConstants.Constants.Num32BitValues = 1;
+    objectConstants.Constants.Num32BitValues = 8;
     objectConstants.Constants.RegisterSpace = 0;
     objectConstants.Constants.ShaderRegister = 1;
     D3D12_ROOT_PARAMETER cascadeConstants;
@@ -451,18 +498,18 @@ Pipeline Device::CreateDrawingPipeline()
     cascadeConstants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
     cascadeConstants.Descriptor.RegisterSpace = 0;
     cascadeConstants.Descriptor.ShaderRegister = 2;
-    D3D12_DESCRIPTOR_RANGE radianceCascadeRange;
-    radianceCascadeRange.BaseShaderRegister = 1;
-    radianceCascadeRange.NumDescriptors = 1;
-    radianceCascadeRange.OffsetInDescriptorsFromTableStart = 0;
-    radianceCascadeRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-    radianceCascadeRange.RegisterSpace = 0;
-    D3D12_ROOT_PARAMETER radianceCascade;
-    radianceCascade.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-    radianceCascade.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-    radianceCascade.DescriptorTable.NumDescriptorRanges = 1;
-    radianceCascade.DescriptorTable.pDescriptorRanges = &radianceCascadeRange;
-    std::array parameters = {cameraConstants, instances, objectConstants, cascadeConstants, radianceCascade};
+    D3D12_DESCRIPTOR_RANGE irradianceRange;
+    irradianceRange.BaseShaderRegister = 1;
+    irradianceRange.NumDescriptors = 1;
+    irradianceRange.OffsetInDescriptorsFromTableStart = 0;
+    irradianceRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    irradianceRange.RegisterSpace = 0;
+    D3D12_ROOT_PARAMETER irradiance;
+    irradiance.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    irradiance.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    irradiance.DescriptorTable.NumDescriptorRanges = 1;
+    irradiance.DescriptorTable.pDescriptorRanges = &irradianceRange;
+    std::array parameters = {cameraConstants, instances, objectConstants, cascadeConstants, irradiance};
 
     D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
     rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
@@ -521,24 +568,31 @@ Pipeline Device::CreateDrawingPipeline()
 
     D3D12_INPUT_ELEMENT_DESC position;
     position.AlignedByteOffset = 0;
-    position.Format = DXGI_FORMAT_R32G32B32_FLOAT;
+    position.Format = positionFormat;
     position.InputSlot = 0;
     position.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
     position.InstanceDataStepRate = 0;
     position.SemanticIndex = 0;
     position.SemanticName = "Position";
     D3D12_INPUT_ELEMENT_DESC normal = position;
+    normal.Format = normalFormat;
     normal.InputSlot = 1;
     normal.SemanticIndex = 0;
     normal.SemanticName = "Normal";
     std::array vertexInputs = {position, normal};
     streamDesc.InputLayout.desc = {vertexInputs.data(), (UINT)vertexInputs.size()};
     streamDesc.VS.desc = { DrawingVS, sizeof(DrawingVS) };
-    streamDesc.PS.desc = { DrawingPS, sizeof(DrawingPS) };
+    streamDesc.PS.desc = gbuffer ? D3D12_SHADER_BYTECODE{ GBufferPS, sizeof(GBufferPS) } : D3D12_SHADER_BYTECODE{ DrawingPS, sizeof(DrawingPS) };
     streamDesc.RootSignature.desc = ret.RootSignature.Get();
     streamDesc.RenderTargets.desc = {};
     streamDesc.RenderTargets.desc.NumRenderTargets = 1;
     streamDesc.RenderTargets.desc.RTFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+    if (gbuffer)
+    {
+        streamDesc.RenderTargets.desc.NumRenderTargets = (UINT)std::size(c_gbufferFormats);
+        std::copy(std::begin(c_gbufferFormats), std::end(c_gbufferFormats), streamDesc.RenderTargets.desc.RTFormats);
+    }
+    streamDesc.DepthStencil.desc = {};
     streamDesc.DepthStencil.desc.DepthEnable = TRUE;
     streamDesc.DepthStencil.desc.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
     streamDesc.DepthStencil.desc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
@@ -547,16 +601,12 @@ Pipeline Device::CreateDrawingPipeline()
     streamDesc.Rasterizer.desc = {};
     streamDesc.Rasterizer.desc.FillMode = D3D12_FILL_MODE_SOLID;
     streamDesc.Rasterizer.desc.CullMode = D3D12_CULL_MODE_NONE;
-    D3D12_PIPELINE_STATE_STREAM_DESC stateDesc;
-    stateDesc.pPipelineStateSubobjectStream = &streamDesc;
-    stateDesc.SizeInBytes = sizeof(streamDesc);
-    device->CreatePipelineState(&stateDesc, IID_PPV_ARGS(&ret.State));
-    assert(ret.State);
+    ret.State = CreatePipelineState(&streamDesc, sizeof(streamDesc), blob);
 
     return ret;
 }
 
-Pipeline Device::CreateCascadeDebugPipeline()
+Pipeline Device::CreateCascadeDebugPipeline(CascadeTopologyId topology)
 {
     ComPtr<ID3D12Device5> device;
     m_device.As(&device);
@@ -587,7 +637,13 @@ Pipeline Device::CreateCascadeDebugPipeline()
     radianceCascade.DescriptorTable.NumDescriptorRanges = 1;
     radianceCascade.DescriptorTable.pDescriptorRanges = &radianceCascadeRange;
 
-    std::array parameters = {constants, cascadeConstants, radianceCascade};
+    D3D12_ROOT_PARAMETER bricks;
+    bricks.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    bricks.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    bricks.Descriptor.RegisterSpace = 0;
+    bricks.Descriptor.ShaderRegister = 1;
+
+    std::array parameters = {constants, cascadeConstants, radianceCascade, bricks};
 
     D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
     rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
@@ -663,11 +719,12 @@ Pipeline Device::CreateCascadeDebugPipeline()
     std::array vertexInputs = {position, normal};
     streamDesc.InputLayout.desc = {vertexInputs.data(), (UINT)vertexInputs.size()};
     streamDesc.VS.desc = { DebugCascadesVS, sizeof(DebugCascadesVS) };
-    streamDesc.PS.desc = { DebugCascadesPS, sizeof(DebugCascadesPS) };
+    streamDesc.PS.desc = c_cascadeShaders[(uint32_t)topology].DebugPS;
     streamDesc.RootSignature.desc = ret.RootSignature.Get();
     streamDesc.RenderTargets.desc = {};
     streamDesc.RenderTargets.desc.NumRenderTargets = 1;
     streamDesc.RenderTargets.desc.RTFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+    streamDesc.DepthStencil.desc = {};
     streamDesc.DepthStencil.desc.DepthEnable = TRUE;
     streamDesc.DepthStencil.desc.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
     streamDesc.DepthStencil.desc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
@@ -676,16 +733,12 @@ Pipeline Device::CreateCascadeDebugPipeline()
     streamDesc.Rasterizer.desc = {};
     streamDesc.Rasterizer.desc.FillMode = D3D12_FILL_MODE_SOLID;
     streamDesc.Rasterizer.desc.CullMode = D3D12_CULL_MODE_NONE;
-    D3D12_PIPELINE_STATE_STREAM_DESC stateDesc;
-    stateDesc.pPipelineStateSubobjectStream = &streamDesc;
-    stateDesc.SizeInBytes = sizeof(streamDesc);
-    device->CreatePipelineState(&stateDesc, IID_PPV_ARGS(&ret.State));
-    assert(ret.State);
+    ret.State = CreatePipelineState(&streamDesc, sizeof(streamDesc), blob);
 
     return ret;
 }
 
-State Device::CreateCascadeTracingPipeline()
+State Device::CreateCascadeTracingPipeline(CascadeTopologyId topology)
 {
     ComPtr<ID3D12Device5> device;
     m_device.As(&device);
@@ -697,7 +750,7 @@ State Device::CreateCascadeTracingPipeline()
     D3D12_ROOT_PARAMETER constants;
     constants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
     constants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-    constants.Constants.Num32BitValues = 1;
+    constants.Constants.Num32BitValues = 3;
     constants.Constants.RegisterSpace = 0;
     constants.Constants.ShaderRegister = 0;
 
@@ -719,17 +772,11 @@ State Device::CreateCascadeTracingPipeline()
     accelerationStructure.DescriptorTable.NumDescriptorRanges = 1;
     accelerationStructure.DescriptorTable.pDescriptorRanges = &as;
 
-    D3D12_DESCRIPTOR_RANGE instanceRange;
-    instanceRange.BaseShaderRegister = 1;
-    instanceRange.NumDescriptors = 1;
-    instanceRange.OffsetInDescriptorsFromTableStart = 0;
-    instanceRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-    instanceRange.RegisterSpace = 0;
-    D3D12_ROOT_PARAMETER instances;
-    instances.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-    instances.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-    instances.DescriptorTable.NumDescriptorRanges = 1;
-    instances.DescriptorTable.pDescriptorRanges = &instanceRange;
+    D3D12_ROOT_PARAMETER probes;
+    probes.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    probes.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    probes.Descriptor.RegisterSpace = 0;
+    probes.Descriptor.ShaderRegister = 1;
 
     D3D12_DESCRIPTOR_RANGE cascadesRange;
     cascadesRange.BaseShaderRegister = 0;
@@ -743,7 +790,13 @@ State Device::CreateCascadeTracingPipeline()
     cascades.DescriptorTable.NumDescriptorRanges = 1;
     cascades.DescriptorTable.pDescriptorRanges = &cascadesRange;
 
-    std::array parameters = {constants, cascadeConstants, accelerationStructure, instances, cascades};
+    D3D12_ROOT_PARAMETER bricks;
+    bricks.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    bricks.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    bricks.Descriptor.RegisterSpace = 0;
+    bricks.Descriptor.ShaderRegister = 2;
+
+    std::array parameters = {constants, cascadeConstants, accelerationStructure, probes, cascades, bricks};
     
     D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
     rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
@@ -763,7 +816,7 @@ State Device::CreateCascadeTracingPipeline()
     D3D12_EXPORT_DESC rayMiss = {L"RayMiss", nullptr, D3D12_EXPORT_FLAG_NONE};
     std::array exports = {rayGen, rayHit, rayMiss};
     D3D12_DXIL_LIBRARY_DESC rayLibraryDesc;
-    rayLibraryDesc.DXILLibrary = {CascadeTracing, sizeof(CascadeTracing)};
+    rayLibraryDesc.DXILLibrary = c_cascadeShaders[(uint32_t)topology].Tracing;
     rayLibraryDesc.NumExports = (UINT)exports.size();
     rayLibraryDesc.pExports = exports.data();
     subobjects.push_back({D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY, &rayLibraryDesc});
@@ -776,7 +829,7 @@ State Device::CreateCascadeTracingPipeline()
 
     D3D12_RAYTRACING_SHADER_CONFIG sc;
     sc.MaxAttributeSizeInBytes = 2 * sizeof(float);
-    sc.MaxPayloadSizeInBytes = 4 * sizeof(float);
+    sc.MaxPayloadSizeInBytes = sizeof(uint32_t);
     subobjects.push_back({D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_SHADER_CONFIG, &sc});
 
     D3D12_GLOBAL_ROOT_SIGNATURE globalRootSig;
@@ -818,7 +871,7 @@ State Device::CreateCascadeTracingPipeline()
     return ret;
 }
 
-Pipeline Device::CreateCascadeAccumulationPipeline()
+Pipeline Device::CreateCascadeAccumulationPipeline(CascadeTopologyId topology)
 {
     ComPtr<ID3D12Device5> device;
     m_device.As(&device);
@@ -830,7 +883,7 @@ Pipeline Device::CreateCascadeAccumulationPipeline()
     D3D12_ROOT_PARAMETER constants;
     constants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
     constants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-    constants.Constants.Num32BitValues = 1;
+    constants.Constants.Num32BitValues = 2;
     constants.Constants.RegisterSpace = 0;
     constants.Constants.ShaderRegister = 0;
     D3D12_ROOT_PARAMETER cascadeConstants;
@@ -860,7 +913,34 @@ Pipeline Device::CreateCascadeAccumulationPipeline()
     currentCascade.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
     currentCascade.DescriptorTable.NumDescriptorRanges = 1;
     currentCascade.DescriptorTable.pDescriptorRanges = &currentCascadeRange;
-    std::array parameters = {constants, cascadeConstants, higherCascade, currentCascade};
+    D3D12_DESCRIPTOR_RANGE hitsRange;
+    hitsRange.BaseShaderRegister = 1;
+    hitsRange.NumDescriptors = 1;
+    hitsRange.OffsetInDescriptorsFromTableStart = 0;
+    hitsRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    hitsRange.RegisterSpace = 0;
+    D3D12_ROOT_PARAMETER hits;
+    hits.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    hits.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    hits.DescriptorTable.NumDescriptorRanges = 1;
+    hits.DescriptorTable.pDescriptorRanges = &hitsRange;
+    D3D12_DESCRIPTOR_RANGE instanceRange;
+    instanceRange.BaseShaderRegister = 2;
+    instanceRange.NumDescriptors = 1;
+    instanceRange.OffsetInDescriptorsFromTableStart = 0;
+    instanceRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    instanceRange.RegisterSpace = 0;
+    D3D12_ROOT_PARAMETER instances;
+    instances.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    instances.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    instances.DescriptorTable.NumDescriptorRanges = 1;
+    instances.DescriptorTable.pDescriptorRanges = &instanceRange;
+    D3D12_ROOT_PARAMETER bricks;
+    bricks.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    bricks.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    bricks.Descriptor.RegisterSpace = 0;
+    bricks.Descriptor.ShaderRegister = 3;
+    std::array parameters = {constants, cascadeConstants, higherCascade, currentCascade, hits, instances, bricks};
 
     D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
     rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
@@ -887,18 +967,312 @@ Pipeline Device::CreateCascadeAccumulationPipeline()
         } RootSignature;
     } streamDesc;
 
-    streamDesc.CS.desc = {CascadeAccumulation, sizeof(CascadeAccumulation)};
+    streamDesc.CS.desc = c_cascadeShaders[(uint32_t)topology].Accumulation;
+    streamDesc.RootSignature.desc = ret.RootSignature.Get();
+
+    ret.State = CreatePipelineState(&streamDesc, sizeof(streamDesc), blob);
+
+    return ret;
+}
+
+Pipeline Device::CreateCascadeIrradiancePipeline(CascadeTopologyId topology)
+{
+    ComPtr<ID3D12Device5> device;
+    m_device.As(&device);
+    assert(device);
+
+    Pipeline ret;
+
+    ComPtr<ID3DBlob> blob;
+    D3D12_ROOT_PARAMETER cascadeConstants;
+    cascadeConstants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+    cascadeConstants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    cascadeConstants.Descriptor.RegisterSpace = 0;
+    cascadeConstants.Descriptor.ShaderRegister = 0;
+    D3D12_DESCRIPTOR_RANGE cascadeRange;
+    cascadeRange.BaseShaderRegister = 0;
+    cascadeRange.NumDescriptors = 1;
+    cascadeRange.OffsetInDescriptorsFromTableStart = 0;
+    cascadeRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    cascadeRange.RegisterSpace = 0;
+    D3D12_ROOT_PARAMETER cascade;
+    cascade.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    cascade.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    cascade.DescriptorTable.NumDescriptorRanges = 1;
+    cascade.DescriptorTable.pDescriptorRanges = &cascadeRange;
+    D3D12_DESCRIPTOR_RANGE irradianceRange;
+    irradianceRange.BaseShaderRegister = 0;
+    irradianceRange.NumDescriptors = 1;
+    irradianceRange.OffsetInDescriptorsFromTableStart = 0;
+    irradianceRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+    irradianceRange.RegisterSpace = 0;
+    D3D12_ROOT_PARAMETER irradiance;
+    irradiance.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    irradiance.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    irradiance.DescriptorTable.NumDescriptorRanges = 1;
+    irradiance.DescriptorTable.pDescriptorRanges = &irradianceRange;
+    D3D12_ROOT_PARAMETER bricks;
+    bricks.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    bricks.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    bricks.Descriptor.RegisterSpace = 0;
+    bricks.Descriptor.ShaderRegister = 1;
+    std::array parameters = {cascadeConstants, cascade, irradiance, bricks};
+
+    D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+    rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+    rootSignatureDesc.NumParameters = (UINT)parameters.size();
+    rootSignatureDesc.NumStaticSamplers = 0;
+    rootSignatureDesc.pParameters = parameters.data();
+    rootSignatureDesc.pStaticSamplers = nullptr;
+    D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &blob, nullptr);
+    assert(blob);
+
+    device->CreateRootSignature(0b1, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&ret.RootSignature));
+
+    struct
+    {
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS;
+            D3D12_SHADER_BYTECODE desc;
+        } CS;
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+            ID3D12RootSignature* desc;
+        } RootSignature;
+    } streamDesc;
+
+    streamDesc.CS.desc = c_cascadeShaders[(uint32_t)topology].Irradiance;
+    streamDesc.RootSignature.desc = ret.RootSignature.Get();
+
+    ret.State = CreatePipelineState(&streamDesc, sizeof(streamDesc), blob);
+
+    return ret;
+}
+
+Pipeline Device::CreateDeferredGatherPipeline()
+{
+    ComPtr<ID3D12Device5> device;
+    m_device.As(&device);
+    assert(device);
+
+    Pipeline ret;
+
+    ComPtr<ID3DBlob> blob;
+    D3D12_ROOT_PARAMETER deferredConstants;
+    deferredConstants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+    deferredConstants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    deferredConstants.Descriptor.RegisterSpace = 0;
+    deferredConstants.Descriptor.ShaderRegister = 0;
+    D3D12_ROOT_PARAMETER cascadeConstants = deferredConstants;
+    cascadeConstants.Descriptor.ShaderRegister = 1;
+    // One table each for the normals, the depth and the irradiance volume at t0 to t2
+    std::array<D3D12_DESCRIPTOR_RANGE, 3> textureRanges;
+    std::array<D3D12_ROOT_PARAMETER, 3> textures;
+    for (auto i = 0u; i < textures.size(); ++i)
+    {
+        textureRanges[i].BaseShaderRegister = i;
+        textureRanges[i].NumDescriptors = 1;
+        textureRanges[i].OffsetInDescriptorsFromTableStart = 0;
+        textureRanges[i].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        textureRanges[i].RegisterSpace = 0;
+        textures[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        textures[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        textures[i].DescriptorTable.NumDescriptorRanges = 1;
+        textures[i].DescriptorTable.pDescriptorRanges = &textureRanges[i];
+    }
+    D3D12_DESCRIPTOR_RANGE gatheredRange;
+    gatheredRange.BaseShaderRegister = 0;
+    gatheredRange.NumDescriptors = 1;
+    gatheredRange.OffsetInDescriptorsFromTableStart = 0;
+    gatheredRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+    gatheredRange.RegisterSpace = 0;
+    D3D12_ROOT_PARAMETER gathered;
+    gathered.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    gathered.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    gathered.DescriptorTable.NumDescriptorRanges = 1;
+    gathered.DescriptorTable.pDescriptorRanges = &gatheredRange;
+    std::array parameters = {deferredConstants, cascadeConstants, textures[0], textures[1], textures[2], gathered};
+
+    D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+    rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+    rootSignatureDesc.NumParameters = (UINT)parameters.size();
+    rootSignatureDesc.NumStaticSamplers = 1;
+    rootSignatureDesc.pParameters = parameters.data();
+    rootSignatureDesc.pStaticSamplers = &m_linearSampler;
+    D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &blob, nullptr);
+    assert(blob);
+
+    device->CreateRootSignature(0b1, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&ret.RootSignature));
+
+    struct
+    {
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS;
+            D3D12_SHADER_BYTECODE desc;
+        } CS;
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+            ID3D12RootSignature* desc;
+        } RootSignature;
+    } streamDesc;
+
+    streamDesc.CS.desc = {DeferredGather, sizeof(DeferredGather)};
     streamDesc.RootSignature.desc = ret.RootSignature.Get();
 
-    D3D12_PIPELINE_STATE_STREAM_DESC stateDesc;
-    stateDesc.pPipelineStateSubobjectStream = &streamDesc;
-    stateDesc.SizeInBytes = sizeof(streamDesc);
-    device->CreatePipelineState(&stateDesc, IID_PPV_ARGS(&ret.State));
-    assert(ret.State);
+    ret.State = CreatePipelineState(&streamDesc, sizeof(streamDesc), blob);
 
     return ret;
 }
 
+Pipeline Device::CreateDeferredCompositePipeline()
+{
+    ComPtr<ID3D12Device5> device;
+    m_device.As(&device);
+    assert(device);
+
+    Pipeline ret;
+
+    ComPtr<ID3DBlob> blob;
+    D3D12_ROOT_PARAMETER deferredConstants;
+    deferredConstants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+    deferredConstants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    deferredConstants.Descriptor.RegisterSpace = 0;
+    deferredConstants.Descriptor.ShaderRegister = 0;
+    D3D12_ROOT_PARAMETER cascadeConstants = deferredConstants;
+    cascadeConstants.Descriptor.ShaderRegister = 1;
+    // One table each for the albedo, emission, normals, depth, gathered irradiance and irradiance volume at t0 to t5
+    std::array<D3D12_DESCRIPTOR_RANGE, 6> textureRanges;
+    std::array<D3D12_ROOT_PARAMETER, 8> parameters = {deferredConstants, cascadeConstants};
+    for (auto i = 0u; i < textureRanges.size(); ++i)
+    {
+        textureRanges[i].BaseShaderRegister = i;
+        textureRanges[i].NumDescriptors = 1;
+        textureRanges[i].OffsetInDescriptorsFromTableStart = 0;
+        textureRanges[i].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        textureRanges[i].RegisterSpace = 0;
+        auto& texture = parameters[2 + i];
+        texture.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        texture.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        texture.DescriptorTable.NumDescriptorRanges = 1;
+        texture.DescriptorTable.pDescriptorRanges = &textureRanges[i];
+    }
+
+    D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+    rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+    rootSignatureDesc.NumParameters = (UINT)parameters.size();
+    rootSignatureDesc.NumStaticSamplers = 1;
+    rootSignatureDesc.pParameters = parameters.data();
+    rootSignatureDesc.pStaticSamplers = &m_linearSampler;
+    D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &blob, nullptr);
+    assert(blob);
+
+    device->CreateRootSignature(0b1, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&ret.RootSignature));
+
+    struct
+    {
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS;
+            D3D12_SHADER_BYTECODE desc;
+        } VS;
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS;
+            D3D12_SHADER_BYTECODE desc;
+        } PS;
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+            ID3D12RootSignature* desc;
+        } RootSignature;
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS;
+            D3D12_RT_FORMAT_ARRAY desc;
+        } RenderTargets;
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL;
+            D3D12_DEPTH_STENCIL_DESC desc;
+        } DepthStencil;
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER;
+            D3D12_RASTERIZER_DESC desc;
+        } Rasterizer;
+    } streamDesc;
+
+    streamDesc.VS.desc = { FullScreenVS, sizeof(FullScreenVS) };
+    streamDesc.PS.desc = { DeferredCompositePS, sizeof(DeferredCompositePS) };
+    streamDesc.RootSignature.desc = ret.RootSignature.Get();
+    streamDesc.RenderTargets.desc = {};
+    streamDesc.RenderTargets.desc.NumRenderTargets = 1;
+    streamDesc.RenderTargets.desc.RTFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+    // The depth is read as a texture, background pixels are discarded by the shader
+    streamDesc.DepthStencil.desc = {};
+    streamDesc.DepthStencil.desc.DepthEnable = FALSE;
+    streamDesc.DepthStencil.desc.StencilEnable = FALSE;
+    streamDesc.Rasterizer.desc = {};
+    streamDesc.Rasterizer.desc.FillMode = D3D12_FILL_MODE_SOLID;
+    streamDesc.Rasterizer.desc.CullMode = D3D12_CULL_MODE_NONE;
+    ret.State = CreatePipelineState(&streamDesc, sizeof(streamDesc), blob);
+
+    return ret;
+}
+
+ComPtr<ID3D12PipelineState> Device::CreatePipelineState(const void* stream, uint64_t size, const ComPtr<ID3DBlob>& rootSignature)
+{
+    ComPtr<ID3D12Device2> device;
+    m_device.As(&device);
+    assert(device);
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const auto key = GetPipelineKey(stream, size, rootSignature);
+    const bool cacheable = key != PipelineKey::c_invalidKey;
+    ComPtr<ID3D12PipelineState> state;
+    if (const auto cached = cacheable ? m_pipelineCache.Find(key) : nullptr)
+    {
+        // The blob of an earlier launch goes along as one more subobject
+        struct alignas(void*)
+        {
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CACHED_PSO;
+            D3D12_CACHED_PIPELINE_STATE desc;
+        } cachedPso;
+        cachedPso.desc = {cached->data(), cached->size()};
+        const auto cachedOffset = roundUp(size, sizeof(void*));
+        std::vector<uint8_t> cachedStream(cachedOffset + sizeof(cachedPso));
+        std::memcpy(cachedStream.data(), stream, size);
+        std::memcpy(cachedStream.data() + cachedOffset, &cachedPso, sizeof(cachedPso));
+
+        D3D12_PIPELINE_STATE_STREAM_DESC stateDesc;
+        stateDesc.pPipelineStateSubobjectStream = cachedStream.data();
+        stateDesc.SizeInBytes = cachedStream.size();
+        // Blobs of another driver or device fail with D3D12_ERROR_DRIVER_VERSION_MISMATCH and the like
+        if (FAILED(device->CreatePipelineState(&stateDesc, IID_PPV_ARGS(&state))))
+            m_pipelineCache.Reject(key);
+    }
+
+    if (!state)
+    {
+        D3D12_PIPELINE_STATE_STREAM_DESC stateDesc;
+        stateDesc.pPipelineStateSubobjectStream = const_cast<void*>(stream);
+        stateDesc.SizeInBytes = size;
+        device->CreatePipelineState(&stateDesc, IID_PPV_ARGS(&state));
+        assert(state);
+
+        ComPtr<ID3DBlob> blob;
+        if (cacheable && SUCCEEDED(state->GetCachedBlob(&blob)))
+            m_pipelineCache.Store(key, blob->GetBufferPointer(), blob->GetBufferSize());
+    }
+
+    m_pipelineSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return state;
+}
+
 void Device::SetResourceDataInternal(const ComPtr<ID3D12Resource>& resource, const void* data, uint64_t size)
 {
     void* resourcePtr = nullptr;
@@ -911,6 +1285,22 @@ void Device::SetResourceDataInternal(const ComPtr<ID3D12Resource>& resource, con
     resource->Unmap(0, &writeRange);
 }
 
+D3D12_GPU_VIRTUAL_ADDRESS Device::UploadData(const void* data, uint64_t size)
+{
+    auto offset = m_constantRing.Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    while (offset == UploadRing::c_invalidOffset && m_constantRing.GetOldestSubmission() != 0)
+    {
+        // Only when the CPU is far enough ahead to have filled the ring, wait for the oldest frame in it
+        WaitForSubmission(m_constantRing.GetOldestSubmission());
+        m_constantRing.Retire(GetCompletedSubmission());
+        offset = m_constantRing.Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    }
+    assert(offset != UploadRing::c_invalidOffset);
+
+    std::memcpy(m_constantPtr + offset, data, size);
+    return m_constantBuffer->GetGPUVirtualAddress() + offset;
+}
+
 void Device::SetDescriptorHeaps(const ComPtr<ID3D12GraphicsCommandList>& commandList)
 {
     auto srvHeap = m_srvHeap.Get();
@@ -925,7 +1315,15 @@ void Device::Finish()
 
 void Device::WaitIdle()
 {
-    m_submissionFence->SetEventOnCompletion(m_submissionCounter, m_submissionEvent);
+    WaitForSubmission(m_submissionCounter);
+}
+
+void Device::WaitForSubmission(uint64_t submission)
+{
+    if (m_submissionFence->GetCompletedValue() >= submission)
+        return;
+
+    m_submissionFence->SetEventOnCompletion(submission, m_submissionEvent);
     WaitForSingleObject(m_submissionEvent, INFINITE);
 }
 
@@ -948,4 +1346,71 @@ void Device::PipelineBarrierTransition(const ComPtr<ID3D12GraphicsCommandList>&
     barr.Transition.StateAfter = after;
     barr.Transition.Subresource = subresource;
     commandList->ResourceBarrier(1, &barr);
+}
+
+void Device::PipelineBarriers(const ComPtr<ID3D12GraphicsCommandList>& commandList, const RenderGraph& graph, const std::vector<GraphBarrier>& barriers)
+{
+    static_assert(GraphState::RenderTarget == D3D12_RESOURCE_STATE_RENDER_TARGET && GraphState::UnorderedAccess == D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    static_assert(GraphState::DepthWrite == D3D12_RESOURCE_STATE_DEPTH_WRITE && GraphState::DepthRead == D3D12_RESOURCE_STATE_DEPTH_READ);
+    static_assert(GraphState::AllShaderResource == D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE && GraphState::Present == D3D12_RESOURCE_STATE_PRESENT);
+    static_assert(GraphState::CopyDest == D3D12_RESOURCE_STATE_COPY_DEST && GraphState::CopySource == D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barrs(barriers.size());
+    for (auto i = 0u; i < barriers.size(); ++i)
+    {
+        auto& barrier = barriers[i];
+        auto resource = static_cast<ID3D12Resource*>(graph.GetNative(barrier.Resource));
+        auto& barr = barrs[i];
+        barr.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        if (barrier.Phase == GraphBarrier::Split::Begin)
+            barr.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+        else if (barrier.Phase == GraphBarrier::Split::End)
+            barr.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+
+        if (barrier.Kind == GraphBarrier::Type::Uav)
+        {
+            barr.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            barr.UAV.pResource = resource;
+        }
+        else
+        {
+            barr.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            barr.Transition.pResource = resource;
+            barr.Transition.StateBefore = (D3D12_RESOURCE_STATES)barrier.Before;
+            barr.Transition.StateAfter = (D3D12_RESOURCE_STATES)barrier.After;
+            barr.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        }
+    }
+    commandList->ResourceBarrier((UINT)barrs.size(), barrs.data());
+}
+
+void D3D12FrameDevice::RecordBarriers(const RenderGraph& graph, const std::vector<GraphBarrier>& barriers)
+{
+    assert(m_commandList);
+    Device::PipelineBarriers(m_commandList, graph, barriers);
+}
+
+void D3D12FrameDevice::CopyBuffer(void* dest, uint64_t destOffset, void* source, uint64_t sourceOffset, uint64_t size)
+{
+    assert(m_commandList);
+    m_commandList->CopyBufferRegion(static_cast<ID3D12Resource*>(dest), destOffset, static_cast<ID3D12Resource*>(source), sourceOffset, size);
+}
+
+uint64_t D3D12FrameDevice::Submit()
+{
+    assert(m_commandList);
+    const auto submission = m_device.SubmitCommandList(m_commandList);
+    m_device.SubmitFrame(submission);
+    m_commandList = nullptr;
+    return submission;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE Device::GetSrvCpuHandle(uint32_t index) const
+{
+    return m_srvHeap->GetCPUDescriptorHandleForHeapStart() + index * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Device::GetSrvGpuHandle(uint32_t index) const
+{
+    return m_srvHeap->GetGPUDescriptorHandleForHeapStart() + index * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "DirtyRanges.h"
+
+#include <algorithm>
+#include <cassert>
+
+DirtyRanges::DirtyRanges(uint32_t capacity, uint32_t mergeGap, float fullCopyFraction)
+    : m_marks((capacity + 63) / 64, 0)
+    , m_capacity(capacity)
+    , m_mergeGap(mergeGap)
+    , m_fullCopyFraction(fullCopyFraction)
+{
+}
+
+void DirtyRanges::Mark(uint32_t index)
+{
+    assert(index < m_capacity);
+
+    auto& word = m_marks[index / 64];
+    const auto bit = 1ull << (index % 64);
+    if (m_allDirty || (word & bit))
+        return;
+
+    word |= bit;
+    m_dirty.push_back(index);
+}
+
+void DirtyRanges::MarkAll()
+{
+    m_allDirty = true;
+}
+
+std::vector<DirtyRange> DirtyRanges::Collect(uint32_t usedCount)
+{
+    assert(usedCount <= m_capacity);
+
+    std::vector<DirtyRange> ret;
+    for (const auto index : m_dirty)
+        m_marks[index / 64] &= ~(1ull << (index % 64));
+
+    const auto dirtyCount = m_dirty.size();
+    const bool fullCopy = m_allDirty || dirtyCount > m_fullCopyFraction * usedCount;
+    m_allDirty = false;
+
+    if (fullCopy)
+    {
+        if (usedCount > 0)
+            ret.push_back({0, usedCount});
+    }
+    else
+    {
+        std::sort(m_dirty.begin(), m_dirty.end());
+        for (const auto index : m_dirty)
+        {
+            if (index >= usedCount)
+                break;
+
+            if (!ret.empty() && index <= ret.back().End + m_mergeGap)
+                ret.back().End = index + 1;
+            else
+                ret.push_back({index, index + 1});
+        }
+    }
+    m_dirty.clear();
+
+    m_stats.Elements = 0;
+    m_stats.Ranges = (uint32_t)ret.size();
+    for (const auto& range : ret)
+        m_stats.Elements += range.End - range.Begin;
+    m_stats.TotalElements += m_stats.Elements;
+    return ret;
+}
@@ -0,0 +1,189 @@
+#include "GpuAllocator.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Private data slot of placed resources holding their Releaser
+    const GUID c_allocationGuid = {0x6a4b1f0e, 0x3c2d, 0x4e8a, {0x9b, 0x71, 0x5d, 0x20, 0xc4, 0x8e, 0x13, 0xf7}};
+
+    D3D12_HEAP_TYPE GetHeapType(GpuAllocator::Pool pool)
+    {
+        return pool == GpuAllocator::Pool::UploadBuffers ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT;
+    }
+
+    D3D12_HEAP_FLAGS GetHeapFlags(GpuAllocator::Pool pool)
+    {
+        switch (pool)
+        {
+        case GpuAllocator::Pool::Textures:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+        case GpuAllocator::Pool::RenderTargets:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        default:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        }
+    }
+}
+
+// Owned by the resource through its private data, hands the range back when the resource is destroyed
+class GpuAllocator::Releaser final : public IUnknown
+{
+public:
+    Releaser(GpuAllocator& allocator, Pool pool, HeapBlock* block, const TlsfAllocation& allocation)
+        : m_allocator(allocator)
+        , m_pool(pool)
+        , m_block(block)
+        , m_allocation(allocation)
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+    {
+        if (riid != __uuidof(IUnknown))
+        {
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+        *object = this;
+        AddRef();
+        return S_OK;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return ++m_refCount;
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        const auto refCount = --m_refCount;
+        if (refCount == 0)
+        {
+            m_allocator.Free(m_pool, m_block, m_allocation);
+            delete this;
+        }
+        return refCount;
+    }
+
+private:
+    GpuAllocator& m_allocator;
+    Pool m_pool;
+    HeapBlock* m_block;
+    TlsfAllocation m_allocation;
+    ULONG m_refCount = 1;
+};
+
+GpuAllocator::GpuAllocator(const ComPtr<ID3D12Device>& device)
+    : m_device(device)
+{
+}
+
+GpuAllocator::~GpuAllocator()
+{
+    // Every placed resource has to be released before the device goes away
+    for (auto& blocks : m_pools)
+    {
+        for (auto& block : blocks)
+            assert(block->Allocator.IsEmpty());
+    }
+}
+
+ComPtr<ID3D12Resource> GpuAllocator::Create(const D3D12_RESOURCE_DESC& desc, Pool pool, D3D12_RESOURCE_STATES state)
+{
+    // The only state upload heap resources can be in
+    if (pool == Pool::UploadBuffers)
+        state = D3D12_RESOURCE_STATE_GENERIC_READ;
+
+    ComPtr<ID3D12Resource> resource;
+    const auto info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+
+    if (info.SizeInBytes > c_maxPlacedSize)
+    {
+        D3D12_HEAP_PROPERTIES heapProps = {};
+        heapProps.Type = GetHeapType(pool);
+        heapProps.CreationNodeMask = 0b1;
+        heapProps.VisibleNodeMask = 0b1;
+        m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc, state, nullptr, IID_PPV_ARGS(&resource));
+        ++m_committedCount;
+        return resource;
+    }
+
+    auto& blocks = m_pools[(size_t)pool];
+    HeapBlock* block = nullptr;
+    TlsfAllocation allocation = {TlsfAllocator::c_invalidOffset, 0};
+    for (auto& candidate : blocks)
+    {
+        allocation = candidate->Allocator.Allocate(info.SizeInBytes, info.Alignment);
+        if (allocation.Offset != TlsfAllocator::c_invalidOffset)
+        {
+            block = candidate.get();
+            break;
+        }
+    }
+
+    if (!block)
+    {
+        D3D12_HEAP_DESC heapDesc = {};
+        heapDesc.SizeInBytes = c_blockSize;
+        heapDesc.Properties.Type = GetHeapType(pool);
+        heapDesc.Properties.CreationNodeMask = 0b1;
+        heapDesc.Properties.VisibleNodeMask = 0b1;
+        heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Flags = GetHeapFlags(pool);
+
+        auto newBlock = std::make_unique<HeapBlock>(HeapBlock{nullptr, TlsfAllocator(c_blockSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)});
+        m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&newBlock->Heap));
+        block = newBlock.get();
+        blocks.push_back(std::move(newBlock));
+
+        allocation = block->Allocator.Allocate(info.SizeInBytes, info.Alignment);
+        assert(allocation.Offset != TlsfAllocator::c_invalidOffset);
+    }
+
+    m_device->CreatePlacedResource(block->Heap.Get(), allocation.Offset, &desc, state, nullptr, IID_PPV_ARGS(&resource));
+    assert(resource);
+
+    auto releaser = new Releaser(*this, pool, block, allocation);
+    resource->SetPrivateDataInterface(c_allocationGuid, releaser);
+    releaser->Release();
+    return resource;
+}
+
+TlsfStats GpuAllocator::GetStats() const
+{
+    TlsfStats ret;
+    for (auto& blocks : m_pools)
+    {
+        for (auto& block : blocks)
+        {
+            const auto stats = block->Allocator.GetStats();
+            ret.Capacity += stats.Capacity;
+            ret.UsedBytes += stats.UsedBytes;
+            ret.LargestFreeBlock = std::max(ret.LargestFreeBlock, stats.LargestFreeBlock);
+            ret.AllocationCount += stats.AllocationCount;
+            ret.FreeBlockCount += stats.FreeBlockCount;
+        }
+    }
+    return ret;
+}
+
+uint32_t GpuAllocator::GetBlockCount() const
+{
+    uint32_t count = 0;
+    for (auto& blocks : m_pools)
+        count += (uint32_t)blocks.size();
+    return count;
+}
+
+void GpuAllocator::Free(Pool pool, HeapBlock* block, const TlsfAllocation& allocation)
+{
+    block->Allocator.Free(allocation);
+
+    // Keep one block per pool around so a single resource coming and going does not recreate heaps
+    auto& blocks = m_pools[(size_t)pool];
+    if (block->Allocator.IsEmpty() && blocks.size() > 1)
+    {
+        blocks.erase(std::find_if(blocks.begin(), blocks.end(), [&](const auto& candidate) { return candidate.get() == block; }));
+    }
+}
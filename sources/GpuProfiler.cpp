@@ -0,0 +1,115 @@
+#include "GpuProfiler.h"
+#include "Device.h"
+
+GpuProfiler::GpuProfiler(Device& device, Profiler& profiler, uint32_t framesInFlight)
+    : m_device(device)
+    , m_profiler(profiler)
+    , m_contexts(framesInFlight)
+{
+    ID3D12Device* d3dDevice = device;
+    ID3D12CommandQueue* queue = device;
+
+    D3D12_QUERY_HEAP_DESC heapDesc = {};
+    heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    heapDesc.Count = framesInFlight * c_maxScopes * 2;
+    d3dDevice->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&m_queryHeap));
+    assert(m_queryHeap);
+
+    D3D12_HEAP_PROPERTIES heapProperties = {};
+    heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+    D3D12_RESOURCE_DESC bufferDesc = {};
+    bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    bufferDesc.Width = heapDesc.Count * sizeof(uint64_t);
+    bufferDesc.Height = 1;
+    bufferDesc.DepthOrArraySize = 1;
+    bufferDesc.MipLevels = 1;
+    bufferDesc.SampleDesc = {1, 0};
+    bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    d3dDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readback));
+    assert(m_readback);
+
+    queue->GetTimestampFrequency(&m_frequency);
+}
+
+void GpuProfiler::BeginFrame(uint32_t context)
+{
+    assert(context < m_contexts.size() && m_openScopes.empty());
+    ReadBack(context);
+    m_current = context;
+    auto& current = m_contexts[context];
+    current.Scopes.clear();
+    current.Frame = m_profiler.GetFrame();
+    current.Resolved = false;
+}
+
+void GpuProfiler::Begin(const ComPtr<ID3D12GraphicsCommandList>& commandList, const char* name)
+{
+    auto& current = m_contexts[m_current];
+    // Scopes past the limit are still paired up, they just record nothing
+    m_openScopes.push_back((uint32_t)current.Scopes.size());
+    if (current.Scopes.size() >= c_maxScopes)
+        return;
+    commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, (m_current * c_maxScopes + (uint32_t)current.Scopes.size()) * 2);
+    current.Scopes.push_back({name, (uint32_t)m_openScopes.size() - 1});
+}
+
+void GpuProfiler::End(const ComPtr<ID3D12GraphicsCommandList>& commandList)
+{
+    assert(!m_openScopes.empty());
+    const auto scope = m_openScopes.back();
+    m_openScopes.pop_back();
+    if (scope >= c_maxScopes)
+        return;
+    commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, (m_current * c_maxScopes + scope) * 2 + 1);
+}
+
+void GpuProfiler::EndFrame(const ComPtr<ID3D12GraphicsCommandList>& commandList)
+{
+    assert(m_openScopes.empty());
+    auto& current = m_contexts[m_current];
+    if (current.Scopes.empty())
+        return;
+    const auto first = m_current * c_maxScopes * 2;
+    commandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, (uint32_t)current.Scopes.size() * 2, m_readback.Get(), first * sizeof(uint64_t));
+    current.Resolved = true;
+}
+
+void GpuProfiler::ReadBack(uint32_t context)
+{
+    auto& previous = m_contexts[context];
+    if (!previous.Resolved || previous.Scopes.empty())
+        return;
+
+    const auto first = context * c_maxScopes * 2;
+    const D3D12_RANGE range = {first * sizeof(uint64_t), (first + previous.Scopes.size() * 2) * sizeof(uint64_t)};
+    uint64_t* timestamps = nullptr;
+    if (FAILED(m_readback->Map(0, &range, (void**)&timestamps)))
+        return;
+
+    // Pairs up a GPU and a QPC timestamp, the QPC one is moved onto the profiler clock by reading both clocks now
+    uint64_t gpuCalibration = 0;
+    uint64_t cpuCalibration = 0;
+    static_cast<ID3D12CommandQueue*>(m_device)->GetClockCalibration(&gpuCalibration, &cpuCalibration);
+    LARGE_INTEGER qpcNow;
+    LARGE_INTEGER qpcFrequency;
+    QueryPerformanceCounter(&qpcNow);
+    QueryPerformanceFrequency(&qpcFrequency);
+    const auto profilerNow = (double)m_profiler.Now();
+    const auto calibration = profilerNow - (double)(qpcNow.QuadPart - (int64_t)cpuCalibration) * 1e9 / qpcFrequency.QuadPart;
+    const auto toProfiler = [&](uint64_t timestamp)
+    {
+        return (uint64_t)std::max(0.0, calibration + ((double)timestamp - (double)gpuCalibration) * 1e9 / m_frequency);
+    };
+
+    for (auto i = 0u; i < previous.Scopes.size(); ++i)
+    {
+        const auto& scope = previous.Scopes[i];
+        const auto begin = timestamps[first + i * 2];
+        const auto end = timestamps[first + i * 2 + 1];
+        m_profiler.AddGpuSample(scope.Name, previous.Frame, toProfiler(begin), toProfiler(std::max(begin, end)), scope.Depth);
+    }
+
+    const D3D12_RANGE written = {0, 0};
+    m_readback->Unmap(0, &written);
+    previous.Resolved = false;
+}
@@ -0,0 +1,207 @@
+#include "HeadlessRenderer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+HeadlessRenderer::HeadlessRenderer(FrameDevice& device, uint32_t width, uint32_t height, const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount, uint32_t framesInFlight, uint32_t gatherDownscale, CascadeFormat cascadeFormat, const CascadeTopology& cascadeTopology, uint32_t threadCount)
+    : m_device(device)
+    , m_cascades(resolution, extends, offset, cascadeCount, cascadeFormat, cascadeTopology)
+    , m_invalidation(resolution, extends, offset, cascadeCount, cascadeTopology)
+    , m_scheduler(resolution, cascadeCount, cascadeTopology)
+    , m_framePacer(framesInFlight)
+    , m_cascadeStates(cascadeCount, GraphState::AllShaderResource)
+    , m_hitStates(cascadeCount, GraphState::AllShaderResource)
+    , m_irradianceState(GraphState::AllShaderResource)
+    , m_gatherDownscale(gatherDownscale)
+    , m_threadCount(threadCount)
+{
+    // The cascades hold nothing yet, the first frame traces them whole whatever the schedule
+    m_scheduler.Invalidate();
+
+    m_gbuffer.Width = width;
+    m_gbuffer.Height = height;
+    m_gbuffer.Positions.resize(width * height);
+    m_gbuffer.Normals.resize(width * height);
+    m_gbuffer.Depths.resize(width * height);
+    m_gbuffer.Albedo.resize(width * height);
+    m_gbuffer.Emission.resize(width * height);
+    m_color.resize(width * height);
+    if (m_gatherDownscale > 0)
+        m_gathered.resize(GetGatherSize(width, m_gatherDownscale) * GetGatherSize(height, m_gatherDownscale));
+}
+
+void HeadlessRenderer::Render(const CpuScene& scene, const std::vector<Aabb>& changedBounds, const GBuffer& gbuffer)
+{
+    assert(gbuffer.Width == m_gbuffer.Width && gbuffer.Height == m_gbuffer.Height);
+    if (m_profiler)
+        m_profiler->BeginFrame();
+    ProfileScope frameScope(m_profiler, "Frame");
+
+    {
+        // Blocks only when the CPU is a full set of frame contexts ahead of the device
+        ProfileScope waitScope(m_profiler, "Frame pacing");
+        const auto waitSubmission = m_framePacer.Begin(m_device.GetCompletedSubmission());
+        if (waitSubmission != 0)
+            m_device.WaitForSubmission(waitSubmission);
+    }
+
+    for (const auto& bounds : changedBounds)
+        m_invalidation.Invalidate(bounds);
+
+    RenderGraph graph;
+    const auto target = graph.Import(&m_color, GraphState::Present, GraphState::Present);
+    const auto clearPass = graph.AddPass("Clear", [this]()
+    {
+        std::fill(m_color.begin(), m_color.end(), Float3{0.f, 0.f, 0.f});
+    });
+    graph.Use(clearPass, target, GraphState::RenderTarget);
+
+    // Natives are the containers, reassigned by some passes, standing in for the resources of RadianceCascades
+    const auto count = m_cascades.GetCount();
+    std::vector<uint32_t> cascades(count);
+    std::vector<uint32_t> hits(count);
+    for (auto i = 0u; i < count; ++i)
+    {
+        cascades[i] = graph.Import((void*)&m_cascades.GetCascade(i), m_cascadeStates[i]);
+        hits[i] = graph.Import((void*)&m_cascades.GetHits(i), m_hitStates[i]);
+    }
+
+    const auto& updates = m_scheduler.Advance();
+    std::vector<uint32_t> listedProbes;
+    for (auto i = 0u; i < count; ++i)
+    {
+        auto slices = updates[i];
+        m_invalidation.SplitTracing(i, slices, listedProbes);
+
+        if (!slices.IsEmpty())
+        {
+            const auto pass = graph.AddPass("Cascade tracing", [&, i, slices]()
+            {
+                m_cascades.Trace(scene, i, slices, m_threadCount);
+            });
+            graph.Use(pass, hits[i], GraphState::UnorderedAccess);
+        }
+
+        if (!listedProbes.empty())
+        {
+            const auto pass = graph.AddPass("Cascade tracing", [&, i, listedProbes]()
+            {
+                m_cascades.TraceProbes(scene, i, listedProbes, m_threadCount);
+            });
+            graph.Use(pass, hits[i], GraphState::UnorderedAccess);
+        }
+    }
+    m_invalidation.Clear();
+
+    // Hits of levels and probes not traced this frame are still valid, every level is resolved again
+    for (int i = count - 1; i >= 0; --i)
+    {
+        const auto pass = graph.AddPass("Cascade merging", [&, i]()
+        {
+            m_cascades.Merge(scene, i, m_threadCount);
+        });
+        if (i + 1 < (int)count)
+            graph.Use(pass, cascades[i + 1], GraphState::NonPixelShaderResource);
+        graph.Use(pass, hits[i], GraphState::NonPixelShaderResource);
+        graph.Use(pass, cascades[i], GraphState::UnorderedAccess);
+    }
+
+    const auto irradiance = graph.Import((void*)&m_cascades.GetIrradiance(), m_irradianceState);
+    const auto irradiancePass = graph.AddPass("Cascade irradiance", [this]()
+    {
+        m_cascades.ProjectIrradiance(m_threadCount);
+    });
+    graph.Use(irradiancePass, cascades[0], GraphState::NonPixelShaderResource);
+    graph.Use(irradiancePass, irradiance, GraphState::UnorderedAccess);
+
+    // Stands in for drawing the scene, the caller's G-buffer is copied in like a readback of the GPU one
+    const std::pair<void*, const void*> gbufferCopies[] = {
+        {m_gbuffer.Positions.data(), gbuffer.Positions.data()},
+        {m_gbuffer.Normals.data(), gbuffer.Normals.data()},
+        {m_gbuffer.Depths.data(), gbuffer.Depths.data()},
+        {m_gbuffer.Albedo.data(), gbuffer.Albedo.data()},
+        {m_gbuffer.Emission.data(), gbuffer.Emission.data()}};
+    const uint64_t gbufferSizes[] = {sizeof(Float3), sizeof(Float3), sizeof(float), sizeof(Float3), sizeof(Float3)};
+    const auto gbufferPass = graph.AddPass("G-buffer", [&]()
+    {
+        for (auto i = 0u; i < std::size(gbufferCopies); ++i)
+            m_device.CopyBuffer(gbufferCopies[i].first, 0, (void*)gbufferCopies[i].second, 0, gbufferSizes[i] * gbuffer.Width * gbuffer.Height);
+    });
+    std::vector<uint32_t> gbufferResources;
+    for (const auto& copy : gbufferCopies)
+    {
+        gbufferResources.push_back(graph.Import(copy.first, GraphState::PixelShaderResource, GraphState::PixelShaderResource));
+        graph.Use(gbufferPass, gbufferResources.back(), GraphState::CopyDest);
+    }
+
+    const auto gather = [this](const Float3& position, const Float3& normal)
+    {
+        return m_cascades.SampleIrradiance(position, normal);
+    };
+    m_deferredStats = {};
+    if (m_gatherDownscale > 0)
+    {
+        const auto gathered = graph.Import(&m_gathered, GraphState::PixelShaderResource, GraphState::PixelShaderResource);
+        const auto gatherPass = graph.AddPass("Deferred gather", [this, gather]()
+        {
+            m_gathered = GatherIrradiance(m_gbuffer, m_gatherDownscale, gather, m_deferredStats);
+        });
+        for (const auto resource : gbufferResources)
+            graph.Use(gatherPass, resource, GraphState::NonPixelShaderResource);
+        graph.Use(gatherPass, irradiance, GraphState::NonPixelShaderResource);
+        graph.Use(gatherPass, gathered, GraphState::UnorderedAccess);
+
+        const auto compositePass = graph.AddPass("Deferred composite", [this, gather]()
+        {
+            m_color = Composite(m_gbuffer, UpsampleIrradiance(m_gbuffer, m_gatherDownscale, m_gathered, gather, true, m_deferredStats));
+        });
+        graph.Use(compositePass, target, GraphState::RenderTarget);
+        for (const auto resource : gbufferResources)
+            graph.Use(compositePass, resource, GraphState::PixelShaderResource);
+        graph.Use(compositePass, gathered, GraphState::PixelShaderResource);
+        graph.Use(compositePass, irradiance, GraphState::PixelShaderResource);
+    }
+    else
+    {
+        // Every pixel gathers on its own
+        const auto drawPass = graph.AddPass("Draw", [this, gather]()
+        {
+            m_color = Composite(m_gbuffer, GatherIrradiance(m_gbuffer, 1, gather, m_deferredStats));
+        });
+        graph.Use(drawPass, target, GraphState::RenderTarget);
+        for (const auto resource : gbufferResources)
+            graph.Use(drawPass, resource, GraphState::PixelShaderResource);
+        graph.Use(drawPass, irradiance, GraphState::PixelShaderResource);
+    }
+
+    graph.Compile();
+    {
+        // Every pass is timed on the CPU running it
+        ProfileScope executeScope(m_profiler, "Graph execution");
+        m_passTimings.clear();
+        graph.Execute([&](const std::vector<GraphBarrier>& barriers)
+        {
+            m_device.RecordBarriers(graph, barriers);
+        }, [&](uint32_t pass, const RenderGraph::Execution& execution)
+        {
+            ProfileScope passScope(m_profiler, graph.GetPassName(pass));
+            const auto start = std::chrono::high_resolution_clock::now();
+            execution();
+            m_passTimings.push_back({graph.GetPassName(pass), std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count()});
+        });
+    }
+    m_barrierCount = graph.GetBarrierCount();
+
+    for (auto i = 0u; i < count; ++i)
+    {
+        m_cascadeStates[i] = graph.GetFinalState(cascades[i]);
+        m_hitStates[i] = graph.GetFinalState(hits[i]);
+    }
+    m_irradianceState = graph.GetFinalState(irradiance);
+
+    ProfileScope submitScope(m_profiler, "Submit");
+    const auto submission = m_device.Submit();
+    m_framePacer.End(submission);
+}
@@ -0,0 +1,146 @@
+#include "MeshCache.h"
+#include "Hash.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint32_t c_meshCacheMagic = 0x434D4352; // "RCMC"
+    constexpr uint32_t c_meshCacheVersion = 2;
+    constexpr uint64_t c_meshCacheAlignment = 16;
+
+    struct MeshCacheHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t SourceHash;
+        uint64_t SourceSize;
+        uint32_t VertexCount;
+        uint32_t IndexCount;
+        uint64_t PositionsOffset;
+        uint64_t NormalsOffset;
+        uint64_t IndicesOffset;
+        uint64_t FileSize;
+        uint32_t SourceVertexCount;
+        float SourceAcmr;
+        float Acmr;
+        uint32_t Reserved;
+    };
+    static_assert(sizeof(MeshCacheHeader) == 80, "Mesh cache header layout changed, bump c_meshCacheVersion");
+
+    uint64_t AlignUp(uint64_t value)
+    {
+        return (value + c_meshCacheAlignment - 1) / c_meshCacheAlignment * c_meshCacheAlignment;
+    }
+}
+
+MeshCache::MeshCache(const std::string& filepath)
+{
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    {
+        const MappedFile source(filepath);
+        if (!source.IsOpen())
+            throw std::runtime_error("Failed to load model!");
+        sourceHash = HashBytes(source.GetData(), source.GetSize());
+        sourceSize = source.GetSize();
+    }
+
+    const auto cachePath = GetCachePath(filepath);
+    if (Map(cachePath, sourceHash, sourceSize))
+        return;
+
+    m_rebuilt = true;
+    auto mesh = LoadMeshData(filepath);
+    m_stats = OptimizeMesh(mesh);
+    if (Write(cachePath, mesh, m_stats, sourceHash, sourceSize) && Map(cachePath, sourceHash, sourceSize))
+        return;
+
+    m_fallback = std::move(mesh);
+    m_view.Positions = m_fallback.Positions.data();
+    m_view.Normals = m_fallback.Normals.data();
+    m_view.Indices = m_fallback.Indices.data();
+    m_view.VertexCount = m_fallback.GetVertexCount();
+    m_view.IndexCount = m_fallback.GetIndexCount();
+}
+
+std::string MeshCache::GetCachePath(const std::string& filepath)
+{
+    return filepath + ".meshcache";
+}
+
+bool MeshCache::Write(const std::string& cachePath, const MeshData& mesh, const MeshOptimizationStats& stats, uint64_t sourceHash, uint64_t sourceSize)
+{
+    MeshCacheHeader header = {};
+    header.Magic = c_meshCacheMagic;
+    header.Version = c_meshCacheVersion;
+    header.SourceHash = sourceHash;
+    header.SourceSize = sourceSize;
+    header.VertexCount = mesh.GetVertexCount();
+    header.IndexCount = mesh.GetIndexCount();
+    header.PositionsOffset = AlignUp(sizeof(MeshCacheHeader));
+    header.NormalsOffset = AlignUp(header.PositionsOffset + mesh.Positions.size() * sizeof(float));
+    header.IndicesOffset = AlignUp(header.NormalsOffset + mesh.Normals.size() * sizeof(float));
+    header.FileSize = header.IndicesOffset + mesh.Indices.size() * sizeof(uint32_t);
+    header.SourceVertexCount = stats.SourceVertexCount;
+    header.SourceAcmr = stats.SourceAcmr;
+    header.Acmr = stats.Acmr;
+
+    // Written under a temporary name and renamed so a crashed write never leaves a truncated cache behind
+    const auto tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        const char padding[c_meshCacheAlignment] = {};
+        const auto writeAt = [&](uint64_t offset, const void* data, uint64_t size)
+        {
+            file.write(padding, offset - (uint64_t)file.tellp());
+            file.write((const char*)data, size);
+        };
+        file.write((const char*)&header, sizeof(header));
+        writeAt(header.PositionsOffset, mesh.Positions.data(), mesh.Positions.size() * sizeof(float));
+        writeAt(header.NormalsOffset, mesh.Normals.data(), mesh.Normals.size() * sizeof(float));
+        writeAt(header.IndicesOffset, mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+        if (!file)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::Map(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize)
+{
+    MappedFile cache(cachePath);
+    if (cache.GetSize() < sizeof(MeshCacheHeader))
+        return false;
+
+    MeshCacheHeader header;
+    std::memcpy(&header, cache.GetData(), sizeof(header));
+    if (header.Magic != c_meshCacheMagic || header.Version != c_meshCacheVersion
+        || header.SourceHash != sourceHash || header.SourceSize != sourceSize
+        || header.FileSize != cache.GetSize()
+        || header.PositionsOffset + header.VertexCount * 3ull * sizeof(float) > header.NormalsOffset
+        || header.NormalsOffset + header.VertexCount * 3ull * sizeof(float) > header.IndicesOffset
+        || header.IndicesOffset + header.IndexCount * sizeof(uint32_t) > header.FileSize)
+        return false;
+
+    m_cache = std::move(cache);
+    m_view.Positions = (const float*)(m_cache.GetData() + header.PositionsOffset);
+    m_view.Normals = (const float*)(m_cache.GetData() + header.NormalsOffset);
+    m_view.Indices = (const uint32_t*)(m_cache.GetData() + header.IndicesOffset);
+    m_view.VertexCount = header.VertexCount;
+    m_view.IndexCount = header.IndexCount;
+    m_stats = {header.SourceVertexCount, header.VertexCount, header.SourceAcmr, header.Acmr};
+    return true;
+}
@@ -0,0 +1,41 @@
+#include "MeshData.h"
+
+#include <cassert>
+#include <stdexcept>
+
+#include <assimp/scene.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+
+MeshData LoadMeshData(const std::string& filepath)
+{
+    Assimp::Importer importer;
+    importer.ReadFile(filepath, aiProcess_Triangulate | aiProcess_GenNormals);
+    const auto scene = importer.GetScene();
+
+    if(!scene)
+        throw std::runtime_error("Failed to load model!");
+
+    MeshData ret;
+    uint32_t indexOffset = 0;
+    for(auto meshIndex = 0u; meshIndex < scene->mNumMeshes; ++meshIndex)
+    {
+        const auto& mesh = scene->mMeshes[meshIndex];
+        ret.Positions.insert(ret.Positions.end(), (float*)mesh->mVertices, (float*)(mesh->mVertices + mesh->mNumVertices));
+        ret.Normals.insert(ret.Normals.end(), (float*)mesh->mNormals, (float*)(mesh->mNormals + mesh->mNumVertices));
+
+        for(auto faceIndex = 0u; faceIndex < mesh->mNumFaces; ++faceIndex)
+        {
+            const auto& face = mesh->mFaces[faceIndex];
+            assert(face.mNumIndices == 3);
+
+            ret.Indices.push_back(face.mIndices[0] + indexOffset);
+            ret.Indices.push_back(face.mIndices[1] + indexOffset);
+            ret.Indices.push_back(face.mIndices[2] + indexOffset);
+        }
+
+        indexOffset = ret.GetVertexCount();
+    }
+
+    return ret;
+}
@@ -0,0 +1,351 @@
+#include "MeshOptimization.h"
+#include "CpuMath.h"
+#include "Hash.h"
+
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+    // Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+    constexpr uint32_t c_scoringCacheSize = 32;
+    constexpr float c_cacheDecayPower = 1.5f;
+    constexpr float c_lastTriangleScore = 0.75f;
+    constexpr float c_valenceBoostScale = 2.f;
+    constexpr float c_valenceBoostPower = 0.5f;
+
+    // Clusters may be split wherever their ACMR so far stays within this factor of the whole cluster
+    constexpr float c_overdrawThreshold = 1.05f;
+    constexpr uint32_t c_minClusterTriangles = 32;
+
+    struct VertexKey
+    {
+        uint32_t Bits[6];
+
+        bool operator==(const VertexKey& other) const { return std::memcmp(Bits, other.Bits, sizeof(Bits)) == 0; }
+    };
+
+    struct VertexKeyHash
+    {
+        size_t operator()(const VertexKey& key) const { return (size_t)HashValue(key); }
+    };
+
+    uint32_t ToBits(float value)
+    {
+        // -0 and +0 weld
+        if (value == 0.f)
+            value = 0.f;
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    Float3 GetVector(const std::vector<float>& data, uint32_t index)
+    {
+        return {data[index * 3], data[index * 3 + 1], data[index * 3 + 2]};
+    }
+
+    void RemapVertices(MeshData& mesh, const std::vector<uint32_t>& remap, uint32_t newVertexCount)
+    {
+        std::vector<float> positions(newVertexCount * 3ull);
+        std::vector<float> normals(newVertexCount * 3ull);
+        for (auto i = 0u; i < remap.size(); ++i)
+        {
+            if (remap[i] == ~0u)
+                continue;
+            std::memcpy(&positions[remap[i] * 3ull], &mesh.Positions[i * 3ull], 3 * sizeof(float));
+            std::memcpy(&normals[remap[i] * 3ull], &mesh.Normals[i * 3ull], 3 * sizeof(float));
+        }
+        mesh.Positions = std::move(positions);
+        mesh.Normals = std::move(normals);
+
+        for (auto& index : mesh.Indices)
+            index = remap[index];
+    }
+
+    void WeldVertices(MeshData& mesh)
+    {
+        const auto vertexCount = mesh.GetVertexCount();
+        std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
+        unique.reserve(vertexCount);
+
+        std::vector<uint32_t> remap(vertexCount);
+        for (auto i = 0u; i < vertexCount; ++i)
+        {
+            VertexKey key;
+            for (auto c = 0u; c < 3; ++c)
+            {
+                key.Bits[c] = ToBits(mesh.Positions[i * 3ull + c]);
+                key.Bits[c + 3] = ToBits(mesh.Normals[i * 3ull + c]);
+            }
+            remap[i] = unique.emplace(key, (uint32_t)unique.size()).first->second;
+        }
+
+        RemapVertices(mesh, remap, (uint32_t)unique.size());
+    }
+
+    float VertexScore(int cachePosition, uint32_t remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.f;
+
+        float score = 0.f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = c_lastTriangleScore;
+            else
+                score = std::pow(1.f - (cachePosition - 3) / (float)(c_scoringCacheSize - 3), c_cacheDecayPower);
+        }
+        return score + c_valenceBoostScale * std::pow((float)remainingTriangles, -c_valenceBoostPower);
+    }
+
+    std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount)
+    {
+        const auto triangleCount = (uint32_t)indices.size() / 3;
+
+        // Triangles adjacent to each vertex, the first Remaining entries are the ones not emitted yet
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (const auto index : indices)
+            ++adjacencyOffsets[index + 1];
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        for (auto i = 0u; i < indices.size(); ++i)
+        {
+            const auto vertex = indices[i];
+            adjacency[adjacencyOffsets[vertex] + remaining[vertex]++] = i / 3;
+        }
+
+        std::vector<int> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (auto i = 0u; i < vertexCount; ++i)
+            vertexScores[i] = VertexScore(-1, remaining[i]);
+
+        std::vector<float> triangleScores(triangleCount);
+        for (auto i = 0u; i < triangleCount; ++i)
+            triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+        std::vector<bool> emitted(triangleCount, false);
+
+        std::vector<uint32_t> ret;
+        ret.reserve(indices.size());
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        uint32_t scanCursor = 0;
+        uint32_t bestTriangle = ~0u;
+
+        for (auto emittedCount = 0u; emittedCount < triangleCount; ++emittedCount)
+        {
+            if (bestTriangle == ~0u)
+            {
+                // Nothing adjacent to the cache left, restart at the next triangle in input order
+                while (emitted[scanCursor])
+                    ++scanCursor;
+                bestTriangle = scanCursor;
+            }
+
+            const auto triangle = bestTriangle;
+            emitted[triangle] = true;
+            nextCache.clear();
+            for (auto corner = 0u; corner < 3; ++corner)
+            {
+                const auto vertex = indices[triangle * 3 + corner];
+                ret.push_back(vertex);
+                if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end())
+                    nextCache.push_back(vertex);
+
+                const auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+                const auto end = begin + remaining[vertex];
+                std::iter_swap(std::find(begin, end, triangle), end - 1);
+                --remaining[vertex];
+            }
+            const auto triangleVertices = nextCache.size();
+            for (const auto vertex : cache)
+            {
+                if (std::find(nextCache.begin(), nextCache.begin() + triangleVertices, vertex) == nextCache.begin() + triangleVertices)
+                    nextCache.push_back(vertex);
+            }
+            std::swap(cache, nextCache);
+
+            for (auto i = 0u; i < cache.size(); ++i)
+            {
+                const auto vertex = cache[i];
+                cachePositions[vertex] = i < c_scoringCacheSize ? (int)i : -1;
+                const auto score = VertexScore(cachePositions[vertex], remaining[vertex]);
+                const auto delta = score - vertexScores[vertex];
+                vertexScores[vertex] = score;
+                for (auto a = 0u; a < remaining[vertex]; ++a)
+                    triangleScores[adjacency[adjacencyOffsets[vertex] + a]] += delta;
+            }
+            if (cache.size() > c_scoringCacheSize)
+                cache.resize(c_scoringCacheSize);
+
+            bestTriangle = ~0u;
+            float bestScore = -INFINITY;
+            for (const auto vertex : cache)
+            {
+                for (auto a = 0u; a < remaining[vertex]; ++a)
+                {
+                    const auto candidate = adjacency[adjacencyOffsets[vertex] + a];
+                    if (triangleScores[candidate] > bestScore)
+                    {
+                        bestScore = triangleScores[candidate];
+                        bestTriangle = candidate;
+                    }
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    // Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw": the cache-ordered
+    // triangles are cut into clusters and the clusters sorted so outward facing ones on the convex side come first
+    std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<float>& positions, uint32_t vertexCount)
+    {
+        const auto triangleCount = (uint32_t)indices.size() / 3;
+        if (triangleCount == 0)
+            return indices;
+
+        std::vector<uint32_t> misses(triangleCount);
+        {
+            std::vector<uint32_t> cacheTime(vertexCount, 0);
+            uint32_t time = c_acmrCacheSize + 1;
+            for (auto i = 0u; i < triangleCount; ++i)
+            {
+                misses[i] = 0;
+                for (auto corner = 0u; corner < 3; ++corner)
+                {
+                    const auto vertex = indices[i * 3 + corner];
+                    if (time - cacheTime[vertex] > c_acmrCacheSize)
+                    {
+                        cacheTime[vertex] = time++;
+                        ++misses[i];
+                    }
+                }
+            }
+        }
+
+        // Hard boundaries where the cache had to restart, soft ones inside where cutting does not hurt the cache much
+        std::vector<uint32_t> clusters;
+        for (auto begin = 0u; begin < triangleCount;)
+        {
+            auto end = begin + 1;
+            uint32_t clusterMisses = misses[begin];
+            while (end < triangleCount && misses[end] < 3)
+                clusterMisses += misses[end++];
+            const float clusterAcmr = (float)clusterMisses / (end - begin);
+
+            uint32_t subMisses = 0;
+            uint32_t subBegin = begin;
+            clusters.push_back(begin);
+            for (auto i = begin; i < end; ++i)
+            {
+                subMisses += misses[i];
+                const auto subCount = i + 1 - subBegin;
+                if (subCount >= c_minClusterTriangles && i + 1 < end && (float)subMisses / subCount <= clusterAcmr * c_overdrawThreshold)
+                {
+                    clusters.push_back(i + 1);
+                    subBegin = i + 1;
+                    subMisses = 0;
+                }
+            }
+            begin = end;
+        }
+        clusters.push_back(triangleCount);
+
+        Float3 meshCentroid = {0.f, 0.f, 0.f};
+        float meshArea = 0.f;
+        std::vector<Float3> clusterCentroids(clusters.size() - 1);
+        std::vector<Float3> clusterNormals(clusters.size() - 1);
+        for (auto c = 0u; c + 1 < clusters.size(); ++c)
+        {
+            Float3 centroid = {0.f, 0.f, 0.f};
+            Float3 normal = {0.f, 0.f, 0.f};
+            float area = 0.f;
+            for (auto i = clusters[c]; i < clusters[c + 1]; ++i)
+            {
+                const auto v0 = GetVector(positions, indices[i * 3]);
+                const auto v1 = GetVector(positions, indices[i * 3 + 1]);
+                const auto v2 = GetVector(positions, indices[i * 3 + 2]);
+                const auto n = Cross(v1 - v0, v2 - v0);
+                const float a = std::sqrt(Dot(n, n));
+                centroid = centroid + (v0 + v1 + v2) * (a / 3.f);
+                normal = normal + n;
+                area += a;
+            }
+            meshCentroid = meshCentroid + centroid;
+            meshArea += area;
+            clusterCentroids[c] = area > 0.f ? centroid * (1.f / area) : GetVector(positions, indices[clusters[c] * 3]);
+            const float length = std::sqrt(Dot(normal, normal));
+            clusterNormals[c] = length > 0.f ? normal * (1.f / length) : normal;
+        }
+        if (meshArea > 0.f)
+            meshCentroid = meshCentroid * (1.f / meshArea);
+
+        std::vector<float> sortKeys(clusters.size() - 1);
+        for (auto c = 0u; c < sortKeys.size(); ++c)
+            sortKeys[c] = Dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+
+        std::vector<uint32_t> order(sortKeys.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+        std::vector<uint32_t> ret;
+        ret.reserve(indices.size());
+        for (const auto c : order)
+            ret.insert(ret.end(), indices.begin() + clusters[c] * 3ull, indices.begin() + clusters[c + 1] * 3ull);
+        return ret;
+    }
+
+    void OptimizeVertexFetch(MeshData& mesh)
+    {
+        std::vector<uint32_t> remap(mesh.GetVertexCount(), ~0u);
+        uint32_t next = 0;
+        for (const auto index : mesh.Indices)
+        {
+            if (remap[index] == ~0u)
+                remap[index] = next++;
+        }
+        RemapVertices(mesh, remap, next);
+    }
+}
+
+MeshOptimizationStats OptimizeMesh(MeshData& mesh)
+{
+    MeshOptimizationStats ret;
+    ret.SourceVertexCount = mesh.GetVertexCount();
+    ret.SourceAcmr = ComputeAcmr(mesh.Indices.data(), mesh.GetIndexCount(), mesh.GetVertexCount());
+
+    if (mesh.Normals.size() != mesh.Positions.size())
+        mesh.Normals.resize(mesh.Positions.size(), 0.f);
+
+    WeldVertices(mesh);
+    mesh.Indices = OptimizeVertexCache(mesh.Indices, mesh.GetVertexCount());
+    mesh.Indices = OptimizeOverdraw(mesh.Indices, mesh.Positions, mesh.GetVertexCount());
+    OptimizeVertexFetch(mesh);
+
+    ret.VertexCount = mesh.GetVertexCount();
+    ret.Acmr = ComputeAcmr(mesh.Indices.data(), mesh.GetIndexCount(), mesh.GetVertexCount());
+    return ret;
+}
+
+float ComputeAcmr(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+    if (indexCount < 3)
+        return 0.f;
+
+    // FIFO cache, a vertex is still cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> loadTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    uint32_t misses = 0;
+    for (auto i = 0u; i < indexCount; ++i)
+    {
+        if (time - loadTime[indices[i]] > cacheSize)
+        {
+            loadTime[indices[i]] = time++;
+            ++misses;
+        }
+    }
+    return (float)misses / (indexCount / 3);
+}
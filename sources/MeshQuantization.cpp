@@ -0,0 +1,116 @@
+#include "MeshQuantization.h"
+
+namespace
+{
+    template<typename T>
+    void Append(std::vector<uint8_t>& data, const T& value)
+    {
+        const auto offset = data.size();
+        data.resize(offset + sizeof(T));
+        std::memcpy(data.data() + offset, &value, sizeof(T));
+    }
+}
+
+void EncodeOctahedral(const Float3& n, float& u, float& v)
+{
+    const float invL1 = 1.f / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    u = n.x * invL1;
+    v = n.y * invL1;
+    if (n.z < 0.f)
+    {
+        const float x = u;
+        u = (1.f - std::abs(v)) * (x >= 0.f ? 1.f : -1.f);
+        v = (1.f - std::abs(x)) * (v >= 0.f ? 1.f : -1.f);
+    }
+}
+
+Float3 DecodeOctahedral(float u, float v)
+{
+    Float3 n = {u, v, 1.f - std::abs(u) - std::abs(v)};
+    const float t = std::clamp(-n.z, 0.f, 1.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return n * (1.f / std::sqrt(Dot(n, n)));
+}
+
+PackedMesh PackMesh(const MeshView& mesh, const MeshLayout& layout)
+{
+    PackedMesh ret;
+    ret.PositionEncoding = layout.Positions;
+    ret.OctahedralNormals = layout.OctahedralNormals;
+    ret.VertexCount = mesh.VertexCount;
+    ret.IndexCount = mesh.IndexCount;
+
+    const auto positions = reinterpret_cast<const Float3*>(mesh.Positions);
+    const auto normals = reinterpret_cast<const Float3*>(mesh.Normals);
+
+    Float3 boundsMin = {INFINITY, INFINITY, INFINITY};
+    Float3 boundsMax = {-INFINITY, -INFINITY, -INFINITY};
+    for (auto i = 0u; i < mesh.VertexCount; ++i)
+    {
+        boundsMin = Min(boundsMin, positions[i]);
+        boundsMax = Max(boundsMax, positions[i]);
+    }
+
+    if (layout.Positions == PositionFormat::Snorm16 && mesh.VertexCount > 0)
+    {
+        ret.PositionBias = (boundsMin + boundsMax) * 0.5f;
+        ret.PositionScale = (boundsMax - boundsMin) * 0.5f;
+        for (auto i = 0u; i < 3; ++i)
+        {
+            if (ret.PositionScale[i] <= 0.f)
+                ret.PositionScale[i] = 1.f;
+        }
+    }
+
+    ret.PositionStride = layout.Positions == PositionFormat::Float32 ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+    ret.Positions.reserve((uint64_t)mesh.VertexCount * ret.PositionStride);
+    for (auto i = 0u; i < mesh.VertexCount; ++i)
+    {
+        const auto& p = positions[i];
+        if (layout.Positions == PositionFormat::Float32)
+        {
+            Append(ret.Positions, p);
+        }
+        else if (layout.Positions == PositionFormat::Float16)
+        {
+            const uint16_t packed[4] = {FloatToHalf(p.x), FloatToHalf(p.y), FloatToHalf(p.z), 0};
+            Append(ret.Positions, packed);
+        }
+        else
+        {
+            const auto n = (p - ret.PositionBias) / ret.PositionScale;
+            const int16_t packed[4] = {ToSnorm16(n.x), ToSnorm16(n.y), ToSnorm16(n.z), 0};
+            Append(ret.Positions, packed);
+        }
+    }
+
+    ret.NormalStride = layout.OctahedralNormals ? 2 * sizeof(int16_t) : 3 * sizeof(float);
+    ret.Normals.reserve((uint64_t)mesh.VertexCount * ret.NormalStride);
+    for (auto i = 0u; i < mesh.VertexCount; ++i)
+    {
+        if (layout.OctahedralNormals)
+        {
+            float u, v;
+            EncodeOctahedral(normals[i], u, v);
+            const int16_t packed[2] = {ToSnorm16(u), ToSnorm16(v)};
+            Append(ret.Normals, packed);
+        }
+        else
+        {
+            Append(ret.Normals, normals[i]);
+        }
+    }
+
+    ret.IndexSize = layout.CompactIndices && mesh.VertexCount <= 0x10000 ? sizeof(uint16_t) : sizeof(uint32_t);
+    ret.Indices.reserve((uint64_t)mesh.IndexCount * ret.IndexSize);
+    for (auto i = 0u; i < mesh.IndexCount; ++i)
+    {
+        if (ret.IndexSize == sizeof(uint16_t))
+            Append(ret.Indices, (uint16_t)mesh.Indices[i]);
+        else
+            Append(ret.Indices, mesh.Indices[i]);
+    }
+
+    return ret;
+}
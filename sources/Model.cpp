@@ -1,53 +1,52 @@
 #include "Model.h"
+#include "CascadeBricks.h"
+#include "MeshCache.h"
 
-#include <assimp/scene.h>
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-
-Model::Model(const std::string& filepath, Device& device)
+Model::Model(const std::string& filepath, UploadContext& uploads, const MeshLayout& layout)
 {
-    Assimp::Importer importer;
-    importer.ReadFile(filepath, aiProcess_Triangulate | aiProcess_GenNormals);
-    const auto scene = importer.GetScene();
-
-    if(!scene)
-        throw std::exception("Failed to load model!");
-
-    std::vector<float> vertices;
-    std::vector<float> normals;
-    std::vector<uint32_t> indices;
-    uint32_t indexOffset = 0;
-    for(auto meshIndex = 0u; meshIndex < scene->mNumMeshes; ++meshIndex)
+    const MeshCache mesh(filepath);
+    const auto& view = mesh.GetView();
+    m_vertexCount = view.VertexCount;
+    m_indexCount = view.IndexCount;
+    for (auto i = 0u; i < view.VertexCount; ++i)
     {
-        const auto& mesh = scene->mMeshes[meshIndex];
-        vertices.insert(vertices.end(), (float*)mesh->mVertices, (float*)(mesh->mVertices + mesh->mNumVertices));
-        normals.insert(normals.end(), (float*)mesh->mNormals, (float*)(mesh->mNormals + mesh->mNumVertices));
-
-        for(auto faceIndex = 0u; faceIndex < mesh->mNumFaces; ++faceIndex)
-        {
-            const auto& face = mesh->mFaces[faceIndex];
-            assert(face.mNumIndices == 3);
-
-            indices.push_back(face.mIndices[0] + indexOffset);
-            indices.push_back(face.mIndices[1] + indexOffset);
-            indices.push_back(face.mIndices[2] + indexOffset);
-        }
+        const Float3 position = {view.Positions[i * 3], view.Positions[i * 3 + 1], view.Positions[i * 3 + 2]};
+        m_bounds = Union(m_bounds, {position, position});
+    }
+    m_occupancy = CascadeBricks::BuildOccupancy(view.Positions, view.VertexCount, view.Indices, view.IndexCount);
 
-        indexOffset = (uint32_t)vertices.size() / 3;
+    if (!layout.IsPacked())
+    {
+        m_vertexBuffer = uploads.CreateVertexBuffer(view.Positions, view.VertexCount * 3ull * sizeof(float), 3 * sizeof(float));
+        m_normalBuffer = uploads.CreateVertexBuffer(view.Normals, view.VertexCount * 3ull * sizeof(float), 3 * sizeof(float));
+        m_indexBuffer = uploads.CreateIndexBuffer(view.Indices, view.IndexCount * sizeof(uint32_t));
+        m_blas = uploads.CreateBottomLevelAccelerationStructure(m_vertexBuffer, m_indexBuffer, m_vertexCount, m_indexCount);
+        return;
     }
 
-    m_vertexBuffer = device.CreateVertexBuffer(vertices);
-    m_normalBuffer = device.CreateVertexBuffer(normals);
-    m_indexBuffer = device.CreateIndexBuffer(indices);
-    m_vertexCount = (uint32_t)vertices.size() / 3;
-    m_indexCount = (uint32_t)indices.size();
+    const auto packed = PackMesh(view, layout);
+    m_vertexBuffer = uploads.CreateVertexBuffer(packed.Positions.data(), packed.Positions.size(), packed.PositionStride, GetPositionFormat(layout));
+    m_normalBuffer = uploads.CreateVertexBuffer(packed.Normals.data(), packed.Normals.size(), packed.NormalStride, GetNormalFormat(layout));
+    m_indexBuffer = uploads.CreateIndexBuffer(packed.Indices.data(), packed.Indices.size(), packed.IndexSize == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT);
+    m_constants.PositionScale = packed.PositionScale;
+    m_constants.PositionBias = packed.PositionBias;
+    m_constants.OctahedralNormals = packed.OctahedralNormals ? 1 : 0;
 
-    m_blas = device.CreateBottomLevelAccelerationStructure(m_vertexBuffer, m_indexBuffer, m_vertexCount, m_indexCount);
+    // The BLAS is built in the model's own space, so normalized positions are expanded by the build
+    const float transform[12] = {
+        packed.PositionScale.x, 0.f, 0.f, packed.PositionBias.x,
+        0.f, packed.PositionScale.y, 0.f, packed.PositionBias.y,
+        0.f, 0.f, packed.PositionScale.z, packed.PositionBias.z
+    };
+    const bool needsTransform = layout.Positions == PositionFormat::Snorm16;
+    m_blas = uploads.CreateBottomLevelAccelerationStructure(m_vertexBuffer, m_indexBuffer, m_vertexCount, m_indexCount, needsTransform ? transform : nullptr);
 }
 
 void Model::Draw(const ComPtr<ID3D12GraphicsCommandList>& commandList, uint32_t instanceId) const
 {
-    commandList->SetGraphicsRoot32BitConstant(2, instanceId, 0);
+    auto constants = m_constants;
+    constants.InstanceId = instanceId;
+    commandList->SetGraphicsRoot32BitConstants(2, sizeof(constants) / sizeof(uint32_t), &constants, 0);
     std::array vertexBufferViews = {m_vertexBuffer.View, m_normalBuffer.View};
     commandList->IASetVertexBuffers(0, (UINT)vertexBufferViews.size(), vertexBufferViews.data());
     commandList->IASetIndexBuffer(&m_indexBuffer.View);
@@ -60,4 +59,22 @@ void Model::DrawInstanced(const ComPtr<ID3D12GraphicsCommandList>& commandList,
     commandList->IASetVertexBuffers(0, (UINT)vertexBufferViews.size(), vertexBufferViews.data());
     commandList->IASetIndexBuffer(&m_indexBuffer.View);
     commandList->DrawIndexedInstanced(m_indexCount, instanceCount, 0, 0, 0);
-}
\ No newline at end of file
+}
+
+DXGI_FORMAT Model::GetPositionFormat(const MeshLayout& layout)
+{
+    switch (layout.Positions)
+    {
+    case PositionFormat::Float16:
+        return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case PositionFormat::Snorm16:
+        return DXGI_FORMAT_R16G16B16A16_SNORM;
+    default:
+        return DXGI_FORMAT_R32G32B32_FLOAT;
+    }
+}
+
+DXGI_FORMAT Model::GetNormalFormat(const MeshLayout& layout)
+{
+    return layout.OctahedralNormals ? DXGI_FORMAT_R16G16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+}
@@ -0,0 +1,55 @@
+#include "NullDevice.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+NullDevice::NullDevice(uint32_t latency)
+    : m_latency(latency)
+{
+}
+
+void NullDevice::RecordBarriers(const RenderGraph& graph, const std::vector<GraphBarrier>& barriers)
+{
+    ++m_stats.Batches;
+    for (const auto& barrier : barriers)
+    {
+        if (barrier.Kind == GraphBarrier::Type::Uav)
+            ++m_stats.UavBarriers;
+        else
+            ++m_stats.Transitions;
+        if (barrier.Phase == GraphBarrier::Split::Begin)
+            ++m_stats.SplitBegins;
+        else if (barrier.Phase == GraphBarrier::Split::End)
+            ++m_stats.SplitEnds;
+        m_recordedBarriers.push_back({graph.GetNative(barrier.Resource), barrier});
+    }
+}
+
+void NullDevice::CopyBuffer(void* dest, uint64_t destOffset, void* source, uint64_t sourceOffset, uint64_t size)
+{
+    assert(dest && source);
+    ++m_stats.Copies;
+    m_stats.CopiedBytes += size;
+    memmove((uint8_t*)dest + destOffset, (const uint8_t*)source + sourceOffset, size);
+}
+
+uint64_t NullDevice::Submit()
+{
+    ++m_stats.Submissions;
+    m_submittedBarriers.swap(m_recordedBarriers);
+    m_recordedBarriers.clear();
+
+    ++m_submission;
+    m_completed = std::max(m_completed, m_submission > m_latency ? m_submission - m_latency : 0);
+    return m_submission;
+}
+
+void NullDevice::WaitForSubmission(uint64_t submission)
+{
+    assert(submission <= m_submission);
+    if (m_completed >= submission)
+        return;
+    ++m_stats.Waits;
+    m_completed = submission;
+}
@@ -0,0 +1,187 @@
+#include "PipelineCache.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+    constexpr uint32_t c_pipelineCacheMagic = 0x43504352; // "RCPC"
+    constexpr uint32_t c_pipelineCacheVersion = 1;
+
+    struct PipelineCacheHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Environment;
+        uint64_t FileSize;
+        uint32_t EntryCount;
+        uint32_t Reserved;
+        // Of the entry table following the header, the payloads follow the table
+        uint64_t TableHash;
+    };
+    static_assert(sizeof(PipelineCacheHeader) == 40, "Pipeline cache header layout changed, bump c_pipelineCacheVersion");
+
+    struct PipelineCacheEntry
+    {
+        uint64_t Key;
+        uint64_t Offset;
+        uint64_t Size;
+        uint64_t Hash;
+        uint32_t Age;
+        uint32_t Reserved;
+    };
+    static_assert(sizeof(PipelineCacheEntry) == 40, "Pipeline cache entry layout changed, bump c_pipelineCacheVersion");
+}
+
+PipelineCache::PipelineCache(uint64_t environment)
+    : m_environment(environment)
+{
+}
+
+bool PipelineCache::Load(const std::string& path)
+{
+    m_entries.clear();
+    m_stats = {};
+    m_dirty = false;
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    const auto fileSize = (uint64_t)file.tellg();
+    file.seekg(0);
+
+    PipelineCacheHeader header = {};
+    m_stats.Stale = true;
+    if (fileSize < sizeof(header) || !file.read((char*)&header, sizeof(header)))
+        return false;
+    if (header.Magic != c_pipelineCacheMagic || header.Version != c_pipelineCacheVersion
+        || header.Environment != m_environment || header.FileSize != fileSize
+        || sizeof(header) + (uint64_t)header.EntryCount * sizeof(PipelineCacheEntry) > fileSize)
+        return false;
+
+    std::vector<PipelineCacheEntry> table(header.EntryCount);
+    if (!file.read((char*)table.data(), table.size() * sizeof(PipelineCacheEntry))
+        || HashBytes(table.data(), table.size() * sizeof(PipelineCacheEntry)) != header.TableHash)
+        return false;
+    m_stats.Stale = false;
+
+    std::vector<uint8_t> payloads(fileSize - sizeof(header) - table.size() * sizeof(PipelineCacheEntry));
+    if (!file.read((char*)payloads.data(), payloads.size()))
+        return false;
+
+    const auto payloadStart = fileSize - payloads.size();
+    for (const auto& entry : table)
+    {
+        const auto inside = entry.Offset >= payloadStart && entry.Size <= fileSize && entry.Offset <= fileSize - entry.Size;
+        const auto* data = inside ? payloads.data() + (entry.Offset - payloadStart) : nullptr;
+        if (!inside || HashBytes(data, entry.Size) != entry.Hash)
+        {
+            ++m_stats.Damaged;
+            m_dirty = true;
+            continue;
+        }
+        auto& loaded = m_entries[entry.Key];
+        loaded.Blob.assign(data, data + entry.Size);
+        loaded.Age = entry.Age;
+        ++m_stats.Loaded;
+    }
+    return true;
+}
+
+bool PipelineCache::Save(const std::string& path)
+{
+    if (!m_dirty)
+        return true;
+
+    std::vector<PipelineCacheEntry> table;
+    std::vector<const Entry*> entries;
+    table.reserve(m_entries.size());
+    entries.reserve(m_entries.size());
+    for (auto& [key, entry] : m_entries)
+    {
+        if (!entry.Used && entry.Age + 1 >= c_maxAge)
+        {
+            ++m_stats.Evicted;
+            continue;
+        }
+        PipelineCacheEntry written = {};
+        written.Key = key;
+        written.Size = entry.Blob.size();
+        written.Hash = HashBytes(entry.Blob.data(), entry.Blob.size());
+        written.Age = entry.Used ? 0 : entry.Age + 1;
+        table.push_back(written);
+        entries.push_back(&entry);
+    }
+
+    PipelineCacheHeader header = {};
+    header.Magic = c_pipelineCacheMagic;
+    header.Version = c_pipelineCacheVersion;
+    header.Environment = m_environment;
+    header.EntryCount = (uint32_t)table.size();
+    auto offset = sizeof(header) + table.size() * sizeof(PipelineCacheEntry);
+    for (auto& entry : table)
+    {
+        entry.Offset = offset;
+        offset += entry.Size;
+    }
+    header.FileSize = offset;
+    header.TableHash = HashBytes(table.data(), table.size() * sizeof(PipelineCacheEntry));
+
+    // Written under a temporary name and renamed so a crashed write never leaves a truncated cache behind
+    const auto tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)table.data(), table.size() * sizeof(PipelineCacheEntry));
+        for (const auto* entry : entries)
+            file.write((const char*)entry->Blob.data(), entry->Blob.size());
+        if (!file)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+const std::vector<uint8_t>* PipelineCache::Find(uint64_t key)
+{
+    const auto entry = m_entries.find(key);
+    if (entry == m_entries.end())
+    {
+        ++m_stats.Misses;
+        return nullptr;
+    }
+    ++m_stats.Hits;
+    entry->second.Used = true;
+    m_dirty |= entry->second.Age > 0;
+    return &entry->second.Blob;
+}
+
+void PipelineCache::Store(uint64_t key, const void* data, uint64_t size)
+{
+    auto& entry = m_entries[key];
+    entry.Blob.assign((const uint8_t*)data, (const uint8_t*)data + size);
+    entry.Age = 0;
+    entry.Used = true;
+    m_dirty = true;
+}
+
+void PipelineCache::Reject(uint64_t key)
+{
+    if (m_entries.erase(key) == 0)
+        return;
+    // The Find before was no hit after all
+    --m_stats.Hits;
+    ++m_stats.Misses;
+    ++m_stats.Rejected;
+    m_dirty = true;
+}
@@ -0,0 +1,128 @@
+#include "ProbeInvalidation.h"
+
+#include <cassert>
+
+ProbeInvalidation::ProbeInvalidation(const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount, const CascadeTopology& topology)
+    : m_probes(cascadeCount)
+    , m_marks(cascadeCount)
+    , m_resolution(resolution)
+    , m_extends(extends)
+    , m_offset(offset)
+    , m_topology(topology)
+    , m_count(cascadeCount)
+{
+    assert(resolution.x <= c_maxResolution && resolution.y <= c_maxResolution && resolution.z <= c_maxResolution);
+    for (auto i = 0u; i < m_count; ++i)
+        m_marks[i].resize(GetProbeCount(i));
+}
+
+void ProbeInvalidation::Invalidate(const Aabb& bounds)
+{
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        // Same interval as the rays of CascadeTracing.hlsl
+        const float start = 0.01f + m_topology.GetEnd((int)i - 1);
+        const float end = m_topology.GetEnd(i);
+        const uint32_t levelCount[3] = {m_resolution.x >> i, m_resolution.y >> i, m_resolution.z >> i};
+        const Float3 extends = {m_extends.x, m_extends.y, m_extends.z};
+        const Float3 offset = {m_offset.x, m_offset.y, m_offset.z};
+
+        // Probes further than end from the bounds cannot see them, only the grid cells around them are tested
+        uint32_t first[3];
+        uint32_t last[3];
+        bool empty = false;
+        for (auto axis = 0u; axis < 3; ++axis)
+        {
+            const auto toGrid = [&](float world)
+            {
+                return ((world - offset[axis]) / extends[axis] + 1.f) * 0.5f * levelCount[axis] - 0.5f;
+            };
+            const float low = std::max(std::ceil(toGrid(bounds.Min[axis] - end)), 0.f);
+            const float high = std::min(std::floor(toGrid(bounds.Max[axis] + end)), levelCount[axis] - 1.f);
+            empty |= !(low <= high);
+            first[axis] = empty ? 0 : (uint32_t)low;
+            last[axis] = empty ? 0 : (uint32_t)high;
+        }
+        if (empty)
+            continue;
+
+        for (auto z = first[2]; z <= last[2]; ++z)
+        {
+            for (auto y = first[1]; y <= last[1]; ++y)
+            {
+                for (auto x = first[0]; x <= last[0]; ++x)
+                {
+                    auto& mark = m_marks[i][GetIndex(i, x, y, z)];
+                    if (mark || !Overlaps(GetProbePosition(i, x, y, z), start, end, bounds))
+                        continue;
+                    mark = 1;
+                    m_probes[i].push_back(PackProbe(x, y, z));
+                }
+            }
+        }
+    }
+}
+
+void ProbeInvalidation::InvalidateProbe(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z)
+{
+    auto& mark = m_marks[cascade][GetIndex(cascade, x, y, z)];
+    if (mark)
+        return;
+    mark = 1;
+    m_probes[cascade].push_back(PackProbe(x, y, z));
+}
+
+void ProbeInvalidation::Clear()
+{
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        for (const auto probe : m_probes[i])
+        {
+            const auto [x, y, z] = UnpackProbe(probe);
+            m_marks[i][GetIndex(i, x, y, z)] = 0;
+        }
+        m_probes[i].clear();
+    }
+}
+
+void ProbeInvalidation::SplitTracing(uint32_t cascade, CascadeSlices& slices, std::vector<uint32_t>& listedProbes) const
+{
+    // Invalidated probes inside the scheduled slices are traced with them
+    listedProbes.clear();
+    for (const auto probe : m_probes[cascade])
+    {
+        const auto z = UnpackProbe(probe)[2];
+        if (z < slices.Begin || z >= slices.End)
+            listedProbes.push_back(probe);
+    }
+
+    if (listedProbes.size() * 2 > GetProbeCount(cascade))
+    {
+        slices = {0, m_resolution.z >> cascade};
+        listedProbes.clear();
+    }
+}
+
+Float3 ProbeInvalidation::GetProbePosition(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z) const
+{
+    const Float3 levelCount = {(float)(m_resolution.x >> cascade), (float)(m_resolution.y >> cascade), (float)(m_resolution.z >> cascade)};
+    const Float3 position = Float3{x + 0.5f, y + 0.5f, z + 0.5f} / levelCount;
+    return (position * 2.f - Float3{1.f, 1.f, 1.f}) * Float3{m_extends.x, m_extends.y, m_extends.z} + Float3{m_offset.x, m_offset.y, m_offset.z};
+}
+
+bool ProbeInvalidation::Overlaps(const Float3& position, float start, float end, const Aabb& bounds)
+{
+    // The distances from position to the points of a box form the interval [nearest, farthest]
+    float nearest = 0.f;
+    float farthest = 0.f;
+    for (auto axis = 0u; axis < 3; ++axis)
+    {
+        const float below = bounds.Min[axis] - position[axis];
+        const float above = position[axis] - bounds.Max[axis];
+        const float outside = std::max(std::max(below, above), 0.f);
+        const float across = std::max(std::abs(bounds.Min[axis] - position[axis]), std::abs(bounds.Max[axis] - position[axis]));
+        nearest += outside * outside;
+        farthest += across * across;
+    }
+    return nearest <= end * end && farthest >= start * start;
+}
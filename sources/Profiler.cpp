@@ -0,0 +1,178 @@
+#include "Profiler.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+
+namespace
+{
+    void WriteJsonString(std::ostream& out, const char* text)
+    {
+        out << '"';
+        for (auto c = text; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                out << '\\' << *c;
+            else if ((unsigned char)*c < 0x20)
+                out << ' ';
+            else
+                out << *c;
+        }
+        out << '"';
+    }
+
+    // Microseconds with the nanoseconds as decimals, without going through a double
+    void WriteMicroseconds(std::ostream& out, uint64_t nanoseconds)
+    {
+        const auto fraction = nanoseconds % 1000;
+        out << nanoseconds / 1000 << '.' << fraction / 100 << fraction / 10 % 10 << fraction % 10;
+    }
+
+    inline bool SameName(const char* a, const char* b)
+    {
+        return a == b || std::strcmp(a, b) == 0;
+    }
+}
+
+Profiler::Profiler(uint32_t capacity)
+    : m_samples(capacity)
+    , m_start(std::chrono::steady_clock::now())
+{
+    // A power of two so the ring position is a mask
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    m_openScopes.reserve(64);
+}
+
+void Profiler::BeginFrame()
+{
+    assert(m_openScopes.empty());
+    ++m_frame;
+}
+
+void Profiler::BeginCpu(const char* name)
+{
+    m_openScopes.push_back({name, Now()});
+}
+
+void Profiler::EndCpu()
+{
+    assert(!m_openScopes.empty());
+    const auto end = Now();
+    const auto scope = m_openScopes.back();
+    m_openScopes.pop_back();
+    Add({scope.Name, m_frame, scope.Begin, end, (uint32_t)m_openScopes.size(), ProfileTrack::Cpu});
+}
+
+void Profiler::AddGpuSample(const char* name, uint64_t frame, uint64_t begin, uint64_t end, uint32_t depth)
+{
+    Add({name, frame, begin, std::max(begin, end), depth, ProfileTrack::Gpu});
+}
+
+void Profiler::Add(const ProfileSample& sample)
+{
+    m_samples[m_written & (m_samples.size() - 1)] = sample;
+    ++m_written;
+}
+
+std::vector<ProfileSample> Profiler::GetSamples() const
+{
+    std::vector<ProfileSample> ret;
+    ret.reserve(GetSampleCount());
+    for (auto i = GetDroppedCount(); i < m_written; ++i)
+        ret.push_back(m_samples[i & (m_samples.size() - 1)]);
+    return ret;
+}
+
+std::vector<ProfileStats> Profiler::CollectStats() const
+{
+    struct Accumulator
+    {
+        uint64_t Frame = 0;
+        uint64_t Sum = 0;
+        uint64_t Calls = 0;
+        uint64_t TotalCalls = 0;
+        double Total = 0.0;
+    };
+
+    // Samples of one name arrive frame by frame, a frame is summed up once the next one starts
+    std::vector<ProfileStats> ret;
+    std::vector<Accumulator> accumulators;
+    const auto flush = [&](ProfileStats& stats, Accumulator& accumulator)
+    {
+        if (accumulator.Calls == 0)
+            return;
+        const auto seconds = accumulator.Sum * 1e-9;
+        stats.Min = stats.Frames == 0 ? seconds : std::min(stats.Min, seconds);
+        stats.Max = std::max(stats.Max, seconds);
+        stats.Last = seconds;
+        ++stats.Frames;
+        accumulator.Total += seconds;
+        accumulator.TotalCalls += accumulator.Calls;
+        accumulator.Sum = 0;
+        accumulator.Calls = 0;
+    };
+
+    for (auto i = GetDroppedCount(); i < m_written; ++i)
+    {
+        const auto& sample = m_samples[i & (m_samples.size() - 1)];
+        auto entry = 0u;
+        while (entry < ret.size() && (ret[entry].Track != sample.Track || ret[entry].Depth != sample.Depth || !SameName(ret[entry].Name, sample.Name)))
+            ++entry;
+        if (entry == ret.size())
+        {
+            ProfileStats stats;
+            stats.Name = sample.Name;
+            stats.Track = sample.Track;
+            stats.Depth = sample.Depth;
+            ret.push_back(stats);
+            accumulators.emplace_back();
+        }
+
+        auto& accumulator = accumulators[entry];
+        if (accumulator.Calls > 0 && accumulator.Frame != sample.Frame)
+            flush(ret[entry], accumulator);
+        accumulator.Frame = sample.Frame;
+        accumulator.Sum += sample.End - sample.Begin;
+        ++accumulator.Calls;
+    }
+
+    for (auto i = 0u; i < ret.size(); ++i)
+    {
+        flush(ret[i], accumulators[i]);
+        ret[i].Mean = ret[i].Frames > 0 ? accumulators[i].Total / ret[i].Frames : 0.0;
+        ret[i].Calls = ret[i].Frames > 0 ? (double)accumulators[i].TotalCalls / ret[i].Frames : 0.0;
+    }
+    return ret;
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out) const
+{
+    // Complete events in microseconds, one thread per track
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    out << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n";
+    out << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"GPU\"}}";
+    for (auto i = GetDroppedCount(); i < m_written; ++i)
+    {
+        const auto& sample = m_samples[i & (m_samples.size() - 1)];
+        const auto gpu = sample.Track == ProfileTrack::Gpu;
+        out << ",\n  {\"name\": ";
+        WriteJsonString(out, sample.Name);
+        out << ", \"cat\": \"" << (gpu ? "gpu" : "cpu") << "\""
+            << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << (gpu ? 2 : 1) << ", \"ts\": ";
+        WriteMicroseconds(out, sample.Begin);
+        out << ", \"dur\": ";
+        WriteMicroseconds(out, sample.End - sample.Begin);
+        out << ", \"args\": {\"frame\": " << sample.Frame << ", \"depth\": " << sample.Depth << "}}";
+    }
+    out << "\n]}\n";
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    WriteChromeTrace(file);
+    return (bool)file;
+}
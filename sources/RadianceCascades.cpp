@@ -1,54 +1,123 @@
 #include "RadianceCascades.h"
 #include "Scene.h"
 
-RadianceCascades::RadianceCascades(Device& device, const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount)
-    : m_resolution(resolution)
+namespace
+{
+    DXGI_FORMAT GetDxgiFormat(CascadeFormat format)
+    {
+        switch (format)
+        {
+        case CascadeFormat::Rgba32f:
+            return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case CascadeFormat::Rgba16f:
+            return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case CascadeFormat::R11g11b10f:
+            return DXGI_FORMAT_R11G11B10_FLOAT;
+        default:
+            // No typed UAV stores of shared exponent formats
+            assert(false);
+            return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+}
+
+RadianceCascades::RadianceCascades(Device& device, const CascadeResultion& resolution, const CascadeExtends& extends, const CascadeOffset& offset, uint32_t cascadeCount, CascadeFormat format, CascadeLayout layout, CascadeTopologyId topology)
+    : m_device(device)
+    , m_resolution(resolution)
     , m_extends(extends)
     , m_offset(offset)
+    , m_format(format)
+    , m_layout(layout)
+    , m_topology(topology)
     , m_count(cascadeCount)
+    , m_scheduler(resolution, cascadeCount, ::GetTopology(topology))
+    , m_invalidation(resolution, extends, offset, cascadeCount, ::GetTopology(topology))
+    , m_bricks(resolution, extends, offset, cascadeCount)
 {
-    constexpr auto cascadePixelsX = 64;
-    constexpr auto cascadePixelsY = 32;
-
-    m_cascadePixelsX = cascadePixelsX * resolution.x;
-    m_cascadePixelsY = cascadePixelsY * resolution.y;
-    m_cascadePixelsZ = resolution.z;
-
+    // The probe lists CascadeTracing.hlsl reads are packed with ProbeInvalidation::PackProbe
+    assert(resolution.x <= ProbeInvalidation::c_maxResolution && resolution.y <= ProbeInvalidation::c_maxResolution && resolution.z <= ProbeInvalidation::c_maxResolution);
     m_cascades.resize(m_count);
     m_cascadeSrvs.resize(m_count);
     m_cascadeUavs.resize(m_count);
+    m_cascadeStates.resize(m_count);
+    m_graphResources.resize(m_count);
+    m_hits.resize(m_count);
+    m_hitSrvs.resize(m_count);
+    m_hitUavs.resize(m_count);
+    m_hitStates.resize(m_count);
+    m_hitGraphResources.resize(m_count);
+    m_layers.resize(m_count);
     for (auto i = 0u; i < m_count; ++i)
+        CreateLevel(i, 1);
+
+    m_irradiance = device.CreateTexture(DXGI_FORMAT_R16G16B16A16_FLOAT, c_irradianceTexels * resolution.x, resolution.y, resolution.z, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2DARRAY;
+    uavDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    uavDesc.Texture2DArray.ArraySize = resolution.z;
+    uavDesc.Texture2DArray.FirstArraySlice = 0;
+    uavDesc.Texture2DArray.MipSlice = 0;
+    uavDesc.Texture2DArray.PlaneSlice = 0;
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+    srvDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Texture2DArray.ArraySize = resolution.z;
+    srvDesc.Texture2DArray.FirstArraySlice = 0;
+    srvDesc.Texture2DArray.MipLevels = 1;
+    srvDesc.Texture2DArray.MostDetailedMip = 0;
+    srvDesc.Texture2DArray.PlaneSlice = 0;
+    srvDesc.Texture2DArray.ResourceMinLODClamp = 0.f;
+    m_irradianceUav = device.CreateUnorderedAccessView(m_irradiance, uavDesc);
+    m_irradianceSrv = device.CreateShaderResourceView(m_irradiance, srvDesc);
+
+    m_cascadeGenerationPipeline = device.CreateCascadeTracingPipeline(topology);
+    m_cascadeAccumulationPipeline = device.CreateCascadeAccumulationPipeline(topology);
+    m_irradiancePipeline = device.CreateCascadeIrradiancePipeline(topology);
+
+}
+
+void RadianceCascades::UpdateBricks(const Scene& scene)
+{
+    for (auto i = 0u; i < scene.GetInstanceCount(); ++i)
     {
-        const auto z = m_cascadePixelsZ >> i;
-        m_cascades[i] = device.CreateTexture(DXGI_FORMAT_R16G16B16A16_FLOAT, m_cascadePixelsX, m_cascadePixelsY, z, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-        D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-        uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2DARRAY;
-        uavDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-        uavDesc.Texture2DArray.ArraySize = z;
-        uavDesc.Texture2DArray.FirstArraySlice = 0;
-        uavDesc.Texture2DArray.MipSlice = 0;
-        uavDesc.Texture2DArray.PlaneSlice = 0;
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-        srvDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.Texture2DArray.ArraySize = z;
-        srvDesc.Texture2DArray.FirstArraySlice = 0;
-        srvDesc.Texture2DArray.MipLevels = 1;
-        srvDesc.Texture2DArray.MostDetailedMip = 0;
-        srvDesc.Texture2DArray.PlaneSlice = 0;
-        srvDesc.Texture2DArray.ResourceMinLODClamp = 0.f;
-        m_cascadeUavs[i] = device.CreateUnorderedAccessView(m_cascades[i], uavDesc);
-        m_cascadeSrvs[i] = device.CreateShaderResourceView(m_cascades[i], srvDesc);
+        const auto& transform = scene.GetInstanceTransform(i);
+        for (const auto& box : scene.GetInstanceModel(i).GetOccupancy())
+            m_bricks.Occupy(TransformBounds(box, transform));
     }
+    m_bricks.Update();
 
-    m_cascadeGenerationPipeline = device.CreateCascadeTracingPipeline();
-    m_cascadeAccumulationPipeline = device.CreateCascadeAccumulationPipeline();
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        if (m_bricks.GetLayerCount(i) > m_layers[i])
+        {
+            // Frames in flight may still read the atlas being replaced
+            m_device.WaitIdle();
+            CreateLevel(i, m_bricks.GetLayerCount(i));
+            m_scheduler.Invalidate();
+            continue;
+        }
 
-    m_tracingConstants = device.CreateBuffer(256, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
+        // Slots handed out again hold the hits of another brick
+        const auto brickSize = GetBrickSize(m_resolution, i);
+        const auto bricksX = (m_resolution.x >> i) / brickSize[0];
+        const auto bricksY = (m_resolution.y >> i) / brickSize[1];
+        for (const auto brick : m_bricks.GetAddedBricks(i))
+        {
+            const uint32_t first[3] = {brick % bricksX * brickSize[0], brick / bricksX % bricksY * brickSize[1], brick / (bricksX * bricksY) * brickSize[2]};
+            for (auto z = first[2]; z < first[2] + brickSize[2]; ++z)
+            {
+                for (auto y = first[1]; y < first[1] + brickSize[1]; ++y)
+                {
+                    for (auto x = first[0]; x < first[0] + brickSize[0]; ++x)
+                        m_invalidation.InvalidateProbe(i, x, y, z);
+                }
+            }
+        }
+    }
 }
 
-const std::vector<D3D12_GPU_DESCRIPTOR_HANDLE>& RadianceCascades::Generate(const ComPtr<ID3D12GraphicsCommandList>& commandList, D3D12_GPU_DESCRIPTOR_HANDLE accelerationStructure, D3D12_GPU_DESCRIPTOR_HANDLE instanceData)
+const std::vector<uint32_t>& RadianceCascades::Generate(RenderGraph& graph, const ComPtr<ID3D12GraphicsCommandList>& commandList, D3D12_GPU_DESCRIPTOR_HANDLE accelerationStructure, D3D12_GPU_DESCRIPTOR_HANDLE instanceData)
 {
     struct
     {
@@ -56,59 +125,183 @@ const std::vector<D3D12_GPU_DESCRIPTOR_HANDLE>& RadianceCascades::Generate(const
         CascadeExtends extends; DUMMY_CBV_ENTRY;
         CascadeOffset offset; DUMMY_CBV_ENTRY;
         std::array<uint32_t, 2> size;
+        CascadeLayout layout;
     } CascadeConstants;
     CascadeConstants.probeCount = m_resolution;
     CascadeConstants.extends = m_extends;
     CascadeConstants.offset = m_offset;
-    CascadeConstants.size = {m_cascadePixelsX, m_cascadePixelsY };
+    CascadeConstants.size = GetTopology().GetAtlasSize(m_resolution, 0);
+    CascadeConstants.layout = m_layout;
 
-    Device::SetResourceData(m_tracingConstants, CascadeConstants);
+    m_constants = m_device.UploadConstants(CascadeConstants);
+    const auto& indirection = m_bricks.GetIndirection();
+    m_bricksAddress = m_device.UploadData(indirection.data(), indirection.size() * sizeof(uint32_t));
 
-    ComPtr<ID3D12GraphicsCommandList4> commandList4;
-    commandList.As(&commandList4);
-    assert(commandList4);
-    commandList4->SetPipelineState1(m_cascadeGenerationPipeline.Object.Get());
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        m_graphResources[i] = graph.Import(m_cascades[i].Get(), m_cascadeStates[i]);
+        m_hitGraphResources[i] = graph.Import(m_hits[i].Get(), m_hitStates[i]);
+    }
 
-    commandList->SetComputeRootSignature(m_cascadeGenerationPipeline.RootSignature.Get());
-    commandList->SetComputeRootConstantBufferView(1, m_tracingConstants->GetGPUVirtualAddress());
-    commandList->SetComputeRootDescriptorTable(2, accelerationStructure);
-    commandList->SetComputeRootDescriptorTable(3, instanceData);
+    const auto& updates = m_scheduler.Advance();
+    bool firstTrace = true;
+    const auto addTracing = [&](uint32_t cascade, const D3D12_DISPATCH_RAYS_DESC& rays, uint32_t sliceBegin, D3D12_GPU_VIRTUAL_ADDRESS probes)
+    {
+        const bool setup = firstTrace;
+        firstTrace = false;
+        const auto pass = graph.AddPass("Cascade tracing", [=]()
+        {
+            ComPtr<ID3D12GraphicsCommandList4> commandList4;
+            commandList.As(&commandList4);
+            assert(commandList4);
+            if (setup)
+            {
+                commandList4->SetPipelineState1(m_cascadeGenerationPipeline.Object.Get());
+                commandList->SetComputeRootSignature(m_cascadeGenerationPipeline.RootSignature.Get());
+                commandList->SetComputeRootConstantBufferView(1, m_constants);
+                commandList->SetComputeRootDescriptorTable(2, accelerationStructure);
+            }
+            const uint32_t rootConstants[] = {cascade, sliceBegin, probes != 0 ? 1u : 0u};
+            commandList->SetComputeRoot32BitConstants(0, 3, rootConstants, 0);
+            // Not read without a probe list, but has to point at a buffer
+            commandList->SetComputeRootShaderResourceView(3, probes != 0 ? probes : m_constants);
+            commandList->SetComputeRootDescriptorTable(4, m_hitUavs[cascade]);
+            commandList->SetComputeRootShaderResourceView(5, m_bricksAddress);
+            commandList4->DispatchRays(&rays);
+        });
+        graph.Use(pass, m_hitGraphResources[cascade], GraphState::UnorderedAccess);
+    };
 
     D3D12_DISPATCH_RAYS_DESC rays = {};
-    rays.Width = m_cascadePixelsX;
-    rays.Height = m_cascadePixelsY;
     rays.RayGenerationShaderRecord = m_cascadeGenerationPipeline.RayGenRange;
     rays.MissShaderTable = m_cascadeGenerationPipeline.RayMissRange;
     rays.HitGroupTable = m_cascadeGenerationPipeline.RayHitRange;
 
     for (auto i = 0u; i < m_count; ++i)
     {
-        Device::PipelineBarrierTransition(commandList, m_cascades[i], D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        commandList->SetComputeRoot32BitConstant(0, i, 0);
-        commandList->SetComputeRootDescriptorTable(4, m_cascadeUavs[i]);
+        auto slices = updates[i];
+        m_invalidation.SplitTracing(i, slices, m_listedProbes);
+
+        if (!slices.IsEmpty())
+        {
+            const auto atlasSize = GetTopology().GetAtlasSize(m_resolution, i);
+            rays.Width = atlasSize[0];
+            rays.Height = atlasSize[1];
+            rays.Depth = slices.GetCount();
+            addTracing(i, rays, slices.Begin, 0);
+        }
 
-        rays.Depth = m_cascadePixelsZ >> i;
-        commandList4->DispatchRays(&rays);
+        if (!m_listedProbes.empty())
+        {
+            const auto pixelCount = GetTopology().GetPixelCount(i);
+            rays.Width = pixelCount[0];
+            rays.Height = pixelCount[1];
+            rays.Depth = (uint32_t)m_listedProbes.size();
+            addTracing(i, rays, 0, m_device.UploadData(m_listedProbes.data(), m_listedProbes.size() * sizeof(uint32_t)));
+        }
     }
+    m_invalidation.Clear();
 
-    commandList->SetPipelineState(m_cascadeAccumulationPipeline.State.Get());
-    commandList->SetComputeRootSignature(m_cascadeAccumulationPipeline.RootSignature.Get());
-    commandList->SetComputeRootConstantBufferView(1, m_tracingConstants->GetGPUVirtualAddress());
+    // Hits of levels and probes not traced this frame are still valid, every level is resolved again
+    for (int i = m_count - 1; i >= 0; --i)
+    {
+        const auto pass = graph.AddPass("Cascade merging", [=]()
+        {
+            if (i == (int)m_count - 1)
+            {
+                commandList->SetPipelineState(m_cascadeAccumulationPipeline.State.Get());
+                commandList->SetComputeRootSignature(m_cascadeAccumulationPipeline.RootSignature.Get());
+                commandList->SetComputeRootConstantBufferView(1, m_constants);
+                commandList->SetComputeRootDescriptorTable(5, instanceData);
+                commandList->SetComputeRootShaderResourceView(6, m_bricksAddress);
+            }
+            const uint32_t rootConstants[] = {(uint32_t)i, m_count};
+            commandList->SetComputeRoot32BitConstants(0, 2, rootConstants, 0);
+            // The highest level samples nothing above, its own hits stand in for a valid table
+            commandList->SetComputeRootDescriptorTable(2, i + 1 < (int)m_count ? m_cascadeSrvs[i + 1] : m_hitSrvs[i]);
+            commandList->SetComputeRootDescriptorTable(3, m_cascadeUavs[i]);
+            commandList->SetComputeRootDescriptorTable(4, m_hitSrvs[i]);
+
+            constexpr auto groupSize = 4;
+            const auto atlasSize = GetTopology().GetAtlasSize(m_resolution, i);
+            const uint32_t x = (atlasSize[0] + groupSize - 1) / groupSize;
+            const uint32_t y = (atlasSize[1] + groupSize - 1) / groupSize;
+            const uint32_t z = ((m_resolution.z >> i) + groupSize - 1) / groupSize;
+            commandList->Dispatch(x, y, z);
+        });
+        if (i + 1 < (int)m_count)
+            graph.Use(pass, m_graphResources[i + 1], GraphState::NonPixelShaderResource);
+        graph.Use(pass, m_hitGraphResources[i], GraphState::NonPixelShaderResource);
+        graph.Use(pass, m_graphResources[i], GraphState::UnorderedAccess);
+    }
 
-    for (int i = m_count - 2; i >= 0; --i)
+    // Dense over the probes, absent ones keep stale values no lookup reaches
+    m_irradianceGraphResource = graph.Import(m_irradiance.Get(), m_irradianceState);
+    const auto irradiancePass = graph.AddPass("Cascade irradiance", [=]()
     {
-        Device::PipelineBarrierTransition(commandList, m_cascades[i + 1], D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
-        commandList->SetComputeRoot32BitConstant(0, i, 0);
-        commandList->SetComputeRootDescriptorTable(2, m_cascadeSrvs[i + 1]);
-        commandList->SetComputeRootDescriptorTable(3, m_cascadeUavs[i]);
-
-        constexpr auto groupSize = 4;
-        const uint32_t x = (m_cascadePixelsX + groupSize - 1) / groupSize;
-        const uint32_t y = (m_cascadePixelsY + groupSize - 1) / groupSize;
-        const uint32_t z = ((m_cascadePixelsZ >> i) + groupSize - 1) / groupSize;
-        commandList->Dispatch(x, y, z);
+        commandList->SetPipelineState(m_irradiancePipeline.State.Get());
+        commandList->SetComputeRootSignature(m_irradiancePipeline.RootSignature.Get());
+        commandList->SetComputeRootConstantBufferView(0, m_constants);
+        commandList->SetComputeRootDescriptorTable(1, m_cascadeSrvs[0]);
+        commandList->SetComputeRootDescriptorTable(2, m_irradianceUav);
+        commandList->SetComputeRootShaderResourceView(3, m_bricksAddress);
+        commandList->Dispatch(m_resolution.x, m_resolution.y, m_resolution.z);
+    });
+    graph.Use(irradiancePass, m_graphResources[0], GraphState::NonPixelShaderResource);
+    graph.Use(irradiancePass, m_irradianceGraphResource, GraphState::UnorderedAccess);
+
+    return m_graphResources;
+}
+
+void RadianceCascades::UpdateStates(const RenderGraph& graph)
+{
+    for (auto i = 0u; i < m_count; ++i)
+    {
+        m_cascadeStates[i] = graph.GetFinalState(m_graphResources[i]);
+        m_hitStates[i] = graph.GetFinalState(m_hitGraphResources[i]);
     }
-    Device::PipelineBarrierTransition(commandList, m_cascades[0], D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    m_irradianceState = graph.GetFinalState(m_irradianceGraphResource);
+}
 
-    return m_cascadeSrvs;
-}
\ No newline at end of file
+void RadianceCascades::CreateLevel(uint32_t cascade, uint32_t layers)
+{
+    if (m_cascades[cascade])
+    {
+        for (const auto handle : {m_cascadeUavs[cascade], m_cascadeSrvs[cascade], m_hitUavs[cascade], m_hitSrvs[cascade]})
+            m_device.ReleaseDescriptor(handle);
+    }
+
+    const auto z = layers * GetBrickSize(m_resolution, cascade)[2];
+    const auto format = GetDxgiFormat(m_format);
+    const auto atlasSize = GetTopology().GetAtlasSize(m_resolution, cascade);
+    m_cascades[cascade] = m_device.CreateTexture(format, atlasSize[0], atlasSize[1], z, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    m_hits[cascade] = m_device.CreateTexture(DXGI_FORMAT_R16_UINT, atlasSize[0], atlasSize[1], z, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    m_cascadeStates[cascade] = GraphState::AllShaderResource;
+    m_hitStates[cascade] = GraphState::AllShaderResource;
+    m_layers[cascade] = layers;
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2DARRAY;
+    uavDesc.Format = format;
+    uavDesc.Texture2DArray.ArraySize = z;
+    uavDesc.Texture2DArray.FirstArraySlice = 0;
+    uavDesc.Texture2DArray.MipSlice = 0;
+    uavDesc.Texture2DArray.PlaneSlice = 0;
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+    srvDesc.Format = format;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Texture2DArray.ArraySize = z;
+    srvDesc.Texture2DArray.FirstArraySlice = 0;
+    srvDesc.Texture2DArray.MipLevels = 1;
+    srvDesc.Texture2DArray.MostDetailedMip = 0;
+    srvDesc.Texture2DArray.PlaneSlice = 0;
+    srvDesc.Texture2DArray.ResourceMinLODClamp = 0.f;
+    m_cascadeUavs[cascade] = m_device.CreateUnorderedAccessView(m_cascades[cascade], uavDesc);
+    m_cascadeSrvs[cascade] = m_device.CreateShaderResourceView(m_cascades[cascade], srvDesc);
+
+    uavDesc.Format = DXGI_FORMAT_R16_UINT;
+    srvDesc.Format = DXGI_FORMAT_R16_UINT;
+    m_hitUavs[cascade] = m_device.CreateUnorderedAccessView(m_hits[cascade], uavDesc);
+    m_hitSrvs[cascade] = m_device.CreateShaderResourceView(m_hits[cascade], srvDesc);
+}
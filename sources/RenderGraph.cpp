@@ -0,0 +1,141 @@
+#include "RenderGraph.h"
+
+#include <cassert>
+
+RenderGraph::RenderGraph(bool splitBarriers)
+    : m_splitBarriers(splitBarriers)
+{
+}
+
+uint32_t RenderGraph::Import(void* native, uint32_t state, uint32_t finalState)
+{
+    m_resources.push_back({native, state, finalState, false});
+    return (uint32_t)m_resources.size() - 1;
+}
+
+uint32_t RenderGraph::CreateTransient(void* native)
+{
+    m_resources.push_back({native, GraphState::Common, c_anyState, true});
+    return (uint32_t)m_resources.size() - 1;
+}
+
+uint32_t RenderGraph::AddPass(const char* name, Execution execution)
+{
+    m_passes.push_back({name, std::move(execution), {}});
+    return (uint32_t)m_passes.size() - 1;
+}
+
+void RenderGraph::Use(uint32_t pass, uint32_t resource, uint32_t state)
+{
+    assert(pass < m_passes.size() && resource < m_resources.size());
+
+    auto& accesses = m_passes[pass].Accesses;
+    for (auto& access : accesses)
+    {
+        if (access.Resource != resource)
+            continue;
+
+        // A pass can read a resource in several ways but not read and write it through different states
+        assert(access.State == state || (GraphState::IsReadOnly(access.State) && GraphState::IsReadOnly(state)));
+        access.State |= state;
+        return;
+    }
+    accesses.push_back({resource, state});
+}
+
+void RenderGraph::Compile()
+{
+    m_batches.assign(m_passes.size() + 1, {});
+    m_finalStates.resize(m_resources.size());
+    m_lifetimes.resize(m_resources.size());
+
+    // (pass, state) of every resource in pass order
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> uses(m_resources.size());
+    for (auto i = 0u; i < m_passes.size(); ++i)
+    {
+        for (auto& access : m_passes[i].Accesses)
+            uses[access.Resource].push_back({i, access.State});
+    }
+
+    for (auto i = 0u; i < m_resources.size(); ++i)
+        CompileResource(i, uses[i]);
+}
+
+uint32_t RenderGraph::GetBarrierCount() const
+{
+    uint32_t count = 0;
+    for (auto& batch : m_batches)
+        count += (uint32_t)batch.size();
+    return count;
+}
+
+void RenderGraph::CompileResource(uint32_t resource, const std::vector<std::pair<uint32_t, uint32_t>>& uses)
+{
+    const auto& desc = m_resources[resource];
+    auto state = desc.State;
+    // Batch right after the previous use, the earliest point a transition can begin
+    uint32_t earliest = 0;
+    bool accessed = false;
+
+    m_lifetimes[resource] = {c_unused, c_unused};
+    if (!uses.empty())
+        m_lifetimes[resource] = {uses.front().first, uses.back().first};
+
+    for (auto i = 0u; i < uses.size();)
+    {
+        const auto first = uses[i].first;
+        auto target = uses[i].second;
+        auto last = first;
+        ++i;
+        if (GraphState::IsReadOnly(target))
+        {
+            for (; i < uses.size() && GraphState::IsReadOnly(uses[i].second); ++i)
+            {
+                target |= uses[i].second;
+                last = uses[i].first;
+            }
+        }
+
+        if (desc.Transient && !accessed)
+        {
+            state = target;
+        }
+        else if (state == target)
+        {
+            if (target == GraphState::UnorderedAccess && accessed)
+                m_batches[first].push_back({resource, state, state, GraphBarrier::Type::Uav, GraphBarrier::Split::None});
+        }
+        else if (GraphState::IsReadOnly(state) && GraphState::IsReadOnly(target) && (state & target) == target)
+        {
+            // Already readable in every requested way
+        }
+        else
+        {
+            AddTransition(resource, state, target, earliest, first);
+            state = target;
+        }
+
+        earliest = last + 1;
+        accessed = true;
+    }
+
+    if (!desc.Transient && desc.FinalState != c_anyState && desc.FinalState != state)
+    {
+        AddTransition(resource, state, desc.FinalState, earliest, (uint32_t)m_passes.size());
+        state = desc.FinalState;
+    }
+    m_finalStates[resource] = state;
+}
+
+void RenderGraph::AddTransition(uint32_t resource, uint32_t before, uint32_t after, uint32_t begin, uint32_t end)
+{
+    if (m_splitBarriers && begin < end)
+    {
+        m_batches[begin].push_back({resource, before, after, GraphBarrier::Type::Transition, GraphBarrier::Split::Begin});
+        m_batches[end].push_back({resource, before, after, GraphBarrier::Type::Transition, GraphBarrier::Split::End});
+    }
+    else
+    {
+        m_batches[end].push_back({resource, before, after, GraphBarrier::Type::Transition, GraphBarrier::Split::None});
+    }
+}
@@ -1,9 +1,33 @@
 #include "Renderer.h"
 #include "Camera.h"
+#include "DeferredShading.h"
 #include "Scene.h"
 
-Renderer::Renderer(HWND hwnd, uint32_t width, uint32_t height)
-    : m_radianceCascades(m_device, {32, 32, 32}, {1.f, 1.f, 1.f}, {0.f, 1.f, 0.f}, 4)
+namespace
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC GetTextureViewDesc(DXGI_FORMAT format)
+    {
+        D3D12_SHADER_RESOURCE_VIEW_DESC ret;
+        ret.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        ret.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        ret.Format = format;
+        ret.Texture2D.MipLevels = 1;
+        ret.Texture2D.MostDetailedMip = 0;
+        ret.Texture2D.PlaneSlice = 0;
+        ret.Texture2D.ResourceMinLODClamp = 0.f;
+        return ret;
+    }
+}
+
+Renderer::Renderer(HWND hwnd, uint32_t width, uint32_t height, const MeshLayout& meshLayout, uint32_t framesInFlight, CascadeFormat cascadeFormat, uint32_t gatherDownscale, CascadeLayout cascadeLayout, CascadeTopologyId cascadeTopology)
+    : m_frameDevice(m_device)
+    , m_uploadContext(m_device)
+    , m_radianceCascades(m_device, {32, 32, 32}, {1.f, 1.f, 1.f}, {0.f, 1.f, 0.f}, 4, cascadeFormat, cascadeLayout, cascadeTopology)
+    , m_frames(framesInFlight)
+    , m_framePacer(framesInFlight)
+    , m_gpuProfiler(m_device, m_profiler, framesInFlight)
+    , m_meshLayout(meshLayout)
+    , m_gatherDownscale(gatherDownscale)
     , m_width(width)
     , m_height(height)
 {
@@ -14,123 +38,298 @@ Renderer::Renderer(HWND hwnd, uint32_t width, uint32_t height)
         m_swapChain->GetBuffer(i, IID_PPV_ARGS(&swapChainTarget.Resource));
         swapChainTarget.CpuHandle = m_device.CreateRenderTargetView(swapChainTarget.Resource, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
     }
-    m_depthStencil.Resource = m_device.CreateTexture(DXGI_FORMAT_D32_FLOAT, width, height, 1, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+    // Typeless so the deferred passes can read it as R32_FLOAT
+    m_depthStencil.Resource = m_device.CreateTexture(DXGI_FORMAT_R32_TYPELESS, width, height, 1, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
     m_depthStencil.CpuHandle = m_device.CreateDepthStencilView(m_depthStencil.Resource, DXGI_FORMAT_D32_FLOAT);
     
-    m_drawingPipeline = m_device.CreateDrawingPipeline();
-    m_cameraConstants = m_device.CreateBuffer(256, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
+    m_drawingPipeline = m_device.CreateDrawingPipeline(Model::GetPositionFormat(m_meshLayout), Model::GetNormalFormat(m_meshLayout));
+    if (m_gatherDownscale > 0)
+        CreateDeferredTargets();
 
-    m_debugSphere = std::make_unique<Model>("d:\\Scenes\\Test\\Sphere.glb", m_device);
-    m_debugCascadesPipeline = m_device.CreateCascadeDebugPipeline();
-    m_debugCascadesConstants = m_device.CreateBuffer(256, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
+    m_debugSphere = std::make_unique<Model>("d:\\Scenes\\Test\\Sphere.glb", m_uploadContext);
+    m_debugCascadesPipeline = m_device.CreateCascadeDebugPipeline(cascadeTopology);
 }
 
 void Renderer::Render(const Camera& camera, Scene& scene)
 {
-    auto commands = m_device.CreateGraphicsCommands();
+    m_profiler.BeginFrame();
+    ProfileScope frameScope(&m_profiler, "Frame");
 
-    const auto frameIndex = m_frameCounter % c_backBufferCount;
-    auto& frameTarget = m_swapChainTargets[frameIndex];
-    D3D12_RESOURCE_BARRIER barr;
-    barr.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    barr.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    barr.Transition.pResource = frameTarget.Resource.Get();
-    barr.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-    barr.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-    barr.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    commands.List->ResourceBarrier(1, &barr);
-
-    FLOAT color[] = {0.f, 0.f, 0.f, 0.f};
-    D3D12_RECT rect = {0, 0, (LONG)m_width, (LONG)m_height};
-    commands.List->ClearRenderTargetView(frameTarget.CpuHandle, color, 1, &rect);
-    commands.List->ClearDepthStencilView(m_depthStencil.CpuHandle, D3D12_CLEAR_FLAG_DEPTH, 0.f, 0, 1, &rect);
+    // Uploads recorded since the last frame go to the queue ahead of it
+    m_uploadContext.Flush();
 
-    scene.Update(commands.List);
+    {
+        // Blocks only when the CPU is a full set of frame contexts ahead of the device
+        ProfileScope waitScope(&m_profiler, "Frame pacing");
+        const auto waitSubmission = m_framePacer.Begin(m_frameDevice.GetCompletedSubmission());
+        if (waitSubmission != 0)
+            m_frameDevice.WaitForSubmission(waitSubmission);
+    }
+    m_gpuProfiler.BeginFrame(m_framePacer.GetCurrent());
 
-    auto accelStruct = scene.GetAccelerationStructure();
+    auto& commands = m_frames[m_framePacer.GetCurrent()];
+    if (commands.List)
+        m_device.ResetCommands(commands);
+    else
+        commands = m_device.CreateGraphicsCommands();
+    m_frameDevice.SetCommandList(commands.List);
+
+    const auto frameIndex = m_frameCounter % c_backBufferCount;
+    auto& frameTarget = m_swapChainTargets[frameIndex];
 
-    D3D12_GPU_DESCRIPTOR_HANDLE accelHandle = {};
-    if(!m_freeRaytracingHandles.empty())
+    const auto changedBounds = scene.CollectChangedBounds();
+    for (const auto& bounds : changedBounds)
+        m_radianceCascades.Invalidate(bounds);
+    if (!changedBounds.empty())
+        m_radianceCascades.UpdateBricks(scene);
     {
-        accelHandle = m_freeRaytracingHandles.back();
-        m_freeRaytracingHandles.pop_back();
+        // Instance uploads included
+        ProfileScope tlasScope(&m_profiler, "TLAS build");
+        GpuProfileScope gpuTlasScope(&m_gpuProfiler, commands.List, "TLAS build");
+        scene.Update(commands.List, m_framePacer.GetCurrent());
     }
 
+    auto accelStruct = scene.GetAccelerationStructure();
+
     D3D12_SHADER_RESOURCE_VIEW_DESC accelViewDesc;
     accelViewDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
     accelViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
     accelViewDesc.Format = DXGI_FORMAT_UNKNOWN;
     accelViewDesc.RaytracingAccelerationStructure.Location = accelStruct->GetGPUVirtualAddress();
-    accelHandle = m_device.CreateShaderResourceView(accelStruct, accelViewDesc, accelHandle);
+    // The TLAS buffer changes from frame to frame, its view lives in the transient part of the heap
+    const auto accelHandle = m_device.CreateTransientShaderResourceView(accelStruct, accelViewDesc);
+
+    RenderGraph graph;
+    const auto target = graph.Import(frameTarget.Resource.Get(), GraphState::Present, GraphState::Present);
+    const auto depth = graph.Import(m_depthStencil.Resource.Get(), GraphState::DepthWrite, GraphState::DepthWrite);
+
+    D3D12_RECT rect = {0, 0, (LONG)m_width, (LONG)m_height};
+    const auto clearPass = graph.AddPass("Clear", [&]()
+    {
+        FLOAT color[] = {0.f, 0.f, 0.f, 0.f};
+        commands.List->ClearRenderTargetView(frameTarget.CpuHandle, color, 1, &rect);
+        commands.List->ClearDepthStencilView(m_depthStencil.CpuHandle, D3D12_CLEAR_FLAG_DEPTH, 0.f, 0, 1, &rect);
+    });
+    graph.Use(clearPass, target, GraphState::RenderTarget);
+    graph.Use(clearPass, depth, GraphState::DepthWrite);
+
+    auto& cascades = m_radianceCascades.Generate(graph, commands.List, accelHandle, scene.GetInstanceDataHandle());
+    auto& cascadesHandles = m_radianceCascades.GetShaderResourceViews();
 
-    auto& cascadesHandles = m_radianceCascades.Generate(commands.List, accelHandle, scene.GetInstanceDataHandle());
-    
-    commands.List->SetPipelineState(m_drawingPipeline.State.Get());
-    commands.List->SetGraphicsRootSignature(m_drawingPipeline.RootSignature.Get());
-    
     struct 
     {
         DirectX::XMMATRIX viewProjection;
     } cameraConstants;  
     cameraConstants.viewProjection = camera.GetViewProjection();
-    m_device.SetResourceData(m_cameraConstants, cameraConstants);
-    commands.List->SetGraphicsRootConstantBufferView(0, m_cameraConstants->GetGPUVirtualAddress());
-    commands.List->SetGraphicsRootDescriptorTable(1, scene.GetInstanceDataHandle());
-    commands.List->SetGraphicsRootConstantBufferView(3, m_radianceCascades.GetConstants()->GetGPUVirtualAddress());
-    commands.List->SetGraphicsRootDescriptorTable(4, cascadesHandles[0]);
-    
-    D3D12_VIEWPORT viewport = {0.f, 0.f, (float)m_width, (float)m_height, 0.f, 1.f};
-    commands.List->RSSetScissorRects(1, &rect);
-    commands.List->RSSetViewports(1, &viewport);
-    commands.List->OMSetRenderTargets(1, &frameTarget.CpuHandle, FALSE, &m_depthStencil.CpuHandle);
-    commands.List->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    const auto cameraConstantsAddress = m_device.UploadConstants(cameraConstants);
 
-    scene.Draw(commands.List);
-
-    if(m_debugCascade >= 0)
+    if (m_gatherDownscale > 0)
     {
+        const auto gbufferPass = graph.AddPass("G-buffer", [&]()
+        {
+            commands.List->SetPipelineState(m_gbufferPipeline.State.Get());
+            commands.List->SetGraphicsRootSignature(m_gbufferPipeline.RootSignature.Get());
+
+            commands.List->SetGraphicsRootConstantBufferView(0, cameraConstantsAddress);
+            commands.List->SetGraphicsRootDescriptorTable(1, scene.GetInstanceDataHandle());
+
+            std::array<D3D12_CPU_DESCRIPTOR_HANDLE, std::size(c_gbufferFormats)> targets;
+            for (auto i = 0u; i < targets.size(); ++i)
+                targets[i] = m_gbuffer[i].CpuHandle;
+
+            D3D12_VIEWPORT viewport = {0.f, 0.f, (float)m_width, (float)m_height, 0.f, 1.f};
+            commands.List->RSSetScissorRects(1, &rect);
+            commands.List->RSSetViewports(1, &viewport);
+            commands.List->OMSetRenderTargets((UINT)targets.size(), targets.data(), FALSE, &m_depthStencil.CpuHandle);
+            commands.List->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+            scene.Draw(commands.List);
+        });
+        // Every drawn pixel overwrites them, the depth tells the rest apart
+        std::array<uint32_t, std::size(c_gbufferFormats)> gbuffer;
+        for (auto i = 0u; i < gbuffer.size(); ++i)
+        {
+            gbuffer[i] = graph.Import(m_gbuffer[i].Resource.Get(), GraphState::PixelShaderResource, GraphState::PixelShaderResource);
+            graph.Use(gbufferPass, gbuffer[i], GraphState::RenderTarget);
+        }
+        graph.Use(gbufferPass, depth, GraphState::DepthWrite);
+        const auto normals = gbuffer.back();
+
         struct
         {
-            DirectX::XMMATRIX vp;
-            DirectX::XMMATRIX model;
-            uint32_t cascade;
-        } debugConstants;
-        debugConstants.vp = cameraConstants.viewProjection;
-        debugConstants.model = DirectX::XMMatrixScaling(0.005f, 0.005f, 0.005f);
-        debugConstants.cascade = m_debugCascade;
-
-        Device::SetResourceData(m_debugCascadesConstants, debugConstants);
-
-        commands.List->SetPipelineState(m_debugCascadesPipeline.State.Get());
-        commands.List->SetGraphicsRootSignature(m_debugCascadesPipeline.RootSignature.Get());
-        commands.List->SetGraphicsRootConstantBufferView(0, m_debugCascadesConstants->GetGPUVirtualAddress());
-        commands.List->SetGraphicsRootConstantBufferView(1, m_radianceCascades.GetConstants()->GetGPUVirtualAddress());
-        commands.List->SetGraphicsRootDescriptorTable(2, cascadesHandles[debugConstants.cascade]);
-
-        auto& res = m_radianceCascades.GetResolution();
-        const auto div = 1 << debugConstants.cascade;
-        m_debugSphere->DrawInstanced(commands.List, res.x * res.y * res.z / (div * div * div));
+            DirectX::XMMATRIX inverseViewProjection;
+            uint32_t screenSize[2];
+            uint32_t gatherSize[2];
+            uint32_t downscale;
+        } deferredConstants;
+        deferredConstants.inverseViewProjection = DirectX::XMMatrixInverse(nullptr, cameraConstants.viewProjection);
+        deferredConstants.screenSize[0] = m_width;
+        deferredConstants.screenSize[1] = m_height;
+        deferredConstants.gatherSize[0] = GetGatherSize(m_width, m_gatherDownscale);
+        deferredConstants.gatherSize[1] = GetGatherSize(m_height, m_gatherDownscale);
+        deferredConstants.downscale = m_gatherDownscale;
+        const auto deferredConstantsAddress = m_device.UploadConstants(deferredConstants);
+
+        const auto gathered = graph.Import(m_gathered.Resource.Get(), GraphState::PixelShaderResource, GraphState::PixelShaderResource);
+        // Passes run after this scope, its locals are captured by value
+        const auto gatherPass = graph.AddPass("Deferred gather", [&, deferredConstantsAddress]()
+        {
+            commands.List->SetPipelineState(m_deferredGatherPipeline.State.Get());
+            commands.List->SetComputeRootSignature(m_deferredGatherPipeline.RootSignature.Get());
+            commands.List->SetComputeRootConstantBufferView(0, deferredConstantsAddress);
+            commands.List->SetComputeRootConstantBufferView(1, m_radianceCascades.GetConstants());
+            commands.List->SetComputeRootDescriptorTable(2, m_gbuffer.back().GpuHandle);
+            commands.List->SetComputeRootDescriptorTable(3, m_depthStencil.GpuHandle);
+            commands.List->SetComputeRootDescriptorTable(4, m_radianceCascades.GetIrradianceView());
+            commands.List->SetComputeRootDescriptorTable(5, m_gatheredUav);
+            commands.List->Dispatch((GetGatherSize(m_width, m_gatherDownscale) + 7) / 8, (GetGatherSize(m_height, m_gatherDownscale) + 7) / 8, 1);
+        });
+        graph.Use(gatherPass, normals, GraphState::NonPixelShaderResource);
+        graph.Use(gatherPass, depth, GraphState::NonPixelShaderResource);
+        graph.Use(gatherPass, m_radianceCascades.GetIrradianceResource(), GraphState::NonPixelShaderResource);
+        graph.Use(gatherPass, gathered, GraphState::UnorderedAccess);
+
+        const auto compositePass = graph.AddPass("Deferred composite", [&, deferredConstantsAddress]()
+        {
+            commands.List->SetPipelineState(m_deferredCompositePipeline.State.Get());
+            commands.List->SetGraphicsRootSignature(m_deferredCompositePipeline.RootSignature.Get());
+            commands.List->SetGraphicsRootConstantBufferView(0, deferredConstantsAddress);
+            commands.List->SetGraphicsRootConstantBufferView(1, m_radianceCascades.GetConstants());
+            for (auto i = 0u; i < m_gbuffer.size(); ++i)
+                commands.List->SetGraphicsRootDescriptorTable(2 + i, m_gbuffer[i].GpuHandle);
+            commands.List->SetGraphicsRootDescriptorTable(5, m_depthStencil.GpuHandle);
+            commands.List->SetGraphicsRootDescriptorTable(6, m_gathered.GpuHandle);
+            commands.List->SetGraphicsRootDescriptorTable(7, m_radianceCascades.GetIrradianceView());
+
+            D3D12_VIEWPORT viewport = {0.f, 0.f, (float)m_width, (float)m_height, 0.f, 1.f};
+            commands.List->RSSetScissorRects(1, &rect);
+            commands.List->RSSetViewports(1, &viewport);
+            commands.List->OMSetRenderTargets(1, &frameTarget.CpuHandle, FALSE, nullptr);
+            commands.List->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            commands.List->DrawInstanced(3, 1, 0, 0);
+        });
+        graph.Use(compositePass, target, GraphState::RenderTarget);
+        for (const auto resource : gbuffer)
+            graph.Use(compositePass, resource, GraphState::PixelShaderResource);
+        graph.Use(compositePass, depth, GraphState::PixelShaderResource);
+        graph.Use(compositePass, gathered, GraphState::PixelShaderResource);
+        graph.Use(compositePass, m_radianceCascades.GetIrradianceResource(), GraphState::PixelShaderResource);
+    }
+    else
+    {
+        const auto drawPass = graph.AddPass("Draw", [&]()
+        {
+            commands.List->SetPipelineState(m_drawingPipeline.State.Get());
+            commands.List->SetGraphicsRootSignature(m_drawingPipeline.RootSignature.Get());
+
+            commands.List->SetGraphicsRootConstantBufferView(0, cameraConstantsAddress);
+            commands.List->SetGraphicsRootDescriptorTable(1, scene.GetInstanceDataHandle());
+            commands.List->SetGraphicsRootConstantBufferView(3, m_radianceCascades.GetConstants());
+            commands.List->SetGraphicsRootDescriptorTable(4, m_radianceCascades.GetIrradianceView());
+
+            D3D12_VIEWPORT viewport = {0.f, 0.f, (float)m_width, (float)m_height, 0.f, 1.f};
+            commands.List->RSSetScissorRects(1, &rect);
+            commands.List->RSSetViewports(1, &viewport);
+            commands.List->OMSetRenderTargets(1, &frameTarget.CpuHandle, FALSE, &m_depthStencil.CpuHandle);
+            commands.List->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+            scene.Draw(commands.List);
+        });
+        graph.Use(drawPass, target, GraphState::RenderTarget);
+        graph.Use(drawPass, depth, GraphState::DepthWrite);
+        graph.Use(drawPass, m_radianceCascades.GetIrradianceResource(), GraphState::PixelShaderResource);
     }
 
-    barr.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-    barr.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-    commands.List->ResourceBarrier(1, &barr);
+    if(m_debugCascade >= 0)
+    {
+        const auto debugPass = graph.AddPass("Debug cascades", [&]()
+        {
+            struct
+            {
+                DirectX::XMMATRIX vp;
+                DirectX::XMMATRIX model;
+                uint32_t cascade;
+            } debugConstants;
+            debugConstants.vp = cameraConstants.viewProjection;
+            debugConstants.model = DirectX::XMMatrixScaling(0.005f, 0.005f, 0.005f);
+            debugConstants.cascade = m_debugCascade;
+
+            const auto debugConstantsAddress = m_device.UploadConstants(debugConstants);
 
-    const auto submission = m_device.SubmitGraphicsCommands(std::move(commands));
+            commands.List->SetPipelineState(m_debugCascadesPipeline.State.Get());
+            commands.List->SetGraphicsRootSignature(m_debugCascadesPipeline.RootSignature.Get());
+            commands.List->SetGraphicsRootConstantBufferView(0, debugConstantsAddress);
+            commands.List->SetGraphicsRootConstantBufferView(1, m_radianceCascades.GetConstants());
+            commands.List->SetGraphicsRootDescriptorTable(2, cascadesHandles[debugConstants.cascade]);
+            commands.List->SetGraphicsRootShaderResourceView(3, m_radianceCascades.GetBricks());
+
+            auto& res = m_radianceCascades.GetResolution();
+            const auto div = 1 << debugConstants.cascade;
+            m_debugSphere->DrawInstanced(commands.List, res.x * res.y * res.z / (div * div * div));
+        });
+        graph.Use(debugPass, target, GraphState::RenderTarget);
+        graph.Use(debugPass, depth, GraphState::DepthWrite);
+        graph.Use(debugPass, cascades[m_debugCascade], GraphState::AllShaderResource);
+    }
+
+    graph.Compile();
+    {
+        // The CPU scopes cover recording the passes, the GPU ones running them without the barriers in between
+        ProfileScope executeScope(&m_profiler, "Graph execution");
+        graph.Execute([&](const std::vector<GraphBarrier>& barriers)
+        {
+            m_frameDevice.RecordBarriers(graph, barriers);
+        }, [&](uint32_t pass, const RenderGraph::Execution& execution)
+        {
+            ProfileScope passScope(&m_profiler, graph.GetPassName(pass));
+            GpuProfileScope gpuPassScope(&m_gpuProfiler, commands.List, graph.GetPassName(pass));
+            execution();
+        });
+    }
+    m_radianceCascades.UpdateStates(graph);
+    m_gpuProfiler.EndFrame(commands.List);
 
-    m_pendingRaytracingResources.push_back({accelStruct, accelHandle, submission});
-    const auto finishedSubmission = m_device.GetCompletedSubmission();
-    while (!m_pendingRaytracingResources.empty() && m_pendingRaytracingResources.front().Submission <= finishedSubmission)
     {
-        m_freeRaytracingHandles.push_back(m_pendingRaytracingResources.front().Handle);
-        m_pendingRaytracingResources.pop_front();
+        ProfileScope submitScope(&m_profiler, "Submit");
+        const auto submission = m_frameDevice.Submit();
+        m_framePacer.End(submission);
+        scene.Submit(submission);
     }
 
-    m_swapChain->Present(1, 0);
+    {
+        ProfileScope presentScope(&m_profiler, "Present");
+        m_swapChain->Present(1, 0);
+    }
 
     ++m_frameCounter;
 }
 
+void Renderer::CreateDeferredTargets()
+{
+    for (auto i = 0u; i < m_gbuffer.size(); ++i)
+    {
+        auto& target = m_gbuffer[i];
+        target.Resource = m_device.CreateTexture(c_gbufferFormats[i], m_width, m_height, 1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+        target.CpuHandle = m_device.CreateRenderTargetView(target.Resource, c_gbufferFormats[i]);
+        target.GpuHandle = m_device.CreateShaderResourceView(target.Resource, GetTextureViewDesc(c_gbufferFormats[i]));
+    }
+    m_depthStencil.GpuHandle = m_device.CreateShaderResourceView(m_depthStencil.Resource, GetTextureViewDesc(DXGI_FORMAT_R32_FLOAT));
+
+    // Irradiance and linear depth of every gathered pixel
+    m_gathered.Resource = m_device.CreateTexture(DXGI_FORMAT_R16G16B16A16_FLOAT, GetGatherSize(m_width, m_gatherDownscale), GetGatherSize(m_height, m_gatherDownscale), 1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    m_gathered.GpuHandle = m_device.CreateShaderResourceView(m_gathered.Resource, GetTextureViewDesc(DXGI_FORMAT_R16G16B16A16_FLOAT));
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+    uavDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    uavDesc.Texture2D.MipSlice = 0;
+    uavDesc.Texture2D.PlaneSlice = 0;
+    m_gatheredUav = m_device.CreateUnorderedAccessView(m_gathered.Resource, uavDesc);
+
+    m_gbufferPipeline = m_device.CreateDrawingPipeline(Model::GetPositionFormat(m_meshLayout), Model::GetNormalFormat(m_meshLayout), true);
+    m_deferredGatherPipeline = m_device.CreateDeferredGatherPipeline();
+    m_deferredCompositePipeline = m_device.CreateDeferredCompositePipeline();
+}
+
 void Renderer::Finish()
 {
     m_device.Finish();
@@ -1,11 +1,36 @@
 #include "Scene.h"
 
-Scene::Scene(Device& device)
+namespace
+{
+    // Same rows as D3D12_RAYTRACING_INSTANCE_DESC::Transform
+    Float3x4 ToFloat3x4(const DirectX::XMMATRIX& transform)
+    {
+        const auto transposedTransform = DirectX::XMMatrixTranspose(transform);
+        Float3x4 ret;
+        std::memcpy(ret.m, &transposedTransform, sizeof(ret.m));
+        return ret;
+    }
+}
+
+Scene::Scene(Device& device, uint32_t framesInFlight)
     : m_device(device)
+    , m_dirtyInstances(c_instanceCount)
 {
-    m_instanceDataCpu = device.CreateBuffer(c_instanceDataSize, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
     m_instanceDataGpu = device.CreateBuffer(c_instanceDataSize);
-    m_tlasBuildData = device.CreateBuffer(c_instanceDataSize * sizeof(D3D12_RAYTRACING_INSTANCE_DESC), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
+
+    m_contexts.reserve(framesInFlight);
+    for (auto i = 0u; i < framesInFlight; ++i)
+    {
+        FrameContext context = {nullptr, nullptr, nullptr, nullptr, DirtyRanges(c_instanceCount)};
+        context.InstanceData = device.CreateBuffer(c_instanceDataSize, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
+        context.BuildData = device.CreateBuffer(c_instanceCount * sizeof(D3D12_RAYTRACING_INSTANCE_DESC), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, true);
+
+        // Upload buffers stay mapped, they are only written
+        D3D12_RANGE readRange = {0, 0};
+        context.InstanceData->Map(0, &readRange, (void**)&context.InstanceDataPtr);
+        context.BuildData->Map(0, &readRange, (void**)&context.BuildDataPtr);
+        m_contexts.push_back(std::move(context));
+    }
 
     D3D12_SHADER_RESOURCE_VIEW_DESC instanceDataViewDesc;
     instanceDataViewDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
@@ -18,30 +43,38 @@ Scene::Scene(Device& device)
     m_instanceDataHandle = device.CreateShaderResourceView(m_instanceDataGpu, instanceDataViewDesc);
 
     m_modelRefs.reserve(c_instanceCount);
-
-    D3D12_RANGE range = {0, c_instanceDataSize};
-    m_instanceDataCpu->Map(0, &range, (void**)&m_instanceDataPtr);
 }
 
-void Scene::Update(const ComPtr<ID3D12GraphicsCommandList>& commandList)
+void Scene::Update(const ComPtr<ID3D12GraphicsCommandList>& commandList, uint32_t context)
 {
-    if(m_transformsDirty || m_instanceDataDirty)
+    // Frames still in flight read the upload buffers of the other contexts, only this one is brought up to date with
+    // every instance written since it was last used
+    auto& frame = m_contexts[context];
+    const auto count = (uint32_t)m_modelRefs.size();
+    for (const auto& range : frame.Dirty.Collect(count))
     {
-        D3D12_RANGE writeRange = {0, c_instanceDataSize};
-        m_instanceDataCpu->Unmap(0, &writeRange);
-
-        commandList->CopyResource(m_instanceDataGpu.Get(), m_instanceDataCpu.Get());
-        
-        m_instanceDataCpu->Map(0, nullptr, (void**)&m_instanceDataPtr);
+        std::memcpy(frame.InstanceDataPtr + range.Begin, m_instances.data() + range.Begin, (range.End - range.Begin) * sizeof(Instance));
+        std::memcpy(frame.BuildDataPtr + range.Begin, m_instanceDescs.data() + range.Begin, (range.End - range.Begin) * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
     }
 
-    if(m_transformsDirty)
+    // Only the instances written since the last update are copied to the GPU buffer
+    for (const auto& range : m_dirtyInstances.Collect(count))
     {
-        m_tlas = m_device.CreateTopLevelAccelerationStructure(commandList.Get(), m_tlasBuildData.Get(), (uint32_t)m_modelRefs.size());
+        const auto offset = range.Begin * sizeof(Instance);
+        const auto size = (range.End - range.Begin) * sizeof(Instance);
+        commandList->CopyBufferRegion(m_instanceDataGpu.Get(), offset, frame.InstanceData.Get(), offset, size);
     }
 
+    TlasBackend backend = {m_device, commandList, frame.BuildData};
+    m_tlasUpdater.Update(backend, count, m_instancesChanged, m_transformsDirty);
+
     m_transformsDirty = false;
-    m_instanceDataDirty = false;
+    m_instancesChanged = false;
+}
+
+void Scene::Submit(uint64_t submission)
+{
+    m_tlasUpdater.Submit(submission);
 }
 
 void Scene::Draw(const ComPtr<ID3D12GraphicsCommandList>& commandList)
@@ -58,49 +91,85 @@ uint32_t Scene::AddInstance(const Model& model, const DirectX::XMMATRIX& transfo
 
     const uint32_t instanceId = (uint32_t)m_modelRefs.size();
     m_modelRefs.push_back(&model);
+    m_instances.push_back({transform, albedo, emission});
 
-    auto& instance = m_instanceDataPtr[instanceId];
-    instance.Transform = transform;
-    instance.Albedo = albedo;
-    instance.Emission = emission;
-
-    D3D12_RAYTRACING_INSTANCE_DESC* buildData;
-    m_tlasBuildData->Map(0, nullptr, (void**)&buildData);
-
-    const auto transposedTransform = DirectX::XMMatrixTranspose(transform);
-
-    auto& instanceBuildData = buildData[instanceId];
+    D3D12_RAYTRACING_INSTANCE_DESC instanceBuildData = {};
     instanceBuildData.AccelerationStructure = model.GetBLAS()->GetGPUVirtualAddress();
     instanceBuildData.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE; //D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE;
     instanceBuildData.InstanceContributionToHitGroupIndex = 0;
     instanceBuildData.InstanceID = instanceId;
     instanceBuildData.InstanceMask = 0xFF;
-    std::memcpy(instanceBuildData.Transform, &transposedTransform, sizeof(instanceBuildData.Transform));
+    m_instanceTransforms.push_back(ToFloat3x4(transform));
+    std::memcpy(instanceBuildData.Transform, m_instanceTransforms.back().m, sizeof(instanceBuildData.Transform));
+    m_instanceDescs.push_back(instanceBuildData);
 
-    D3D12_RANGE writeRange = {instanceId * sizeof(D3D12_RAYTRACING_INSTANCE_DESC), (instanceId + 1) * sizeof(D3D12_RAYTRACING_INSTANCE_DESC) };
-    m_tlasBuildData->Unmap(0, &writeRange);
+    m_instanceBounds.push_back(TransformBounds(model.GetBounds(), m_instanceTransforms.back()));
+    m_changedBounds.push_back(m_instanceBounds.back());
 
-    m_transformsDirty = true;
-    m_instanceDataDirty = true;
+    m_instancesChanged = true;
+    MarkDirty(instanceId);
 
     return instanceId;
 }
 
 void Scene::SetInstanceTransform(uint32_t instanceId, const DirectX::XMMATRIX& transform)
 {
-    auto& instance = m_instanceDataPtr[instanceId];
-    instance.Transform = transform;
+    m_instances[instanceId].Transform = transform;
+
+    m_instanceTransforms[instanceId] = ToFloat3x4(transform);
+    std::memcpy(m_instanceDescs[instanceId].Transform, m_instanceTransforms[instanceId].m, sizeof(m_instanceDescs[instanceId].Transform));
+
+    auto& bounds = m_instanceBounds[instanceId];
+    m_changedBounds.push_back(bounds);
+    bounds = TransformBounds(m_modelRefs[instanceId]->GetBounds(), m_instanceTransforms[instanceId]);
+    m_changedBounds.push_back(bounds);
+
+    m_transformsDirty = true;
+    MarkDirty(instanceId);
+}
+
+void Scene::SetInstanceAlbedo(uint32_t instanceId, const DirectX::XMVECTOR& albedo)
+{
+    m_instances[instanceId].Albedo = albedo;
+    MarkDirty(instanceId);
+}
 
-    D3D12_RAYTRACING_INSTANCE_DESC* buildData;
-    m_tlasBuildData->Map(0, nullptr, (void**)&buildData);
+void Scene::SetInstanceEmission(uint32_t instanceId, const DirectX::XMVECTOR& emission)
+{
+    m_instances[instanceId].Emission = emission;
+    MarkDirty(instanceId);
+}
 
-    const auto transposedTransform = DirectX::XMMatrixTranspose(transform);
+std::vector<Aabb> Scene::CollectChangedBounds()
+{
+    auto ret = std::move(m_changedBounds);
+    m_changedBounds.clear();
+    return ret;
+}
 
-    auto& instanceBuildData = buildData[instanceId];
-    std::memcpy(instanceBuildData.Transform, &transposedTransform, sizeof(instanceBuildData.Transform));
+void Scene::MarkDirty(uint32_t instanceId)
+{
+    m_dirtyInstances.Mark(instanceId);
+    for (auto& context : m_contexts)
+        context.Dirty.Mark(instanceId);
+}
 
-    D3D12_RANGE writeRange = {instanceId * sizeof(D3D12_RAYTRACING_INSTANCE_DESC), (instanceId + 1) * sizeof(D3D12_RAYTRACING_INSTANCE_DESC) };
-    m_tlasBuildData->Unmap(0, &writeRange);
+uint64_t Scene::TlasBackend::GetResultSize(uint32_t count)
+{
+    return Gpu.GetTopLevelAccelerationStructureSize(InstanceBuffer, count);
+}
 
-    m_transformsDirty = true;
+Scene::TlasBackend::Buffer Scene::TlasBackend::CreateBuffer(uint64_t size)
+{
+    return Gpu.CreateBuffer(size, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+}
+
+void Scene::TlasBackend::Build(const Buffer& dest, const Buffer* source, uint32_t count)
+{
+    Gpu.BuildTopLevelAccelerationStructure(CommandList, InstanceBuffer, count, dest, source ? *source : Buffer());
+}
+
+uint64_t Scene::TlasBackend::GetCompletedSubmission()
+{
+    return Gpu.GetCompletedSubmission();
 }
\ No newline at end of file
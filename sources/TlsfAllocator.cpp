@@ -0,0 +1,238 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    uint32_t HighestBit(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    uint32_t LowestBit(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint64_t granularity)
+    : m_capacity(capacity / granularity * granularity)
+    , m_granularity(granularity)
+{
+    assert(granularity > 0 && (granularity & (granularity - 1)) == 0);
+
+    for (auto& heads : m_heads)
+        std::fill(std::begin(heads), std::end(heads), c_null);
+
+    if (m_capacity > 0)
+        InsertFree(NewBlock(0, m_capacity / m_granularity, c_null, c_null));
+}
+
+TlsfAllocation TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    const auto granules = std::max<uint64_t>((size + m_granularity - 1) / m_granularity, 1);
+    // Worst case padding in front of the first aligned offset of a block
+    const auto padding = alignment > m_granularity ? alignment / m_granularity - 1 : 0;
+
+    const auto block = FindFree(granules + padding);
+    if (block == c_null)
+        return {c_invalidOffset, c_null};
+    RemoveFree(block);
+
+    const auto offset = m_blocks[block].Offset;
+    const auto aligned = (offset + alignment - 1) & ~(alignment - 1);
+    if (aligned != offset)
+    {
+        const auto front = NewBlock(offset, (aligned - offset) / m_granularity, m_blocks[block].PrevPhysical, block);
+        if (m_blocks[front].PrevPhysical != c_null)
+            m_blocks[m_blocks[front].PrevPhysical].NextPhysical = front;
+        m_blocks[block].PrevPhysical = front;
+        m_blocks[block].Offset = aligned;
+        m_blocks[block].Size -= m_blocks[front].Size;
+        InsertFree(front);
+    }
+
+    SplitTail(block, granules);
+    m_blocks[block].Free = false;
+    m_usedBytes += granules * m_granularity;
+    ++m_allocationCount;
+
+    return {aligned, block};
+}
+
+void TlsfAllocator::Free(const TlsfAllocation& allocation)
+{
+    auto block = allocation.Block;
+    assert(block < m_blocks.size() && !m_blocks[block].Free && m_blocks[block].Offset == allocation.Offset);
+
+    m_blocks[block].Free = true;
+    m_usedBytes -= m_blocks[block].Size * m_granularity;
+    --m_allocationCount;
+
+    const auto prev = m_blocks[block].PrevPhysical;
+    if (prev != c_null && m_blocks[prev].Free)
+    {
+        RemoveFree(prev);
+        block = MergePhysical(prev, block);
+    }
+
+    const auto next = m_blocks[block].NextPhysical;
+    if (next != c_null && m_blocks[next].Free)
+    {
+        RemoveFree(next);
+        block = MergePhysical(block, next);
+    }
+
+    InsertFree(block);
+}
+
+TlsfStats TlsfAllocator::GetStats() const
+{
+    TlsfStats stats;
+    stats.Capacity = m_capacity;
+    stats.UsedBytes = m_usedBytes;
+    stats.AllocationCount = m_allocationCount;
+    for (auto& block : m_blocks)
+    {
+        if (!block.Free)
+            continue;
+        ++stats.FreeBlockCount;
+        stats.LargestFreeBlock = std::max(stats.LargestFreeBlock, block.Size * m_granularity);
+    }
+    return stats;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size < c_secondLevelCount)
+    {
+        firstLevel = 0;
+        secondLevel = (uint32_t)size;
+        return;
+    }
+
+    const auto highest = HighestBit(size);
+    firstLevel = highest - c_secondLevelLog2 + 1;
+    secondLevel = (uint32_t)(size >> (highest - c_secondLevelLog2)) - c_secondLevelCount;
+}
+
+uint32_t TlsfAllocator::NewBlock(uint64_t offset, uint64_t size, uint32_t prevPhysical, uint32_t nextPhysical)
+{
+    const Block block = {offset, size, prevPhysical, nextPhysical, c_null, c_null, false};
+    if (m_unusedBlocks.empty())
+    {
+        m_blocks.push_back(block);
+        return (uint32_t)m_blocks.size() - 1;
+    }
+
+    const auto index = m_unusedBlocks.back();
+    m_unusedBlocks.pop_back();
+    m_blocks[index] = block;
+    return index;
+}
+
+void TlsfAllocator::InsertFree(uint32_t block)
+{
+    uint32_t firstLevel, secondLevel;
+    Mapping(m_blocks[block].Size, firstLevel, secondLevel);
+
+    auto& head = m_heads[firstLevel][secondLevel];
+    m_blocks[block].Free = true;
+    m_blocks[block].PrevFree = c_null;
+    m_blocks[block].NextFree = head;
+    if (head != c_null)
+        m_blocks[head].PrevFree = block;
+    head = block;
+
+    m_firstLevelMask |= 1ull << firstLevel;
+    m_secondLevelMasks[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block)
+{
+    uint32_t firstLevel, secondLevel;
+    Mapping(m_blocks[block].Size, firstLevel, secondLevel);
+
+    const auto prev = m_blocks[block].PrevFree;
+    const auto next = m_blocks[block].NextFree;
+    if (prev != c_null)
+        m_blocks[prev].NextFree = next;
+    else
+        m_heads[firstLevel][secondLevel] = next;
+    if (next != c_null)
+        m_blocks[next].PrevFree = prev;
+
+    if (m_heads[firstLevel][secondLevel] == c_null)
+    {
+        m_secondLevelMasks[firstLevel] &= ~(1u << secondLevel);
+        if (m_secondLevelMasks[firstLevel] == 0)
+            m_firstLevelMask &= ~(1ull << firstLevel);
+    }
+}
+
+uint32_t TlsfAllocator::FindFree(uint64_t size) const
+{
+    // Rounding up to the next class start makes every block of the found class large enough
+    if (size >= c_secondLevelCount)
+        size += (1ull << (HighestBit(size) - c_secondLevelLog2)) - 1;
+
+    uint32_t firstLevel, secondLevel;
+    Mapping(size, firstLevel, secondLevel);
+
+    auto secondLevelMask = m_secondLevelMasks[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMask == 0)
+    {
+        const auto firstLevelMask = firstLevel + 1 < 64 ? m_firstLevelMask & (~0ull << (firstLevel + 1)) : 0;
+        if (firstLevelMask == 0)
+            return c_null;
+        firstLevel = LowestBit(firstLevelMask);
+        secondLevelMask = m_secondLevelMasks[firstLevel];
+    }
+
+    return m_heads[firstLevel][LowestBit(secondLevelMask)];
+}
+
+void TlsfAllocator::SplitTail(uint32_t block, uint64_t size)
+{
+    if (m_blocks[block].Size <= size)
+        return;
+
+    const auto tail = NewBlock(m_blocks[block].Offset + size * m_granularity, m_blocks[block].Size - size, block, m_blocks[block].NextPhysical);
+    if (m_blocks[tail].NextPhysical != c_null)
+        m_blocks[m_blocks[tail].NextPhysical].PrevPhysical = tail;
+    m_blocks[block].NextPhysical = tail;
+    m_blocks[block].Size = size;
+    InsertFree(tail);
+}
+
+uint32_t TlsfAllocator::MergePhysical(uint32_t first, uint32_t second)
+{
+    m_blocks[first].Size += m_blocks[second].Size;
+    m_blocks[first].NextPhysical = m_blocks[second].NextPhysical;
+    if (m_blocks[first].NextPhysical != c_null)
+        m_blocks[m_blocks[first].NextPhysical].PrevPhysical = first;
+
+    m_blocks[second].Free = false;
+    m_blocks[second].Size = 0;
+    m_unusedBlocks.push_back(second);
+    return first;
+}
@@ -0,0 +1,242 @@
+#include "UploadContext.h"
+
+namespace
+{
+    template<typename T, typename U>
+    T roundUp(T value, U align)
+    {
+        return ((value + align - 1) / align) * align;
+    }
+}
+
+UploadContext::UploadContext(Device& device, uint64_t stagingSize)
+    : m_device(device)
+    , m_ring(roundUp(stagingSize, c_stagingAlignment))
+{
+    m_staging = device.CreateBuffer(m_ring.GetCapacity(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_FLAG_NONE, true);
+    D3D12_RANGE readRange = {0, 0};
+    m_staging->Map(0, &readRange, (void**)&m_stagingPtr);
+    assert(m_stagingPtr);
+}
+
+VertexBuffer UploadContext::CreateVertexBuffer(const void* data, uint64_t size, uint32_t stride, DXGI_FORMAT format)
+{
+    VertexBuffer ret;
+    ret.Resource = UploadBuffer(data, size);
+    ret.View.BufferLocation = ret.Resource->GetGPUVirtualAddress();
+    ret.View.SizeInBytes = (UINT)size;
+    ret.View.StrideInBytes = stride;
+    ret.Format = format;
+    return ret;
+}
+
+IndexBuffer UploadContext::CreateIndexBuffer(const void* data, uint64_t size, DXGI_FORMAT format)
+{
+    assert(format == DXGI_FORMAT_R32_UINT || format == DXGI_FORMAT_R16_UINT);
+
+    IndexBuffer ret;
+    ret.Resource = UploadBuffer(data, size);
+    ret.View.BufferLocation = ret.Resource->GetGPUVirtualAddress();
+    ret.View.SizeInBytes = (UINT)size;
+    ret.View.Format = format;
+    return ret;
+}
+
+ComPtr<ID3D12Resource> UploadContext::CreateBottomLevelAccelerationStructure(const VertexBuffer& vertices, const IndexBuffer& indices, uint32_t vertexCount, uint32_t indexCount, const float* transform)
+{
+    // Only read by the build, lives until the batch has completed
+    ComPtr<ID3D12Resource> transformBuffer;
+    if (transform)
+        transformBuffer = UploadBuffer(transform, 12 * sizeof(float));
+
+    D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc;
+    geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+    geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+    geometryDesc.Triangles.IndexBuffer = indices.Resource->GetGPUVirtualAddress();
+    geometryDesc.Triangles.IndexCount = indexCount;
+    geometryDesc.Triangles.IndexFormat = indices.View.Format;
+    geometryDesc.Triangles.Transform3x4 = transformBuffer ? transformBuffer->GetGPUVirtualAddress() : 0;
+    geometryDesc.Triangles.VertexBuffer = {vertices.Resource->GetGPUVirtualAddress(), vertices.View.StrideInBytes};
+    geometryDesc.Triangles.VertexCount = vertexCount;
+    geometryDesc.Triangles.VertexFormat = vertices.Format;
+
+    ComPtr<ID3D12Device5> device;
+    static_cast<ID3D12Device*>(m_device)->QueryInterface(IID_PPV_ARGS(&device));
+    assert(device);
+
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info;
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs;
+    inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+    inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+    inputs.NumDescs = 1;
+    inputs.pGeometryDescs = &geometryDesc;
+    device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
+
+    const auto ret = m_device.CreateBuffer(roundUp(info.ResultDataMaxSizeInBytes, 256), D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
+    buildDesc.Inputs = inputs;
+    buildDesc.DestAccelerationStructureData = ret->GetGPUVirtualAddress();
+    buildDesc.SourceAccelerationStructureData = 0;
+
+    auto& commands = GetCommands();
+    ComPtr<ID3D12GraphicsCommandList4> commandList;
+    commands.List.As(&commandList);
+    assert(commandList);
+
+    buildDesc.ScratchAccelerationStructureData = AllocateScratch(roundUp(info.ScratchDataSizeInBytes, 256));
+
+    // Geometry copied in this batch was promoted to COPY_DEST, builds read it as a non-pixel shader resource
+    if (!m_copiedBuffers.empty())
+    {
+        std::vector<D3D12_RESOURCE_BARRIER> barriers(m_copiedBuffers.size());
+        for (auto i = 0u; i < barriers.size(); ++i)
+        {
+            barriers[i].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            barriers[i].Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            barriers[i].Transition.pResource = m_copiedBuffers[i].Get();
+            barriers[i].Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+            barriers[i].Transition.StateAfter = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+            barriers[i].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        }
+        commandList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+        m_copiedBuffers.clear();
+    }
+
+    commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+
+    m_batchResources.push_back(ret);
+    m_hasBuilds = true;
+
+    return ret;
+}
+
+UploadTicket UploadContext::Flush()
+{
+    if (!m_commands.List)
+        return {m_lastSubmission};
+
+    if (m_hasBuilds)
+    {
+        D3D12_RESOURCE_BARRIER barr;
+        barr.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+        barr.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        barr.UAV.pResource = nullptr;
+        m_commands.List->ResourceBarrier(1, &barr);
+    }
+
+    m_lastSubmission = m_device.SubmitGraphicsCommands(std::move(m_commands));
+    m_commands = {};
+
+    m_ring.Submit(m_lastSubmission);
+    if (m_scratch)
+    {
+        m_scratchPool.Release(std::move(m_scratch), m_scratchSize);
+        m_scratch = nullptr;
+    }
+    m_scratchPool.Submit(m_lastSubmission);
+    for (auto& resource : m_batchResources)
+        m_pendingResources.push_back({std::move(resource), m_lastSubmission});
+    m_batchResources.clear();
+    m_copiedBuffers.clear();
+    m_hasBuilds = false;
+
+    Retire();
+
+    return {m_lastSubmission};
+}
+
+bool UploadContext::IsComplete(const UploadTicket& ticket) const
+{
+    return m_device.GetCompletedSubmission() >= ticket.Submission;
+}
+
+void UploadContext::Wait(const UploadTicket& ticket)
+{
+    m_device.WaitForSubmission(ticket.Submission);
+    Retire();
+}
+
+ComPtr<ID3D12Resource> UploadContext::UploadBuffer(const void* data, uint64_t size)
+{
+    const auto gpuBuffer = m_device.CreateBuffer(size);
+
+    Retire();
+    auto offset = m_ring.Allocate(size, c_stagingAlignment);
+    if (offset == UploadRing::c_invalidOffset && size <= m_ring.GetCapacity())
+    {
+        // Ring is full: submit what is recorded and wait for the oldest batches until there is room
+        Flush();
+        while (offset == UploadRing::c_invalidOffset && m_ring.GetOldestSubmission() != 0)
+        {
+            Wait({m_ring.GetOldestSubmission()});
+            offset = m_ring.Allocate(size, c_stagingAlignment);
+        }
+    }
+
+    auto& commands = GetCommands();
+    if (offset != UploadRing::c_invalidOffset)
+    {
+        std::memcpy(m_stagingPtr + offset, data, size);
+        commands.List->CopyBufferRegion(gpuBuffer.Get(), 0, m_staging.Get(), offset, size);
+    }
+    else
+    {
+        // Larger than the whole ring, stage through a dedicated buffer released with the batch
+        const auto stagingBuffer = m_device.CreateBuffer(size, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_FLAG_NONE, true);
+        Device::SetResourceData(stagingBuffer, *(const uint8_t*)data, size);
+        commands.List->CopyBufferRegion(gpuBuffer.Get(), 0, stagingBuffer.Get(), 0, size);
+        m_batchResources.push_back(stagingBuffer);
+    }
+
+    m_copiedBuffers.push_back(gpuBuffer);
+    m_batchResources.push_back(gpuBuffer);
+    return gpuBuffer;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS UploadContext::AllocateScratch(uint64_t size)
+{
+    if (size > c_scratchArenaSize)
+    {
+        // Too large to share, a dedicated buffer released with the batch
+        const auto scratch = m_device.CreateBuffer(size, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        m_batchResources.push_back(scratch);
+        return scratch->GetGPUVirtualAddress();
+    }
+
+    if (!m_scratch)
+    {
+        if (!m_scratchPool.Acquire(c_scratchArenaSize, m_device.GetCompletedSubmission(), m_scratch, m_scratchSize))
+        {
+            m_scratch = m_device.CreateBuffer(c_scratchArenaSize, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            m_scratchSize = c_scratchArenaSize;
+        }
+        m_scratchOffset = 0;
+    }
+    else if (m_scratchOffset + size > m_scratchSize)
+    {
+        // Builds recorded so far finish before the ones aliasing their scratch memory start
+        Device::PipelineBarrierUav(m_commands.List, m_scratch);
+        m_scratchOffset = 0;
+    }
+
+    const auto address = m_scratch->GetGPUVirtualAddress() + m_scratchOffset;
+    m_scratchOffset += size;
+    return address;
+}
+
+Commands& UploadContext::GetCommands()
+{
+    if (!m_commands.List)
+        m_commands = m_device.CreateGraphicsCommands();
+    return m_commands;
+}
+
+void UploadContext::Retire()
+{
+    const auto completed = m_device.GetCompletedSubmission();
+    m_ring.Retire(completed);
+    while (!m_pendingResources.empty() && m_pendingResources.front().Submission <= completed)
+        m_pendingResources.pop_front();
+}
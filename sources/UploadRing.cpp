@@ -0,0 +1,57 @@
+#include "UploadRing.h"
+
+#include <cassert>
+
+UploadRing::UploadRing(uint64_t capacity)
+    : m_capacity(capacity)
+{
+}
+
+uint64_t UploadRing::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(alignment > 0 && m_capacity % alignment == 0);
+    if (size > m_capacity)
+        return c_invalidOffset;
+
+    auto start = (m_head + alignment - 1) / alignment * alignment;
+    if (start % m_capacity + size > m_capacity)
+        start = (start / m_capacity + 1) * m_capacity;
+
+    if (start + size - m_tail > m_capacity)
+        return c_invalidOffset;
+
+    m_head = start + size;
+    return start % m_capacity;
+}
+
+void UploadRing::Submit(uint64_t submission)
+{
+    if (m_head == m_submittedHead)
+        return;
+
+    assert(m_blocks.empty() || m_blocks.back().Submission <= submission);
+    m_blocks.push_back({submission, m_head});
+    m_submittedHead = m_head;
+}
+
+void UploadRing::Retire(uint64_t completedSubmission)
+{
+    while (!m_blocks.empty() && m_blocks.front().Submission <= completedSubmission)
+    {
+        m_tail = m_blocks.front().End;
+        m_blocks.pop_front();
+    }
+
+    // Fully drained, restart at the beginning to keep large allocations contiguous
+    if (m_blocks.empty() && m_head == m_submittedHead)
+    {
+        m_head = 0;
+        m_tail = 0;
+        m_submittedHead = 0;
+    }
+}
+
+uint64_t UploadRing::GetOldestSubmission() const
+{
+    return m_blocks.empty() ? 0 : m_blocks.front().Submission;
+}
@@ -0,0 +1,56 @@
+#include "CascadeBricks.h"
+#include "Check.h"
+#include "CpuCascades.h"
+#include "TestScene.h"
+
+namespace
+{
+    constexpr CascadeResultion c_resolution = {16, 16, 16};
+    constexpr CascadeExtends c_extends = {1.f, 1.f, 1.f};
+    constexpr CascadeOffset c_offset = {0.f, 1.f, 0.f};
+    constexpr uint32_t c_cascadeCount = 3;
+
+    void TestSparseMatchesDense()
+    {
+        // Only the emitter is occupied, so residency stays partial, and every resident probe merges like the dense one
+        TestScene scene;
+        const auto& topology = GetTopology(CascadeTopologyId::Fast);
+        CascadeBricks bricks(c_resolution, c_extends, c_offset, c_cascadeCount);
+        bricks.Occupy(scene.MoveEmitter(0).second);
+        bricks.Update();
+
+        CpuCascades dense(c_resolution, c_extends, c_offset, c_cascadeCount, CascadeFormat::Rgba16f, topology);
+        CpuCascades sparse(c_resolution, c_extends, c_offset, c_cascadeCount, CascadeFormat::Rgba16f, topology);
+        sparse.SetBricks(&bricks);
+        dense.Generate(scene.GetScene());
+        sparse.Generate(scene.GetScene());
+
+        for (auto i = 0u; i < c_cascadeCount; ++i)
+        {
+            CHECK(bricks.GetResidentCount(i) > 0);
+            CHECK(bricks.GetResidentCount(i) <= bricks.GetBrickCount(i));
+            const auto pixelCount = topology.GetPixelCount(i);
+            for (auto z = 0u; z < dense.GetDepth(i); ++z)
+            {
+                for (auto y = 0u; y < dense.GetHeight(i); ++y)
+                {
+                    for (auto x = 0u; x < dense.GetWidth(i); ++x)
+                    {
+                        if (!bricks.IsResident(i, x / pixelCount[0], y / pixelCount[1], z))
+                            continue;
+                        const auto expected = dense.Load(i, x, y, z);
+                        const auto actual = sparse.Load(i, x, y, z);
+                        CHECK(actual.x == expected.x && actual.y == expected.y && actual.z == expected.z && actual.w == expected.w);
+                    }
+                }
+            }
+        }
+        CHECK(bricks.GetResidentCount(0) < bricks.GetBrickCount(0));
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestSparseMatchesDense);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Unlike assert the checks stay in release builds, the first failing one ends the test with its location
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::exit(1); \
+        } \
+    } while (false)
+
+// Runs a test function and reports it, main of every test executable is a list of these
+#define RUN_TEST(test) \
+    do \
+    { \
+        test(); \
+        std::printf("%s passed\n", #test); \
+    } while (false)
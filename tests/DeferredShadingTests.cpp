@@ -0,0 +1,146 @@
+#include "Check.h"
+#include "DeferredShading.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr uint32_t c_width = 64;
+    constexpr uint32_t c_height = 48;
+    constexpr uint32_t c_downscale = 4;
+
+    struct Pixel
+    {
+        Float3 Normal;
+        float Depth;
+    };
+
+    // Positions span [0, 1] over the image, every pixel is lit albedo 0.5 without emission
+    template<typename Shade>
+    GBuffer MakeGBuffer(const Shade& shade)
+    {
+        GBuffer gbuffer;
+        gbuffer.Width = c_width;
+        gbuffer.Height = c_height;
+        for (auto y = 0u; y < c_height; ++y)
+        {
+            for (auto x = 0u; x < c_width; ++x)
+            {
+                const auto pixel = shade(x, y);
+                gbuffer.Positions.push_back({(x + 0.5f) / c_width, (y + 0.5f) / c_height, pixel.Depth * 0.1f});
+                gbuffer.Normals.push_back(pixel.Normal);
+                gbuffer.Depths.push_back(pixel.Depth);
+                gbuffer.Albedo.push_back({0.5f, 0.5f, 0.5f});
+                gbuffer.Emission.push_back({0.f, 0.f, 0.f});
+            }
+        }
+        return gbuffer;
+    }
+
+    float MaxError(const std::vector<Float3>& a, const std::vector<Float3>& b)
+    {
+        float error = 0.f;
+        for (auto i = 0u; i < a.size(); ++i)
+        {
+            const auto difference = a[i] - b[i];
+            error = std::max(error, std::max(std::abs(difference.x), std::max(std::abs(difference.y), std::abs(difference.z))));
+        }
+        return error;
+    }
+
+    // Full resolution gather of every pixel, what the upsample is compared against
+    std::vector<Float3> GatherFull(const GBuffer& gbuffer, const IrradianceGather& gather)
+    {
+        DeferredStats stats;
+        return GatherIrradiance(gbuffer, 1, gather, stats);
+    }
+
+    std::vector<Float3> Upsample(const GBuffer& gbuffer, const IrradianceGather& gather, bool bilateral, DeferredStats& stats)
+    {
+        const auto gathered = GatherIrradiance(gbuffer, c_downscale, gather, stats);
+        return UpsampleIrradiance(gbuffer, c_downscale, gathered, gather, bilateral, stats);
+    }
+
+    void TestGatherLayout()
+    {
+        CHECK(GetGatherSize(c_width, c_downscale) == 16);
+        CHECK(GetGatherSize(c_width + 1, c_downscale) == 17);
+        CHECK(GetGatherSource(0, c_downscale, c_width) == 2);
+        CHECK(GetGatherSource(16, c_downscale, c_width + 1) == c_width);
+
+        // The background is neither gathered nor shaded
+        const auto gbuffer = MakeGBuffer([](uint32_t x, uint32_t) { return Pixel{{0.f, 1.f, 0.f}, x < c_width / 2 ? 2.f : 0.f}; });
+        uint32_t gathers = 0;
+        DeferredStats stats;
+        const auto upsampled = Upsample(gbuffer, [&](const Float3&, const Float3&) { ++gathers; return Float3{1.f, 1.f, 1.f}; }, true, stats);
+        CHECK(stats.Gathers == gathers - stats.Regathers);
+        CHECK(stats.Gathers == GetGatherSize(c_width, c_downscale) / 2 * GetGatherSize(c_height, c_downscale));
+        for (auto y = 0u; y < c_height; ++y)
+        {
+            for (auto x = 0u; x < c_width; ++x)
+            {
+                const auto& value = upsampled[gbuffer.GetIndex(x, y)];
+                CHECK(x < c_width / 2 ? std::abs(value.x - 1.f) < 1e-5f : value.x == 0.f);
+            }
+        }
+
+        const auto color = Composite(gbuffer, upsampled);
+        CHECK(std::abs(color[0].x - 0.5f) < 1e-5f && color[c_width - 1].x == 0.f);
+    }
+
+    void TestSmoothSurface()
+    {
+        // A tilted plane lit by a slowly varying gather, the upsample only misses the gradient at the image borders
+        const auto gbuffer = MakeGBuffer([](uint32_t x, uint32_t y) { return Pixel{{0.f, 0.f, -1.f}, 2.f + 0.01f * x + 0.005f * y}; });
+        const IrradianceGather gather = [](const Float3& position, const Float3&) { return Float3{1.f + 0.2f * position.x, 1.f + 0.1f * position.y, 1.f}; };
+
+        DeferredStats stats;
+        const auto upsampled = Upsample(gbuffer, gather, true, stats);
+        CHECK(stats.Regathers == 0);
+        CHECK(stats.Gathers == GetGatherSize(c_width, c_downscale) * GetGatherSize(c_height, c_downscale));
+        CHECK(MaxError(upsampled, GatherFull(gbuffer, gather)) < 0.01f);
+    }
+
+    // Irradiance that differs on the two sides of an edge, taps from across it must not blend in
+    void CheckEdge(const GBuffer& gbuffer, const IrradianceGather& gather)
+    {
+        const auto full = GatherFull(gbuffer, gather);
+
+        DeferredStats stats;
+        CHECK(MaxError(Upsample(gbuffer, gather, true, stats), full) < 1e-3f);
+        // Pixels of the thin strip have no tap on their side and gather on their own
+        CHECK(stats.Regathers > 0);
+
+        // The plain bilinear upsample bleeds across
+        DeferredStats bilinearStats;
+        CHECK(MaxError(Upsample(gbuffer, gather, false, bilinearStats), full) > 0.5f);
+        CHECK(bilinearStats.Regathers == 0);
+    }
+
+    bool IsForeground(uint32_t x)
+    {
+        // The left part and a strip two pixels wide that no gathered pixel sits on
+        return x < 29 || x == 40 || x == 41;
+    }
+
+    void TestDepthDiscontinuity()
+    {
+        const auto gbuffer = MakeGBuffer([](uint32_t x, uint32_t) { return Pixel{{0.f, 0.f, -1.f}, IsForeground(x) ? 1.f : 10.f}; });
+        CheckEdge(gbuffer, [](const Float3& position, const Float3&) { return position.z < 0.5f ? Float3{1.f, 1.f, 1.f} : Float3{4.f, 2.f, 0.f}; });
+    }
+
+    void TestNormalDiscontinuity()
+    {
+        const auto gbuffer = MakeGBuffer([](uint32_t x, uint32_t) { return Pixel{IsForeground(x) ? Float3{0.f, 1.f, 0.f} : Float3{1.f, 0.f, 0.f}, 2.f}; });
+        CheckEdge(gbuffer, [](const Float3&, const Float3& normal) { return normal.y > 0.5f ? Float3{1.f, 1.f, 1.f} : Float3{0.f, 3.f, 5.f}; });
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestGatherLayout);
+    RUN_TEST(TestSmoothSurface);
+    RUN_TEST(TestDepthDiscontinuity);
+    RUN_TEST(TestNormalDiscontinuity);
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "Check.h"
+#include "DescriptorAllocator.h"
+
+#include <deque>
+#include <random>
+
+namespace
+{
+    constexpr auto c_invalid = DescriptorAllocator::c_invalidIndex;
+
+    void TestFencedRelease()
+    {
+        DescriptorAllocator allocator(2 + 8, 8);
+        CHECK(allocator.GetPersistentCapacity() == 2);
+        const auto a = allocator.Allocate();
+        const auto b = allocator.Allocate();
+        CHECK(a != c_invalid && b != c_invalid && a != b);
+        CHECK(allocator.Allocate() == c_invalid);
+
+        // Released while recording the frame, the commands of the frame may still read it
+        allocator.Release(a);
+        CHECK(allocator.GetPendingCount() == 1);
+        CHECK(allocator.Allocate() == c_invalid);
+        allocator.Submit(1);
+        allocator.Retire(0);
+        CHECK(allocator.Allocate() == c_invalid);
+
+        allocator.Retire(1);
+        CHECK(allocator.GetPendingCount() == 0);
+        CHECK(allocator.Allocate() == a);
+    }
+
+    void TestFrameSubmission()
+    {
+        // Submission 2 was an upload made while recording the frame, only the frame's own submission 3 tags the
+        // release, its completion alone must not free the descriptor
+        DescriptorAllocator allocator(1 + 8, 8);
+        const auto index = allocator.Allocate();
+        allocator.Release(index);
+        const auto transient = allocator.AllocateTransient(4);
+        CHECK(transient == 1);
+
+        allocator.Retire(2);
+        CHECK(allocator.Allocate() == c_invalid);
+        allocator.Submit(3);
+        CHECK(allocator.GetOldestTransientSubmission() == 3);
+        allocator.Retire(2);
+        CHECK(allocator.Allocate() == c_invalid);
+        CHECK(allocator.GetTransientUsed() == 4);
+
+        allocator.Retire(3);
+        CHECK(allocator.Allocate() == index);
+        CHECK(allocator.GetTransientUsed() == 0);
+        CHECK(allocator.GetOldestTransientSubmission() == 0);
+    }
+
+    void TestTransientWrap()
+    {
+        // Transient indices follow the persistent part
+        DescriptorAllocator allocator(4 + 8, 8);
+        CHECK(allocator.AllocateTransient(3) == 4);
+        allocator.Submit(1);
+        CHECK(allocator.AllocateTransient(3) == 7);
+        allocator.Submit(2);
+
+        // Two left at the end are too few for a contiguous table, the start is held by frame 1
+        CHECK(allocator.AllocateTransient(3) == c_invalid);
+        CHECK(allocator.GetOldestTransientSubmission() == 1);
+        allocator.Retire(1);
+        CHECK(allocator.GetOldestTransientSubmission() == 2);
+        CHECK(allocator.AllocateTransient(3) == 4);
+        allocator.Submit(3);
+
+        // Frame 2 still holds the middle
+        CHECK(allocator.AllocateTransient(1) == c_invalid);
+        allocator.Retire(2);
+        CHECK(allocator.AllocateTransient(2) == 7);
+        allocator.Submit(4);
+
+        // Drained, the next table starts at the beginning again
+        allocator.Retire(4);
+        CHECK(allocator.GetTransientUsed() == 0);
+        CHECK(allocator.AllocateTransient(8) == 4);
+        CHECK(allocator.AllocateTransient(9) == c_invalid);
+    }
+
+    void TestPersistentRanges()
+    {
+        // Ranges of a released table coalesce back once retired
+        DescriptorAllocator allocator(16, 0);
+        const auto first = allocator.Allocate(6);
+        const auto second = allocator.Allocate(10);
+        CHECK(first != c_invalid && second != c_invalid);
+        CHECK(allocator.GetPersistentUsed() == 16);
+
+        allocator.Release(first);
+        allocator.Release(second);
+        allocator.Submit(1);
+        allocator.Retire(1);
+        CHECK(allocator.GetPersistentUsed() == 0);
+        CHECK(allocator.Allocate(16) == 0);
+    }
+
+    // The descriptor traffic of cascade-benchmark: transient tables plus churn of persistent views, two frames in
+    // flight. Nothing may fail and what is held stays bounded by the frames in flight.
+    void TestSteadyState()
+    {
+        constexpr uint32_t tablesPerFrame = 64;
+        constexpr uint32_t viewsPerFrame = 16;
+        constexpr uint32_t liveViews = 4096;
+        constexpr uint32_t maxCount = 8;
+        constexpr uint64_t framesInFlight = 2;
+        DescriptorAllocator allocator(65536, 4096);
+        std::mt19937 random(1);
+        std::deque<uint32_t> views;
+
+        for (auto frame = 1u; frame <= 4096; ++frame)
+        {
+            for (auto i = 0u; i < tablesPerFrame; ++i)
+                CHECK(allocator.AllocateTransient(1 + random() % maxCount) != c_invalid);
+            for (auto i = 0u; i < viewsPerFrame; ++i)
+            {
+                const auto index = allocator.Allocate(1 + random() % maxCount);
+                CHECK(index != c_invalid);
+                views.push_back(index);
+            }
+            while (views.size() > liveViews)
+            {
+                allocator.Release(views.front());
+                views.pop_front();
+            }
+
+            allocator.Submit(frame);
+            allocator.Retire(frame > framesInFlight ? frame - framesInFlight : 0);
+            CHECK(allocator.GetPendingCount() <= viewsPerFrame * framesInFlight);
+            CHECK(allocator.GetPersistentUsed() <= (liveViews + viewsPerFrame * framesInFlight) * maxCount);
+            CHECK(allocator.GetTransientUsed() <= tablesPerFrame * maxCount * framesInFlight);
+        }
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestFencedRelease);
+    RUN_TEST(TestFrameSubmission);
+    RUN_TEST(TestTransientWrap);
+    RUN_TEST(TestPersistentRanges);
+    RUN_TEST(TestSteadyState);
+    return 0;
+}
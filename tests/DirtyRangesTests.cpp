@@ -0,0 +1,136 @@
+#include "Check.h"
+#include "DirtyRanges.h"
+
+#include <vector>
+
+namespace
+{
+    bool Equals(const std::vector<DirtyRange>& ranges, const std::vector<DirtyRange>& expected)
+    {
+        if (ranges.size() != expected.size())
+            return false;
+        for (auto i = 0u; i < ranges.size(); ++i)
+        {
+            if (ranges[i].Begin != expected[i].Begin || ranges[i].End != expected[i].End)
+                return false;
+        }
+        return true;
+    }
+
+    void TestMergeGap()
+    {
+        DirtyRanges ranges(1024, 4, 0.5f);
+
+        // Four clean elements between 10 and 15 are bridged, five between 15 and 21 are not
+        for (const auto index : {21u, 15u, 10u, 10u})
+            ranges.Mark(index);
+        CHECK(ranges.IsDirty());
+        CHECK(Equals(ranges.Collect(1024), {{10, 16}, {21, 22}}));
+        CHECK(!ranges.IsDirty());
+        CHECK(ranges.Collect(1024).empty());
+
+        // Runs grow element by element and across every gap up to mergeGap
+        for (const auto index : {100u, 101u, 102u, 105u, 110u, 116u})
+            ranges.Mark(index);
+        CHECK(Equals(ranges.Collect(1024), {{100, 111}, {116, 117}}));
+
+        // No gap at all keeps every dirty element its own range
+        DirtyRanges exact(1024, 0, 0.5f);
+        for (const auto index : {3u, 4u, 6u})
+            exact.Mark(index);
+        CHECK(Equals(exact.Collect(1024), {{3, 5}, {6, 7}}));
+    }
+
+    void TestUsedCount()
+    {
+        // Marks past the used elements are dropped, e.g. of instances removed before the update
+        DirtyRanges ranges(256, 4, 0.5f);
+        for (const auto index : {5u, 40u, 200u})
+            ranges.Mark(index);
+        CHECK(Equals(ranges.Collect(100), {{5, 6}, {40, 41}}));
+        CHECK(ranges.Collect(256).empty());
+    }
+
+    void TestFullCopyFraction()
+    {
+        DirtyRanges ranges(1024, 0, 0.5f);
+
+        // Exactly half of the used elements dirty still copies ranges, one more copies everything used
+        for (auto i = 0u; i < 10; ++i)
+            ranges.Mark(i * 2);
+        CHECK(ranges.Collect(20).size() == 10);
+        for (auto i = 0u; i < 11; ++i)
+            ranges.Mark(i * 2);
+        CHECK(Equals(ranges.Collect(20), {{0, 20}}));
+
+        // The fraction counts marks against the used elements, also those past them
+        ranges.Mark(1);
+        ranges.Mark(500);
+        ranges.Mark(501);
+        CHECK(Equals(ranges.Collect(4), {{0, 4}}));
+
+        ranges.MarkAll();
+        ranges.Mark(7);
+        CHECK(ranges.IsDirty());
+        CHECK(Equals(ranges.Collect(64), {{0, 64}}));
+        CHECK(!ranges.IsDirty());
+        CHECK(ranges.Collect(64).empty());
+
+        // Nothing used, nothing to copy
+        ranges.MarkAll();
+        CHECK(ranges.Collect(0).empty());
+        CHECK(!ranges.IsDirty());
+
+        // The marks of a full copy are cleared as well
+        for (auto i = 0u; i < 8; ++i)
+            ranges.Mark(i);
+        CHECK(ranges.Collect(8).size() == 1);
+        ranges.Mark(3);
+        CHECK(Equals(ranges.Collect(8), {{3, 4}}));
+    }
+
+    void TestStats()
+    {
+        // Scene reports these times the instance size as the bytes it uploaded
+        DirtyRanges ranges(1024, 4, 0.5f);
+        CHECK(ranges.GetStats().Elements == 0);
+        CHECK(ranges.GetStats().Ranges == 0);
+        CHECK(ranges.GetStats().TotalElements == 0);
+
+        for (const auto index : {10u, 15u, 21u})
+            ranges.Mark(index);
+        ranges.Collect(1024);
+        CHECK(ranges.GetStats().Elements == 7);
+        CHECK(ranges.GetStats().Ranges == 2);
+        CHECK(ranges.GetStats().TotalElements == 7);
+
+        // Full copies count every used element
+        ranges.MarkAll();
+        ranges.Collect(300);
+        CHECK(ranges.GetStats().Elements == 300);
+        CHECK(ranges.GetStats().Ranges == 1);
+        CHECK(ranges.GetStats().TotalElements == 307);
+
+        // Clean updates reset the last counts and keep the total
+        ranges.Collect(300);
+        CHECK(ranges.GetStats().Elements == 0);
+        CHECK(ranges.GetStats().Ranges == 0);
+        CHECK(ranges.GetStats().TotalElements == 307);
+
+        // Dropped marks are not counted
+        ranges.Mark(299);
+        ranges.Mark(600);
+        ranges.Collect(300);
+        CHECK(ranges.GetStats().Elements == 1);
+        CHECK(ranges.GetStats().TotalElements == 308);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestMergeGap);
+    RUN_TEST(TestUsedCount);
+    RUN_TEST(TestFullCopyFraction);
+    RUN_TEST(TestStats);
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "Check.h"
+#include "FramePacer.h"
+#include "NullDevice.h"
+
+namespace
+{
+    // Runs frames on a device completing every submission latency submissions later. Begin may only ask for a wait
+    // when the CPU is framesInFlight frames ahead, then for the submission of the context's previous frame.
+    void RunFrames(uint32_t framesInFlight, uint32_t latency)
+    {
+        constexpr uint64_t frames = 32;
+        NullDevice device(latency);
+        FramePacer pacer(framesInFlight);
+
+        uint64_t waits = 0;
+        for (uint64_t frame = 0; frame < frames; ++frame)
+        {
+            CHECK(pacer.GetCurrent() == frame % framesInFlight);
+
+            // Submissions start at 1, frame f is submitted as f + 1
+            const auto completed = device.GetCompletedSubmission();
+            const bool ahead = frame >= framesInFlight && frame - completed >= framesInFlight;
+            const auto wait = pacer.Begin(completed);
+            CHECK((wait != 0) == ahead);
+            if (wait != 0)
+            {
+                CHECK(wait == frame - framesInFlight + 1);
+                device.WaitForSubmission(wait);
+                ++waits;
+            }
+
+            pacer.End(device.Submit());
+            CHECK(pacer.GetLastSubmission() == frame + 1);
+        }
+
+        // A device further behind than the contexts allow blocks every frame once they are all in use
+        CHECK(waits == (latency >= framesInFlight ? frames - framesInFlight : 0));
+        CHECK(pacer.GetWaitCount() == waits);
+        CHECK(device.GetStats().Waits == waits);
+        CHECK(pacer.GetFrame() == frames);
+    }
+
+    void TestNoLatency()
+    {
+        for (auto framesInFlight = 1u; framesInFlight <= 3; ++framesInFlight)
+            RunFrames(framesInFlight, 0);
+    }
+
+    void TestLatency()
+    {
+        for (auto framesInFlight = 1u; framesInFlight <= 3; ++framesInFlight)
+        {
+            for (auto latency = 1u; latency <= 4; ++latency)
+                RunFrames(framesInFlight, latency);
+        }
+    }
+
+    void TestCatchUp()
+    {
+        // The device finishing everything at once frees every context again
+        NullDevice device(8);
+        FramePacer pacer(2);
+        for (auto i = 0u; i < 2; ++i)
+        {
+            CHECK(pacer.Begin(device.GetCompletedSubmission()) == 0);
+            pacer.End(device.Submit());
+        }
+        CHECK(pacer.Begin(device.GetCompletedSubmission()) == 1);
+        device.WaitForSubmission(pacer.GetLastSubmission());
+        pacer.End(device.Submit());
+        CHECK(pacer.Begin(device.GetCompletedSubmission()) == 0);
+        pacer.End(device.Submit());
+        CHECK(pacer.GetWaitCount() == 1);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestNoLatency);
+    RUN_TEST(TestLatency);
+    RUN_TEST(TestCatchUp);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Check.h"
+#include "HeadlessRenderer.h"
+#include "NullDevice.h"
+#include "TestScene.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr uint32_t c_width = 24;
+    constexpr uint32_t c_height = 16;
+    constexpr uint32_t c_downscale = 2;
+    constexpr CascadeResultion c_resolution = {8, 8, 8};
+    constexpr CascadeExtends c_extends = {1.f, 1.f, 1.f};
+    constexpr CascadeOffset c_offset = {0.f, 1.f, 0.f};
+    constexpr uint32_t c_cascadeCount = 3;
+
+    // Floor of the test room seen from above, the left half a step higher to give the upsampling a depth edge
+    GBuffer MakeFloor()
+    {
+        GBuffer ret;
+        ret.Width = c_width;
+        ret.Height = c_height;
+        for (auto y = 0u; y < c_height; ++y)
+        {
+            for (auto x = 0u; x < c_width; ++x)
+            {
+                const float height = x < c_width / 2 ? 0.3f : 0.f;
+                ret.Positions.push_back({(x + 0.5f) / c_width * 1.6f - 0.8f, height, (y + 0.5f) / c_height * 1.6f - 0.8f});
+                ret.Normals.push_back({0.f, 1.f, 0.f});
+                ret.Depths.push_back(2.f - height);
+                ret.Albedo.push_back({0.7f, 0.7f, 0.7f});
+                ret.Emission.push_back({0.f, 0.f, 0.f});
+            }
+        }
+        return ret;
+    }
+
+    bool SameBarriers(const std::vector<NullBarrier>& a, const std::vector<NullBarrier>& b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const NullBarrier& x, const NullBarrier& y)
+        {
+            return x.Native == y.Native && x.Barrier.Before == y.Barrier.Before && x.Barrier.After == y.Barrier.After && x.Barrier.Kind == y.Barrier.Kind && x.Barrier.Phase == y.Barrier.Phase;
+        });
+    }
+
+    void TestMovingEmitter()
+    {
+        // Frames a frame behind with the emitter moving every frame record the same barriers on the same resources,
+        // and the last one shades exactly like generating the cascades whole
+        const auto& topology = GetTopology(CascadeTopologyId::Fast);
+        TestScene scene;
+        NullDevice device(1);
+        HeadlessRenderer renderer(device, c_width, c_height, c_resolution, c_extends, c_offset, c_cascadeCount, 2, c_downscale, CascadeFormat::Rgba16f, topology);
+        const auto gbuffer = MakeFloor();
+
+        std::vector<NullBarrier> lastBarriers;
+        for (auto frame = 0u; frame < 4; ++frame)
+        {
+            const auto [before, after] = scene.MoveEmitter(frame);
+            lastBarriers = device.GetSubmittedBarriers();
+            renderer.Render(scene.GetScene(), {before, after}, gbuffer);
+        }
+        CHECK(!device.GetSubmittedBarriers().empty());
+        CHECK(SameBarriers(device.GetSubmittedBarriers(), lastBarriers));
+
+        CpuCascades reference(c_resolution, c_extends, c_offset, c_cascadeCount, CascadeFormat::Rgba16f, topology);
+        reference.Generate(scene.GetScene());
+        reference.ProjectIrradiance();
+        const IrradianceGather gather = [&](const Float3& position, const Float3& normal)
+        {
+            return reference.SampleIrradiance(position, normal);
+        };
+        DeferredStats stats;
+        const auto expected = Composite(gbuffer, UpsampleIrradiance(gbuffer, c_downscale, GatherIrradiance(gbuffer, c_downscale, gather, stats), gather, true, stats));
+        const auto& colors = renderer.GetColor();
+        CHECK(colors.size() == expected.size());
+        for (auto i = 0u; i < colors.size(); ++i)
+            CHECK(colors[i].x == expected[i].x && colors[i].y == expected[i].y && colors[i].z == expected[i].z);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestMovingEmitter);
+    return 0;
+}
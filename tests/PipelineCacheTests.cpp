@@ -0,0 +1,167 @@
+#include "Check.h"
+#include "PipelineCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+    constexpr uint32_t c_entryCount = 16;
+    constexpr uint64_t c_environment = 0x5043;
+
+    struct Pipeline
+    {
+        std::vector<uint8_t> Bytecode;
+        uint32_t State[8];
+        std::vector<uint8_t> Blob;
+    };
+
+    // Keyed like Device keys its pipeline streams
+    uint64_t GetKey(const Pipeline& pipeline)
+    {
+        return PipelineKey().Add(pipeline.Bytecode.data(), pipeline.Bytecode.size()).AddValue(pipeline.State).GetHash();
+    }
+
+    std::vector<Pipeline> MakePipelines()
+    {
+        std::mt19937 random(1);
+        std::vector<Pipeline> ret(c_entryCount);
+        for (auto& pipeline : ret)
+        {
+            pipeline.Bytecode.resize(256 + random() % 1024);
+            for (auto& byte : pipeline.Bytecode)
+                byte = (uint8_t)random();
+            for (auto& state : pipeline.State)
+                state = random() % 4;
+            pipeline.Blob.resize(512 + random() % 4096);
+            for (auto& byte : pipeline.Blob)
+                byte = (uint8_t)random();
+        }
+        return ret;
+    }
+
+    std::string GetPath()
+    {
+        return (std::filesystem::temp_directory_path() / "PipelineCacheTests.pipelines").string();
+    }
+
+    std::vector<char> ReadFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void WriteFile(const std::string& path, const std::vector<char>& bytes)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size());
+    }
+
+    // Saves every pipeline into a fresh cache at path
+    void SaveAll(const std::string& path, const std::vector<Pipeline>& pipelines)
+    {
+        PipelineCache cache(c_environment);
+        for (const auto& pipeline : pipelines)
+            cache.Store(GetKey(pipeline), pipeline.Blob.data(), pipeline.Blob.size());
+        CHECK(cache.Save(path));
+    }
+
+    void TestKeys()
+    {
+        // One bytecode byte or one state field changes the key
+        const auto pipelines = MakePipelines();
+        auto changed = pipelines[0];
+        changed.Bytecode[changed.Bytecode.size() / 2] ^= 1;
+        CHECK(GetKey(changed) != GetKey(pipelines[0]));
+        changed = pipelines[0];
+        changed.State[7] ^= 1;
+        CHECK(GetKey(changed) != GetKey(pipelines[0]));
+    }
+
+    void TestRoundTrip()
+    {
+        const auto path = GetPath();
+        const auto pipelines = MakePipelines();
+        SaveAll(path, pipelines);
+
+        PipelineCache loaded(c_environment);
+        CHECK(loaded.Load(path));
+        CHECK(loaded.GetEntryCount() == c_entryCount);
+        for (const auto& pipeline : pipelines)
+        {
+            const auto blob = loaded.Find(GetKey(pipeline));
+            CHECK(blob && *blob == pipeline.Blob);
+        }
+        CHECK(loaded.GetStats().Hits == c_entryCount);
+        std::filesystem::remove(path);
+    }
+
+    void TestDamagedFiles()
+    {
+        const auto path = GetPath();
+        const auto pipelines = MakePipelines();
+        SaveAll(path, pipelines);
+        const auto saved = ReadFile(path);
+
+        // A flipped payload byte drops only its entry, the last byte belongs to the payload written last
+        auto damaged = saved;
+        damaged.back() ^= 1;
+        WriteFile(path, damaged);
+        PipelineCache cache(c_environment);
+        cache.Load(path);
+        CHECK(cache.GetStats().Damaged == 1);
+        CHECK(cache.GetEntryCount() == c_entryCount - 1);
+
+        // Another environment and a file cut short drop the cache
+        WriteFile(path, saved);
+        PipelineCache otherEnvironment(c_environment + 1);
+        CHECK(!otherEnvironment.Load(path));
+        CHECK(otherEnvironment.GetStats().Stale && otherEnvironment.GetEntryCount() == 0);
+
+        WriteFile(path, std::vector<char>(saved.begin(), saved.begin() + saved.size() / 2));
+        PipelineCache truncated(c_environment);
+        CHECK(!truncated.Load(path));
+        CHECK(truncated.GetStats().Stale && truncated.GetEntryCount() == 0);
+        std::filesystem::remove(path);
+    }
+
+    void TestEviction()
+    {
+        // c_maxAge launches finding only the first half and storing one more pipeline, so the file is written each
+        // time, leave out the second half in the last save
+        const auto path = GetPath();
+        const auto pipelines = MakePipelines();
+        SaveAll(path, pipelines);
+
+        uint32_t evicted = 0;
+        for (auto launch = 0u; launch < PipelineCache::c_maxAge; ++launch)
+        {
+            PipelineCache launched(c_environment);
+            launched.Load(path);
+            for (auto i = 0u; i < c_entryCount / 2; ++i)
+                launched.Find(GetKey(pipelines[i]));
+            const uint8_t blob[] = {(uint8_t)launch};
+            launched.Store(~(uint64_t)launch, blob, sizeof(blob));
+            launched.Save(path);
+            evicted += launched.GetStats().Evicted;
+        }
+        CHECK(evicted == c_entryCount / 2);
+
+        PipelineCache last(c_environment);
+        last.Load(path);
+        for (auto i = 0u; i < c_entryCount; ++i)
+            CHECK((last.Find(GetKey(pipelines[i])) != nullptr) == (i < c_entryCount / 2));
+        std::filesystem::remove(path);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestKeys);
+    RUN_TEST(TestRoundTrip);
+    RUN_TEST(TestDamagedFiles);
+    RUN_TEST(TestEviction);
+    return 0;
+}
@@ -0,0 +1,234 @@
+#include "Check.h"
+#include "CpuCascades.h"
+#include "ProbeInvalidation.h"
+#include "TestScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    constexpr CascadeResultion c_resolution = {32, 16, 24};
+    constexpr CascadeExtends c_extends = {2.f, 1.f, 1.5f};
+    constexpr CascadeOffset c_offset = {0.f, 1.f, 0.f};
+    constexpr uint32_t c_cascadeCount = 4;
+    // Float rounding of the shell test, probes closer than this to a shell boundary may go either way
+    constexpr double c_tolerance = 1e-4;
+
+    enum class Expected
+    {
+        Outside,
+        Inside,
+        Boundary
+    };
+
+    // Every probe on its own with the distances of the box in double: the closest point is the clamped position,
+    // the farthest one a corner
+    Expected ExhaustiveOverlap(uint32_t cascade, uint32_t x, uint32_t y, uint32_t z, const CascadeTopology& topology, const Aabb& bounds)
+    {
+        const uint32_t counts[3] = {c_resolution.x >> cascade, c_resolution.y >> cascade, c_resolution.z >> cascade};
+        const uint32_t cell[3] = {x, y, z};
+        const double extends[3] = {c_extends.x, c_extends.y, c_extends.z};
+        const double offset[3] = {c_offset.x, c_offset.y, c_offset.z};
+
+        double nearest = 0.0;
+        double farthest = 0.0;
+        for (auto axis = 0u; axis < 3; ++axis)
+        {
+            const double position = ((cell[axis] + 0.5) / counts[axis] * 2.0 - 1.0) * extends[axis] + offset[axis];
+            const double closest = std::clamp<double>(position, bounds.Min[axis], bounds.Max[axis]);
+            const double corner = std::max(std::abs(bounds.Min[axis] - position), std::abs(bounds.Max[axis] - position));
+            nearest += (closest - position) * (closest - position);
+            farthest += corner * corner;
+        }
+        nearest = std::sqrt(nearest);
+        farthest = std::sqrt(farthest);
+
+        const double start = 0.01 + topology.GetEnd((int)cascade - 1);
+        const double end = topology.GetEnd(cascade);
+        if (std::abs(nearest - end) < c_tolerance || std::abs(farthest - start) < c_tolerance)
+            return Expected::Boundary;
+        return nearest <= end && farthest >= start ? Expected::Inside : Expected::Outside;
+    }
+
+    Aabb RandomBounds(std::mt19937& random)
+    {
+        const float offset[3] = {c_offset.x, c_offset.y, c_offset.z};
+        const float extends[3] = {c_extends.x, c_extends.y, c_extends.z};
+        Aabb bounds;
+        for (auto axis = 0u; axis < 3; ++axis)
+        {
+            // Partly outside the volume as well, and from tiny to a sizable share of it
+            const float center = std::uniform_real_distribution<float>(offset[axis] - 1.3f * extends[axis], offset[axis] + 1.3f * extends[axis])(random);
+            const float half = extends[axis] * std::exp(std::uniform_real_distribution<float>(std::log(1e-3f), std::log(0.5f))(random));
+            bounds.Min[axis] = center - half;
+            bounds.Max[axis] = center + half;
+        }
+        return bounds;
+    }
+
+    // The listed probes of every level are unique, marked and exactly those the exhaustive test finds for any of bounds
+    void CheckAgainstExhaustive(const ProbeInvalidation& invalidation, const CascadeTopology& topology, const std::vector<Aabb>& bounds)
+    {
+        for (auto i = 0u; i < c_cascadeCount; ++i)
+        {
+            uint32_t expectedCount = 0;
+            uint32_t boundaryCount = 0;
+            for (auto z = 0u; z < (c_resolution.z >> i); ++z)
+            {
+                for (auto y = 0u; y < (c_resolution.y >> i); ++y)
+                {
+                    for (auto x = 0u; x < (c_resolution.x >> i); ++x)
+                    {
+                        auto expected = Expected::Outside;
+                        for (const auto& box : bounds)
+                        {
+                            const auto overlap = ExhaustiveOverlap(i, x, y, z, topology, box);
+                            if (overlap == Expected::Inside || (overlap == Expected::Boundary && expected == Expected::Outside))
+                                expected = overlap;
+                        }
+
+                        const bool invalid = invalidation.IsInvalid(i, x, y, z);
+                        if (expected == Expected::Boundary)
+                        {
+                            boundaryCount += invalid;
+                            continue;
+                        }
+                        CHECK(invalid == (expected == Expected::Inside));
+                        expectedCount += invalid;
+                    }
+                }
+            }
+
+            auto probes = invalidation.GetProbes(i);
+            CHECK(probes.size() == expectedCount + boundaryCount);
+            for (const auto probe : probes)
+            {
+                const auto [x, y, z] = ProbeInvalidation::UnpackProbe(probe);
+                CHECK(invalidation.IsInvalid(i, x, y, z));
+            }
+            std::sort(probes.begin(), probes.end());
+            CHECK(std::adjacent_find(probes.begin(), probes.end()) == probes.end());
+        }
+    }
+
+    void TestRandomBounds()
+    {
+        std::mt19937 random(42);
+        for (const auto& topology : c_cascadeTopologies)
+        {
+            ProbeInvalidation invalidation(c_resolution, c_extends, c_offset, c_cascadeCount, topology);
+            for (auto i = 0u; i < 64; ++i)
+            {
+                const auto bounds = RandomBounds(random);
+                invalidation.Invalidate(bounds);
+                CheckAgainstExhaustive(invalidation, topology, {bounds});
+                invalidation.Clear();
+            }
+        }
+    }
+
+    void TestAccumulatedBounds()
+    {
+        // The old and new bounds of several moved instances add up until Clear
+        std::mt19937 random(7);
+        const auto& topology = GetTopology(CascadeTopologyId::Default);
+        ProbeInvalidation invalidation(c_resolution, c_extends, c_offset, c_cascadeCount, topology);
+        std::vector<Aabb> bounds;
+        for (auto i = 0u; i < 6; ++i)
+        {
+            bounds.push_back(RandomBounds(random));
+            invalidation.Invalidate(bounds.back());
+        }
+        CheckAgainstExhaustive(invalidation, topology, bounds);
+
+        invalidation.Clear();
+        for (auto i = 0u; i < c_cascadeCount; ++i)
+        {
+            CHECK(invalidation.GetProbes(i).empty());
+            CHECK(!invalidation.IsInvalid(i, 0, 0, 0));
+        }
+    }
+
+    void TestSplitTracing()
+    {
+        ProbeInvalidation invalidation(c_resolution, c_extends, c_offset, c_cascadeCount);
+        invalidation.InvalidateProbe(0, 1, 2, 3);
+        invalidation.InvalidateProbe(0, 4, 5, 10);
+        invalidation.InvalidateProbe(0, 4, 5, 10);
+
+        // Probes inside the scheduled slices are traced with them
+        CascadeSlices slices = {0, 8};
+        std::vector<uint32_t> listed;
+        invalidation.SplitTracing(0, slices, listed);
+        CHECK(slices.Begin == 0 && slices.End == 8);
+        CHECK((listed == std::vector<uint32_t>{ProbeInvalidation::PackProbe(4, 5, 10)}));
+
+        // Past half of the level the whole level is traced instead
+        const auto count = invalidation.GetProbeCount(3);
+        for (auto probe = 0u; probe <= count / 2; ++probe)
+            invalidation.InvalidateProbe(3, probe % (c_resolution.x >> 3), probe / (c_resolution.x >> 3) % (c_resolution.y >> 3), probe / ((c_resolution.x >> 3) * (c_resolution.y >> 3)));
+        slices = {0, 0};
+        invalidation.SplitTracing(3, slices, listed);
+        CHECK(slices.Begin == 0 && slices.End == (c_resolution.z >> 3));
+        CHECK(listed.empty());
+    }
+    void TestIncrementalGeneration()
+    {
+        // Tracing only the invalidated probes of a moving emitter gives exactly what tracing everything does
+        constexpr CascadeResultion resolution = {8, 8, 8};
+        constexpr CascadeExtends extends = {1.f, 1.f, 1.f};
+        constexpr uint32_t cascadeCount = 3;
+        const auto& topology = GetTopology(CascadeTopologyId::Fast);
+        TestScene scene;
+        CpuCascades reference(resolution, extends, c_offset, cascadeCount, CascadeFormat::Rgba16f, topology);
+        CpuCascades incremental(resolution, extends, c_offset, cascadeCount, CascadeFormat::Rgba16f, topology);
+        ProbeInvalidation invalidation(resolution, extends, c_offset, cascadeCount, topology);
+        const std::vector<CascadeSlices> noSlices(cascadeCount);
+
+        incremental.Generate(scene.GetScene());
+        for (auto frame = 1u; frame < 4; ++frame)
+        {
+            const auto [before, after] = scene.MoveEmitter(frame);
+            invalidation.Invalidate(before);
+            invalidation.Invalidate(after);
+            uint32_t invalidCount = 0;
+            uint32_t probeCount = 0;
+            for (auto i = 0u; i < cascadeCount; ++i)
+            {
+                invalidCount += (uint32_t)invalidation.GetProbes(i).size();
+                probeCount += invalidation.GetProbeCount(i);
+            }
+            CHECK(invalidCount > 0 && invalidCount < probeCount);
+
+            reference.Generate(scene.GetScene());
+            incremental.Generate(scene.GetScene(), noSlices, invalidation);
+            invalidation.Clear();
+            for (auto i = 0u; i < cascadeCount; ++i)
+            {
+                for (auto z = 0u; z < reference.GetDepth(i); ++z)
+                {
+                    for (auto y = 0u; y < reference.GetHeight(i); ++y)
+                    {
+                        for (auto x = 0u; x < reference.GetWidth(i); ++x)
+                        {
+                            const auto expected = reference.Load(i, x, y, z);
+                            const auto actual = incremental.Load(i, x, y, z);
+                            CHECK(actual.x == expected.x && actual.y == expected.y && actual.z == expected.z && actual.w == expected.w);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestRandomBounds);
+    RUN_TEST(TestAccumulatedBounds);
+    RUN_TEST(TestSplitTracing);
+    RUN_TEST(TestIncrementalGeneration);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "Check.h"
+#include "Profiler.h"
+
+#include <string>
+
+namespace
+{
+    // Frame loop like the graph execution: three nested scopes per frame, the innermost opened passesPerFrame times
+    void RecordFrames(Profiler& profiler, uint32_t frameCount, uint32_t passesPerFrame)
+    {
+        for (auto f = 0u; f < frameCount; ++f)
+        {
+            profiler.BeginFrame();
+            ProfileScope frame(&profiler, "Frame");
+            ProfileScope execution(&profiler, "Graph execution");
+            for (auto i = 0u; i < passesPerFrame; ++i)
+                ProfileScope pass(&profiler, "Pass");
+        }
+    }
+
+    const ProfileStats* FindStats(const std::vector<ProfileStats>& stats, const char* name)
+    {
+        for (const auto& entry : stats)
+        {
+            if (std::string(entry.Name) == name)
+                return &entry;
+        }
+        return nullptr;
+    }
+
+    void TestWholeFrames()
+    {
+        // 16 frames of 4 samples fill the ring exactly
+        Profiler profiler(64);
+        RecordFrames(profiler, 16, 2);
+        CHECK(profiler.GetSampleCount() == 64);
+        CHECK(profiler.GetDroppedCount() == 0);
+
+        const auto stats = profiler.CollectStats();
+        CHECK(stats.size() == 3);
+        const auto* pass = FindStats(stats, "Pass");
+        const auto* frame = FindStats(stats, "Frame");
+        CHECK(pass && pass->Depth == 2 && pass->Frames == 16 && pass->Calls == 2.0);
+        CHECK(frame && frame->Depth == 0 && frame->Frames == 16 && frame->Calls == 1.0);
+        CHECK(pass && pass->Min <= pass->Mean && pass->Mean <= pass->Max);
+    }
+
+    void TestWrappedRing()
+    {
+        // 20 frames of 6 samples in a ring of 64 keep the last 10 frames whole and the last 4 samples of the frame
+        // before, two of its passes, the graph execution and the frame scope, which are closed last
+        Profiler profiler(64);
+        RecordFrames(profiler, 20, 4);
+        CHECK(profiler.GetSampleCount() == 64);
+        CHECK(profiler.GetDroppedCount() == 56);
+
+        const auto stats = profiler.CollectStats();
+        CHECK(stats.size() == 3);
+        CHECK(std::string(stats[0].Name) == "Pass");
+        const auto* pass = FindStats(stats, "Pass");
+        const auto* execution = FindStats(stats, "Graph execution");
+        CHECK(pass && pass->Frames == 11 && pass->Calls == 42.0 / 11);
+        CHECK(execution && execution->Depth == 1 && execution->Frames == 11 && execution->Calls == 1.0);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestWholeFrames);
+    RUN_TEST(TestWrappedRing);
+    return 0;
+}
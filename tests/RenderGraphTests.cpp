@@ -0,0 +1,219 @@
+#include "Check.h"
+#include "NullDevice.h"
+#include "RenderGraph.h"
+
+#include <string>
+
+namespace
+{
+    using Type = GraphBarrier::Type;
+    using Split = GraphBarrier::Split;
+
+    struct Resources
+    {
+        uint32_t Target;
+        uint32_t Cascades[2];
+        uint32_t Hits[2];
+    };
+
+    // Two levels of RadianceCascades: level 1 is traced by a slice and a probe list pass, then both levels are
+    // merged top down and drawn, the draw also reads level 1 for the debug view
+    Resources BuildCascadeFrame(RenderGraph& graph, std::vector<std::string>* order = nullptr)
+    {
+        static int natives[5];
+        Resources resources;
+        resources.Target = graph.Import(&natives[0], GraphState::Present, GraphState::Present);
+        for (auto i = 0u; i < 2; ++i)
+            resources.Cascades[i] = graph.Import(&natives[1 + i], GraphState::AllShaderResource);
+        for (auto i = 0u; i < 2; ++i)
+            resources.Hits[i] = graph.Import(&natives[3 + i], GraphState::AllShaderResource);
+
+        const auto addPass = [&](const char* name)
+        {
+            return graph.AddPass(name, [order, name]()
+            {
+                if (order)
+                    order->push_back(name);
+            });
+        };
+
+        const auto traceSlices = addPass("Trace slices 1");
+        graph.Use(traceSlices, resources.Hits[1], GraphState::UnorderedAccess);
+        const auto traceProbes = addPass("Trace probes 1");
+        graph.Use(traceProbes, resources.Hits[1], GraphState::UnorderedAccess);
+        const auto trace = addPass("Trace 0");
+        graph.Use(trace, resources.Hits[0], GraphState::UnorderedAccess);
+
+        const auto merge1 = addPass("Merge 1");
+        graph.Use(merge1, resources.Hits[1], GraphState::NonPixelShaderResource);
+        graph.Use(merge1, resources.Cascades[1], GraphState::UnorderedAccess);
+        const auto merge0 = addPass("Merge 0");
+        graph.Use(merge0, resources.Cascades[1], GraphState::NonPixelShaderResource);
+        graph.Use(merge0, resources.Hits[0], GraphState::NonPixelShaderResource);
+        graph.Use(merge0, resources.Cascades[0], GraphState::UnorderedAccess);
+
+        const auto draw = addPass("Draw");
+        graph.Use(draw, resources.Cascades[0], GraphState::PixelShaderResource);
+        graph.Use(draw, resources.Cascades[1], GraphState::PixelShaderResource);
+        graph.Use(draw, resources.Target, GraphState::RenderTarget);
+        return resources;
+    }
+
+    void CheckBarrier(const GraphBarrier& barrier, uint32_t resource, uint32_t before, uint32_t after, Type type, Split split)
+    {
+        CHECK(barrier.Resource == resource);
+        CHECK(barrier.Before == before);
+        CHECK(barrier.After == after);
+        CHECK(barrier.Kind == type);
+        CHECK(barrier.Phase == split);
+    }
+
+    void TestSplitBarriers()
+    {
+        RenderGraph graph;
+        const auto r = BuildCascadeFrame(graph);
+        graph.Compile();
+
+        constexpr auto sr = GraphState::AllShaderResource;
+        constexpr auto uav = GraphState::UnorderedAccess;
+        constexpr auto npsr = GraphState::NonPixelShaderResource;
+        constexpr auto psr = GraphState::PixelShaderResource;
+        constexpr auto rt = GraphState::RenderTarget;
+        constexpr auto present = GraphState::Present;
+
+        CHECK(graph.GetPassCount() == 6);
+
+        // Transitions begin right after the last use, hits 1 is used by the first pass and cannot be split
+        auto& before0 = graph.GetBarriers(0);
+        CHECK(before0.size() == 5);
+        CheckBarrier(before0[0], r.Target, present, rt, Type::Transition, Split::Begin);
+        CheckBarrier(before0[1], r.Cascades[0], sr, uav, Type::Transition, Split::Begin);
+        CheckBarrier(before0[2], r.Cascades[1], sr, uav, Type::Transition, Split::Begin);
+        CheckBarrier(before0[3], r.Hits[0], sr, uav, Type::Transition, Split::Begin);
+        CheckBarrier(before0[4], r.Hits[1], sr, uav, Type::Transition, Split::None);
+
+        // Back to back writes of the two trace passes
+        auto& before1 = graph.GetBarriers(1);
+        CHECK(before1.size() == 1);
+        CheckBarrier(before1[0], r.Hits[1], uav, uav, Type::Uav, Split::None);
+
+        auto& before2 = graph.GetBarriers(2);
+        CHECK(before2.size() == 2);
+        CheckBarrier(before2[0], r.Hits[0], sr, uav, Type::Transition, Split::End);
+        CheckBarrier(before2[1], r.Hits[1], uav, npsr, Type::Transition, Split::Begin);
+
+        auto& before3 = graph.GetBarriers(3);
+        CHECK(before3.size() == 3);
+        CheckBarrier(before3[0], r.Cascades[1], sr, uav, Type::Transition, Split::End);
+        CheckBarrier(before3[1], r.Hits[0], uav, npsr, Type::Transition, Split::Begin);
+        CheckBarrier(before3[2], r.Hits[1], uav, npsr, Type::Transition, Split::End);
+
+        // Merge 0 and the draw read level 1 back to back, a single transition to the union of both states
+        auto& before4 = graph.GetBarriers(4);
+        CHECK(before4.size() == 3);
+        CheckBarrier(before4[0], r.Cascades[0], sr, uav, Type::Transition, Split::End);
+        CheckBarrier(before4[1], r.Cascades[1], uav, npsr | psr, Type::Transition, Split::None);
+        CheckBarrier(before4[2], r.Hits[0], uav, npsr, Type::Transition, Split::End);
+
+        auto& before5 = graph.GetBarriers(5);
+        CHECK(before5.size() == 2);
+        CheckBarrier(before5[0], r.Target, present, rt, Type::Transition, Split::End);
+        CheckBarrier(before5[1], r.Cascades[0], uav, psr, Type::Transition, Split::None);
+
+        // Only the target has a final state to return to
+        auto& closing = graph.GetBarriers(6);
+        CHECK(closing.size() == 1);
+        CheckBarrier(closing[0], r.Target, rt, present, Type::Transition, Split::None);
+
+        CHECK(graph.GetBarrierCount() == 17);
+        CHECK(graph.GetFinalState(r.Target) == present);
+        CHECK(graph.GetFinalState(r.Cascades[0]) == psr);
+        CHECK(graph.GetFinalState(r.Cascades[1]) == (npsr | psr));
+        CHECK(graph.GetFinalState(r.Hits[0]) == npsr);
+        CHECK(graph.GetFinalState(r.Hits[1]) == npsr);
+
+        CHECK(graph.GetLifetime(r.Target).FirstPass == 5 && graph.GetLifetime(r.Target).LastPass == 5);
+        CHECK(graph.GetLifetime(r.Hits[1]).FirstPass == 0 && graph.GetLifetime(r.Hits[1]).LastPass == 3);
+    }
+
+    void TestWholeBarriers()
+    {
+        RenderGraph graph(false);
+        const auto r = BuildCascadeFrame(graph);
+        graph.Compile();
+
+        // Every split pair collapses into its end, nothing is recorded ahead
+        CHECK(graph.GetBarriers(0).size() == 1);
+        CheckBarrier(graph.GetBarriers(0)[0], r.Hits[1], GraphState::AllShaderResource, GraphState::UnorderedAccess, Type::Transition, Split::None);
+        CHECK(graph.GetBarriers(2).size() == 1);
+        CheckBarrier(graph.GetBarriers(2)[0], r.Hits[0], GraphState::AllShaderResource, GraphState::UnorderedAccess, Type::Transition, Split::None);
+        CHECK(graph.GetBarriers(5).size() == 2);
+        CheckBarrier(graph.GetBarriers(5)[0], r.Target, GraphState::Present, GraphState::RenderTarget, Type::Transition, Split::None);
+        CHECK(graph.GetBarrierCount() == 11);
+        for (auto i = 0u; i <= graph.GetPassCount(); ++i)
+        {
+            for (auto& barrier : graph.GetBarriers(i))
+                CHECK(barrier.Phase == Split::None);
+        }
+    }
+
+    void TestExecution()
+    {
+        RenderGraph graph;
+        std::vector<std::string> order;
+        BuildCascadeFrame(graph, &order);
+        graph.Compile();
+
+        // The device sees the batches in front of their passes, the closing one after the last pass
+        NullDevice device;
+        std::vector<size_t> passesBeforeBatch;
+        graph.Execute([&](const std::vector<GraphBarrier>& barriers)
+        {
+            passesBeforeBatch.push_back(order.size());
+            device.RecordBarriers(graph, barriers);
+        });
+        device.Submit();
+
+        const std::vector<std::string> expected = {"Trace slices 1", "Trace probes 1", "Trace 0", "Merge 1", "Merge 0", "Draw"};
+        CHECK(order == expected);
+        CHECK((passesBeforeBatch == std::vector<size_t>{0, 1, 2, 3, 4, 5, 6}));
+
+        const auto& stats = device.GetStats();
+        CHECK(stats.Batches == 7);
+        CHECK(stats.SplitBegins == 6);
+        CHECK(stats.SplitEnds == 6);
+        CHECK(stats.UavBarriers == 1);
+        CHECK(stats.Transitions == 16);
+
+        const auto& submitted = device.GetSubmittedBarriers();
+        CHECK(submitted.size() == graph.GetBarrierCount());
+        CHECK(submitted.back().Native == graph.GetNative(submitted.back().Barrier.Resource));
+    }
+
+    void TestTransient()
+    {
+        // Transients start in the state of their first use, without a transition in front of it
+        RenderGraph graph;
+        const auto transient = graph.CreateTransient();
+        const auto write = graph.AddPass("Write");
+        graph.Use(write, transient, GraphState::UnorderedAccess);
+        const auto read = graph.AddPass("Read");
+        graph.Use(read, transient, GraphState::PixelShaderResource);
+        graph.Compile();
+
+        CHECK(graph.GetBarriers(0).empty());
+        CHECK(graph.GetBarriers(1).size() == 1);
+        CheckBarrier(graph.GetBarriers(1)[0], transient, GraphState::UnorderedAccess, GraphState::PixelShaderResource, Type::Transition, Split::None);
+        CHECK(graph.GetBarriers(2).empty());
+        CHECK(graph.GetFinalState(transient) == GraphState::PixelShaderResource);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestSplitBarriers);
+    RUN_TEST(TestWholeBarriers);
+    RUN_TEST(TestExecution);
+    RUN_TEST(TestTransient);
+    return 0;
+}
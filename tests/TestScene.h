@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CpuScene.h"
+
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+// Dim room around the default cascade volume with a small bright cube the tests move around, small enough for tests
+// that generate cascades every frame
+class TestScene
+{
+public:
+    TestScene()
+        : m_room(MakeBox({-1.2f, -0.2f, -1.2f}, {1.2f, 2.2f, 1.2f}))
+        , m_emitter(MakeBox({-0.1f, -0.1f, -0.1f}, {0.1f, 0.1f, 0.1f}))
+    {
+        m_scene.AddInstance(*m_room, Float3x4::Identity(), {0.1f, 0.1f, 0.1f});
+        m_emitterInstance = m_scene.AddInstance(*m_emitter, GetEmitterTransform(0), {5.f, 4.f, 3.f});
+    }
+
+    // Moves the emitter to where it is in the frame and returns its bounds before and after
+    std::pair<Aabb, Aabb> MoveEmitter(uint32_t frame)
+    {
+        const auto before = m_scene.GetInstanceBounds(m_emitterInstance);
+        m_scene.SetInstanceTransform(m_emitterInstance, GetEmitterTransform(frame));
+        return {before, m_scene.GetInstanceBounds(m_emitterInstance)};
+    }
+
+    inline auto& GetScene() const { return m_scene; }
+
+    static std::unique_ptr<CpuMesh> MakeBox(const Float3& min, const Float3& max)
+    {
+        float positions[8 * 3];
+        for (auto corner = 0u; corner < 8; ++corner)
+        {
+            for (auto axis = 0u; axis < 3; ++axis)
+                positions[corner * 3 + axis] = corner >> axis & 1 ? max[axis] : min[axis];
+        }
+        // Two triangles per face, corners indexed by their x, y and z bits
+        const uint32_t indices[] = {
+            0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3,
+            0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6,
+            0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5
+        };
+        return std::make_unique<CpuMesh>(positions, 8, indices, (uint32_t)std::size(indices), 1);
+    }
+
+private:
+    static Float3x4 GetEmitterTransform(uint32_t frame)
+    {
+        auto ret = Float3x4::Identity();
+        ret.m[0][3] = 0.5f * std::sin(frame * 0.7f);
+        ret.m[1][3] = 0.6f;
+        ret.m[2][3] = 0.2f;
+        return ret;
+    }
+
+    std::unique_ptr<CpuMesh> m_room;
+    std::unique_ptr<CpuMesh> m_emitter;
+    CpuScene m_scene;
+    uint32_t m_emitterInstance = c_invalidInstance;
+};
@@ -0,0 +1,155 @@
+#include "Check.h"
+#include "NullDevice.h"
+#include "TlasUpdater.h"
+
+#include <memory>
+
+namespace
+{
+    // TlasUpdater backend on a NullDevice. Builds copy the source of refits into dest and end with a UAV barrier on
+    // dest like Device::BuildTopLevelAccelerationStructure.
+    struct NullTlasBackend
+    {
+        using Buffer = std::shared_ptr<std::vector<uint8_t>>;
+
+        struct BuildRecord
+        {
+            const void* Dest;
+            const void* Source;
+            uint32_t Count;
+        };
+
+        uint64_t GetResultSize(uint32_t count)
+        {
+            return 64 + 64 * (uint64_t)count;
+        }
+
+        Buffer CreateBuffer(uint64_t size)
+        {
+            return std::make_shared<std::vector<uint8_t>>(size);
+        }
+
+        void Build(const Buffer& dest, const Buffer* source, uint32_t count)
+        {
+            CHECK(dest->size() >= GetResultSize(count));
+            if (source)
+                Device.CopyBuffer(dest->data(), 0, (*source)->data(), 0, GetResultSize(count));
+
+            RenderGraph graph;
+            const auto resource = graph.Import(dest.get(), GraphState::UnorderedAccess);
+            Device.RecordBarriers(graph, {{resource, GraphState::UnorderedAccess, GraphState::UnorderedAccess, GraphBarrier::Type::Uav, GraphBarrier::Split::None}});
+            Builds.push_back({dest.get(), source ? source->get() : nullptr, count});
+        }
+
+        uint64_t GetCompletedSubmission()
+        {
+            return Device.GetCompletedSubmission();
+        }
+
+        NullDevice& Device;
+        std::vector<BuildRecord> Builds;
+    };
+
+    void TestChoice()
+    {
+        CHECK(ChooseTlasUpdate(false, false, false, 0, 4) == TlasUpdate::Rebuild);
+        CHECK(ChooseTlasUpdate(true, true, true, 0, 4) == TlasUpdate::Rebuild);
+        CHECK(ChooseTlasUpdate(true, false, false, 0, 4) == TlasUpdate::None);
+        CHECK(ChooseTlasUpdate(true, false, true, 3, 4) == TlasUpdate::Refit);
+        CHECK(ChooseTlasUpdate(true, false, true, 4, 4) == TlasUpdate::Rebuild);
+    }
+
+    // Frame of Scene::Update and Scene::Submit: the update, the barriers it recorded and the buffer it left current
+    struct Frame
+    {
+        TlasUpdate Update;
+        const void* Current;
+    };
+
+    Frame RunFrame(TlasUpdater<NullTlasBackend>& updater, NullTlasBackend& backend, uint32_t count, bool instancesChanged, bool transformsChanged)
+    {
+        const auto builds = backend.Builds.size();
+        const auto update = updater.Update(backend, count, instancesChanged, transformsChanged);
+        const auto submission = backend.Device.Submit();
+        updater.Submit(submission);
+
+        // One UAV barrier on the result of every build, nothing when the TLAS is kept
+        const auto& barriers = backend.Device.GetSubmittedBarriers();
+        CHECK(backend.Builds.size() == builds + (update != TlasUpdate::None));
+        if (update == TlasUpdate::None)
+        {
+            CHECK(barriers.empty());
+        }
+        else
+        {
+            CHECK(barriers.size() == 1);
+            CHECK(barriers[0].Native == updater.GetCurrent().get());
+            CHECK(barriers[0].Barrier.Kind == GraphBarrier::Type::Uav);
+        }
+        return {update, updater.GetCurrent().get()};
+    }
+
+    void TestRefitAndRebuild()
+    {
+        NullDevice device;
+        NullTlasBackend backend = {device, {}};
+        TlasUpdater<NullTlasBackend> updater(2);
+
+        CHECK(RunFrame(updater, backend, 3, true, false).Update == TlasUpdate::Rebuild);
+        CHECK(backend.Builds.back().Source == nullptr && backend.Builds.back().Count == 3);
+        CHECK(RunFrame(updater, backend, 3, false, false).Update == TlasUpdate::None);
+
+        // Refits read the previous TLAS and write another buffer
+        const auto before = updater.GetCurrent().get();
+        CHECK(RunFrame(updater, backend, 3, false, true).Update == TlasUpdate::Refit);
+        CHECK(backend.Builds.back().Source == before && backend.Builds.back().Dest != before);
+        CHECK(RunFrame(updater, backend, 3, false, true).Update == TlasUpdate::Refit);
+        // Refits piled up
+        CHECK(RunFrame(updater, backend, 3, false, true).Update == TlasUpdate::Rebuild);
+        CHECK(RunFrame(updater, backend, 3, false, true).Update == TlasUpdate::Refit);
+
+        // Added instances, or a count changed without the flag, rebuild
+        CHECK(RunFrame(updater, backend, 4, true, true).Update == TlasUpdate::Rebuild);
+        CHECK(RunFrame(updater, backend, 5, false, true).Update == TlasUpdate::Rebuild);
+        CHECK(backend.Builds.back().Source == nullptr && backend.Builds.back().Count == 5);
+
+        const auto& stats = updater.GetStats();
+        CHECK(stats.Rebuilds == 4);
+        CHECK(stats.Refits == 3);
+        CHECK(device.GetStats().UavBarriers == 7);
+        CHECK(device.GetStats().Copies == 3);
+    }
+
+    void TestFramesInFlight()
+    {
+        // The device runs two submissions behind: the TLAS of a frame not completed yet is never written again
+        constexpr uint32_t latency = 2;
+        NullDevice device(latency);
+        NullTlasBackend backend = {device, {}};
+        TlasUpdater<NullTlasBackend> updater;
+
+        std::vector<Frame> frames;
+        frames.push_back(RunFrame(updater, backend, 8, true, false));
+        for (auto i = 0u; i < 40; ++i)
+        {
+            frames.push_back(RunFrame(updater, backend, 8, false, true));
+            CHECK(frames.back().Update == TlasUpdate::Refit);
+
+            // Frames up to latency back are in flight and still read their TLAS, the new one is elsewhere
+            for (auto back = 1u; back <= latency && back < frames.size(); ++back)
+                CHECK(frames[frames.size() - 1 - back].Current != frames.back().Current);
+        }
+
+        // Completed buffers are reused instead of allocating one per frame
+        CHECK(updater.GetStats().Allocations <= latency + 2);
+        CHECK(updater.GetPooledCount() <= latency + 1);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestChoice);
+    RUN_TEST(TestRefitAndRebuild);
+    RUN_TEST(TestFramesInFlight);
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "Check.h"
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace
+{
+    struct Live
+    {
+        TlsfAllocation Allocation;
+        uint64_t End;
+    };
+
+    void CheckEmpty(const TlsfAllocator& allocator)
+    {
+        const auto stats = allocator.GetStats();
+        CHECK(allocator.IsEmpty());
+        CHECK(stats.UsedBytes == 0);
+        CHECK(stats.FreeBlockCount == 1);
+        CHECK(stats.LargestFreeBlock == allocator.GetCapacity());
+    }
+
+    // Random allocations and frees checked against an interval map of the live ranges: no overlap, aligned to the
+    // request and the granularity, inside the capacity. Freeing everything has to coalesce into the initial block.
+    void TestRandom(uint64_t granularity)
+    {
+        const auto capacity = 4096 * granularity;
+        TlsfAllocator allocator(capacity, granularity);
+        CheckEmpty(allocator);
+
+        std::mt19937 random(1234 + (uint32_t)granularity);
+        std::map<uint64_t, Live> live;
+        uint64_t usedBytes = 0;
+
+        const auto allocate = [&]()
+        {
+            const auto size = std::uniform_int_distribution<uint64_t>(1, capacity / 64)(random);
+            const auto alignment = 1ull << std::uniform_int_distribution<uint32_t>(0, 18)(random);
+            if (alignment > capacity)
+                return;
+
+            const auto allocation = allocator.Allocate(size, alignment);
+            if (allocation.Offset == TlsfAllocator::c_invalidOffset)
+                return;
+
+            const auto rounded = (size + granularity - 1) / granularity * granularity;
+            const auto end = allocation.Offset + rounded;
+            CHECK(allocation.Offset % alignment == 0);
+            CHECK(allocation.Offset % granularity == 0);
+            CHECK(end <= capacity);
+
+            const auto next = live.lower_bound(allocation.Offset);
+            CHECK(next == live.end() || next->first >= end);
+            CHECK(next == live.begin() || std::prev(next)->second.End <= allocation.Offset);
+            live.emplace(allocation.Offset, Live{allocation, end});
+            usedBytes += rounded;
+        };
+
+        const auto free = [&]()
+        {
+            auto it = live.begin();
+            std::advance(it, std::uniform_int_distribution<size_t>(0, live.size() - 1)(random));
+            allocator.Free(it->second.Allocation);
+            usedBytes -= it->second.End - it->first;
+            live.erase(it);
+        };
+
+        for (auto round = 0u; round < 4; ++round)
+        {
+            // Fill up to pressure with a bias towards allocating, then churn and drain
+            for (auto i = 0u; i < 20000; ++i)
+            {
+                if (live.empty() || std::uniform_int_distribution<uint32_t>(0, 99)(random) < 60)
+                    allocate();
+                else
+                    free();
+
+                CHECK(allocator.GetUsedBytes() == usedBytes);
+                CHECK(allocator.GetAllocationCount() == live.size());
+            }
+
+            const auto stats = allocator.GetStats();
+            CHECK(stats.LargestFreeBlock <= capacity - usedBytes);
+            // Free blocks never touch, every one is followed by a live allocation or the end
+            CHECK(stats.FreeBlockCount <= live.size() + 1);
+
+            while (!live.empty())
+                free();
+            CheckEmpty(allocator);
+        }
+
+        // Coalesced back to one block, the whole capacity fits again
+        const auto whole = allocator.Allocate(capacity);
+        CHECK(whole.Offset == 0);
+        CHECK(allocator.Allocate(1).Offset == TlsfAllocator::c_invalidOffset);
+        allocator.Free(whole);
+        CheckEmpty(allocator);
+    }
+
+    void TestGranularity1() { TestRandom(1); }
+    void TestGranularity256() { TestRandom(256); }
+    void TestGranularity64K() { TestRandom(64 * 1024); }
+
+    void TestNeighbourCoalescing()
+    {
+        // Freeing the middle last merges it with free blocks on both sides
+        TlsfAllocator allocator(1024, 256);
+        const auto a = allocator.Allocate(256);
+        const auto b = allocator.Allocate(256);
+        const auto c = allocator.Allocate(256);
+        CHECK(a.Offset != b.Offset && b.Offset != c.Offset && a.Offset != c.Offset);
+
+        allocator.Free(a);
+        allocator.Free(c);
+        CHECK(allocator.GetStats().FreeBlockCount == 2);
+        allocator.Free(b);
+        CheckEmpty(allocator);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestGranularity1);
+    RUN_TEST(TestGranularity256);
+    RUN_TEST(TestGranularity64K);
+    RUN_TEST(TestNeighbourCoalescing);
+    return 0;
+}
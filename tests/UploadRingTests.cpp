@@ -0,0 +1,140 @@
+#include "Check.h"
+#include "UploadRing.h"
+
+#include <deque>
+#include <random>
+
+namespace
+{
+    constexpr auto c_invalid = UploadRing::c_invalidOffset;
+
+    void TestAlignmentAndWrap()
+    {
+        UploadRing ring(1024);
+        CHECK(ring.Allocate(100, 256) == 0);
+        CHECK(ring.Allocate(100, 256) == 256);
+        CHECK(ring.Allocate(1025, 1) == c_invalid);
+        ring.Submit(1);
+
+        CHECK(ring.Allocate(400, 256) == 512);
+        ring.Submit(2);
+        CHECK(ring.GetUsed() == 912);
+
+        // The tail past 912 is too short, the allocation wraps to the start still held by submission 1
+        CHECK(ring.Allocate(200, 256) == c_invalid);
+        ring.Retire(1);
+        CHECK(ring.GetOldestSubmission() == 2);
+        CHECK(ring.Allocate(200, 256) == 0);
+        CHECK(ring.HasUnsubmitted());
+        ring.Submit(3);
+        CHECK(!ring.HasUnsubmitted());
+
+        // Drained rings restart at the beginning
+        ring.Retire(3);
+        CHECK(ring.GetOldestSubmission() == 0);
+        CHECK(ring.GetUsed() == 0);
+        CHECK(ring.Allocate(1024, 256) == 0);
+    }
+
+    void TestFrameSubmission()
+    {
+        // Constants of the frame being recorded stay untagged across submissions made meanwhile, here upload
+        // submission 4, and only retire with the frame's own submission 5
+        UploadRing ring(512);
+        CHECK(ring.Allocate(256, 256) == 0);
+        ring.Retire(4);
+        CHECK(ring.GetOldestSubmission() == 0);
+        CHECK(ring.Allocate(256, 256) == 256);
+        CHECK(ring.Allocate(1, 1) == c_invalid);
+
+        ring.Submit(5);
+        CHECK(ring.GetOldestSubmission() == 5);
+        ring.Retire(4);
+        CHECK(ring.GetUsed() == 512);
+        ring.Retire(5);
+        CHECK(ring.GetUsed() == 0);
+
+        // Nothing allocated, nothing tagged
+        ring.Submit(6);
+        CHECK(ring.GetOldestSubmission() == 0);
+    }
+
+    // Frames allocate random sizes with the device latency frames behind, live allocations of frames not completed
+    // yet must never overlap and a failing allocation has to succeed once the oldest frame retired
+    void TestFramesInFlight()
+    {
+        constexpr uint64_t capacity = 1 << 16;
+        constexpr uint64_t latency = 8;
+        UploadRing ring(capacity);
+        std::mt19937 random(7);
+
+        struct Live
+        {
+            uint64_t Begin;
+            uint64_t End;
+            uint64_t Submission;
+        };
+        std::deque<Live> live;
+
+        const auto overlaps = [&](uint64_t begin, uint64_t end)
+        {
+            for (const auto& allocation : live)
+            {
+                if (begin < allocation.End && allocation.Begin < end)
+                    return true;
+            }
+            return false;
+        };
+
+        uint64_t completed = 0;
+        uint32_t waits = 0;
+        for (uint64_t submission = 1; submission <= 2000; ++submission)
+        {
+            const auto count = std::uniform_int_distribution<uint32_t>(1, 16)(random);
+            for (auto i = 0u; i < count; ++i)
+            {
+                const auto size = std::uniform_int_distribution<uint64_t>(1, capacity / 32)(random);
+                const auto alignment = 1ull << std::uniform_int_distribution<uint32_t>(0, 8)(random);
+                auto offset = ring.Allocate(size, alignment);
+                while (offset == c_invalid)
+                {
+                    // Waiting for the oldest frame like Device::UploadData
+                    CHECK(ring.GetOldestSubmission() != 0 && ring.GetOldestSubmission() > completed);
+                    completed = ring.GetOldestSubmission();
+                    ring.Retire(completed);
+                    while (!live.empty() && live.front().Submission <= completed)
+                        live.pop_front();
+                    offset = ring.Allocate(size, alignment);
+                    ++waits;
+                }
+
+                CHECK(offset % alignment == 0);
+                CHECK(offset + size <= capacity);
+                CHECK(!overlaps(offset, offset + size));
+                live.push_back({offset, offset + size, submission});
+            }
+
+            ring.Submit(submission);
+            if (submission > latency && submission - latency > completed)
+            {
+                completed = submission - latency;
+                ring.Retire(completed);
+                while (!live.empty() && live.front().Submission <= completed)
+                    live.pop_front();
+            }
+            CHECK(ring.GetUsed() <= capacity);
+        }
+        CHECK(waits > 0);
+
+        ring.Retire(2000);
+        CHECK(ring.GetUsed() == 0);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestAlignmentAndWrap);
+    RUN_TEST(TestFrameSubmission);
+    RUN_TEST(TestFramesInFlight);
+    return 0;
+}